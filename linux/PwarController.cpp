@@ -3,13 +3,15 @@
 #include <cstring>
 #include <QProcess>
 #include <QStandardPaths>
+#include <QStringList>
+#include "pwar_rt.h"
 
 PwarController::PwarController(QObject *parent) 
     : QObject(parent), m_status("Ready"), m_initialized(false),
       m_audioProcMinMs(0.0), m_audioProcMaxMs(0.0), m_audioProcAvgMs(0.0),
       m_jitterMinMs(0.0), m_jitterMaxMs(0.0), m_jitterAvgMs(0.0),
       m_rttMinMs(0.0), m_rttMaxMs(0.0), m_rttAvgMs(0.0),
-      m_xruns(0), m_currentWindowsBufferSize(0) {
+      m_xruns(0), m_lockInMs(0.0), m_lostSegments(0), m_recoveredSegments(0), m_recordDroppedBlocks(0), m_currentWindowsBufferSize(0) {
     
     // Initialize QSettings with organization and application name
     m_settings = new QSettings("PWAR", "PwarController", this);
@@ -19,7 +21,29 @@ PwarController::PwarController(QObject *parent)
     m_config.stream_port = 8321;
     m_config.passthrough_test = 0;
     m_config.oneshot_mode = 0;
+    m_config.pipeline_depth = 0; // From the peer's profile, ping-pong without one
     m_config.buffer_size = 64;
+    m_config.peer_timeout_ms = 0;
+    m_config.watchdog_ms = 0;
+    m_config.watchdog_action = PWAR_WATCHDOG_ACTION_NONE;
+    m_config.record = 0;
+    memset(m_config.threads, 0, sizeof(m_config.threads)); // Built-in scheduling, nothing pinned
+    m_config.num_remotes = 0; // The GUI drives a single remote
+    memset(m_config.remotes, 0, sizeof(m_config.remotes));
+    m_config.receive_workers = 0;
+    m_config.bind_ip[0] = '\0';
+    memset(&m_config.redundant_path, 0, sizeof(m_config.redundant_path)); // No second path from the GUI
+    m_config.driver = 0;
+    m_config.direction = PWAR_DIRECTION_DUPLEX;
+    m_config.pm_qos = 0;
+    m_config.pm_qos_us = 0;
+    m_config.udp_offload = 0;
+    m_config.xdp_ifname[0] = '\0'; // Socket only, AF_XDP needs root and the interface's queue steering
+    m_config.xdp_queue = 0;
+    m_config.xdp_busy_poll = 0;
+    strncpy(m_config.record_dir, QStandardPaths::writableLocation(QStandardPaths::MusicLocation).toUtf8().constData(),
+            sizeof(m_config.record_dir) - 1);
+    m_config.record_dir[sizeof(m_config.record_dir) - 1] = '\0';
     
     // Populate port lists
     updateInputPorts();
@@ -123,6 +147,47 @@ void PwarController::setBufferSize(int size) {
     }
 }
 
+bool PwarController::recording() const {
+    // While stopped the checkbox means "record on start"
+    return pwar_is_running() ? pwar_is_recording() : m_config.record != 0;
+}
+
+void PwarController::setRecording(bool enabled) {
+    if (recording() == enabled) {
+        return;
+    }
+    // Remember the choice so the next start records too
+    m_config.record = enabled;
+    if (pwar_is_running()) {
+        if (enabled) {
+            if (pwar_recording_start(m_config.record_dir) != 0) {
+                m_config.record = 0;
+                setStatus("Failed to start recording");
+            }
+        } else {
+            pwar_recording_stop();
+        }
+    }
+    emit recordingChanged();
+}
+
+QString PwarController::recordDirectory() const {
+    return QString(m_config.record_dir);
+}
+
+void PwarController::setRecordDirectory(const QString &dir) {
+    QByteArray dirBytes = dir.toUtf8();
+    if (strcmp(m_config.record_dir, dirBytes.constData()) != 0) {
+        strncpy(m_config.record_dir, dirBytes.constData(), sizeof(m_config.record_dir) - 1);
+        m_config.record_dir[sizeof(m_config.record_dir) - 1] = '\0';
+        emit recordDirectoryChanged();
+    }
+}
+
+uint32_t PwarController::recordDroppedBlocks() const {
+    return m_recordDroppedBlocks;
+}
+
 QStringList PwarController::outputPorts() const {
     return m_outputPorts;
 }
@@ -211,6 +276,7 @@ void PwarController::start() {
     if (pwar_start() == 0) {
         setStatus("Running");
         emit isRunningChanged();
+        emit recordingChanged();
         
         // Start latency metrics timer
         m_latencyUpdateTimer->start();
@@ -230,6 +296,7 @@ void PwarController::stop() {
         unlinkAudioPorts();
         setStatus("Stopped");
         emit isRunningChanged();
+        emit recordingChanged();
     } else {
         setStatus("Failed to stop");
     }
@@ -241,7 +308,9 @@ void PwarController::applyRuntimeConfig() {
     }
     
     int result = pwar_update_config(&m_config);
-    (void)result;
+    if (result == -2 && pwar_is_running()) {
+        setStatus("Settings changed - stop and start to apply");
+    }
 }
 
 void PwarController::loadSettings() {
@@ -261,6 +330,10 @@ void PwarController::loadSettings() {
     
     int savedBufferSize = m_settings->value("audio/bufferSize", m_config.buffer_size).toInt();
     setBufferSize(savedBufferSize);
+
+    // Load recording settings
+    QString savedRecordDir = m_settings->value("recording/directory", recordDirectory()).toString();
+    setRecordDirectory(savedRecordDir);
     
     // Load port selections
     m_selectedInputPort = m_settings->value("audio/selectedInputPort", "").toString();
@@ -284,6 +357,9 @@ void PwarController::saveSettings() {
     m_settings->setValue("audio/passthroughTest", passthroughTest());
     m_settings->setValue("audio/oneshotMode", oneshotMode());
     m_settings->setValue("audio/bufferSize", bufferSize());
+
+    // Save recording settings
+    m_settings->setValue("recording/directory", recordDirectory());
     
     // Save port selections
     m_settings->setValue("audio/selectedInputPort", m_selectedInputPort);
@@ -409,6 +485,22 @@ uint32_t PwarController::xruns() const {
     return m_xruns;
 }
 
+double PwarController::lockInMs() const {
+    return m_lockInMs;
+}
+
+uint32_t PwarController::lostSegments() const {
+    return m_lostSegments;
+}
+
+uint32_t PwarController::recoveredSegments() const {
+    return m_recoveredSegments;
+}
+
+QString PwarController::threadStatus() const {
+    return m_threadStatus;
+}
+
 int PwarController::currentWindowsBufferSize() const {
     return m_currentWindowsBufferSize;
 }
@@ -477,6 +569,45 @@ void PwarController::updateLatencyMetrics() {
         }
     }
     
+    if (m_lockInMs != metrics.lock_in_ms) {
+        m_lockInMs = metrics.lock_in_ms;
+        changed = true;
+    }
+
+    if (m_lostSegments != metrics.lost_segments) {
+        m_lostSegments = metrics.lost_segments;
+        changed = true;
+    }
+
+    if (m_recoveredSegments != metrics.recovered_segments) {
+        m_recoveredSegments = metrics.recovered_segments;
+        changed = true;
+    }
+
+    // Effective scheduling of every running thread, one per line
+    pwar_thread_status_t threads[PWAR_THREAD_COUNT];
+    QStringList threadLines;
+    int threadCount = pwar_get_thread_status(threads, PWAR_THREAD_COUNT);
+    for (int i = 0; i < threadCount; ++i) {
+        if (!threads[i].applied) continue;
+        char line[192];
+        pwar_rt_describe(&threads[i], line, sizeof(line));
+        threadLines << QString::fromUtf8(line);
+    }
+    QString threadStatus = threadLines.join("\n");
+    if (m_threadStatus != threadStatus) {
+        m_threadStatus = threadStatus;
+        changed = true;
+    }
+
+    // Update recording drops
+    pwar_recording_stats_t recordingStats;
+    pwar_get_recording_stats(&recordingStats);
+    if (m_recordDroppedBlocks != recordingStats.blocks_dropped) {
+        m_recordDroppedBlocks = recordingStats.blocks_dropped;
+        changed = true;
+    }
+
     // Update current Windows buffer size
     uint32_t currentBufferSize = pwar_get_current_windows_buffer_size();
     if (m_currentWindowsBufferSize != (int)currentBufferSize) {
@@ -13,6 +13,9 @@ class PwarController : public QObject {
     Q_PROPERTY(bool passthroughTest READ passthroughTest WRITE setPassthroughTest NOTIFY passthroughTestChanged)
     Q_PROPERTY(bool oneshotMode READ oneshotMode WRITE setOneshotMode NOTIFY oneshotModeChanged)
     Q_PROPERTY(int bufferSize READ bufferSize WRITE setBufferSize NOTIFY bufferSizeChanged)
+    Q_PROPERTY(bool recording READ recording WRITE setRecording NOTIFY recordingChanged)
+    Q_PROPERTY(QString recordDirectory READ recordDirectory WRITE setRecordDirectory NOTIFY recordDirectoryChanged)
+    Q_PROPERTY(uint32_t recordDroppedBlocks READ recordDroppedBlocks NOTIFY latencyMetricsChanged)
     Q_PROPERTY(QStringList outputPorts READ outputPorts NOTIFY outputPortsChanged)
     Q_PROPERTY(QStringList inputPorts READ inputPorts NOTIFY inputPortsChanged)
     Q_PROPERTY(QString selectedInputPort READ selectedInputPort WRITE setSelectedInputPort NOTIFY selectedInputPortChanged)
@@ -30,6 +33,10 @@ class PwarController : public QObject {
     Q_PROPERTY(double rttMaxMs READ rttMaxMs NOTIFY latencyMetricsChanged)
     Q_PROPERTY(double rttAvgMs READ rttAvgMs NOTIFY latencyMetricsChanged)
     Q_PROPERTY(uint32_t xruns READ xruns NOTIFY latencyMetricsChanged)
+    Q_PROPERTY(double lockInMs READ lockInMs NOTIFY latencyMetricsChanged)
+    Q_PROPERTY(uint32_t lostSegments READ lostSegments NOTIFY latencyMetricsChanged)
+    Q_PROPERTY(uint32_t recoveredSegments READ recoveredSegments NOTIFY latencyMetricsChanged)
+    Q_PROPERTY(QString threadStatus READ threadStatus NOTIFY latencyMetricsChanged)
     
     // Current Windows buffer size property
     Q_PROPERTY(int currentWindowsBufferSize READ currentWindowsBufferSize NOTIFY currentWindowsBufferSizeChanged)
@@ -52,6 +59,11 @@ public:
     void setOneshotMode(bool enabled);
     int bufferSize() const;
     void setBufferSize(int size);
+    bool recording() const;
+    void setRecording(bool enabled);
+    QString recordDirectory() const;
+    void setRecordDirectory(const QString &dir);
+    uint32_t recordDroppedBlocks() const;
 
     QStringList outputPorts() const;
     QStringList inputPorts() const;
@@ -81,6 +93,10 @@ public:
     double rttMaxMs() const;
     double rttAvgMs() const;
     uint32_t xruns() const;
+    double lockInMs() const;
+    uint32_t lostSegments() const;
+    uint32_t recoveredSegments() const;
+    QString threadStatus() const;
     
     // Current Windows buffer size getter
     int currentWindowsBufferSize() const;
@@ -95,6 +111,8 @@ signals:
     void passthroughTestChanged();
     void oneshotModeChanged();
     void bufferSizeChanged();
+    void recordingChanged();
+    void recordDirectoryChanged();
     void outputPortsChanged();
     void inputPortsChanged();
     void selectedInputPortChanged();
@@ -129,6 +147,11 @@ private:
     double m_rttMaxMs;
     double m_rttAvgMs;
     uint32_t m_xruns;
+    double m_lockInMs;
+    uint32_t m_lostSegments;
+    uint32_t m_recoveredSegments;
+    QString m_threadStatus;
+    uint32_t m_recordDroppedBlocks;
     QTimer *m_latencyUpdateTimer;
     
     // Current Windows buffer size
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include "libpwar.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -17,20 +18,66 @@
 #include <pipewire/filter.h>
 
 #include "latency_manager.h"
+#include "pwar_recorder.h"
+#include "pwar_profile.h"
+#include "pwar_watchdog.h"
+#include "pwar_rt.h"
+#include "pwar_shard.h"
+#include "pwar_rt_check.h"
+#include "pwar_pm_qos.h"
+#include "pwar_offload.h"
 
 #include "pwar_packet.h"
 #include "pwar_router.h"
 #include "pwar_rcv_buffer.h"
+#include "pwar_slot_ring.h"
+#include "pwar_fanout.h"
+#include "pwar_session.h"
+#include "pwar_atomic.h"
+#include "pwar_clock.h"
+#include "pwar_paths.h"
+#include "pwar_retransmit.h"
+#include "pwar_driver_clock.h"
 
 #define DEFAULT_STREAM_IP "192.168.66.3"
 #define DEFAULT_STREAM_PORT 8321
 
 #define MAX_BUFFER_SIZE 4096
+#define MAX_SEGMENTS (MAX_BUFFER_SIZE / PWAR_PACKET_MIN_CHUNK_SIZE) // Oneshot segments per cycle
 #define NUM_CHANNELS 2
+#define SAMPLE_RATE 48000
+#define RECV_TIMEOUT_US 5000 // Receiver wakes at least this often to drive the session
+#define WARMUP_LOCK_CYCLES 8 // Consecutive cycles with a valid return before audio is unmuted
+#define WARMUP_TIMEOUT_NS 2000000000ULL // Unmute anyway if the return stream never settles
+#define WARMUP_WARM_LOCK_CYCLES 2 // With a fresh profile the peer is known, a short lock-in only checks alignment
+#define WARMUP_WARM_TIMEOUT_NS 500000000ULL
+#define RECEIVER_DEFAULT_PRIORITY 90 // SCHED_FIFO unless configured otherwise
+#define BACKLOG_SLACK_BLOCKS 2 // Blocks a return may be later than its pipeline before it is stale
+#define BACKLOG_MIN_STALE_NS 10000000ULL // Never stale sooner than this, whatever the block size
+#define RCVBUF_HEADROOM_BLOCKS 8 // Blocks the receive buffer holds beyond the pipeline
+#define RCVBUF_MIN_BYTES (64 * 1024)
+#define RCVBUF_MAX_BYTES (8 * 1024 * 1024)
+#define PATH_REPORT_NS 1000000000ULL // How often the path carrying the stream is looked at
+#define ONESHOT_MIN_WAIT_NS 2000000ULL // Oneshot waits this long for the answer, or half the quantum if that is longer
+#define DRIVER_PRIORITY "30000" // Above sound cards, so the graph picks PWAR as its driver
+#define DRIVER_IDLE_PERIODS 2 // Periods without a return before the driver runs cycles on its own timer
+#define RECEIVER_STOP_WAIT_MS 1000 // A restart gives a stalled receiver this long to notice the stop request
+
+enum {
+    WARMUP_RUNNING = 0, // Priming the remote with silence, output muted, nothing counted
+    WARMUP_LOCKED,      // Return stream aligned, audio and statistics live
+    WARMUP_GAVE_UP      // Did not settle in time, live anyway so problems show as xruns
+};
+
+// Receive threads stop on their own after the next bounded receive, they are never cancelled
+enum {
+    RECV_RUN = 0,
+    RECV_STOP_REQUESTED, // Withdrawn again if the thread does not take it in time
+    RECV_STOPPING        // Taken by the thread, it is leaving
+};
 
 // Global data for GUI mode
 static struct data *g_pwar_data = NULL;
-static pthread_t g_recv_thread;
 static int g_pwar_initialized = 0;
 static int g_pwar_running = 0;
 static pwar_config_t g_current_config;
@@ -41,6 +88,31 @@ struct port {
     struct data *data;
 };
 
+// One remote host when fanning out, owned by the receiver thread
+struct remote_link {
+    struct sockaddr_in addr;          // Where its stream and session messages go
+    struct sockaddr_in source;        // Where its answers come from, learned from its session messages
+    int source_known;
+    pwar_session_t session;
+    uint32_t last_state;
+    uint32_t stream_session_id;       // Session and generation its slot ring belongs to
+    uint32_t stream_generation;
+    uint32_t worker;                  // Receive worker that owns it
+};
+
+// Receive workers past the first one, which is the receiver thread
+struct receive_worker {
+    struct data *data;
+    uint32_t index;
+    int sockfd;                       // Shares the receive port, the kernel steers its remotes to it
+    pwar_offload_rx_t rx;             // Reads of sockfd
+    pthread_t thread;
+    int alive;
+    volatile uint32_t stop;           // RECV_*
+    uint32_t flush_seen;
+    uint32_t rcvbuf_bytes;            // Receive buffer size last asked for
+};
+
 struct data {
     struct pw_main_loop *loop;
     struct pw_filter *filter;
@@ -50,28 +122,116 @@ struct data {
     float sine_phase;
     uint8_t passthrough_test; // Add passthrough_test flag
     uint8_t oneshot_mode; // Add oneshot_mode flag
+    uint8_t pipeline_depth; // Blocks in flight when not in oneshot mode, 1 = ping-pong
     uint32_t seq;
     int sockfd;
     struct sockaddr_in servaddr;
     int recv_sockfd;
+    pwar_offload_rx_t recv_rx;            // Reads of recv_sockfd, coalesced with UDP offload
+    pwar_xdp_t xdp;                       // AF_XDP ring recv_rx reads first, inactive = socket only
+
+    // Redundant paths, path 0 is sockfd to servaddr. Every audio datagram goes over each
+    uint32_t num_paths;
+    int path_sockfd[PWAR_PATHS_MAX];
+    struct sockaddr_in path_addr[PWAR_PATHS_MAX];
+    pwar_offload_tx_t path_tx[PWAR_PATHS_MAX]; // Audio thread, sends on path_sockfd
+    pwar_packet_t send_segments[MAX_SEGMENTS]; // Audio thread, the segments of a cycle back to back
+    volatile uint32_t path_send_failing;  // Audio thread, bit per path whose last send failed
+    volatile uint32_t path_send_errno[PWAR_PATHS_MAX]; // Audio thread, why a path started failing
+    uint32_t path_send_failing_seen;      // Receiver thread copy of path_send_failing
+    pwar_paths_t paths;                   // Returns, owned by the receiver thread
+    uint32_t path_first_seen[PWAR_PATHS_MAX]; // Receiver thread, first copies at the last report
+    uint64_t path_report_ns;
+    volatile uint32_t path_leader;        // Path that delivered most returns lately
 
     pthread_mutex_t packet_mutex;
     pthread_cond_t packet_cond;
-    pwar_packet_t latest_packet;
+    float oneshot_return[NUM_CHANNELS * MAX_BUFFER_SIZE]; // Reassembled oneshot answer, channel-major
+    uint32_t oneshot_samples;             // Samples per channel in oneshot_return
+    uint32_t oneshot_seq;                 // Sequence of the first segment it answers
     int packet_available;
 
+    // Driver mode, PWAR drives the graph. Input is sent like in oneshot mode, the answer starts the next cycle
+    uint8_t driver;
+    uint32_t driver_quantum;              // Cycle length, the configured buffer size
+    uint32_t driver_seq;                  // Audio thread, sequence the next answer has to carry
+    pwar_driver_clock_t driver_clock;     // Audio thread
+    volatile uint32_t driving;            // The filter is connected and may be triggered
+    volatile uint32_t triggering;         // Receiver thread, between seeing driving and triggering the filter
+    volatile uint32_t driver_triggers;    // Cycles started by returns
+    uint32_t driver_triggers_seen;        // Main loop copy of driver_triggers
+    uint32_t driver_idle_periods;         // Main loop, timer periods without a return
+    struct spa_source *driver_timer;      // Main loop, runs cycles while the remote does not
+    uint8_t direction;                    // pwar_direction_t, half-duplex leaves one direction out
+
     pwar_router_t linux_router;
     pthread_mutex_t pwar_rcv_mutex; // Mutex for receive buffer
+    pwar_slot_ring_t slot_ring;     // Returned chunks by sequence, pipeline depth 2 and up
+    pwar_nack_tracker_t nacks;      // Pipelined returns asked for again, owned by the receiver thread
 
     uint32_t current_windows_buffer_size; // Current Windows buffer size in samples
+
+    pwar_session_t session;               // Owned by the receiver thread
+    volatile uint32_t requested_block_size; // Set by the audio thread when the quantum changes
+    volatile uint32_t seq_resync;         // Bumped by the receiver thread when a new stream starts
+    uint32_t seq_resync_seen;             // Audio thread copy of seq_resync
+    uint32_t stream_session_id;           // Session and generation the stream state belongs to
+    uint32_t stream_generation;
+
+    pthread_t recv_thread;
+    int recv_thread_alive;                // Cleared once a restart has joined the old thread
+    volatile uint32_t recv_stop;          // RECV_*, for the receiver thread
+    int watchdog_enabled;
+    pwar_watchdog_t watchdog;
+    volatile uint32_t flush_requested;    // Bumped by the watchdog, the receiver thread flushes
+    uint32_t flush_seen;                  // Receiver thread copy of flush_requested
+    uint32_t rcvbuf_bytes;                // Receiver thread, receive buffer size last asked for
+
+    // Warm-up at stream start, driven by the audio thread
+    volatile uint32_t warmup_state;       // WARMUP_*
+    uint32_t warmup_state_seen;           // Receiver thread copy of warmup_state
+    uint32_t warmup_good_cycles;          // Consecutive cycles with a valid return
+    uint32_t warmup_lock_cycles;          // Good cycles needed to lock in, fewer after a warm start
+    uint64_t warmup_timeout_ns;
+    uint64_t warmup_start_ns;             // First cycle of the warm-up, 0 = not started
+    volatile uint32_t lock_in_us;         // Time the last warm-up took
+    volatile uint32_t silent_cycles;      // Audio thread, cycles played as silence after the warm-up
+    volatile uint32_t silent_seq;         // Audio thread, sequence of the last return that was missing
+    uint32_t silent_cycles_seen;          // Receiver thread copy of silent_cycles
+    volatile uint32_t unsendable_quantum; // Audio thread, quantum too large to send in this mode, 0 = none
+    uint32_t unsendable_quantum_seen;     // Receiver thread copy of unsendable_quantum
+
+    // Scheduling and affinity, every status slot has a single writer
+    pwar_thread_config_t threads[PWAR_THREAD_COUNT];
+    uint32_t rt_buffer_size;              // Quantum the SCHED_DEADLINE periods follow outside the audio thread
+    pwar_thread_status_t thread_status[PWAR_THREAD_COUNT];
+    volatile uint32_t thread_status_seq[PWAR_THREAD_COUNT]; // Odd while a status is written
+    uint32_t audio_rt_quantum;            // Audio thread, quantum its settings were applied for, 0 = not yet
+    uint32_t audio_status_seen;           // Receiver thread copy of the audio status sequence
+    pwar_pm_qos_t pm_qos;                 // CPU wake-up latency limit, held while running
+
+    // Fan-out to several remotes, NULL with a single remote
+    pwar_fanout_t *fanout;
+    struct remote_link *links;
+    uint32_t num_links;
+    struct port *group_in_ports[PWAR_FANOUT_MAX_CHANNELS];
+    struct port *group_out_ports[PWAR_FANOUT_MAX_CHANNELS];
+    uint32_t num_workers;                 // Receive threads, every one owns every num_workers-th link
+    struct receive_worker workers[PWAR_MAX_RECEIVE_WORKERS];
+    pthread_mutex_t steer_mutex;          // Serializes steering updates from the workers
+    uint32_t fanout_active_seen;          // Audio thread, links that streamed last cycle
+    volatile uint32_t link_send_failing;  // Audio thread, bit per link whose last send failed
+    volatile uint32_t link_send_errno[PWAR_FANOUT_MAX_HOSTS]; // Audio thread, why a link started failing
+    uint32_t link_send_failing_seen;      // Receiver thread copy of link_send_failing
+    volatile uint32_t fanout_delay;       // Cycles from sending to playing, the slowest host's pipeline delay
 };
 
-static void setup_recv_socket(struct data *data, int port);
+static int open_recv_socket(int port, int shared);
 static void *receiver_thread(void *userdata);
 
-static void setup_socket(struct data *data, const char *ip, int port);
+static void setup_socket(struct data *data, const char *ip, int port, const char *bind_ip);
 
-static void stream_buffer(float *samples, uint32_t n_samples, void *userdata);
+static uint32_t stream_buffer(float *samples, uint32_t n_samples, void *userdata);
 static void on_process(void *userdata, struct spa_io_position *position);
 static void do_quit(void *userdata, int signal_number);
 
@@ -88,137 +248,1067 @@ int pwar_stop(void);
 void pwar_cleanup(void);
 int pwar_is_running(void);
 
-static void setup_recv_socket(struct data *data, int port) {
-    data->recv_sockfd = socket(AF_INET, SOCK_DGRAM, 0);
-    if (data->recv_sockfd < 0) {
+// shared lets the receive workers bind the same port, in the order of their index
+static int open_recv_socket(int port, int shared) {
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sockfd < 0) {
         perror("recv socket creation failed");
         exit(EXIT_FAILURE);
     }
-    // Increase UDP receive buffer to 1MB to reduce risk of overrun
-    int rcvbuf = 1024 * 1024;
-    if (setsockopt(data->recv_sockfd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf)) < 0) {
-        perror("setsockopt SO_RCVBUF failed");
+    // Wake up regularly even without traffic, the session needs retries and timeouts
+    struct timeval tv = { .tv_sec = 0, .tv_usec = RECV_TIMEOUT_US };
+    if (setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0) {
+        perror("setsockopt SO_RCVTIMEO failed");
+    }
+    if (shared && pwar_shard_join(sockfd) < 0) {
+        perror("setsockopt SO_REUSEPORT failed");
+        exit(EXIT_FAILURE);
     }
     struct sockaddr_in recv_addr;
     memset(&recv_addr, 0, sizeof(recv_addr));
     recv_addr.sin_family = AF_INET;
     recv_addr.sin_addr.s_addr = INADDR_ANY;
     recv_addr.sin_port = htons(port);
-    if (bind(data->recv_sockfd, (struct sockaddr *)&recv_addr, sizeof(recv_addr)) < 0) {
+    if (bind(sockfd, (struct sockaddr *)&recv_addr, sizeof(recv_addr)) < 0) {
         perror("recv socket bind failed");
         exit(EXIT_FAILURE);
     }
+    return sockfd;
 }
 
-static void *receiver_thread(void *userdata) {
-    // Set real-time scheduling to minimize jitter
-    struct sched_param sp = { .sched_priority = 90 };
-    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp) != 0) {
-        perror("Warning: Failed to set SCHED_FIFO for receiver_thread");
+static void send_session_message_to(struct data *data, const struct sockaddr_in *addr, const pwar_session_msg_t *msg) {
+    if (sendto(data->sockfd, msg, sizeof(*msg), 0, (const struct sockaddr *)addr, sizeof(*addr)) < 0) {
+        perror("sendto session message failed");
+    }
+}
+
+static void send_session_message(struct data *data, const pwar_session_msg_t *msg) {
+    send_session_message_to(data, &data->servaddr, msg);
+}
+
+static int same_addr(const struct sockaddr_in *a, const struct sockaddr_in *b) {
+    return a->sin_addr.s_addr == b->sin_addr.s_addr && a->sin_port == b->sin_port;
+}
+
+/*
+ * Which of its remotes a datagram reaching a worker came from. Session messages
+ * carry the session id of their link, everything else is told apart by its source
+ * address: the configured one, the one learned from session messages, or the IP
+ * alone if it is unique. Links of other workers are never touched.
+ */
+static int find_link(struct data *data, uint32_t worker, const pwar_session_msg_t *msg, const struct sockaddr_in *from) {
+    if (msg && msg->session_id) {
+        for (uint32_t i = 0; i < data->num_links; ++i) {
+            if (data->links[i].worker == worker && data->links[i].session.session_id == msg->session_id) return (int)i;
+        }
+    }
+    for (uint32_t i = 0; i < data->num_links; ++i) {
+        const struct remote_link *link = &data->links[i];
+        if (link->worker != worker) continue;
+        if (same_addr(&link->addr, from) || (link->source_known && same_addr(&link->source, from))) return (int)i;
+    }
+    int found = -1;
+    for (uint32_t i = 0; i < data->num_links; ++i) {
+        if (data->links[i].addr.sin_addr.s_addr != from->sin_addr.s_addr) continue;
+        if (found >= 0 || data->links[i].worker != worker) return -1;
+        found = (int)i;
+    }
+    return found;
+}
+
+/*
+ * Tells the kernel which worker each remote's datagrams go to. Runs whenever a
+ * worker starts its sessions or learns where a remote sends from. Both happen
+ * under steer_mutex, so the other workers' links can be read here.
+ */
+static void update_steering(struct data *data) {
+    pwar_shard_route_t routes[PWAR_SHARD_MAX_ROUTES];
+    uint32_t n = 0;
+    if (data->num_workers < 2) return;
+    pthread_mutex_lock(&data->steer_mutex);
+    for (uint32_t i = 0; i < data->num_links && n + 2 <= PWAR_SHARD_MAX_ROUTES; ++i) {
+        const struct remote_link *link = &data->links[i];
+        pwar_shard_route_t *route = &routes[n++];
+        memset(route, 0, sizeof(*route));
+        route->worker = (uint16_t)link->worker;
+        route->session_id = link->session.session_id;
+        if (link->source_known) {
+            route->ip = link->source.sin_addr.s_addr;
+            route->port = link->source.sin_port;
+        }
+        // The IP alone only tells remotes of different workers apart
+        int unique = 1;
+        for (uint32_t j = 0; j < data->num_links; ++j) {
+            if (data->links[j].addr.sin_addr.s_addr == link->addr.sin_addr.s_addr && data->links[j].worker != link->worker) unique = 0;
+        }
+        if (unique) {
+            route = &routes[n++];
+            memset(route, 0, sizeof(*route));
+            route->worker = (uint16_t)link->worker;
+            route->ip = link->addr.sin_addr.s_addr;
+        }
+    }
+    if (pwar_shard_steer(data->recv_sockfd, routes, n) < 0) {
+        perror("setsockopt SO_ATTACH_REUSEPORT_CBPF failed");
+    }
+    pthread_mutex_unlock(&data->steer_mutex);
+}
+
+static void handle_session_datagram(struct data *data, uint32_t worker, const pwar_session_msg_t *msg, const struct sockaddr_in *from) {
+    pwar_session_msg_t reply;
+    if (!data->fanout) {
+        if (pwar_session_handle_message(&data->session, msg, latency_manager_timestamp_now(), &reply)) {
+            send_session_message(data, &reply);
+        }
+        return;
+    }
+    int index = find_link(data, worker, msg, from);
+    if (index < 0) return;
+    struct remote_link *link = &data->links[index];
+    if (!link->source_known || !same_addr(&link->source, from)) {
+        pthread_mutex_lock(&data->steer_mutex);
+        link->source = *from;
+        link->source_known = 1;
+        pthread_mutex_unlock(&data->steer_mutex);
+        update_steering(data);
+    }
+    if (pwar_session_handle_message(&link->session, msg, latency_manager_timestamp_now(), &reply)) {
+        send_session_message_to(data, &link->addr, &reply);
+    }
+}
+
+// Forget partially routed and buffered audio, runs on the receiver thread
+static void flush_stream(struct data *data) {
+    pwar_router_init(&data->linux_router, NUM_CHANNELS);
+    pwar_paths_reset(&data->paths);
+    pwar_slot_ring_reset(&data->slot_ring);
+    pwar_nack_tracker_reset(&data->nacks);
+    pthread_mutex_lock(&data->pwar_rcv_mutex);
+    pwar_rcv_buffer_reset();
+    pthread_mutex_unlock(&data->pwar_rcv_mutex);
+    pthread_mutex_lock(&data->packet_mutex);
+    data->packet_available = 0;
+    pthread_mutex_unlock(&data->packet_mutex);
+}
+
+// A new session generation starts from clean stream state on both ends
+static void reset_stream(struct data *data) {
+    flush_stream(data);
+    // The audio thread restarts its sequence numbers on the next cycle
+    pwar_atomic_fetch_add_u32(&data->seq_resync, 1);
+}
+
+// After a stall the socket holds audio nobody is waiting for anymore, every worker flushes its own
+static void flush_stale_state(struct data *data, uint32_t worker, pwar_offload_rx_t *rx) {
+    char drain[sizeof(pwar_packet_t)];
+    uint32_t dropped = 0;
+    ssize_t n;
+    struct sockaddr_in from;
+    while ((n = pwar_offload_recv(rx, drain, sizeof(drain), MSG_DONTWAIT, &from)) >= 0) {
+        if (n == (ssize_t)sizeof(pwar_session_msg_t) && pwar_session_is_message(drain, (uint32_t)n)) {
+            handle_session_datagram(data, worker, (pwar_session_msg_t *)drain, &from);
+        } else {
+            dropped++;
+        }
+    }
+    if (worker == 0) {
+        flush_stream(data);
+    }
+    for (uint32_t i = 0; i < data->num_links; ++i) {
+        if (data->links[i].worker == worker) pwar_fanout_reset_host(data->fanout, i);
+    }
+    printf("[PWAR]: Flushed stale stream state, %u queued datagrams dropped\n", dropped);
+}
+
+/*
+ * Cycles between sending a chunk and playing its return when pipelined. A remote
+ * block spans several of our cycles, so every block in flight costs that many.
+ */
+static uint32_t delay_cycles(uint32_t depth, uint32_t remote_block, uint32_t n_samples) {
+    uint32_t cycles_per_block = n_samples && remote_block > n_samples ? remote_block / n_samples : 1;
+    uint32_t delay = depth * cycles_per_block;
+    return delay > PWAR_SLOT_RING_MAX_DELAY ? PWAR_SLOT_RING_MAX_DELAY : delay;
+}
+
+static uint32_t pipeline_delay_cycles(struct data *data, uint32_t n_samples) {
+    uint32_t remote_block = data->session.negotiated.remote_block_size;
+    if (!remote_block) remote_block = data->current_windows_buffer_size;
+    return delay_cycles(data->pipeline_depth, remote_block, n_samples);
+}
+
+static void report_session_state(struct data *data, uint32_t *last_state) {
+    uint32_t state = pwar_atomic_load_acquire_u32(&data->session.state);
+    if (state == PWAR_SESSION_STATE_ESTABLISHED &&
+        (data->session.session_id != data->stream_session_id || data->session.generation != data->stream_generation)) {
+        data->stream_session_id = data->session.session_id;
+        data->stream_generation = data->session.generation;
+        reset_stream(data);
+    }
+    if (state == *last_state) return;
+    uint32_t previous = *last_state;
+    *last_state = state;
+    if (!pwar_session_audio_allowed(&data->session)) {
+        // Silence is expected until audio flows again
+        pwar_watchdog_disarm(&data->watchdog, PWAR_WATCHDOG_BEAT_PACKET);
+    }
+    if (state == PWAR_SESSION_STATE_PEER_LOST) {
+        printf("\033[0;31m[PWAR]: Remote silent for %llums, holding audio until it returns\033[0m\n",
+               (unsigned long long)(data->session.liveness_timeout_ns / 1000000));
+    } else if (state == PWAR_SESSION_STATE_ESTABLISHED && previous == PWAR_SESSION_STATE_PEER_LOST) {
+        printf("[PWAR]: Remote is back, session resumed (generation %u)\n", data->session.generation);
     }
+    if (state == PWAR_SESSION_STATE_ESTABLISHED) {
+        const pwar_session_params_t *p = &data->session.negotiated;
+        printf("[PWAR]: Session %08x.%u established: v%u, %u Hz, block %u/%u, channels %u/%u, format 0x%x, features 0x%x\n",
+               data->session.session_id, data->session.generation, data->session.version, p->sample_rate,
+               p->linux_block_size, p->remote_block_size, p->send_channels, p->return_channels,
+               p->sample_formats, p->features);
+        if (p->remote_block_size) {
+            data->current_windows_buffer_size = p->remote_block_size;
+        }
+        if (!data->oneshot_mode && data->pipeline_depth > 1) {
+            uint32_t delay = pipeline_delay_cycles(data, p->linux_block_size);
+            printf("[PWAR]: Pipeline depth %u, audio returns %u cycles (%.2f ms) after it was sent\n", data->pipeline_depth,
+                   delay, delay * p->linux_block_size * 1000.0 / SAMPLE_RATE);
+        }
+    } else if (state == PWAR_SESSION_STATE_LEGACY) {
+        printf("[PWAR]: No session answer from remote, streaming without negotiated options\n");
+    } else if (state == PWAR_SESSION_STATE_REJECTED) {
+        printf("\033[0;31m[PWAR]: Session rejected by remote (reason %u)\033[0m\n", data->session.reject_reason);
+    }
+}
+
+// Receiver thread. Statistics start from a clean window once the warm-up is over
+static void report_warmup(struct data *data) {
+    uint32_t state = pwar_atomic_load_acquire_u32(&data->warmup_state);
+    if (state == data->warmup_state_seen) return;
+    data->warmup_state_seen = state;
+    if (state == WARMUP_RUNNING) return;
+    latency_manager_reset_window();
+    uint32_t lock_in_us = pwar_atomic_load_acquire_u32(&data->lock_in_us);
+    if (state == WARMUP_LOCKED) {
+        printf("[PWAR]: Locked in after %.1f ms, audio unmuted\n", lock_in_us / 1000.0);
+    } else {
+        printf("\033[0;31m[PWAR]: Return stream did not settle within %.1f ms, unmuting anyway\033[0m\n", lock_in_us / 1000.0);
+    }
+}
+
+// The audio thread only counts what went wrong, the receiver thread prints it
+static void report_audio_errors(struct data *data) {
+    uint32_t quantum = pwar_atomic_load_acquire_u32(&data->unsendable_quantum);
+    if (quantum != data->unsendable_quantum_seen) {
+        data->unsendable_quantum_seen = quantum;
+        if (quantum)
+            printf("\033[0;31m[PWAR]: A quantum of %u does not fit a packet of %u samples, outputting silence. "
+                   "Use a smaller buffer size%s\033[0m\n", quantum, PWAR_PACKET_MAX_CHUNK_SIZE,
+                   data->fanout ? "" : " or oneshot mode");
+    }
+    uint32_t silent = pwar_atomic_load_acquire_u32(&data->silent_cycles);
+    if (silent != data->silent_cycles_seen) {
+        printf("\033[0;31m--- ERROR -- %u cycles without a valid return (last seq %u), outputting silence\033[0m\n",
+               silent - data->silent_cycles_seen, pwar_atomic_load_relaxed_u32(&data->silent_seq));
+        data->silent_cycles_seen = silent;
+    }
+    uint32_t failing = pwar_atomic_load_acquire_u32(&data->path_send_failing);
+    uint32_t started = failing & ~data->path_send_failing_seen;
+    data->path_send_failing_seen = failing;
+    for (uint32_t p = 0; started && p < data->num_paths; ++p) {
+        if (!(started & (1u << p))) continue;
+        if (data->num_paths > 1) fprintf(stderr, "Path %u: ", p);
+        fprintf(stderr, "sendto failed: %s\n", strerror((int)pwar_atomic_load_relaxed_u32(&data->path_send_errno[p])));
+    }
+    failing = pwar_atomic_load_acquire_u32(&data->link_send_failing);
+    started = failing & ~data->link_send_failing_seen;
+    data->link_send_failing_seen = failing;
+    for (uint32_t i = 0; started && i < data->num_links; ++i) {
+        if (!(started & (1u << i))) continue;
+        fprintf(stderr, "Remote %s: sendto failed: %s\n", inet_ntoa(data->links[i].addr.sin_addr),
+                strerror((int)pwar_atomic_load_relaxed_u32(&data->link_send_errno[i])));
+    }
+}
+
+// Audio thread, a send that starts failing is reported once by the receiver thread
+static void note_send_result(volatile uint32_t *failing_mask, volatile uint32_t *errnos, uint32_t index, int failed) {
+    uint32_t bit = 1u << index;
+    uint32_t failing = *failing_mask;
+    if (failed && !(failing & bit)) {
+        pwar_atomic_store_relaxed_u32(&errnos[index], (uint32_t)errno);
+        pwar_atomic_store_release_u32(failing_mask, failing | bit);
+    } else if (!failed && (failing & bit)) {
+        pwar_atomic_store_release_u32(failing_mask, failing & ~bit);
+    }
+}
+
+// Audio thread, 1 if a quantum fits a single packet. Otherwise the receiver thread reports it
+static int note_quantum(struct data *data, uint32_t n_samples) {
+    uint32_t unsendable = n_samples > PWAR_PACKET_MAX_CHUNK_SIZE ? n_samples : 0;
+    if (unsendable != data->unsendable_quantum)
+        pwar_atomic_store_release_u32(&data->unsendable_quantum, unsendable);
+    return !unsendable;
+}
+
+// Audio thread, as note_quantum, and the outputs are silenced if the quantum cannot be sent
+static int quantum_sendable(struct data *data, uint32_t n_samples, float *left_out, float *right_out) {
+    if (note_quantum(data, n_samples)) return 1;
+    if (left_out)
+        memset(left_out, 0, n_samples * sizeof(float));
+    if (right_out)
+        memset(right_out, 0, n_samples * sizeof(float));
+    return 0;
+}
+
+// Audio thread
+static void note_silence(struct data *data, uint32_t seq) {
+    latency_manager_report_xrun();
+    pwar_atomic_store_relaxed_u32(&data->silent_seq, seq);
+    pwar_atomic_store_release_u32(&data->silent_cycles, data->silent_cycles + 1);
+}
+
+// Retries, timeouts and quantum changes, runs on the receiver thread
+static void drive_session(struct data *data, pwar_session_t *session, const struct sockaddr_in *addr) {
+    pwar_session_msg_t out;
+    uint64_t now = latency_manager_timestamp_now();
+
+    uint32_t block_size = pwar_atomic_load_acquire_u32(&data->requested_block_size);
+    if (block_size && block_size != session->local.linux_block_size) {
+        pwar_session_params_t local = session->local;
+        local.linux_block_size = block_size;
+        pwar_session_renegotiate(session, &local, now, &out);
+        send_session_message_to(data, addr, &out);
+    }
+    if (pwar_session_poll(session, now, &out)) {
+        send_session_message_to(data, addr, &out);
+    }
+}
+
+static void drive_sessions(struct data *data, uint32_t worker) {
+    if (!data->fanout) {
+        drive_session(data, &data->session, &data->servaddr);
+        return;
+    }
+    for (uint32_t i = 0; i < data->num_links; ++i) {
+        if (data->links[i].worker != worker) continue;
+        drive_session(data, &data->links[i].session, &data->links[i].addr);
+    }
+}
+
+static void start_sessions(struct data *data, uint32_t worker) {
+    pwar_session_msg_t hello;
+    uint32_t session_id = (uint32_t)(latency_manager_timestamp_now() ^ ((uint64_t)getpid() << 16));
+    if (!data->fanout) {
+        pwar_session_start(&data->session, session_id ? session_id : 1, latency_manager_timestamp_now(), &hello);
+        send_session_message(data, &hello);
+        return;
+    }
+    // Every host gets its own session, its id tells their messages apart
+    pthread_mutex_lock(&data->steer_mutex);
+    for (uint32_t i = 0; i < data->num_links; ++i) {
+        struct remote_link *link = &data->links[i];
+        uint32_t id = session_id + i;
+        if (link->worker != worker) continue;
+        link->last_state = PWAR_SESSION_STATE_IDLE;
+        pwar_session_start(&link->session, id ? id : data->num_links, latency_manager_timestamp_now(), &hello);
+        send_session_message_to(data, &link->addr, &hello);
+    }
+    pthread_mutex_unlock(&data->steer_mutex);
+    update_steering(data);
+}
+
+static void stop_sessions(struct data *data) {
+    pwar_session_msg_t bye;
+    if (!data->fanout) {
+        if (pwar_session_stop(&data->session, &bye)) {
+            send_session_message(data, &bye);
+        }
+        return;
+    }
+    for (uint32_t i = 0; i < data->num_links; ++i) {
+        if (pwar_session_stop(&data->links[i].session, &bye)) {
+            send_session_message_to(data, &data->links[i].addr, &bye);
+        }
+    }
+}
+
+// Receive workers. A host that restarts its stream only resets its own returns, the others keep playing
+static void report_link_states(struct data *data, uint32_t worker) {
+    int any_allowed = 0;
+    for (uint32_t i = 0; i < data->num_links; ++i) {
+        struct remote_link *link = &data->links[i];
+        any_allowed |= pwar_session_audio_allowed(&link->session);
+        if (link->worker != worker) continue;
+        uint32_t state = pwar_atomic_load_acquire_u32(&link->session.state);
+        if (state == PWAR_SESSION_STATE_ESTABLISHED &&
+            (link->session.session_id != link->stream_session_id || link->session.generation != link->stream_generation)) {
+            link->stream_session_id = link->session.session_id;
+            link->stream_generation = link->session.generation;
+            pwar_fanout_reset_host(data->fanout, i);
+        }
+        if (state == link->last_state) continue;
+        link->last_state = state;
+
+        const pwar_session_params_t *p = &link->session.negotiated;
+        const pwar_fanout_host_config_t *group = &data->fanout->hosts[i].config;
+        printf("[PWAR]: Remote %u (%s:%u, channels %u-%u): %s", i, inet_ntoa(link->addr.sin_addr), ntohs(link->addr.sin_port),
+               group->first_channel + 1, group->first_channel + group->channels, pwar_session_state_name(state));
+        if (state == PWAR_SESSION_STATE_ESTABLISHED) {
+            printf(", block %u/%u", p->linux_block_size, p->remote_block_size);
+        } else if (state == PWAR_SESSION_STATE_REJECTED) {
+            printf(" (reason %u)", link->session.reject_reason);
+        }
+        printf("\n");
+    }
+    if (worker == 0 && !any_allowed) {
+        pwar_watchdog_disarm(&data->watchdog, PWAR_WATCHDOG_BEAT_PACKET);
+    }
+}
+
+static uint64_t quantum_ns(uint32_t n_samples) {
+    return (uint64_t)n_samples * 1000000000ULL / SAMPLE_RATE;
+}
+
+// Seqlock, the audio thread must never wait for a reader
+static void publish_thread_status(struct data *data, int which, const pwar_thread_status_t *status) {
+    uint32_t seq = pwar_atomic_load_relaxed_u32(&data->thread_status_seq[which]);
+    pwar_atomic_store_relaxed_u32(&data->thread_status_seq[which], seq + 1);
+    pwar_atomic_fence_release();
+    data->thread_status[which] = *status;
+    pwar_atomic_store_release_u32(&data->thread_status_seq[which], seq + 2);
+}
+
+static void read_thread_status(struct data *data, int which, pwar_thread_status_t *out) {
+    for (;;) {
+        uint32_t before = pwar_atomic_load_acquire_u32(&data->thread_status_seq[which]);
+        if (before & 1) continue;
+        *out = data->thread_status[which];
+        pwar_atomic_fence_acquire();
+        if (pwar_atomic_load_relaxed_u32(&data->thread_status_seq[which]) == before) break;
+    }
+    out->thread = pwar_rt_thread_name(which);
+}
+
+static void print_thread_status(const pwar_thread_status_t *status) {
+    char line[192];
+    pwar_rt_describe(status, line, sizeof(line));
+    printf("[PWAR]: %s%s\n", status->failed ? "Warning: " : "", line);
+}
 
+// Applies the configured scheduling to the calling thread
+static void apply_thread_config(struct data *data, int which, int default_policy, int default_priority, uint32_t n_samples) {
+    pwar_thread_status_t status;
+    pwar_rt_apply(pthread_self(), which, &data->threads[which], default_policy, default_priority, quantum_ns(n_samples), &status);
+    publish_thread_status(data, which, &status);
+}
+
+// Runs on the audio thread: once per start, and whenever the quantum changes under SCHED_DEADLINE
+static void apply_audio_config(struct data *data, uint32_t n_samples) {
+    int first = data->audio_rt_quantum == 0;
+    data->audio_rt_quantum = n_samples;
+    if (!first && data->threads[PWAR_THREAD_AUDIO].policy != PWAR_SCHED_DEADLINE) return;
+    // PipeWire already made this thread real-time, only override what was configured
+    apply_thread_config(data, PWAR_THREAD_AUDIO, PWAR_SCHED_DEFAULT, 0, n_samples);
+}
+
+// The audio thread cannot print, the receiver thread does it for it
+static void report_audio_config(struct data *data) {
+    uint32_t seq = pwar_atomic_load_acquire_u32(&data->thread_status_seq[PWAR_THREAD_AUDIO]);
+    if (seq == data->audio_status_seen || (seq & 1)) return;
+    data->audio_status_seen = seq;
+    pwar_thread_status_t status;
+    read_thread_status(data, PWAR_THREAD_AUDIO, &status);
+    print_thread_status(&status);
+}
+
+// Receive workers, returns and latency info from one of the fanned out hosts
+static void handle_fanout_datagram(struct data *data, uint32_t worker, const char *buffer, ssize_t n, const struct sockaddr_in *from) {
+    int index = find_link(data, worker, NULL, from);
+    if (index < 0) return;
+    uint64_t now = latency_manager_timestamp_now();
+    pwar_session_note_traffic(&data->links[index].session, now);
+    if (n == (ssize_t)sizeof(pwar_packet_t)) {
+        const pwar_packet_t *packet = (const pwar_packet_t *)buffer;
+        PWAR_RT_SECTION_ENTER(worker ? "receive worker" : "receiver");
+        pwar_watchdog_beat(&data->watchdog, PWAR_WATCHDOG_BEAT_PACKET, now);
+        // Round trips of the first worker's hosts go into the statistics, the latency manager is single threaded
+        if (worker == 0 && pwar_atomic_load_relaxed_u32(&data->warmup_state) != WARMUP_RUNNING)
+            latency_manager_process_packet_server((pwar_packet_t *)packet);
+        pwar_fanout_put(data->fanout, (uint32_t)index, packet, now);
+        PWAR_RT_SECTION_LEAVE();
+    } else if (worker == 0 && n == (ssize_t)sizeof(pwar_latency_info_t)) {
+        latency_manager_handle_latency_info((pwar_latency_info_t *)buffer);
+    }
+}
+
+/*
+ * Every receive worker runs with the receiver settings. With several workers and
+ * a receiver CPU list of at least as many CPUs, each one gets a core of its own.
+ */
+static void apply_receiver_config(struct data *data, uint32_t worker) {
+    pwar_thread_config_t config = data->threads[PWAR_THREAD_RECEIVER];
+    if (data->num_workers > 1 && config.cpus[0]) {
+        int cpu = pwar_rt_nth_cpu(config.cpus, (int)worker);
+        if (cpu >= 0) snprintf(config.cpus, sizeof(config.cpus), "%d", cpu);
+    }
+    pwar_thread_status_t status;
+    // Real-time scheduling to minimize jitter, unless configured otherwise
+    pwar_rt_apply(pthread_self(), PWAR_THREAD_RECEIVER, &config, PWAR_SCHED_FIFO, RECEIVER_DEFAULT_PRIORITY,
+                  quantum_ns(data->rt_buffer_size), &status);
+    if (worker == 0) {
+        // Only the first worker has a status slot, the others are printed only
+        publish_thread_status(data, PWAR_THREAD_RECEIVER, &status);
+    }
+    if (data->num_workers > 1) {
+        char line[192];
+        pwar_rt_describe(&status, line, sizeof(line));
+        printf("[PWAR]: %sWorker %u %s\n", status.failed ? "Warning: " : "", worker, line);
+    } else {
+        print_thread_status(&status);
+    }
+}
+
+/*
+ * Room for the returns of the pipeline and a few blocks more, for the hosts a
+ * receiver owns. A fixed large buffer would let a stall queue up far more audio
+ * than anybody still waits for.
+ */
+static uint32_t rcvbuf_target(struct data *data, uint32_t worker) {
+    uint32_t quantum = pwar_atomic_load_acquire_u32(&data->requested_block_size);
+    if (!quantum) quantum = data->rt_buffer_size;
+    if (!quantum) quantum = PWAR_PACKET_MIN_CHUNK_SIZE;
+    uint32_t remote_block = 0, hosts = 0;
+    if (!data->fanout) {
+        remote_block = data->session.negotiated.remote_block_size ? data->session.negotiated.remote_block_size
+                                                                  : data->current_windows_buffer_size;
+        hosts = data->num_paths; // Every path delivers its own copy
+    }
+    for (uint32_t i = 0; data->fanout && i < data->num_links; ++i) {
+        if (data->links[i].worker != worker) continue;
+        uint32_t block = data->links[i].session.negotiated.remote_block_size;
+        if (block > remote_block) remote_block = block;
+        hosts++;
+    }
+    uint32_t block = remote_block > quantum ? remote_block : quantum;
+    uint32_t chunk = quantum < PWAR_PACKET_MAX_CHUNK_SIZE ? quantum : PWAR_PACKET_MAX_CHUNK_SIZE;
+    uint32_t depth = data->oneshot_mode ? 1 : data->pipeline_depth;
+    uint64_t datagrams = (uint64_t)(depth + RCVBUF_HEADROOM_BLOCKS) * ((block + chunk - 1) / chunk) * (hosts ? hosts : 1);
+    uint64_t bytes = datagrams * sizeof(pwar_packet_t);
+    if (bytes < RCVBUF_MIN_BYTES) return RCVBUF_MIN_BYTES;
+    return bytes > RCVBUF_MAX_BYTES ? RCVBUF_MAX_BYTES : (uint32_t)bytes;
+}
+
+// Follows quantum, remote block and depth changes, cheap enough to call every wakeup
+static void update_rcvbuf(struct data *data, uint32_t worker, int sockfd, uint32_t *current) {
+    uint32_t bytes = rcvbuf_target(data, worker);
+    if (bytes == *current) return;
+    *current = bytes;
+    int value = (int)bytes;
+    if (setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &value, sizeof(value)) < 0) {
+        perror("setsockopt SO_RCVBUF failed");
+        return;
+    }
+    // The kernel doubles the request for its bookkeeping and caps it at net.core.rmem_max
+    int granted = 0;
+    socklen_t len = sizeof(granted);
+    getsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &granted, &len);
+    if (data->num_workers > 1)
+        printf("[PWAR]: Worker %u receive buffer %u KB (kernel %d KB)\n", worker, bytes / 1024, granted / 1024);
+    else
+        printf("[PWAR]: Receive buffer %u KB (kernel %d KB)\n", bytes / 1024, granted / 1024);
+}
+
+// Age of a return beyond what its pipeline allows, 0 if it is still current
+static uint64_t stale_by_ns(struct data *data, const pwar_packet_t *packet, uint64_t now) {
+    // seq_timestamp echoes our send time, the remote could only start once the whole block was there
+    uint64_t chunk_ns = quantum_ns(packet->n_samples);
+    uint64_t complete_ns = packet->seq_timestamp + (packet->num_packets ? packet->num_packets - 1 : 0) * chunk_ns;
+    if (now <= complete_ns) return 0;
+    uint32_t depth = data->oneshot_mode ? 1 : data->pipeline_depth;
+    uint64_t limit = (depth + BACKLOG_SLACK_BLOCKS) * quantum_ns((uint32_t)packet->n_samples * packet->num_packets);
+    if (limit < BACKLOG_MIN_STALE_NS) limit = BACKLOG_MIN_STALE_NS;
+    return now - complete_ns > limit ? now - complete_ns : 0;
+}
+
+/*
+ * After a stall the socket can hold many more returns than the pipeline, and
+ * working through them one by one keeps every later return just as late. Once a
+ * stale return has more queued behind it, the whole stale run is dropped at once.
+ * Draining stops at the first current return, which is left in buffer. Returns
+ * its length, or -1 if the queue ran dry.
+ */
+static ssize_t flush_backlog(struct data *data, uint32_t worker, pwar_offload_rx_t *rx, char *buffer, size_t size,
+                             struct sockaddr_in *from, uint64_t behind_ns) {
+    uint32_t dropped = 1;
+    ssize_t n;
+    for (;;) {
+        n = pwar_offload_recv(rx, buffer, size, MSG_DONTWAIT, from);
+        if (n < 0) break;
+        if (n == (ssize_t)sizeof(pwar_session_msg_t) && pwar_session_is_message(buffer, (uint32_t)n)) {
+            handle_session_datagram(data, worker, (pwar_session_msg_t *)buffer, from);
+            continue;
+        }
+        if (n == (ssize_t)sizeof(pwar_packet_t) &&
+            !stale_by_ns(data, (const pwar_packet_t *)buffer, latency_manager_timestamp_now())) {
+            break;
+        }
+        dropped++;
+    }
+    // Resynchronize, the reassembled audio still waiting is just as old
+    if (!data->fanout) flush_stream(data);
+    for (uint32_t i = 0; i < data->num_links; ++i) {
+        if (data->links[i].worker == worker) pwar_fanout_reset_host(data->fanout, i);
+    }
+    pwar_watchdog_note_backlog_flush(&data->watchdog, dropped, (uint32_t)(behind_ns / 1000000));
+    printf("\033[0;31m[PWAR]: Backlog flushed, %u stale datagrams dropped, the oldest %.1f ms late\033[0m\n",
+           dropped, behind_ns / 1e6);
+    return n;
+}
+
+// A stale return with more queued behind it, the receiver fell behind
+static uint64_t backlog_behind_ns(struct data *data, pwar_offload_rx_t *rx, const char *buffer, ssize_t n) {
+    if (n != (ssize_t)sizeof(pwar_packet_t)) return 0;
+    uint64_t behind = stale_by_ns(data, (const pwar_packet_t *)buffer, latency_manager_timestamp_now());
+    if (!behind || pwar_offload_rx_pending(rx)) return behind;
+    char peek;
+    if (recv(rx->sockfd, &peek, sizeof(peek), MSG_PEEK | MSG_DONTWAIT) < 0) return 0;
+    return behind;
+}
+
+// Receiver thread. 1 for the first copy of a return, 0 if the other path already delivered it
+static int first_copy(struct data *data, const pwar_packet_t *packet, const struct sockaddr_in *from, uint64_t now) {
+    if (data->num_paths < 2) return 1;
+    uint32_t path = 0;
+    for (uint32_t p = 1; p < data->num_paths; ++p) {
+        if (from->sin_addr.s_addr == data->path_addr[p].sin_addr.s_addr) path = p;
+    }
+    // seq_timestamp echoes our send time, so every copy tells how long its path took
+    uint64_t latency = now > packet->seq_timestamp ? now - packet->seq_timestamp : 0;
+    return pwar_paths_accept(&data->paths, path, pwar_paths_key(packet), now, latency);
+}
+
+// Receiver thread. Tells which path carries the stream whenever that changes
+static void report_paths(struct data *data, uint64_t now) {
+    if (data->num_paths < 2 || now - data->path_report_ns < PATH_REPORT_NS) return;
+    data->path_report_ns = now;
+    int leader = pwar_paths_leader(&data->paths, data->path_first_seen);
+    for (uint32_t p = 0; p < data->num_paths; ++p) {
+        data->path_first_seen[p] = pwar_atomic_load_relaxed_u32(&data->paths.stats[p].first);
+    }
+    if (leader < 0 || (uint32_t)leader == pwar_atomic_load_relaxed_u32(&data->path_leader)) return;
+    pwar_atomic_store_relaxed_u32(&data->path_leader, (uint32_t)leader);
+    const pwar_path_stats_t *stats = &data->paths.stats[leader];
+    printf("[PWAR]: Path %d (%s) carries the stream, %.2f ms send to return, %u returns lost on it so far\n",
+           leader, inet_ntoa(data->path_addr[leader].sin_addr), stats->latency_ns / 1e6, stats->lost);
+}
+
+// Receiver thread. NACKs go over every path, like the audio
+static void send_nack(struct data *data, const pwar_nack_msg_t *nack) {
+    for (uint32_t p = 0; p < data->num_paths; ++p) {
+        if (sendto(data->path_sockfd[p], nack, sizeof(*nack), 0, (const struct sockaddr *)&data->path_addr[p], sizeof(data->path_addr[p])) < 0) {
+            perror("sendto nack failed");
+        }
+    }
+}
+
+/*
+ * Receiver thread, pipelined returns. The router follows which segments of each
+ * returned buffer arrived, without assembling them, and the ones a return shows
+ * to be missing are asked for again while they can still make their turn: segment
+ * i of buffer seq is played delay cycles after chunk seq + i was sent. Returns 1
+ * if the packet is a segment that was asked for.
+ */
+static int track_return(struct data *data, const pwar_packet_t *packet, uint64_t now) {
+    int asked = pwar_nack_tracker_arrived(&data->nacks, packet->seq, packet->packet_index, now);
+    uint64_t seq = data->linux_router.current_seq;
+    uint64_t seq_timestamp = data->linux_router.seq_timestamp;
+    uint64_t missing = pwar_router_take_missing(&data->linux_router, packet);
+    pwar_router_track_packet(&data->linux_router, packet);
+    if (!missing || pwar_atomic_load_acquire_u32(&data->session.state) != PWAR_SESSION_STATE_ESTABLISHED ||
+        !(data->session.negotiated.features & PWAR_FEATURE_RETRANSMIT)) {
+        return asked;
+    }
+    uint64_t chunk_ns = quantum_ns(packet->n_samples);
+    uint64_t first_deadline = seq_timestamp + pipeline_delay_cycles(data, packet->n_samples) * chunk_ns;
+    pwar_nack_msg_t nack;
+    if (pwar_nack_tracker_request(&data->nacks, seq, missing, data->session.generation, first_deadline, chunk_ns, now, &nack)) {
+        send_nack(data, &nack);
+    }
+    return asked;
+}
+
+// Receive threads, between two receives. Locks are never held here
+static int receiver_stopping(volatile uint32_t *stop) {
+    return pwar_atomic_load_relaxed_u32(stop) == RECV_STOP_REQUESTED &&
+           pwar_atomic_cas_u32(stop, RECV_STOP_REQUESTED, RECV_STOPPING);
+}
+
+// Receive workers past the first, each drains its own socket for the remotes it owns
+static void *worker_thread(void *userdata) {
+    struct receive_worker *worker = (struct receive_worker *)userdata;
+    struct data *data = worker->data;
+    apply_receiver_config(data, worker->index);
+
+    char recv_buffer[sizeof(pwar_packet_t)];
+    start_sessions(data, worker->index);
+    while (!receiver_stopping(&worker->stop)) {
+        struct sockaddr_in from;
+        ssize_t n = pwar_offload_recv(&worker->rx, recv_buffer, sizeof(recv_buffer), 0, &from);
+        uint32_t flush = pwar_atomic_load_relaxed_u32(&data->flush_requested);
+        if (flush != worker->flush_seen) {
+            worker->flush_seen = flush;
+            flush_stale_state(data, worker->index, &worker->rx);
+            continue;
+        }
+        drive_sessions(data, worker->index);
+        update_rcvbuf(data, worker->index, worker->sockfd, &worker->rcvbuf_bytes);
+        uint64_t behind = backlog_behind_ns(data, &worker->rx, recv_buffer, n);
+        if (behind) n = flush_backlog(data, worker->index, &worker->rx, recv_buffer, sizeof(recv_buffer), &from, behind);
+        if (n == (ssize_t)sizeof(pwar_session_msg_t) && pwar_session_is_message(recv_buffer, (uint32_t)n)) {
+            handle_session_datagram(data, worker->index, (pwar_session_msg_t *)recv_buffer, &from);
+        } else if (n > 0) {
+            handle_fanout_datagram(data, worker->index, recv_buffer, n, &from);
+        }
+        report_link_states(data, worker->index);
+    }
+    return NULL;
+}
+
+// Driver mode, a complete return from a remote that runs on its own clock starts the next graph cycle
+static void drive_graph(struct data *data) {
+    if (data->session.state != PWAR_SESSION_STATE_ESTABLISHED ||
+        !(data->session.negotiated.features & PWAR_FEATURE_CLOCK_MASTER)) {
+        // The remote follows our input, answering it at once would run cycles as fast as the round trip
+        return;
+    }
+    pwar_atomic_fetch_add_u32(&data->triggering, 1);
+    // Either stop_driving sees triggering or this sees driving = 0, the filter is not destroyed in between
+    pwar_atomic_fence_seq_cst();
+    if (pwar_atomic_load_acquire_u32(&data->driving)) {
+        pwar_atomic_fetch_add_u32(&data->driver_triggers, 1);
+        // Waking the graph is a non-blocking eventfd write, the one syscall meant to be here
+        PWAR_RT_SECTION_LEAVE();
+        pw_filter_trigger_process(data->filter);
+        PWAR_RT_SECTION_ENTER("receiver");
+    }
+    pwar_atomic_fence_release();
+    pwar_atomic_fetch_add_u32(&data->triggering, (uint32_t)-1);
+}
+
+static void *receiver_thread(void *userdata) {
     struct data *data = (struct data *)userdata;
+    apply_receiver_config(data, 0);
+
     char recv_buffer[sizeof(pwar_packet_t) > sizeof(pwar_latency_info_t) ? sizeof(pwar_packet_t) : sizeof(pwar_latency_info_t)];
     float linux_output_buffers[NUM_CHANNELS * MAX_BUFFER_SIZE] = {0};
 
-    while (1) {
-        ssize_t n = recvfrom(data->recv_sockfd, recv_buffer, sizeof(recv_buffer), 0, NULL, NULL);
-        if (n == (ssize_t)sizeof(pwar_packet_t)) {
+    uint32_t last_session_state = PWAR_SESSION_STATE_IDLE;
+    start_sessions(data, 0);
+
+    while (!receiver_stopping(&data->recv_stop)) {
+        struct sockaddr_in from;
+        ssize_t n = pwar_offload_recv(&data->recv_rx, recv_buffer, sizeof(recv_buffer), 0, &from);
+        pwar_watchdog_beat(&data->watchdog, PWAR_WATCHDOG_BEAT_RECEIVER, latency_manager_timestamp_now());
+        uint32_t flush = pwar_atomic_load_relaxed_u32(&data->flush_requested);
+        if (flush != data->flush_seen) {
+            data->flush_seen = flush;
+            flush_stale_state(data, 0, &data->recv_rx);
+            continue;
+        }
+        drive_sessions(data, 0);
+        update_rcvbuf(data, 0, data->recv_sockfd, &data->rcvbuf_bytes);
+        uint64_t behind = backlog_behind_ns(data, &data->recv_rx, recv_buffer, n);
+        if (behind) n = flush_backlog(data, 0, &data->recv_rx, recv_buffer, sizeof(recv_buffer), &from, behind);
+        if (n == (ssize_t)sizeof(pwar_session_msg_t) && pwar_session_is_message(recv_buffer, (uint32_t)n)) {
+            handle_session_datagram(data, 0, (pwar_session_msg_t *)recv_buffer, &from);
+        } else if (data->fanout && n > 0) {
+            handle_fanout_datagram(data, 0, recv_buffer, n, &from);
+        } else if (n == (ssize_t)sizeof(pwar_packet_t) &&
+                   !first_copy(data, (pwar_packet_t *)recv_buffer, &from, latency_manager_timestamp_now())) {
+            // The other path delivered this return first, this copy still shows the path is alive
+            pwar_session_note_traffic(&data->session, latency_manager_timestamp_now());
+        } else if (n == (ssize_t)sizeof(pwar_packet_t)) {
+            PWAR_RT_SECTION_ENTER("receiver");
             pwar_packet_t *packet = (pwar_packet_t *)recv_buffer;
-            latency_manager_process_packet_server(packet);
+            uint64_t now = latency_manager_timestamp_now();
+            pwar_watchdog_beat(&data->watchdog, PWAR_WATCHDOG_BEAT_PACKET, now);
+            pwar_session_note_traffic(&data->session, now);
+            int pipelined = !data->oneshot_mode && data->pipeline_depth > 1;
+            // A resent segment's round trip includes the NACK's
+            int resent = pipelined && track_return(data, packet, now);
+            // Warm-up round trips would skew the statistics, receive-only returns answer nothing
+            if (pwar_atomic_load_relaxed_u32(&data->warmup_state) != WARMUP_RUNNING && !resent &&
+                data->direction != PWAR_DIRECTION_RECEIVE_ONLY)
+                latency_manager_process_packet_server(packet);
             data->current_windows_buffer_size = packet->n_samples * packet->num_packets;
-            if (data->oneshot_mode) {
-                pthread_mutex_lock(&data->packet_mutex);
-                data->latest_packet = *packet;
-                data->packet_available = 1;
-                pthread_cond_signal(&data->packet_cond);
-                pthread_mutex_unlock(&data->packet_mutex);
-            } 
-            else {
+            if (pipelined) {
+                pwar_slot_ring_put(&data->slot_ring, packet);
+            }
+            else if (data->oneshot_mode) {
+                // A quantum larger than a packet is answered in segments, the audio thread is woken once all are in
                 int samples_ready = pwar_router_process_packet(&data->linux_router, packet, linux_output_buffers, MAX_BUFFER_SIZE, NUM_CHANNELS);
                 if (samples_ready > 0) {
+                    // The audio thread waits on this in oneshot mode
+                    PWAR_RT_ALLOW_BEGIN("hands the oneshot answer to the waiting audio thread");
+                    pthread_mutex_lock(&data->packet_mutex);
+                    memcpy(data->oneshot_return, linux_output_buffers, NUM_CHANNELS * samples_ready * sizeof(float));
+                    data->oneshot_samples = samples_ready;
+                    data->oneshot_seq = (uint32_t)data->linux_router.current_seq;
+                    data->packet_available = 1;
+                    pthread_cond_signal(&data->packet_cond);
+                    pthread_mutex_unlock(&data->packet_mutex);
+                    PWAR_RT_ALLOW_END();
+                    if (data->driver)
+                        drive_graph(data);
+                }
+            } 
+            else {
+                // Cut-through: whatever leads the block is playable before its tail arrives
+                pwar_router_t *router = &data->linux_router;
+                pwar_router_process_packet(router, packet, linux_output_buffers, MAX_BUFFER_SIZE, NUM_CHANNELS);
+                uint32_t ready = pwar_router_ready_samples(router);
+                if (ready > 0) {
+                    PWAR_RT_ALLOW_BEGIN("receive buffer shared with the audio thread, held for a copy");
                     pthread_mutex_lock(&data->pwar_rcv_mutex); // Lock before buffer add
-                    pwar_rcv_buffer_add_buffer(linux_output_buffers, samples_ready, NUM_CHANNELS);
+                    pwar_rcv_buffer_add_prefix(router->current_seq, router->buffers[0], ready,
+                                               router->expected_packets * router->segment_samples, NUM_CHANNELS, PWAR_ROUTER_MAX_BUFFER_SIZE);
                     pthread_mutex_unlock(&data->pwar_rcv_mutex); // Unlock after buffer add
+                    PWAR_RT_ALLOW_END();
                 }
             }
+            PWAR_RT_SECTION_LEAVE();
         } else if (n == (ssize_t)sizeof(pwar_latency_info_t)) {
             pwar_latency_info_t *latency_info = (pwar_latency_info_t *)recv_buffer;
+            pwar_session_note_traffic(&data->session, latency_manager_timestamp_now());
             latency_manager_handle_latency_info(latency_info);
         }
+        if (data->fanout)
+            report_link_states(data, 0);
+        else
+            report_session_state(data, &last_session_state);
+        report_paths(data, latency_manager_timestamp_now());
+        report_warmup(data);
+        report_audio_errors(data);
+        report_audio_config(data);
     }
     return NULL;
 }
 
-static void setup_socket(struct data *data, const char *ip, int port) {
-    data->sockfd = socket(AF_INET, SOCK_DGRAM, 0);
-    if (data->sockfd < 0) {
+// Leaves from bind_ip, or from whatever address the kernel picks if it is empty
+static int open_send_socket(const char *bind_ip) {
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sockfd < 0) {
         perror("socket creation failed");
         exit(EXIT_FAILURE);
     }
+    if (bind_ip && bind_ip[0]) {
+        struct sockaddr_in local;
+        memset(&local, 0, sizeof(local));
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = inet_addr(bind_ip);
+        if (bind(sockfd, (struct sockaddr *)&local, sizeof(local)) < 0) {
+            perror("send socket bind failed");
+            exit(EXIT_FAILURE);
+        }
+    }
+    return sockfd;
+}
+
+static void setup_socket(struct data *data, const char *ip, int port, const char *bind_ip) {
+    data->sockfd = open_send_socket(bind_ip);
     memset(&data->servaddr, 0, sizeof(data->servaddr));
     data->servaddr.sin_family = AF_INET;
     data->servaddr.sin_port = htons(port);
     data->servaddr.sin_addr.s_addr = inet_addr(ip);
 }
 
-static void stream_buffer(float *samples, uint32_t n_samples, void *userdata) {
-    struct data *data = (struct data *)userdata;
-    pwar_packet_t packet;
-    packet.seq = data->seq++;
-    packet.n_samples = n_samples;
-    packet.packet_index = 0; // Reset packet index for new packet, (as its oneshot mode)
-    packet.num_packets = 1; // Only one packet in oneshot mode
-    // Just stream the first channel for now.. FIXME: This should be updated to handle multiple channels properly in the future
-    memcpy(packet.samples[0], samples, n_samples * sizeof(float));
+/*
+ * Path 0 is the stream socket, a redundant path gets a socket of its own so its
+ * copies leave from its own address. The remote answers over both, and its
+ * returns are told apart by their source address.
+ */
+static void setup_paths(struct data *data, const pwar_config_t *config) {
+    const pwar_path_config_t *path = &config->redundant_path;
+    data->num_paths = 1;
+    data->path_sockfd[0] = data->sockfd;
+    data->path_addr[0] = data->servaddr;
+    if (path->remote_ip[0] && config->num_remotes > 0) {
+        printf("[PWAR]: Warning: The redundant path only applies to a single remote, ignored\n");
+    } else if (path->remote_ip[0]) {
+        int port = path->remote_port > 0 ? path->remote_port : config->stream_port;
+        data->path_sockfd[1] = open_send_socket(path->bind_ip);
+        data->path_addr[1].sin_family = AF_INET;
+        data->path_addr[1].sin_port = htons(port);
+        data->path_addr[1].sin_addr.s_addr = inet_addr(path->remote_ip);
+        data->num_paths = 2;
+        printf("[PWAR]: Redundant path to %s:%d from %s\n", path->remote_ip, port, path->bind_ip[0] ? path->bind_ip : "any address");
+    }
+    pwar_paths_init(&data->paths, data->num_paths);
+    data->path_leader = UINT32_MAX; // Reported on the first look
+}
 
-    packet.timestamp = latency_manager_timestamp_now();
-    packet.seq_timestamp = packet.timestamp; // Set seq_timestamp to the same value as timestamp
-    if (sendto(data->sockfd, &packet, sizeof(packet), 0, (struct sockaddr *)&data->servaddr, sizeof(data->servaddr)) < 0) {
-        perror("sendto failed");
+static void close_paths(struct data *data) {
+    for (uint32_t p = 1; p < data->num_paths; ++p) {
+        if (data->path_sockfd[p] > 0) close(data->path_sockfd[p]);
     }
+    data->num_paths = 1;
 }
 
-static void process_one_shot(void *userdata, float *in, uint32_t n_samples, float *left_out, float *right_out) {
+// Audio thread. Every audio datagram goes out once per path, a failing path is reported once
+static void send_audio(struct data *data, const pwar_packet_t *packets, uint32_t count) {
+    for (uint32_t p = 0; p < data->num_paths; ++p) {
+        int failed = pwar_offload_send(&data->path_tx[p], packets, sizeof(*packets), count, &data->path_addr[p]) < 0;
+        note_send_result(&data->path_send_failing, data->path_send_errno, p, failed);
+    }
+}
+
+/*
+ * Samples per datagram for a quantum. Oneshot mode splits a quantum larger than a
+ * packet into equal segments, the other modes send one packet per cycle. This is
+ * the linux_block_size negotiated with the remote.
+ */
+static uint32_t wire_block_size(const struct data *data, uint32_t n_samples) {
+    if (!data->oneshot_mode || n_samples <= PWAR_PACKET_MAX_CHUNK_SIZE) return n_samples;
+    uint32_t segment = pwar_router_segment_size(n_samples);
+    return segment ? segment : n_samples; // Not splittable, the remote rejects it
+}
+
+/*
+ * Sends one cycle of input. Its segments are numbered like the remote's answer:
+ * all carry the sequence of the first one plus their packet_index, and the cycle
+ * uses up one sequence number per segment. Returns the sequence the answer carries.
+ */
+static uint32_t stream_buffer(float *samples, uint32_t n_samples, void *userdata) {
     struct data *data = (struct data *)userdata;
-    stream_buffer(in, n_samples, data);
+    uint32_t first_seq = data->seq;
+    uint32_t segment = wire_block_size(data, n_samples);
+    if (segment == 0 || segment > PWAR_PACKET_MAX_CHUNK_SIZE) return first_seq;
+    uint32_t segments = n_samples / segment;
+    data->seq += segments;
+
+    uint64_t timestamp = latency_manager_timestamp_now();
+    // Built back to back, so that with UDP offload the whole cycle goes to the kernel at once
+    for (uint32_t i = 0; i < segments; ++i) {
+        pwar_packet_t *packet = &data->send_segments[i];
+        packet->n_samples = segment;
+        packet->num_packets = segments;
+        packet->timestamp = timestamp;
+        packet->seq_timestamp = timestamp; // Set seq_timestamp to the same value as timestamp
+        packet->seq = first_seq;
+        packet->packet_index = i;
+        // Just stream the first channel for now.. FIXME: This should be updated to handle multiple channels properly in the future
+        memcpy(packet->samples[0], samples + i * segment, segment * sizeof(float));
+        memset(packet->samples[1], 0, segment * sizeof(float)); // The remote maps every channel to a host input
+    }
+    send_audio(data, data->send_segments, segments);
+    return first_seq;
+}
+
+// Returns 1 if the remote's answer was played, 0 if silence was output instead
+static int process_one_shot(void *userdata, float *in, uint32_t n_samples, float *left_out, float *right_out) {
+    struct data *data = (struct data *)userdata;
+    uint32_t first_seq = stream_buffer(in, n_samples, data);
     int got_packet = 0;
+    uint64_t wait_ns = quantum_ns(n_samples) / 2;
+    if (wait_ns < ONESHOT_MIN_WAIT_NS) wait_ns = ONESHOT_MIN_WAIT_NS;
     struct timespec ts;
     clock_gettime(CLOCK_REALTIME, &ts);
-    ts.tv_nsec += 2 * 1000 * 1000;
-    if (ts.tv_nsec >= 1000000000) {
+    ts.tv_nsec += (long)wait_ns;
+    while (ts.tv_nsec >= 1000000000) {
         ts.tv_sec += 1;
         ts.tv_nsec -= 1000000000;
     }
+    // Oneshot mode waits for the answer within the cycle, that is the mode
+    PWAR_RT_ALLOW_BEGIN("oneshot waits for the remote's answer");
     pthread_mutex_lock(&data->packet_mutex);
-    while (!data->packet_available) {
-        // Wait for packet or timeout (no ping-pong)
+    while (!(data->packet_available && data->oneshot_seq == first_seq)) {
+        // An answer to an earlier cycle came too late to be played
+        data->packet_available = 0;
+        // Wait for every segment of the answer or timeout (no ping-pong)
         int rc = pthread_cond_timedwait(&data->packet_cond, &data->packet_mutex, &ts);
         if (rc == ETIMEDOUT)
             break;
     }
-    if (data->packet_available) {
+    if (data->packet_available && data->oneshot_seq == first_seq && data->oneshot_samples >= n_samples) {
         if (left_out)
-            memcpy(left_out, data->latest_packet.samples[0], n_samples * sizeof(float));
+            memcpy(left_out, data->oneshot_return, n_samples * sizeof(float));
         if (right_out)
-            memcpy(right_out, data->latest_packet.samples[1], n_samples * sizeof(float));
+            memcpy(right_out, data->oneshot_return + data->oneshot_samples, n_samples * sizeof(float));
         got_packet = 1;
-        data->packet_available = 0;
     }
+    data->packet_available = 0;
     pthread_mutex_unlock(&data->packet_mutex);
+    PWAR_RT_ALLOW_END();
     if (!got_packet) {
-        latency_manager_report_xrun();
-        printf("\033[0;31m--- ERROR -- No valid packet received, outputting silence\n");
-        printf("I wanted seq: %u and got seq: %lu\033[0m\n", data->seq - 1, data->latest_packet.seq);
+        if (data->warmup_state != WARMUP_RUNNING)
+            note_silence(data, first_seq);
         if (left_out)
             memset(left_out, 0, n_samples * sizeof(float));
         if (right_out)
             memset(right_out, 0, n_samples * sizeof(float));
     }
+    return got_packet;
 }
 
-static void process_ping_pong(void *userdata, float *in, uint32_t n_samples, float *left_out, float *right_out) {
+/*
+ * Driver mode. The return that started this cycle answers the input sent by the
+ * previous one, it is played right away and this cycle's input goes out for the
+ * remote's next period. Receive-only sends nothing, every return is played as it
+ * comes.
+ */
+static int process_driven(struct data *data, float *in, uint32_t n_samples, float *left_out, float *right_out) {
+    int got_packet = 0;
+    int receive_only = data->direction == PWAR_DIRECTION_RECEIVE_ONLY;
+    // Held by the receiver only while it copies one answer in
+    PWAR_RT_ALLOW_BEGIN("short hold on the driver return");
+    pthread_mutex_lock(&data->packet_mutex);
+    if (data->packet_available && (receive_only || data->oneshot_seq == data->driver_seq) && data->oneshot_samples >= n_samples) {
+        if (left_out)
+            memcpy(left_out, data->oneshot_return, n_samples * sizeof(float));
+        if (right_out)
+            memcpy(right_out, data->oneshot_return + data->oneshot_samples, n_samples * sizeof(float));
+        got_packet = 1;
+    }
+    data->packet_available = 0;
+    pthread_mutex_unlock(&data->packet_mutex);
+    PWAR_RT_ALLOW_END();
+    if (!receive_only)
+        data->driver_seq = stream_buffer(in, n_samples, data);
+    if (!got_packet) {
+        if (data->warmup_state != WARMUP_RUNNING)
+            note_silence(data, data->driver_seq);
+        if (left_out)
+            memset(left_out, 0, n_samples * sizeof(float));
+        if (right_out)
+            memset(right_out, 0, n_samples * sizeof(float));
+    }
+    return got_packet;
+}
+
+// The graph's clock is the remote's, PipeWire learns how it runs against CLOCK_MONOTONIC
+static void update_driver_clock(struct data *data, struct spa_io_position *position) {
+    uint64_t now = pwar_clock_reference_ns();
+    pwar_driver_clock_cycle(&data->driver_clock, data->driver_quantum, now);
+    position->clock.nsec = now;
+    position->clock.rate = SPA_FRACTION(1, SAMPLE_RATE);
+    position->clock.position = data->driver_clock.position;
+    position->clock.duration = data->driver_quantum;
+    position->clock.delay = 0;
+    position->clock.rate_diff = data->driver_clock.rate_diff;
+    position->clock.next_nsec = pwar_driver_clock_next_ns(&data->driver_clock);
+}
+
+// Send-only. Nothing comes back, the graph's clock paces the stream and the outputs stay silent
+static int process_send_only(struct data *data, float *in, uint32_t n_samples, float *left_out, float *right_out) {
+    stream_buffer(in, n_samples, data);
+    if (left_out)
+        memset(left_out, 0, n_samples * sizeof(float));
+    if (right_out)
+        memset(right_out, 0, n_samples * sizeof(float));
+    return 1;
+}
+
+static int process_ping_pong(void *userdata, float *in, uint32_t n_samples, float *left_out, float *right_out) {
     struct data *data = (struct data *)userdata;
+    // Without a session nothing stopped a quantum larger than a packet, it is not sent
+    if (!quantum_sendable(data, n_samples, left_out, right_out)) return 0;
 
     // Create a packet for the input samples
     pwar_packet_t packet;
@@ -227,58 +1317,278 @@ static void process_ping_pong(void *userdata, float *in, uint32_t n_samples, flo
 
     // Just stream the first channel for now.. FIXME: This should be updated to handle multiple channels properly in the future
     memcpy(packet.samples[0], in, n_samples * sizeof(float));
+    memset(packet.samples[1], 0, n_samples * sizeof(float)); // The remote maps every channel to a host input
 
     packet.timestamp = latency_manager_timestamp_now();
     packet.seq_timestamp = packet.timestamp; // Set seq_timestamp to the same value as timestamp
     packet.num_packets = 1;
     packet.packet_index = 0;
 
-    /* Lock to prevent the response being received too soon */
+    float linux_rcv_buffers[NUM_CHANNELS * n_samples];
+    memset(linux_rcv_buffers, 0, sizeof(linux_rcv_buffers));
+    // Get the chunk from n-1 (ping-pong) before sending, so the response can never be received too soon.
+    // The receive buffer is shared with the receiver thread, which only holds the lock for a copy
+    PWAR_RT_ALLOW_BEGIN("receive buffer shared with the receiver, held for a copy");
     pthread_mutex_lock(&data->pwar_rcv_mutex); // Lock before get_chunk
+    int got_chunk = pwar_rcv_get_chunk(linux_rcv_buffers, NUM_CHANNELS, n_samples);
+    pthread_mutex_unlock(&data->pwar_rcv_mutex); // Unlock after get_chunk
+    PWAR_RT_ALLOW_END();
 
-    if (sendto(data->sockfd, &packet, sizeof(packet), 0, (struct sockaddr *)&data->servaddr, sizeof(data->servaddr)) < 0) {
-        perror("sendto failed");
-    }
+    send_audio(data, &packet, 1);
+
+    if (!got_chunk && data->warmup_state != WARMUP_RUNNING)
+        note_silence(data, packet.seq);
+
+    if (left_out)
+        memcpy(left_out, linux_rcv_buffers, n_samples * sizeof(float));
+    if (right_out)
+        memcpy(right_out, linux_rcv_buffers + n_samples, n_samples * sizeof(float));
+    return got_chunk;
+}
+
+/*
+ * Pipelined processing, pipeline_depth blocks are in flight. Each cycle plays the
+ * return of the chunk sent a fixed number of cycles ago, so the added latency
+ * never drifts, and nothing waits on the network.
+ */
+static int process_pipelined(void *userdata, float *in, uint32_t n_samples, float *left_out, float *right_out) {
+    struct data *data = (struct data *)userdata;
+    if (!quantum_sendable(data, n_samples, left_out, right_out)) return 0;
+
+    pwar_packet_t packet;
+    uint32_t sent_seq = data->seq++;
+    packet.seq = sent_seq;
+    packet.n_samples = n_samples;
+    memcpy(packet.samples[0], in, n_samples * sizeof(float));
+    memset(packet.samples[1], 0, n_samples * sizeof(float)); // The remote maps every channel to a host input
+    packet.timestamp = latency_manager_timestamp_now();
+    packet.seq_timestamp = packet.timestamp;
+    packet.num_packets = 1;
+    packet.packet_index = 0;
+    send_audio(data, &packet, 1);
 
     float linux_rcv_buffers[NUM_CHANNELS * n_samples];
-    memset(linux_rcv_buffers, 0, sizeof(linux_rcv_buffers));
-    // Get the chunk from n-1 (ping-pong)
-    if (!pwar_rcv_get_chunk(linux_rcv_buffers, NUM_CHANNELS, n_samples)) {
-        printf("\033[0;31m--- ERROR -- No valid buffer ready, outputting silence\033[0m\n");
-        latency_manager_report_xrun();
+    uint32_t delay = pipeline_delay_cycles(data, n_samples);
+    int got_chunk = 0;
+    if (sent_seq < delay) {
+        // Still filling the pipeline
+        memset(linux_rcv_buffers, 0, sizeof(linux_rcv_buffers));
+    } else if (!(got_chunk = pwar_slot_ring_get(&data->slot_ring, sent_seq - delay, linux_rcv_buffers, NUM_CHANNELS, n_samples)) &&
+               data->warmup_state != WARMUP_RUNNING) {
+        note_silence(data, sent_seq - delay);
     }
 
-    pthread_mutex_unlock(&data->pwar_rcv_mutex); // Unlock after get_chunk
-
     if (left_out)
         memcpy(left_out, linux_rcv_buffers, n_samples * sizeof(float));
     if (right_out)
         memcpy(right_out, linux_rcv_buffers + n_samples, n_samples * sizeof(float));
+    return got_chunk;
+}
+
+static float warmup_silence[MAX_BUFFER_SIZE];
+
+static void restart_warmup(struct data *data) {
+    data->warmup_good_cycles = 0;
+    data->warmup_start_ns = 0;
+    pwar_atomic_store_release_u32(&data->warmup_state, WARMUP_RUNNING);
+}
+
+// Audio thread. Mutes the output until the return stream has been steady for a while
+static void advance_warmup(struct data *data, int got_return, uint64_t now_ns, float *left_out, float *right_out, uint32_t n_samples) {
+    if (!data->warmup_start_ns) data->warmup_start_ns = now_ns;
+    data->warmup_good_cycles = got_return ? data->warmup_good_cycles + 1 : 0;
+
+    uint64_t elapsed = now_ns - data->warmup_start_ns;
+    if (data->warmup_good_cycles >= data->warmup_lock_cycles || elapsed >= data->warmup_timeout_ns) {
+        pwar_atomic_store_release_u32(&data->lock_in_us, (uint32_t)(elapsed / 1000));
+        pwar_atomic_store_release_u32(&data->warmup_state,
+                                      data->warmup_good_cycles >= data->warmup_lock_cycles ? WARMUP_LOCKED : WARMUP_GAVE_UP);
+    }
+    // Whatever came back so far may be misaligned, keep it off the outputs
+    if (left_out)
+        memset(left_out, 0, n_samples * sizeof(float));
+    if (right_out)
+        memset(right_out, 0, n_samples * sizeof(float));
+}
+
+static void silence_outputs(float *const *out, uint32_t channels, uint32_t n_samples) {
+    for (uint32_t ch = 0; ch < channels; ++ch) {
+        if (out[ch])
+            memset(out[ch], 0, n_samples * sizeof(float));
+    }
+}
+
+/*
+ * Fan-out, every remote gets its own group of channels each cycle. All groups play
+ * the returns of the same sequence, sent as many cycles ago as the slowest host's
+ * pipeline needs, so they stay sample aligned with each other. A host that misses
+ * a block only affects its own group.
+ */
+static void process_fanout(struct data *data, uint32_t n_samples, uint64_t now_ns) {
+    pwar_fanout_t *fanout = data->fanout;
+    float *in[PWAR_FANOUT_MAX_CHANNELS] = { NULL };
+    float *out[PWAR_FANOUT_MAX_CHANNELS] = { NULL };
+    for (uint32_t ch = 0; ch < fanout->channels; ++ch) {
+        in[ch] = pw_filter_get_dsp_buffer(data->group_in_ports[ch], n_samples);
+        out[ch] = pw_filter_get_dsp_buffer(data->group_out_ports[ch], n_samples);
+    }
+
+    uint32_t active = 0, n_active = 0, delay = 0;
+    for (uint32_t i = 0; i < data->num_links; ++i) {
+        const pwar_session_t *session = &data->links[i].session;
+        uint32_t state = pwar_atomic_load_acquire_u32(&session->state);
+        if (state == PWAR_SESSION_STATE_ESTABLISHED && n_samples != session->negotiated.linux_block_size) {
+            // The quantum changed, the receiver thread renegotiates with every host
+            pwar_atomic_store_release_u32(&data->requested_block_size, n_samples);
+            continue;
+        }
+        if (!pwar_session_audio_allowed(session)) continue;
+        active |= 1u << i;
+        n_active++;
+        uint32_t remote_block = session->negotiated.remote_block_size ? session->negotiated.remote_block_size : n_samples;
+        uint32_t link_delay = delay_cycles(data->pipeline_depth, remote_block, n_samples);
+        if (link_delay > delay) delay = link_delay;
+    }
+    if (data->passthrough_test) {
+        for (uint32_t ch = 0; ch < fanout->channels; ++ch) {
+            if (in[ch] && out[ch])
+                memcpy(out[ch], in[ch], n_samples * sizeof(float));
+        }
+        return;
+    }
+    // Fan-out sends one packet per host and cycle, a larger quantum is reported and not sent
+    int sendable = note_quantum(data, n_samples);
+    if (!active || !sendable) {
+        // Nothing may be sent before a remote has acknowledged the parameters
+        if (data->fanout_active_seen) restart_warmup(data);
+        data->fanout_active_seen = 0;
+        silence_outputs(out, fanout->channels, n_samples);
+        return;
+    }
+    data->fanout_active_seen = active;
+    pwar_atomic_store_relaxed_u32(&data->fanout_delay, delay);
+
+    // The remotes are primed with silence until every return stream has locked in
+    int warming_up = pwar_atomic_load_relaxed_u32(&data->warmup_state) == WARMUP_RUNNING;
+    float *silent[PWAR_FANOUT_MAX_CHANNELS] = { NULL };
+    uint32_t sent_seq = data->seq++;
+    for (uint32_t i = 0; i < data->num_links; ++i) {
+        if (!(active & (1u << i))) continue;
+        pwar_packet_t packet;
+        pwar_fanout_build_packet(fanout, i, sent_seq, warming_up ? silent : in, n_samples, latency_manager_timestamp_now(), &packet);
+        int failed = sendto(data->sockfd, &packet, sizeof(packet), 0, (struct sockaddr *)&data->links[i].addr, sizeof(data->links[i].addr)) < 0;
+        note_send_result(&data->link_send_failing, data->link_send_errno, i, failed);
+    }
+
+    uint32_t delivered = 0;
+    if (sent_seq < delay) {
+        // Still filling the pipeline
+        silence_outputs(out, fanout->channels, n_samples);
+    } else {
+        delivered = pwar_fanout_collect(fanout, sent_seq - delay, active, out, n_samples);
+        if (delivered < n_active && !warming_up) {
+            latency_manager_report_xrun();
+        }
+    }
+    if (warming_up) {
+        advance_warmup(data, sent_seq >= delay && delivered == n_active, now_ns, NULL, NULL, n_samples);
+        silence_outputs(out, fanout->channels, n_samples);
+        if (pwar_atomic_load_relaxed_u32(&data->warmup_state) != WARMUP_RUNNING) {
+            // Only misses after the lock-in count
+            pwar_fanout_clear_counts(fanout);
+        }
+    }
+
+    if (pwar_recorder_is_active()) {
+        // The recorder is stereo, it taps the first group
+        pwar_recorder_push(PWAR_RECORDER_STREAM_SEND, in, 1, n_samples);
+        pwar_recorder_push(PWAR_RECORDER_STREAM_RETURN, out, NUM_CHANNELS, n_samples);
+    }
 }
 
 static void on_process(void *userdata, struct spa_io_position *position) {
     struct data *data = (struct data *)userdata;
-    float *in = pw_filter_get_dsp_buffer(data->in_port, position->clock.duration);
-    float *left_out = pw_filter_get_dsp_buffer(data->left_out_port, position->clock.duration);
-    float *right_out = pw_filter_get_dsp_buffer(data->right_out_port, position->clock.duration);
-
+    PWAR_RT_SECTION_ENTER("audio callback");
+    if (data->driver)
+        update_driver_clock(data, position);
     uint32_t n_samples = position->clock.duration;
+    pwar_watchdog_beat(&data->watchdog, PWAR_WATCHDOG_BEAT_AUDIO, position->clock.nsec);
+    if (n_samples != data->audio_rt_quantum) {
+        apply_audio_config(data, n_samples);
+    }
+    if (data->fanout) {
+        process_fanout(data, n_samples, position->clock.nsec);
+        PWAR_RT_SECTION_LEAVE();
+        return;
+    }
+
+    float *in = pw_filter_get_dsp_buffer(data->in_port, n_samples);
+    float *left_out = pw_filter_get_dsp_buffer(data->left_out_port, n_samples);
+    float *right_out = pw_filter_get_dsp_buffer(data->right_out_port, n_samples);
+    uint32_t resync = pwar_atomic_load_acquire_u32(&data->seq_resync);
+    if (resync != data->seq_resync_seen) {
+        data->seq_resync_seen = resync;
+        data->seq = 0;
+        // A new stream has to lock in again
+        restart_warmup(data);
+    }
+    uint32_t session_state = pwar_atomic_load_acquire_u32(&data->session.state);
+    uint32_t block_size = wire_block_size(data, n_samples);
+    if (session_state == PWAR_SESSION_STATE_ESTABLISHED && block_size != data->session.negotiated.linux_block_size) {
+        // The quantum changed, the receiver thread renegotiates and audio resumes once acknowledged
+        pwar_atomic_store_release_u32(&data->requested_block_size, block_size);
+    }
     if (data->passthrough_test) {
         if (left_out)
             memcpy(left_out, in, n_samples * sizeof(float));
         if (right_out)
             memcpy(right_out, in, n_samples * sizeof(float));
-        return;
     }
-
-    if (data->oneshot_mode) {
-        // Use one-shot processing, i.e. Linux send, Windows process, Linux receive in one go
-        process_one_shot(data, in, n_samples, left_out, right_out);
+    else if (!pwar_session_audio_allowed(&data->session) ||
+             (session_state == PWAR_SESSION_STATE_ESTABLISHED && block_size != data->session.negotiated.linux_block_size)) {
+        // Nothing may be sent before the remote has acknowledged the parameters
+        if (left_out)
+            memset(left_out, 0, n_samples * sizeof(float));
+        if (right_out)
+            memset(right_out, 0, n_samples * sizeof(float));
     }
     else {
-        // Use ping-pong processing, i.e. Linux send, Windows process, Linux receive in chunks
-        process_ping_pong(data, in, n_samples, left_out, right_out);
+        int warming_up = pwar_atomic_load_relaxed_u32(&data->warmup_state) == WARMUP_RUNNING;
+        // The remote is primed with silence until the return stream has locked in
+        float *send = warming_up ? warmup_silence : in;
+        int got_return;
+        if (data->direction == PWAR_DIRECTION_SEND_ONLY) {
+            // Every cycle's input goes out, there is no answer to wait for
+            got_return = process_send_only(data, send, n_samples, left_out, right_out);
+        }
+        else if (data->driver) {
+            // The return that started this cycle is played, the input goes out for the remote's next period
+            got_return = process_driven(data, send, n_samples, left_out, right_out);
+        }
+        else if (data->oneshot_mode) {
+            // Use one-shot processing, i.e. Linux send, Windows process, Linux receive in one go
+            got_return = process_one_shot(data, send, n_samples, left_out, right_out);
+        }
+        else if (data->pipeline_depth > 1) {
+            // Use pipelined processing, several blocks in flight for links slower than a cycle
+            got_return = process_pipelined(data, send, n_samples, left_out, right_out);
+        }
+        else {
+            // Use ping-pong processing, i.e. Linux send, Windows process, Linux receive in chunks
+            got_return = process_ping_pong(data, send, n_samples, left_out, right_out);
+        }
+        if (warming_up) {
+            advance_warmup(data, got_return, position->clock.nsec, left_out, right_out, n_samples);
+        }
     }
+
+    if (pwar_recorder_is_active()) {
+        float *send[1] = { in };
+        float *ret[NUM_CHANNELS] = { left_out, right_out };
+        pwar_recorder_push(PWAR_RECORDER_STREAM_SEND, send, 1, n_samples);
+        pwar_recorder_push(PWAR_RECORDER_STREAM_RETURN, ret, NUM_CHANNELS, n_samples);
+    }
+    PWAR_RT_SECTION_LEAVE();
 }
 
 static const struct pw_filter_events filter_events = {
@@ -291,77 +1601,491 @@ static void do_quit(void *userdata, int signal_number) {
     pw_main_loop_quit(data->loop);
 }
 
+// Warm-start from the calibration saved by the previous session with this peer
+static void profile_warm_start(struct data *data, const pwar_config_t *config) {
+    pwar_profile_t profile;
+    // Profiles are per peer, a fan-out has several
+    if (data->fanout) {
+        return;
+    }
+    if (pwar_profile_load(config->stream_ip, config->stream_port, &profile) < 0) {
+        return;
+    }
+    // A depth given by the user has to match, without one the profile's is used
+    uint32_t depth = data->oneshot_mode || config->pipeline_depth <= 0 ? 0 : data->pipeline_depth;
+    if (!pwar_profile_is_fresh(&profile, SAMPLE_RATE, NUM_CHANNELS, config->buffer_size, data->oneshot_mode, depth)) {
+        printf("[PWAR]: Ignoring stale calibration profile for %s:%d\n", config->stream_ip, config->stream_port);
+        return;
+    }
+    latency_manager_seed_calibration(&profile.calibration);
+    data->current_windows_buffer_size = profile.windows_buffer_size;
+    if (!data->oneshot_mode && profile.pipeline_depth > 1 && profile.pipeline_depth <= PWAR_SLOT_RING_MAX_DELAY)
+        data->pipeline_depth = (uint8_t)profile.pipeline_depth;
+    // Lost returns are only asked for again when the answer can still make it, from the first cycle on
+    pwar_nack_tracker_seed_rtt(&data->nacks, profile.nack_rtt_ns);
+    // The peer's timing is known, the lock-in only has to see the returns line up
+    data->warmup_lock_cycles = WARMUP_WARM_LOCK_CYCLES;
+    data->warmup_timeout_ns = WARMUP_WARM_TIMEOUT_NS;
+    printf("[PWAR]: Warm start from profile: RTT p50=%.3fms p99=%.3fms, remote buffer %u, depth %u, drift %.2fppm\n",
+           profile.calibration.rtt_p50_ns / 1000000.0, profile.calibration.rtt_p99_ns / 1000000.0,
+           profile.windows_buffer_size, data->oneshot_mode ? 0 : data->pipeline_depth, profile.calibration.clock_drift_ppm);
+
+    // Every block in flight buys one remote block of round trip, p99 says how many this peer needs
+    uint32_t remote_block = profile.windows_buffer_size > (uint32_t)config->buffer_size ? profile.windows_buffer_size
+                                                                                        : (uint32_t)config->buffer_size;
+    uint64_t block_ns = (uint64_t)remote_block * 1000000000ULL / SAMPLE_RATE;
+    uint32_t needed = (uint32_t)(profile.calibration.rtt_p99_ns / block_ns) + 1;
+    if (!data->oneshot_mode && needed > data->pipeline_depth && needed <= PWAR_SLOT_RING_MAX_DELAY) {
+        printf("[PWAR]: Warning: RTT p99 of %.3fms with this peer needs --depth %u, running with %u will play xruns\n",
+               profile.calibration.rtt_p99_ns / 1000000.0, needed, data->pipeline_depth);
+    }
+}
+
+static void profile_save(struct data *data, const pwar_config_t *config) {
+    pwar_profile_t profile;
+    if (data->fanout) {
+        return;
+    }
+    memset(&profile, 0, sizeof(profile));
+    latency_manager_get_calibration(&profile.calibration);
+    if (profile.calibration.rtt_samples < PWAR_PROFILE_MIN_RTT_SAMPLES) {
+        return; // Too short to be better than the profile we already have
+    }
+    profile.saved_at = (uint64_t)time(NULL);
+    profile.sample_rate = SAMPLE_RATE;
+    profile.channels = NUM_CHANNELS;
+    profile.buffer_size = config->buffer_size;
+    profile.oneshot_mode = data->oneshot_mode;
+    profile.windows_buffer_size = data->current_windows_buffer_size;
+    profile.pipeline_depth = data->oneshot_mode ? 0 : data->pipeline_depth;
+    profile.nack_rtt_ns = pwar_atomic_load_relaxed_u32(&data->nacks.rtt_ns);
+    pwar_profile_save(config->stream_ip, config->stream_port, &profile);
+}
+
+static void do_toggle_recording(void *userdata, int signal_number) {
+    const pwar_config_t *config = (const pwar_config_t *)userdata;
+    if (pwar_recorder_is_active()) {
+        pwar_recorder_stop();
+    } else {
+        pwar_recorder_start(config->record_dir, SAMPLE_RATE, 1, NUM_CHANNELS);
+    }
+}
+
 // Thread function to run PipeWire main loop for GUI mode
 static void *pipewire_thread_func(void *userdata) {
     struct data *data = (struct data *)userdata;
+    apply_thread_config(data, PWAR_THREAD_MAIN, PWAR_SCHED_DEFAULT, 0, data->rt_buffer_size);
+    print_thread_status(&data->thread_status[PWAR_THREAD_MAIN]);
     pw_main_loop_run(data->loop);
     return NULL;
 }
 
 // Extract common initialization logic
+static int start_receiver(struct data *data) {
+    data->recv_stop = RECV_RUN;
+    if (pthread_create(&data->recv_thread, NULL, receiver_thread, data) != 0) {
+        perror("Failed to start receiver thread");
+        return -1;
+    }
+    data->recv_thread_alive = 1;
+    return 0;
+}
+
+static void stop_receiver(struct data *data) {
+    if (!data->recv_thread_alive) return;
+    pwar_atomic_store_release_u32(&data->recv_stop, RECV_STOP_REQUESTED);
+    pthread_join(data->recv_thread, NULL);
+    data->recv_thread_alive = 0;
+}
+
+static int start_workers(struct data *data) {
+    for (uint32_t i = 1; i < data->num_workers; ++i) {
+        struct receive_worker *worker = &data->workers[i];
+        worker->stop = RECV_RUN;
+        if (pthread_create(&worker->thread, NULL, worker_thread, worker) != 0) {
+            perror("Failed to start receive worker");
+            return -1;
+        }
+        worker->alive = 1;
+    }
+    return 0;
+}
+
+static void stop_workers(struct data *data) {
+    for (uint32_t i = 1; i < data->num_workers; ++i) {
+        struct receive_worker *worker = &data->workers[i];
+        if (!worker->alive) continue;
+        pwar_atomic_store_release_u32(&worker->stop, RECV_STOP_REQUESTED);
+        pthread_join(worker->thread, NULL);
+        worker->alive = 0;
+    }
+}
+
+/*
+ * Runs on the watchdog thread. The receiver is asked to stop and replaced once it
+ * has. One that is stuck for good, in a lock or a loop, cannot be replaced: the
+ * request is withdrawn so it carries on should it ever get going again.
+ */
+static int restart_receiver(struct data *data) {
+    pwar_atomic_store_release_u32(&data->recv_stop, RECV_STOP_REQUESTED);
+    for (uint32_t waited_ms = 0;; waited_ms += 100) {
+        if (waited_ms >= RECEIVER_STOP_WAIT_MS && pwar_atomic_cas_u32(&data->recv_stop, RECV_STOP_REQUESTED, RECV_RUN)) {
+            printf("\033[0;31m[PWAR]: Receiver thread did not stop within %u ms, leaving it running\033[0m\n",
+                   RECEIVER_STOP_WAIT_MS);
+            return -1;
+        }
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += 100 * 1000 * 1000;
+        if (ts.tv_nsec >= 1000000000) {
+            ts.tv_sec += 1;
+            ts.tv_nsec -= 1000000000;
+        }
+        int rc = pthread_timedjoin_np(data->recv_thread, NULL, &ts);
+        if (rc == 0) break;
+        // Shutting down, cleanup joins the thread instead
+        if (rc != ETIMEDOUT || !pwar_watchdog_is_running(&data->watchdog)) return -1;
+    }
+    data->recv_thread_alive = 0;
+    // The new thread starts a fresh session, the stream state is reset once it is established
+    return start_receiver(data);
+}
+
+static int watchdog_recover(pwar_watchdog_beat_t beat, pwar_watchdog_action_t action, void *userdata) {
+    struct data *data = (struct data *)userdata;
+    (void)beat;
+    if (action == PWAR_WATCHDOG_ACTION_FLUSH) {
+        // The receiver thread owns the stream state, it flushes as soon as it runs again
+        pwar_atomic_fetch_add_u32(&data->flush_requested, 1);
+        return 0;
+    }
+    return restart_receiver(data);
+}
+
+static void start_watchdog(struct data *data, const pwar_config_t *config) {
+    if (config->watchdog_ms < 0) return;
+    if (pwar_watchdog_start(&data->watchdog, (uint32_t)config->watchdog_ms,
+                            (pwar_watchdog_action_t)config->watchdog_action, watchdog_recover, data) == 0) {
+        data->watchdog_enabled = 1;
+    } else {
+        return;
+    }
+    // The watchdog must never compete with the threads it watches, it can only be pinned
+    pwar_thread_config_t wd_config = data->threads[PWAR_THREAD_WATCHDOG];
+    if (wd_config.policy != PWAR_SCHED_DEFAULT) {
+        printf("[PWAR]: Warning: the watchdog always runs SCHED_OTHER, its policy setting is ignored\n");
+        wd_config.policy = PWAR_SCHED_DEFAULT;
+    }
+    pwar_thread_status_t status;
+    pwar_rt_apply(data->watchdog.thread, PWAR_THREAD_WATCHDOG, &wd_config, PWAR_SCHED_DEFAULT, 0, 0, &status);
+    publish_thread_status(data, PWAR_THREAD_WATCHDOG, &status);
+    if (!pwar_rt_is_default(&wd_config)) print_thread_status(&status);
+}
+
+static void stop_watchdog(struct data *data) {
+    if (!data->watchdog_enabled) return;
+    pwar_watchdog_stop(&data->watchdog);
+    data->watchdog_enabled = 0;
+}
+
+// Keeps the receiver's CPUs out of C-states slower than a fraction of the quantum
+static void hold_pm_qos(struct data *data, const pwar_config_t *config) {
+    if (!config->pm_qos) return;
+    int32_t latency_us = config->pm_qos_us > 0 ? config->pm_qos_us
+                                               : pwar_pm_qos_latency_for_quantum(config->buffer_size, SAMPLE_RATE);
+    // Pinned, only the CPUs the receiver and the audio thread run on, otherwise all of them
+    char cpus[2 * PWAR_MAX_CPU_LIST_LEN + 2] = "";
+    const char *receiver_cpus = config->threads[PWAR_THREAD_RECEIVER].cpus;
+    const char *audio_cpus = config->threads[PWAR_THREAD_AUDIO].cpus;
+    if (receiver_cpus[0])
+        snprintf(cpus, sizeof(cpus), "%s%s%s", receiver_cpus, audio_cpus[0] ? "," : "", audio_cpus);
+    int held = pwar_pm_qos_hold(&data->pm_qos, latency_us, cpus) == 0;
+    char line[192];
+    pwar_pm_qos_describe(&data->pm_qos, line, sizeof(line));
+    printf("[PWAR]: %s%s\n", held ? "" : "Warning: ", line);
+}
+
+static uint8_t pipeline_depth_from_config(const pwar_config_t *config) {
+    if (config->pipeline_depth <= 1) return 1;
+    if (config->pipeline_depth > PWAR_SLOT_RING_MAX_DELAY) return PWAR_SLOT_RING_MAX_DELAY;
+    return (uint8_t)config->pipeline_depth;
+}
+
+static int init_fanout(struct data *data, const pwar_config_t *config, const pwar_session_params_t *local) {
+    if (config->num_remotes > PWAR_MAX_REMOTES) {
+        fprintf(stderr, "[PWAR]: At most %d remotes are supported\n", PWAR_MAX_REMOTES);
+        return -1;
+    }
+    pwar_fanout_host_config_t hosts[PWAR_MAX_REMOTES];
+    uint32_t first_channel = 0;
+    for (int i = 0; i < config->num_remotes; ++i) {
+        const pwar_remote_config_t *remote = &config->remotes[i];
+        hosts[i].first_channel = first_channel;
+        hosts[i].channels = remote->channels > 0 ? (uint32_t)remote->channels : PWAR_CHANNELS;
+        hosts[i].deadline_us = remote->deadline_us > 0 ? (uint32_t)remote->deadline_us : 0;
+        hosts[i].miss_policy = (uint32_t)remote->miss_policy; // Same values as pwar_fanout_miss_t
+        first_channel += hosts[i].channels;
+    }
+
+    data->fanout = calloc(1, sizeof(*data->fanout));
+    data->links = calloc((size_t)config->num_remotes, sizeof(*data->links));
+    if (!data->fanout || !data->links) {
+        perror("fan-out allocation failed");
+        return -1;
+    }
+    if (pwar_fanout_init(data->fanout, hosts, (uint32_t)config->num_remotes, SAMPLE_RATE) < 0) {
+        fprintf(stderr, "[PWAR]: Invalid remote configuration, every remote takes 1 to %d channels\n", PWAR_CHANNELS);
+        return -1;
+    }
+    data->num_links = (uint32_t)config->num_remotes;
+
+    for (uint32_t i = 0; i < data->num_links; ++i) {
+        struct remote_link *link = &data->links[i];
+        link->worker = i % data->num_workers;
+        link->addr.sin_family = AF_INET;
+        link->addr.sin_port = htons(config->remotes[i].port > 0 ? config->remotes[i].port : DEFAULT_STREAM_PORT);
+        link->addr.sin_addr.s_addr = inet_addr(config->remotes[i].ip);
+        // Each host negotiates its own block size, its group is all it sends and returns
+        pwar_session_params_t params = *local;
+        params.send_channels = (uint16_t)hosts[i].channels;
+        params.return_channels = (uint16_t)hosts[i].channels;
+        pwar_session_init(&link->session, PWAR_SESSION_ROLE_INITIATOR, &params);
+        if (config->peer_timeout_ms > 0) {
+            pwar_session_set_liveness_timeout(&link->session, (uint64_t)config->peer_timeout_ms * 1000000);
+        }
+    }
+    return 0;
+}
+
+static void free_fanout(struct data *data) {
+    free(data->fanout);
+    free(data->links);
+    data->fanout = NULL;
+    data->links = NULL;
+    data->num_links = 0;
+}
+
+// Sharding only pays off with several remotes, and never more workers than remotes
+static uint32_t receive_workers_from_config(const pwar_config_t *config) {
+    int workers = config->receive_workers;
+    if (config->num_remotes <= 0 || workers <= 1) return 1;
+    if (workers > config->num_remotes) workers = config->num_remotes;
+    if (workers > PWAR_MAX_RECEIVE_WORKERS) workers = PWAR_MAX_RECEIVE_WORKERS;
+    return (uint32_t)workers;
+}
+
+static void close_recv_sockets(struct data *data) {
+    if (data->recv_sockfd > 0) {
+        close(data->recv_sockfd);
+    }
+    pwar_offload_rx_free(&data->recv_rx);
+    pwar_xdp_close(&data->xdp);
+    for (uint32_t i = 1; i < data->num_workers; ++i) {
+        if (data->workers[i].sockfd > 0) close(data->workers[i].sockfd);
+        pwar_offload_rx_free(&data->workers[i].rx);
+    }
+}
+
+/*
+ * GSO sends a oneshot cycle's segments with one call per path, GRO lets every
+ * receive socket take a run of returns with one read. Each falls back to one
+ * datagram per call on its own where the kernel or the NIC lack it.
+ */
+static void setup_offload(struct data *data, int enable) {
+    int gso = 1, gro = 1;
+    for (uint32_t p = 0; p < data->num_paths; ++p)
+        gso &= pwar_offload_tx_init(&data->path_tx[p], data->path_sockfd[p], enable);
+    gro &= pwar_offload_rx_init(&data->recv_rx, data->recv_sockfd, enable);
+    for (uint32_t i = 1; i < data->num_workers; ++i)
+        gro &= pwar_offload_rx_init(&data->workers[i].rx, data->workers[i].sockfd, enable);
+    if (enable)
+        printf("[PWAR]: UDP offload: GSO %s, GRO %s\n", gso ? "on" : "not available", gro ? "on" : "not available");
+}
+
+/*
+ * Hands the receiver the returns straight from the interface's RX ring, the
+ * socket stays open for whatever the XDP program lets through. Any failure
+ * leaves the socket path as it was.
+ */
+static void setup_xdp(struct data *data, const pwar_config_t *config) {
+    if (!config->xdp_ifname[0]) return;
+    if (data->num_workers > 1) {
+        printf("[PWAR]: Warning: AF_XDP only applies to a single receive thread, ignored\n");
+        return;
+    }
+    char line[192];
+    int ret = pwar_xdp_open(&data->xdp, config->xdp_ifname, (uint32_t)config->xdp_queue, DEFAULT_STREAM_PORT);
+    pwar_xdp_describe(&data->xdp, config->xdp_ifname, line, sizeof(line));
+    printf("[PWAR]: %s%s\n", ret < 0 ? "Warning: " : "", line);
+    if (ret < 0) return;
+    pwar_offload_rx_attach_xdp(&data->recv_rx, &data->xdp, RECV_TIMEOUT_US, config->xdp_busy_poll);
+    if (config->xdp_busy_poll && !config->threads[PWAR_THREAD_RECEIVER].cpus[0])
+        printf("[PWAR]: Warning: The receiver spins on the ring without a CPU of its own, pin it\n");
+}
+
 static int init_data_structure(struct data *data, const pwar_config_t *config) {
     memset(data, 0, sizeof(struct data));
+    // Every timestamp of the hot paths goes through here, the counter takes over once its rate is measured
+    printf("[PWAR]: Timestamps from the %s clock\n", pwar_clock_source_name(pwar_clock_init(PWAR_CLOCK_SOURCE_AUTO)));
     
-    setup_socket(data, config->stream_ip, config->stream_port);
-    setup_recv_socket(data, DEFAULT_STREAM_PORT);
+    setup_socket(data, config->stream_ip, config->stream_port, config->bind_ip);
+    setup_paths(data, config);
+    data->num_workers = receive_workers_from_config(config);
+    data->recv_sockfd = open_recv_socket(DEFAULT_STREAM_PORT, data->num_workers > 1);
+    for (uint32_t i = 1; i < data->num_workers; ++i) {
+        data->workers[i].data = data;
+        data->workers[i].index = i;
+        data->workers[i].sockfd = open_recv_socket(DEFAULT_STREAM_PORT, 1);
+    }
+    setup_offload(data, config->udp_offload);
+    setup_xdp(data, config);
+    pthread_mutex_init(&data->steer_mutex, NULL);
     pthread_mutex_init(&data->packet_mutex, NULL);
     pthread_cond_init(&data->packet_cond, NULL);
     data->packet_available = 0;
     pthread_mutex_init(&data->pwar_rcv_mutex, NULL);
+    pwar_pm_qos_init(&data->pm_qos);
     
     data->passthrough_test = config->passthrough_test;
-    data->oneshot_mode = config->oneshot_mode;
+    data->direction = config->num_remotes == 0 ? config->direction : PWAR_DIRECTION_DUPLEX;
+    if (config->direction != PWAR_DIRECTION_DUPLEX && config->num_remotes > 0)
+        printf("[PWAR]: Warning: Half-duplex sessions only apply to a single remote, ignored\n");
+    // A driver streams each cycle like oneshot, only the answer is played by the cycle it starts.
+    // Receive-only has nothing to send, the remote's returns are the only clock there is
+    data->driver = (config->driver || data->direction == PWAR_DIRECTION_RECEIVE_ONLY) && config->num_remotes == 0;
+    if (config->driver && !data->driver)
+        printf("[PWAR]: Warning: Driver mode only applies to a single remote, ignored\n");
+    data->driver_quantum = config->buffer_size;
+    data->oneshot_mode = config->oneshot_mode || data->driver || data->direction == PWAR_DIRECTION_SEND_ONLY;
+    data->pipeline_depth = pipeline_depth_from_config(config);
+    data->warmup_lock_cycles = WARMUP_LOCK_CYCLES;
+    data->warmup_timeout_ns = WARMUP_TIMEOUT_NS;
+    memcpy(data->threads, config->threads, sizeof(data->threads));
+    data->rt_buffer_size = config->buffer_size;
     data->sine_phase = 0.0f;
     pwar_router_init(&data->linux_router, NUM_CHANNELS);
+    pwar_slot_ring_init(&data->slot_ring);
+    pwar_nack_tracker_init(&data->nacks);
+
+    pwar_session_params_t local;
+    memset(&local, 0, sizeof(local));
+    local.sample_rate = SAMPLE_RATE;
+    local.linux_block_size = wire_block_size(data, config->buffer_size);
+    local.send_channels = data->direction == PWAR_DIRECTION_RECEIVE_ONLY ? 0 : NUM_CHANNELS;
+    local.return_channels = data->direction == PWAR_DIRECTION_SEND_ONLY ? 0 : NUM_CHANNELS;
+    local.sample_formats = PWAR_SAMPLE_FORMAT_F32;
+    local.features = PWAR_FEATURE_RETRANSMIT; // Only asked for when pipelined
+    if (data->driver)
+        local.features |= PWAR_FEATURE_CLOCK_MASTER;
+    pwar_session_init(&data->session, PWAR_SESSION_ROLE_INITIATOR, &local);
+    if (config->peer_timeout_ms > 0) {
+        pwar_session_set_liveness_timeout(&data->session, (uint64_t)config->peer_timeout_ms * 1000000);
+    }
+    if (config->num_remotes > 0 && init_fanout(data, config, &local) < 0) {
+        free_fanout(data);
+        close(data->sockfd);
+        close_paths(data);
+        close_recv_sockets(data);
+        return -1;
+    }
     
     return 0;
 }
 
+static struct port *add_mono_port(struct data *data, enum pw_direction direction, const char *name) {
+    return pw_filter_add_port(data->filter,
+        direction,
+        PW_FILTER_PORT_FLAG_MAP_BUFFERS,
+        sizeof(struct port),
+        pw_properties_new(
+            PW_KEY_FORMAT_DSP, "32 bit float mono audio",
+            PW_KEY_PORT_NAME, name,
+            NULL),
+        NULL, 0);
+}
+
+static void add_default_ports(struct data *data) {
+    data->in_port = add_mono_port(data, PW_DIRECTION_INPUT, "input");
+    data->left_out_port = add_mono_port(data, PW_DIRECTION_OUTPUT, "output-left");
+    data->right_out_port = add_mono_port(data, PW_DIRECTION_OUTPUT, "output-right");
+}
+
+// Fan-out presents one device, a numbered input and output per channel of all groups
+static void add_group_ports(struct data *data) {
+    char name[32];
+    for (uint32_t ch = 0; ch < data->fanout->channels; ++ch) {
+        snprintf(name, sizeof(name), "input_%u", ch + 1);
+        data->group_in_ports[ch] = add_mono_port(data, PW_DIRECTION_INPUT, name);
+        snprintf(name, sizeof(name), "output_%u", ch + 1);
+        data->group_out_ports[ch] = add_mono_port(data, PW_DIRECTION_OUTPUT, name);
+    }
+}
+
+// Main loop, every period. Runs the graph while no returns do, e.g. until the remote's clock is negotiated
+static void on_driver_timer(void *userdata, uint64_t expirations) {
+    struct data *data = (struct data *)userdata;
+    (void)expirations;
+    uint32_t triggers = pwar_atomic_load_relaxed_u32(&data->driver_triggers);
+    if (triggers != data->driver_triggers_seen) {
+        data->driver_triggers_seen = triggers;
+        data->driver_idle_periods = 0;
+        return;
+    }
+    if (++data->driver_idle_periods >= DRIVER_IDLE_PERIODS) {
+        pw_filter_trigger_process(data->filter);
+    }
+}
+
+static void start_driver_timer(struct data *data) {
+    struct pw_loop *loop = pw_main_loop_get_loop(data->loop);
+    uint64_t period_ns = quantum_ns(data->driver_quantum);
+    struct timespec interval = { .tv_sec = (time_t)(period_ns / 1000000000ULL), .tv_nsec = (long)(period_ns % 1000000000ULL) };
+    data->driver_timer = pw_loop_add_timer(loop, on_driver_timer, data);
+    if (!data->driver_timer) {
+        perror("driver timer");
+        return;
+    }
+    pw_loop_update_timer(loop, data->driver_timer, &interval, &interval, false);
+}
+
+// Before the filter goes away, nothing may trigger it anymore
+static void stop_driving(struct data *data) {
+    pwar_atomic_store_release_u32(&data->driving, 0);
+    pwar_atomic_fence_seq_cst();
+    // Let a trigger that already saw driving = 1 finish before the filter goes
+    while (pwar_atomic_load_acquire_u32(&data->triggering)) usleep(100);
+    if (data->driver_timer) {
+        pw_loop_destroy_source(pw_main_loop_get_loop(data->loop), data->driver_timer);
+        data->driver_timer = NULL;
+    }
+}
+
 static int create_pipewire_filter(struct data *data) {
     const struct spa_pod *params[1];
     uint8_t buffer[1024];
     struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
 
+    struct pw_properties *props = pw_properties_new(
+        PW_KEY_MEDIA_TYPE, "Audio",
+        PW_KEY_MEDIA_CATEGORY, "Filter",
+        PW_KEY_MEDIA_ROLE, "DSP",
+        NULL);
+    if (data->driver) {
+        pw_properties_set(props, PW_KEY_NODE_DRIVER, "true");
+        pw_properties_set(props, PW_KEY_PRIORITY_DRIVER, DRIVER_PRIORITY);
+    }
     data->filter = pw_filter_new_simple(
         pw_main_loop_get_loop(data->loop),
         "pwar",
-        pw_properties_new(
-            PW_KEY_MEDIA_TYPE, "Audio",
-            PW_KEY_MEDIA_CATEGORY, "Filter",
-            PW_KEY_MEDIA_ROLE, "DSP",
-            NULL),
+        props,
         &filter_events,
         data);
 
-    data->in_port = pw_filter_add_port(data->filter,
-        PW_DIRECTION_INPUT,
-        PW_FILTER_PORT_FLAG_MAP_BUFFERS,
-        sizeof(struct port),
-        pw_properties_new(
-            PW_KEY_FORMAT_DSP, "32 bit float mono audio",
-            PW_KEY_PORT_NAME, "input",
-            NULL),
-        NULL, 0);
-
-    data->left_out_port = pw_filter_add_port(data->filter,
-        PW_DIRECTION_OUTPUT,
-        PW_FILTER_PORT_FLAG_MAP_BUFFERS,
-        sizeof(struct port),
-        pw_properties_new(
-            PW_KEY_FORMAT_DSP, "32 bit float mono audio",
-            PW_KEY_PORT_NAME, "output-left",
-            NULL),
-        NULL, 0);
-
-    data->right_out_port = pw_filter_add_port(data->filter,
-        PW_DIRECTION_OUTPUT,
-        PW_FILTER_PORT_FLAG_MAP_BUFFERS,
-        sizeof(struct port),
-        pw_properties_new(
-            PW_KEY_FORMAT_DSP, "32 bit float mono audio",
-            PW_KEY_PORT_NAME, "output-right",
-            NULL),
-        NULL, 0);
+    if (data->fanout) {
+        add_group_ports(data);
+    } else {
+        add_default_ports(data);
+    }
 
     params[0] = spa_process_latency_build(&b,
         SPA_PARAM_ProcessLatency,
@@ -370,11 +2094,16 @@ static int create_pipewire_filter(struct data *data) {
         ));
 
     if (pw_filter_connect(data->filter,
-            PW_FILTER_FLAG_RT_PROCESS,
+            PW_FILTER_FLAG_RT_PROCESS | (data->driver ? PW_FILTER_FLAG_DRIVER : 0),
             params, 1) < 0) {
         return -1;
     }
 
+    if (data->driver) {
+        pwar_driver_clock_init(&data->driver_clock, SAMPLE_RATE);
+        start_driver_timer(data);
+        pwar_atomic_store_release_u32(&data->driving, 1);
+    }
     return 0;
 }
 
@@ -382,7 +2111,23 @@ static int create_pipewire_filter(struct data *data) {
 int pwar_requires_restart(const pwar_config_t *old_config, const pwar_config_t *new_config) {
     if (old_config->buffer_size != new_config->buffer_size ||
         strcmp(old_config->stream_ip, new_config->stream_ip) != 0 ||
-        old_config->stream_port != new_config->stream_port) {
+        old_config->stream_port != new_config->stream_port ||
+        memcmp(old_config->threads, new_config->threads, sizeof(old_config->threads)) != 0 ||
+        old_config->num_remotes != new_config->num_remotes ||
+        memcmp(old_config->remotes, new_config->remotes, sizeof(old_config->remotes)) != 0 ||
+        old_config->receive_workers != new_config->receive_workers ||
+        old_config->driver != new_config->driver ||
+        old_config->direction != new_config->direction ||
+        old_config->oneshot_mode != new_config->oneshot_mode ||
+        old_config->pipeline_depth != new_config->pipeline_depth ||
+        old_config->pm_qos != new_config->pm_qos ||
+        old_config->pm_qos_us != new_config->pm_qos_us ||
+        old_config->udp_offload != new_config->udp_offload ||
+        strcmp(old_config->xdp_ifname, new_config->xdp_ifname) != 0 ||
+        old_config->xdp_queue != new_config->xdp_queue ||
+        old_config->xdp_busy_poll != new_config->xdp_busy_poll ||
+        strcmp(old_config->bind_ip, new_config->bind_ip) != 0 ||
+        memcmp(&old_config->redundant_path, &new_config->redundant_path, sizeof(old_config->redundant_path)) != 0) {
         return 1;
     }
     return 0;
@@ -398,8 +2143,8 @@ int pwar_update_config(const pwar_config_t *config) {
     }
 
     // Apply runtime-changeable settings
+    // Oneshot mode and pipeline depth shape the stream timing and need a restart
     g_pwar_data->passthrough_test = config->passthrough_test;
-    g_pwar_data->oneshot_mode = config->oneshot_mode;
     g_current_config = *config;
     
     return 0;
@@ -427,7 +2172,12 @@ int pwar_init(const pwar_config_t *config) {
         return -1;
     }
 
-    pthread_create(&g_recv_thread, NULL, receiver_thread, g_pwar_data);
+    latency_manager_reset_calibration();
+    profile_warm_start(g_pwar_data, config);
+
+    start_receiver(g_pwar_data);
+    start_workers(g_pwar_data);
+    start_watchdog(g_pwar_data, config);
     pw_init(NULL, NULL);
     g_pwar_data->loop = pw_main_loop_new(NULL);
 
@@ -446,6 +2196,10 @@ int pwar_start(void) {
     }
     g_pwar_data->loop = pw_main_loop_new(NULL);
 
+    // Every start primes the remote and locks in before audio is heard
+    restart_warmup(g_pwar_data);
+    // The filter may get a different data thread, configure whichever runs the first cycle
+    g_pwar_data->audio_rt_quantum = 0;
     if (create_pipewire_filter(g_pwar_data) < 0) {
         return -1;
     }
@@ -456,6 +2210,10 @@ int pwar_start(void) {
     pthread_detach(pw_thread); // We don't need to join this thread
 
     g_pwar_running = 1;
+    hold_pm_qos(g_pwar_data, &g_current_config);
+    if (g_current_config.record) {
+        pwar_recording_start(NULL);
+    }
     return 0;
 }
 
@@ -470,10 +2228,15 @@ int pwar_stop(void) {
     }
 
     if (g_pwar_data->filter) {
+        stop_driving(g_pwar_data);
         pw_filter_destroy(g_pwar_data->filter);
         g_pwar_data->filter = NULL;
     }
+    // No more cycles on purpose, this is not a stall
+    pwar_watchdog_disarm(&g_pwar_data->watchdog, PWAR_WATCHDOG_BEAT_AUDIO);
+    pwar_pm_qos_release(&g_pwar_data->pm_qos);
 
+    pwar_recorder_stop();
     g_pwar_running = 0;
     return 0;
 }
@@ -484,8 +2247,11 @@ void pwar_cleanup(void) {
     }
 
     if (g_pwar_initialized) {
-        pthread_cancel(g_recv_thread);
-        pthread_join(g_recv_thread, NULL);
+        stop_watchdog(g_pwar_data);
+        stop_receiver(g_pwar_data);
+        stop_workers(g_pwar_data);
+        profile_save(g_pwar_data, &g_current_config);
+        stop_sessions(g_pwar_data);
 
         if (g_pwar_data->loop) {
             pw_main_loop_destroy(g_pwar_data->loop);
@@ -495,14 +2261,16 @@ void pwar_cleanup(void) {
         if (g_pwar_data->sockfd > 0) {
             close(g_pwar_data->sockfd);
         }
-        if (g_pwar_data->recv_sockfd > 0) {
-            close(g_pwar_data->recv_sockfd);
-        }
+        close_paths(g_pwar_data);
+        close_recv_sockets(g_pwar_data);
 
         pthread_mutex_destroy(&g_pwar_data->packet_mutex);
         pthread_cond_destroy(&g_pwar_data->packet_cond);
         pthread_mutex_destroy(&g_pwar_data->pwar_rcv_mutex);
+        pthread_mutex_destroy(&g_pwar_data->steer_mutex);
+        pwar_recorder_cleanup();
 
+        free_fanout(g_pwar_data);
         free(g_pwar_data);
         g_pwar_data = NULL;
         g_pwar_initialized = 0;
@@ -520,28 +2288,51 @@ int pwar_cli_run(const pwar_config_t *config) {
     setenv("PIPEWIRE_LATENCY", latency, 1);
 
     struct data data;
-    pthread_t recv_thread;
 
     // Use the shared initialization function
     if (init_data_structure(&data, config) < 0) {
         return -1;
     }
 
-    pthread_create(&recv_thread, NULL, receiver_thread, &data);
+    latency_manager_reset_calibration();
+    profile_warm_start(&data, config);
+
+    start_receiver(&data);
+    start_workers(&data);
+    start_watchdog(&data, config);
     pw_init(NULL, NULL);
     data.loop = pw_main_loop_new(NULL);
     pw_loop_add_signal(pw_main_loop_get_loop(data.loop), SIGINT, do_quit, &data);
     pw_loop_add_signal(pw_main_loop_get_loop(data.loop), SIGTERM, do_quit, &data);
+    pw_loop_add_signal(pw_main_loop_get_loop(data.loop), SIGUSR1, do_toggle_recording, (void *)config);
 
     if (create_pipewire_filter(&data) < 0) {
         fprintf(stderr, "can't connect\n");
         return -1;
     }
 
+    if (config->record) {
+        pwar_recorder_start(config->record_dir, SAMPLE_RATE, 1, NUM_CHANNELS);
+    }
+
+    apply_thread_config(&data, PWAR_THREAD_MAIN, PWAR_SCHED_DEFAULT, 0, data.rt_buffer_size);
+    print_thread_status(&data.thread_status[PWAR_THREAD_MAIN]);
+    hold_pm_qos(&data, config);
     pw_main_loop_run(data.loop);
+    pwar_pm_qos_release(&data.pm_qos);
+    stop_driving(&data);
     pw_filter_destroy(data.filter);
+    pwar_recorder_cleanup();
+
+    stop_watchdog(&data);
+    stop_receiver(&data);
+    stop_workers(&data);
+    // The receiver feeds the calibration, it is read once nothing writes it anymore
+    profile_save(&data, config);
+    stop_sessions(&data);
     pw_main_loop_destroy(data.loop);
     pw_deinit();
+    free_fanout(&data);
     return 0;
 }
 
@@ -550,6 +2341,18 @@ void pwar_get_latency_metrics(pwar_latency_metrics_t *metrics) {
     
     if (g_pwar_initialized && g_pwar_running) {
         latency_manager_get_current_metrics(metrics);
+        uint32_t state = pwar_atomic_load_acquire_u32(&g_pwar_data->warmup_state);
+        metrics->lock_in_ms = state == WARMUP_RUNNING ? 0.0 : pwar_atomic_load_acquire_u32(&g_pwar_data->lock_in_us) / 1000.0;
+        // Pipelined returns land in the slot ring, everything else is reassembled by the router
+        metrics->recovered_segments = pwar_atomic_load_relaxed_u32(&g_pwar_data->nacks.recovered);
+        if (g_pwar_data->fanout) {
+            metrics->lost_segments = 0;
+            for (uint32_t i = 0; i < g_pwar_data->num_links; ++i)
+                metrics->lost_segments += pwar_atomic_load_relaxed_u32(&g_pwar_data->fanout->hosts[i].ring.missing);
+        } else if (!g_pwar_data->oneshot_mode && g_pwar_data->pipeline_depth > 1)
+            metrics->lost_segments = pwar_atomic_load_relaxed_u32(&g_pwar_data->slot_ring.missing);
+        else
+            metrics->lost_segments = pwar_atomic_load_relaxed_u32(&g_pwar_data->linux_router.packets_lost);
     } else {
         // Return zeros if not running
         metrics->audio_proc_min_ms = 0.0;
@@ -562,12 +2365,141 @@ void pwar_get_latency_metrics(pwar_latency_metrics_t *metrics) {
         metrics->rtt_max_ms = 0.0;
         metrics->rtt_avg_ms = 0.0;
         metrics->xruns = 0;
+        metrics->lock_in_ms = 0.0;
+        metrics->lost_segments = 0;
+        metrics->recovered_segments = 0;
+    }
+}
+
+int pwar_get_thread_status(pwar_thread_status_t *status, int max_threads) {
+    if (!status || max_threads <= 0) return 0;
+    int n = max_threads < PWAR_THREAD_COUNT ? max_threads : PWAR_THREAD_COUNT;
+    for (int i = 0; i < n; ++i) {
+        if (g_pwar_initialized && g_pwar_data) {
+            read_thread_status(g_pwar_data, i, &status[i]);
+        } else {
+            memset(&status[i], 0, sizeof(status[i]));
+            status[i].thread = pwar_rt_thread_name(i);
+        }
+    }
+    return n;
+}
+
+int pwar_get_remote_status(pwar_remote_status_t *status, int max_remotes) {
+    if (!status || max_remotes <= 0 || !g_pwar_initialized || !g_pwar_data || !g_pwar_data->fanout) return 0;
+    int n = max_remotes < (int)g_pwar_data->num_links ? max_remotes : (int)g_pwar_data->num_links;
+    for (int i = 0; i < n; ++i) {
+        const struct remote_link *link = &g_pwar_data->links[i];
+        const pwar_fanout_host_t *host = &g_pwar_data->fanout->hosts[i];
+        pwar_remote_status_t *out = &status[i];
+        memset(out, 0, sizeof(*out));
+        strncpy(out->ip, g_current_config.remotes[i].ip, sizeof(out->ip) - 1);
+        out->port = ntohs(link->addr.sin_port);
+        out->first_channel = host->config.first_channel;
+        out->channels = host->config.channels;
+        out->state = pwar_session_state_name(pwar_atomic_load_acquire_u32(&link->session.state));
+        out->remote_block_size = link->session.negotiated.remote_block_size;
+        out->delivered = pwar_atomic_load_relaxed_u32(&host->delivered);
+        out->missed = pwar_atomic_load_relaxed_u32(&host->missed);
+        out->max_consecutive_misses = pwar_atomic_load_relaxed_u32(&host->max_consecutive_misses);
+        out->past_deadline = pwar_atomic_load_relaxed_u32(&host->past_deadline);
+        out->last_return_us = pwar_atomic_load_relaxed_u32(&host->last_return_us);
+    }
+    return n;
+}
+
+int pwar_get_path_status(pwar_path_status_t *status, int max_paths) {
+    if (!status || max_paths <= 0 || !g_pwar_initialized || !g_pwar_data || g_pwar_data->num_paths < 2) return 0;
+    int n = max_paths < (int)g_pwar_data->num_paths ? max_paths : (int)g_pwar_data->num_paths;
+    uint32_t leader = pwar_atomic_load_relaxed_u32(&g_pwar_data->path_leader);
+    for (int i = 0; i < n; ++i) {
+        const pwar_path_stats_t *stats = &g_pwar_data->paths.stats[i];
+        pwar_path_status_t *out = &status[i];
+        memset(out, 0, sizeof(*out));
+        strncpy(out->remote_ip, inet_ntoa(g_pwar_data->path_addr[i].sin_addr), sizeof(out->remote_ip) - 1);
+        out->port = ntohs(g_pwar_data->path_addr[i].sin_port);
+        strncpy(out->bind_ip, i == 0 ? g_current_config.bind_ip : g_current_config.redundant_path.bind_ip, sizeof(out->bind_ip) - 1);
+        out->received = pwar_atomic_load_relaxed_u32(&stats->received);
+        out->first = pwar_atomic_load_relaxed_u32(&stats->first);
+        out->lost = pwar_atomic_load_relaxed_u32(&stats->lost);
+        out->latency_us = pwar_atomic_load_relaxed_u32(&stats->latency_ns) / 1000;
+        out->lag_us = pwar_atomic_load_relaxed_u32(&stats->lag_ns) / 1000;
+        out->carrying = leader == (uint32_t)i;
     }
+    return n;
 }
 
 uint32_t pwar_get_current_windows_buffer_size(void) {
     if (g_pwar_initialized && g_pwar_running && g_pwar_data) {
-        return g_pwar_data->current_windows_buffer_size;
+        if (!g_pwar_data->fanout) return g_pwar_data->current_windows_buffer_size;
+        // The largest host buffer, that host sets the common delay
+        uint32_t largest = 0;
+        for (uint32_t i = 0; i < g_pwar_data->num_links; ++i) {
+            uint32_t block = g_pwar_data->links[i].session.negotiated.remote_block_size;
+            if (block > largest) largest = block;
+        }
+        return largest;
     }
     return 0;
 }
+
+int pwar_recording_start(const char *dir) {
+    if (!g_pwar_initialized) {
+        return -1;
+    }
+    if (dir) {
+        strncpy(g_current_config.record_dir, dir, sizeof(g_current_config.record_dir) - 1);
+        g_current_config.record_dir[sizeof(g_current_config.record_dir) - 1] = '\0';
+    }
+    return pwar_recorder_start(g_current_config.record_dir, SAMPLE_RATE, 1, NUM_CHANNELS);
+}
+
+void pwar_recording_stop(void) {
+    pwar_recorder_stop();
+}
+
+int pwar_is_recording(void) {
+    return pwar_recorder_is_active();
+}
+
+void pwar_get_recording_stats(pwar_recording_stats_t *stats) {
+    pwar_recorder_get_stats(stats);
+}
+
+void pwar_get_watchdog_stats(pwar_watchdog_stats_t *stats) {
+    if (!g_pwar_data || !g_pwar_data->watchdog_enabled) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    pwar_watchdog_get_stats(&g_pwar_data->watchdog, stats);
+}
+
+int pwar_get_watchdog_events(pwar_watchdog_event_t *events, int max_events) {
+    if (!g_pwar_data || !g_pwar_data->watchdog_enabled) return 0;
+    return pwar_watchdog_get_events(&g_pwar_data->watchdog, events, max_events);
+}
+
+void pwar_get_session_info(pwar_session_info_t *info) {
+    if (!info) return;
+    memset(info, 0, sizeof(*info));
+    if (!g_pwar_initialized || !g_pwar_data) return;
+    // When fanning out, the first host stands for all, pwar_get_remote_status has the others
+    const pwar_session_t *session = g_pwar_data->fanout ? &g_pwar_data->links[0].session : &g_pwar_data->session;
+    info->state = pwar_session_state_name(pwar_atomic_load_acquire_u32(&session->state));
+    info->audio_allowed = pwar_session_audio_allowed(session);
+    info->session_id = session->session_id;
+    info->generation = session->generation;
+    info->version = session->version;
+    info->remote_block_size = session->negotiated.remote_block_size;
+    info->sample_formats = session->negotiated.sample_formats;
+    info->features = session->negotiated.features;
+    info->pipeline_depth = g_pwar_data->oneshot_mode ? 0 : g_pwar_data->pipeline_depth;
+    if (g_pwar_data->fanout) {
+        uint32_t block = session->negotiated.linux_block_size ? session->negotiated.linux_block_size : (uint32_t)g_current_config.buffer_size;
+        info->pipeline_depth = g_pwar_data->pipeline_depth;
+        info->pipeline_delay = pwar_atomic_load_relaxed_u32(&g_pwar_data->fanout_delay) * block;
+    } else if (!g_pwar_data->oneshot_mode && g_pwar_data->pipeline_depth > 1) {
+        uint32_t block = session->negotiated.linux_block_size ? session->negotiated.linux_block_size : (uint32_t)g_current_config.buffer_size;
+        info->pipeline_delay = pipeline_delay_cycles(g_pwar_data, block) * block;
+    }
+}
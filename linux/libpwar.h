@@ -9,6 +9,61 @@ extern "C" {
 #endif
 
 #define PWAR_MAX_IP_LEN 64
+#define PWAR_MAX_PATH_LEN 256
+#define PWAR_MAX_CPU_LIST_LEN 64
+#define PWAR_MAX_IFNAME_LEN 16
+#define PWAR_MAX_REMOTES 32
+#define PWAR_MAX_RECEIVE_WORKERS 8
+
+typedef enum {
+    PWAR_THREAD_RECEIVER = 0, // Drains the socket and drives the session
+    PWAR_THREAD_AUDIO,        // PipeWire data thread running the process callback
+    PWAR_THREAD_MAIN,         // PipeWire main loop
+    PWAR_THREAD_WATCHDOG,     // Stall watchdog, always SCHED_OTHER, only pinned
+    PWAR_THREAD_COUNT
+} pwar_thread_t;
+
+typedef enum {
+    PWAR_SCHED_DEFAULT = 0,   // Keep what PWAR or PipeWire picks
+    PWAR_SCHED_OTHER,
+    PWAR_SCHED_FIFO,
+    PWAR_SCHED_RR,
+    PWAR_SCHED_DEADLINE       // Period follows the quantum
+} pwar_sched_policy_t;
+
+typedef struct {
+    int policy;                          // pwar_sched_policy_t
+    int priority;                        // 1-99 for FIFO and RR, 0 = default
+    int runtime_us;                      // SCHED_DEADLINE runtime per period, 0 = a quarter of the period
+    char cpus[PWAR_MAX_CPU_LIST_LEN];    // CPU list like "2,3" or "2-5", empty = not pinned
+} pwar_thread_config_t;
+
+typedef enum {
+    PWAR_MISS_SILENCE = 0,    // The host's group plays silence
+    PWAR_MISS_HOLD,           // The host's group repeats its last good block
+    PWAR_MISS_DRY             // The host's group plays its own input, unprocessed
+} pwar_miss_policy_t;
+
+typedef enum {
+    PWAR_DIRECTION_DUPLEX = 0,  // Input goes to the remote and its answer comes back
+    PWAR_DIRECTION_SEND_ONLY,   // Linux -> remote, e.g. a remote recorder
+    PWAR_DIRECTION_RECEIVE_ONLY // remote -> Linux on the remote's clock, e.g. remote instruments
+} pwar_direction_t;
+
+typedef struct {
+    char ip[PWAR_MAX_IP_LEN];
+    int port;
+    int channels;                        // Channels in this host's group, 1-2, 0 = 2
+    int deadline_us;                     // Returns later than this after the block was sent are dropped, 0 = none
+    int miss_policy;                     // pwar_miss_policy_t
+} pwar_remote_config_t;
+
+// A second network path to the remote, every audio datagram is sent over both
+typedef struct {
+    char remote_ip[PWAR_MAX_IP_LEN];     // The remote's address on this path, empty = no second path
+    int remote_port;                     // 0 = stream_port
+    char bind_ip[PWAR_MAX_IP_LEN];       // Local address the copies leave from, empty = the kernel picks
+} pwar_path_config_t;
 
 typedef struct {
     char stream_ip[PWAR_MAX_IP_LEN];
@@ -16,8 +71,85 @@ typedef struct {
     int passthrough_test;
     int oneshot_mode;
     int buffer_size;
+    int pipeline_depth;                  // Blocks in flight unless oneshot, 1 = ping-pong, 0 = the peer's profile or ping-pong
+    int peer_timeout_ms;                 // Remote silent this long is considered lost, 0 = default
+    int watchdog_ms;                     // Heartbeat age counted as a stall, 0 = default, < 0 disables
+    int watchdog_action;                 // pwar_watchdog_action_t
+    int record;                          // Start recording as soon as audio runs
+    char record_dir[PWAR_MAX_PATH_LEN];  // Directory for recordings, "." if empty
+    pwar_thread_config_t threads[PWAR_THREAD_COUNT]; // Scheduling and affinity per pwar_thread_t
+    int num_remotes;                     // Fan channel groups out to remotes[] instead of stream_ip, 0 = single remote
+    pwar_remote_config_t remotes[PWAR_MAX_REMOTES]; // Groups follow each other, remote 0 gets channels 1 and up
+    int receive_workers;                 // Receive threads sharing the remotes, each with its own socket, 0 = 1
+    char bind_ip[PWAR_MAX_IP_LEN];       // Local address the stream leaves from, empty = the kernel picks
+    pwar_path_config_t redundant_path;   // Single remote only, returns are told apart by their source address
+    int driver;                          // Drive the PipeWire graph from the remote's returns, single remote only
+    int direction;                       // pwar_direction_t, single remote only
+    int pm_qos;                          // Keep the CPUs out of slow C-states while running
+    int pm_qos_us;                       // Wake-up latency limit, 0 = a tenth of the quantum
+    int udp_offload;                     // Send segmented cycles with GSO, read returns with GRO
+    char xdp_ifname[PWAR_MAX_IFNAME_LEN]; // Receive returns through AF_XDP on this interface, empty = socket only
+    int xdp_queue;                       // Its RX queue the returns are steered to
+    int xdp_busy_poll;                   // Receiver spins on the ring instead of sleeping, needs a CPU of its own
 } pwar_config_t;
 
+typedef struct {
+    int active;
+    uint64_t bytes_written;
+    uint32_t blocks_dropped;  // Blocks lost because the disk fell behind
+    uint32_t write_errors;
+    int direct_io;            // Files are written with O_DIRECT
+} pwar_recording_stats_t;
+
+typedef enum {
+    PWAR_WATCHDOG_ACTION_NONE = 0, // Only log stalls
+    PWAR_WATCHDOG_ACTION_FLUSH,    // Drop stale packets and stream state
+    PWAR_WATCHDOG_ACTION_RESTART   // Restart the receiver thread and its session
+} pwar_watchdog_action_t;
+
+typedef struct {
+    uint64_t timestamp_ns;    // CLOCK_MONOTONIC
+    const char *heartbeat;    // "receiver", "packets" or "audio"
+    const char *event;        // "stalled", "recovered", "flushed", "restarted", "backlog flushed", ...
+    uint32_t stalled_ms;      // For a backlog flush, how far behind its oldest datagram was
+} pwar_watchdog_event_t;
+
+typedef struct {
+    int enabled;
+    uint32_t stalls;
+    uint32_t flushes;
+    uint32_t restarts;
+    uint32_t longest_stall_ms;
+    uint32_t backlog_flushes; // Runs of stale returns the receiver dropped at once
+    uint32_t backlog_dropped; // Datagrams dropped by them
+} pwar_watchdog_stats_t;
+
+typedef struct {
+    const char *thread;       // "receiver", "audio", "main" or "watchdog"
+    int applied;              // The thread is running and its settings were applied
+    int policy;               // Effective pwar_sched_policy_t, DEFAULT if unknown
+    int priority;
+    uint32_t runtime_us;      // SCHED_DEADLINE only
+    uint32_t period_us;
+    char cpus[PWAR_MAX_CPU_LIST_LEN]; // Effective affinity
+    const char *failed;       // "policy", "affinity" or NULL if every setting took
+    int error;                // errno of the failure
+} pwar_thread_status_t;
+
+typedef struct {
+    char ip[PWAR_MAX_IP_LEN];
+    int port;
+    uint32_t first_channel;   // 0 based
+    uint32_t channels;
+    const char *state;        // Human readable session state
+    uint32_t remote_block_size;
+    uint32_t delivered;       // Blocks played from this host
+    uint32_t missed;          // Blocks covered by the miss policy
+    uint32_t max_consecutive_misses;
+    uint32_t past_deadline;   // Returns dropped for arriving after the deadline
+    uint32_t last_return_us;  // Send to return time of the last block
+} pwar_remote_status_t;
+
 int pwar_cli_run(const pwar_config_t *config);
 
 // New GUI functions
@@ -35,6 +167,53 @@ void pwar_get_latency_metrics(pwar_latency_metrics_t *metrics);
 // Get current Windows buffer size in samples
 uint32_t pwar_get_current_windows_buffer_size(void);
 
+typedef struct {
+    const char *state;         // Human readable session state
+    int audio_allowed;         // Parameters are acknowledged and audio flows
+    uint32_t session_id;
+    uint32_t generation;       // Number of renegotiations
+    uint32_t version;          // Negotiated protocol version
+    uint32_t remote_block_size;
+    uint32_t sample_formats;   // PWAR_SAMPLE_FORMAT_*
+    uint32_t features;         // PWAR_FEATURE_*
+    uint32_t pipeline_depth;   // Blocks in flight, 0 = oneshot
+    uint32_t pipeline_delay;   // Fixed send to return delay in samples added by pipelining, 0 if not pipelined
+} pwar_session_info_t;
+
+// Get the negotiated session parameters
+void pwar_get_session_info(pwar_session_info_t *info);
+
+// Record the send and return streams to WAV files, dir NULL uses the configured directory
+int pwar_recording_start(const char *dir);
+void pwar_recording_stop(void);
+int pwar_is_recording(void);
+void pwar_get_recording_stats(pwar_recording_stats_t *stats);
+
+// Stall watchdog, events are returned oldest first
+void pwar_get_watchdog_stats(pwar_watchdog_stats_t *stats);
+int pwar_get_watchdog_events(pwar_watchdog_event_t *events, int max_events);
+
+// Effective scheduling and affinity of every PWAR thread, indexed by pwar_thread_t
+int pwar_get_thread_status(pwar_thread_status_t *status, int max_threads);
+
+// Per host state when fanning out, returns the number of remotes filled in
+int pwar_get_remote_status(pwar_remote_status_t *status, int max_remotes);
+
+typedef struct {
+    char remote_ip[PWAR_MAX_IP_LEN];
+    int port;
+    char bind_ip[PWAR_MAX_IP_LEN];  // Empty if the kernel picks
+    uint32_t received;        // Returns that arrived over this path
+    uint32_t first;           // Returns that were first, the ones played
+    uint32_t lost;            // Returns only the other path delivered
+    uint32_t latency_us;      // Smoothed send to return time of its copies
+    uint32_t lag_us;          // Smoothed time its copies came after the first one
+    int carrying;             // Delivered most returns lately
+} pwar_path_status_t;
+
+// Per path counters with a redundant path, returns the number of paths filled in, 0 without one
+int pwar_get_path_status(pwar_path_status_t *status, int max_paths);
+
 #ifdef __cplusplus
 }
 #endif
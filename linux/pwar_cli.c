@@ -9,11 +9,91 @@
 #include <stdlib.h>
 #include <string.h>
 #include "libpwar.h"
+#include "pwar_rt.h"
 
 #define DEFAULT_STREAM_IP "192.168.66.3"
 #define DEFAULT_STREAM_PORT 8321
 #define DEFAULT_BUFFER_SIZE 64
 
+// Splits "thread=value", returns the pwar_thread_t or -1
+static int parse_thread_arg(const char *arg, const char **value) {
+    char name[16];
+    const char *eq = strchr(arg, '=');
+    if (!eq || (size_t)(eq - arg) >= sizeof(name)) return -1;
+    memcpy(name, arg, eq - arg);
+    name[eq - arg] = '\0';
+    *value = eq + 1;
+    return pwar_rt_thread_from_name(name);
+}
+
+// "IP[:PORT][,channels=N][,deadline=US][,miss=silence|hold|dry]", returns -1 if malformed
+static int parse_remote_arg(const char *arg, pwar_remote_config_t *remote) {
+    static const char *miss_names[] = { "silence", "hold", "dry" };
+    char buf[256];
+    if (strlen(arg) >= sizeof(buf)) return -1;
+    strcpy(buf, arg);
+    memset(remote, 0, sizeof(*remote));
+    remote->port = DEFAULT_STREAM_PORT;
+
+    char *save = NULL;
+    char *token = strtok_r(buf, ",", &save);
+    if (!token) return -1;
+    char *colon = strchr(token, ':');
+    if (colon) {
+        *colon = '\0';
+        remote->port = atoi(colon + 1);
+    }
+    if (!*token || strlen(token) >= sizeof(remote->ip) || remote->port <= 0) return -1;
+    strcpy(remote->ip, token);
+
+    while ((token = strtok_r(NULL, ",", &save)) != NULL) {
+        if (strncmp(token, "channels=", 9) == 0) {
+            remote->channels = atoi(token + 9);
+            if (remote->channels < 1 || remote->channels > 2) return -1;
+        } else if (strncmp(token, "deadline=", 9) == 0) {
+            remote->deadline_us = atoi(token + 9);
+        } else if (strncmp(token, "miss=", 5) == 0) {
+            remote->miss_policy = -1;
+            for (int m = 0; m < 3; ++m) {
+                if (strcmp(token + 5, miss_names[m]) == 0) remote->miss_policy = m;
+            }
+            if (remote->miss_policy < 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// "IP[:PORT][,bind=LOCAL_IP]", returns -1 if malformed
+static int parse_path_arg(const char *arg, pwar_path_config_t *path) {
+    char buf[256];
+    if (strlen(arg) >= sizeof(buf)) return -1;
+    strcpy(buf, arg);
+    memset(path, 0, sizeof(*path));
+
+    char *save = NULL;
+    char *token = strtok_r(buf, ",", &save);
+    if (!token) return -1;
+    char *colon = strchr(token, ':');
+    if (colon) {
+        *colon = '\0';
+        path->remote_port = atoi(colon + 1);
+        if (path->remote_port <= 0) return -1;
+    }
+    if (!*token || strlen(token) >= sizeof(path->remote_ip)) return -1;
+    strcpy(path->remote_ip, token);
+
+    while ((token = strtok_r(NULL, ",", &save)) != NULL) {
+        if (strncmp(token, "bind=", 5) == 0 && token[5] && strlen(token + 5) < sizeof(path->bind_ip)) {
+            strcpy(path->bind_ip, token + 5);
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
 int main(int argc, char *argv[]) {
     pwar_config_t config;
     memset(&config, 0, sizeof(config));
@@ -22,6 +102,7 @@ int main(int argc, char *argv[]) {
     config.passthrough_test = 0;
     config.oneshot_mode = 0;
     config.buffer_size = DEFAULT_BUFFER_SIZE;
+    config.pipeline_depth = 0; // From the peer's profile, ping-pong without one
 
     for (int i = 1; i < argc; ++i) {
         if ((strcmp(argv[i], "--ip") == 0 || strcmp(argv[i], "-i") == 0) && i + 1 < argc) {
@@ -33,17 +114,190 @@ int main(int argc, char *argv[]) {
             config.passthrough_test = 1;
         } else if ((strcmp(argv[i], "--oneshot") == 0)) {
             config.oneshot_mode = 1;
+        } else if ((strcmp(argv[i], "--driver") == 0)) {
+            config.driver = 1;
+        } else if ((strcmp(argv[i], "--pm-qos") == 0)) {
+            config.pm_qos = 1;
+            // The limit is optional, sized from the quantum without it
+            if (i + 1 < argc && argv[i + 1][0] >= '0' && argv[i + 1][0] <= '9')
+                config.pm_qos_us = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "--udp-offload") == 0)) {
+            config.udp_offload = 1;
+        } else if ((strcmp(argv[i], "--xdp") == 0) && i + 1 < argc) {
+            // "IFNAME[:QUEUE]", queue 0 without one
+            const char *arg = argv[++i];
+            const char *colon = strchr(arg, ':');
+            size_t len = colon ? (size_t)(colon - arg) : strlen(arg);
+            if (len == 0 || len >= sizeof(config.xdp_ifname)) {
+                fprintf(stderr, "Invalid --xdp %s, expected IFNAME[:QUEUE]\n", arg);
+                return 1;
+            }
+            memcpy(config.xdp_ifname, arg, len);
+            config.xdp_ifname[len] = '\0';
+            config.xdp_queue = colon ? atoi(colon + 1) : 0;
+        } else if ((strcmp(argv[i], "--xdp-busy-poll") == 0)) {
+            config.xdp_busy_poll = 1;
+        } else if ((strcmp(argv[i], "--direction") == 0) && i + 1 < argc) {
+            const char *direction = argv[++i];
+            if (strcmp(direction, "send") == 0) {
+                config.direction = PWAR_DIRECTION_SEND_ONLY;
+            } else if (strcmp(direction, "receive") == 0) {
+                config.direction = PWAR_DIRECTION_RECEIVE_ONLY;
+            } else if (strcmp(direction, "duplex") == 0) {
+                config.direction = PWAR_DIRECTION_DUPLEX;
+            } else {
+                fprintf(stderr, "Invalid --direction %s, expected duplex, send or receive\n", direction);
+                return 1;
+            }
+        } else if ((strcmp(argv[i], "--depth") == 0) && i + 1 < argc) {
+            config.pipeline_depth = atoi(argv[++i]);
+            config.oneshot_mode = config.pipeline_depth == 0;
         } else if ((strcmp(argv[i], "--buffer_size") == 0 || strcmp(argv[i], "-b") == 0) && i + 1 < argc) {
             config.buffer_size = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "--peer-timeout") == 0) && i + 1 < argc) {
+            config.peer_timeout_ms = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "--watchdog") == 0) && i + 1 < argc) {
+            config.watchdog_ms = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "--watchdog-action") == 0) && i + 1 < argc) {
+            const char *action = argv[++i];
+            if (strcmp(action, "flush") == 0) {
+                config.watchdog_action = PWAR_WATCHDOG_ACTION_FLUSH;
+            } else if (strcmp(action, "restart") == 0) {
+                config.watchdog_action = PWAR_WATCHDOG_ACTION_RESTART;
+            } else {
+                config.watchdog_action = PWAR_WATCHDOG_ACTION_NONE;
+            }
+        } else if ((strcmp(argv[i], "--record") == 0) && i + 1 < argc) {
+            config.record = 1;
+            strncpy(config.record_dir, argv[++i], sizeof(config.record_dir) - 1);
+            config.record_dir[sizeof(config.record_dir) - 1] = '\0';
+        } else if ((strcmp(argv[i], "--sched") == 0) && i + 1 < argc) {
+            // receiver=fifo:90, audio=deadline, main=other
+            const char *value;
+            int thread = parse_thread_arg(argv[++i], &value);
+            char policy[16];
+            const char *colon = strchr(value, ':');
+            size_t len = colon ? (size_t)(colon - value) : strlen(value);
+            if (thread < 0 || len >= sizeof(policy)) {
+                fprintf(stderr, "Invalid --sched %s, expected THREAD=POLICY[:PRIORITY]\n", argv[i]);
+                return 1;
+            }
+            memcpy(policy, value, len);
+            policy[len] = '\0';
+            config.threads[thread].policy = pwar_rt_policy_from_name(policy);
+            if (config.threads[thread].policy < 0) {
+                fprintf(stderr, "Unknown scheduling policy %s\n", policy);
+                return 1;
+            }
+            config.threads[thread].priority = colon ? atoi(colon + 1) : 0;
+        } else if ((strcmp(argv[i], "--cpus") == 0) && i + 1 < argc) {
+            const char *value;
+            int thread = parse_thread_arg(argv[++i], &value);
+            if (thread < 0 || pwar_rt_count_cpus(value) <= 0 || strlen(value) >= PWAR_MAX_CPU_LIST_LEN) {
+                fprintf(stderr, "Invalid --cpus %s, expected THREAD=CPU_LIST like receiver=2-3\n", argv[i]);
+                return 1;
+            }
+            strcpy(config.threads[thread].cpus, value);
+        } else if ((strcmp(argv[i], "--dl-runtime") == 0) && i + 1 < argc) {
+            const char *value;
+            int thread = parse_thread_arg(argv[++i], &value);
+            if (thread < 0) {
+                fprintf(stderr, "Invalid --dl-runtime %s, expected THREAD=MICROSECONDS\n", argv[i]);
+                return 1;
+            }
+            config.threads[thread].runtime_us = atoi(value);
+        } else if ((strcmp(argv[i], "--remote") == 0) && i + 1 < argc) {
+            // Repeat for every host, each takes the next group of channels
+            if (config.num_remotes >= PWAR_MAX_REMOTES) {
+                fprintf(stderr, "At most %d remotes are supported\n", PWAR_MAX_REMOTES);
+                return 1;
+            }
+            if (parse_remote_arg(argv[++i], &config.remotes[config.num_remotes]) < 0) {
+                fprintf(stderr, "Invalid --remote %s, expected IP[:PORT][,channels=1|2][,deadline=US][,miss=silence|hold|dry]\n", argv[i]);
+                return 1;
+            }
+            config.num_remotes++;
+        } else if ((strcmp(argv[i], "--workers") == 0) && i + 1 < argc) {
+            config.receive_workers = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "--bind") == 0) && i + 1 < argc) {
+            strncpy(config.bind_ip, argv[++i], sizeof(config.bind_ip) - 1);
+            config.bind_ip[sizeof(config.bind_ip) - 1] = '\0';
+        } else if ((strcmp(argv[i], "--redundant") == 0) && i + 1 < argc) {
+            // The remote's address on a second network, every audio datagram is sent over both
+            if (parse_path_arg(argv[++i], &config.redundant_path) < 0) {
+                fprintf(stderr, "Invalid --redundant %s, expected IP[:PORT][,bind=LOCAL_IP]\n", argv[i]);
+                return 1;
+            }
         }
     }
 
     printf("Starting PWAR with config:\n");
-    printf("  Stream IP: %s\n", config.stream_ip);
-    printf("  Stream Port: %d\n", config.stream_port);
+    if (config.num_remotes == 0) {
+        printf("  Stream IP: %s\n", config.stream_ip);
+        printf("  Stream Port: %d\n", config.stream_port);
+        if (config.bind_ip[0])
+            printf("  Bind: %s\n", config.bind_ip);
+        if (config.redundant_path.remote_ip[0]) {
+            printf("  Redundant Path: %s:%d", config.redundant_path.remote_ip,
+                   config.redundant_path.remote_port > 0 ? config.redundant_path.remote_port : config.stream_port);
+            if (config.redundant_path.bind_ip[0])
+                printf(" from %s", config.redundant_path.bind_ip);
+            printf("\n");
+        }
+    }
+    static const char *miss_names[] = { "silence", "hold", "dry" };
+    int first_channel = 1;
+    for (int r = 0; r < config.num_remotes; ++r) {
+        const pwar_remote_config_t *remote = &config.remotes[r];
+        int channels = remote->channels > 0 ? remote->channels : 2;
+        printf("  Remote %d: %s:%d, channels %d-%d, ", r, remote->ip, remote->port, first_channel, first_channel + channels - 1);
+        if (remote->deadline_us > 0)
+            printf("deadline %d us, ", remote->deadline_us);
+        printf("miss %s\n", miss_names[remote->miss_policy]);
+        first_channel += channels;
+    }
+    if (config.num_remotes > 1 && config.receive_workers > 1)
+        printf("  Receive Workers: %d\n", config.receive_workers < config.num_remotes ? config.receive_workers : config.num_remotes);
     printf("  Passthrough Test: %s\n", config.passthrough_test ? "Enabled" : "Disabled");
     printf("  Oneshot Mode: %s\n", config.oneshot_mode ? "Enabled" : "Disabled");
+    if (config.driver)
+        printf("  Driver: Graph cycles follow the remote's returns\n");
+    if (config.direction == PWAR_DIRECTION_SEND_ONLY)
+        printf("  Direction: Send only, nothing comes back\n");
+    else if (config.direction == PWAR_DIRECTION_RECEIVE_ONLY)
+        printf("  Direction: Receive only, graph cycles follow the remote's returns\n");
     printf("  Buffer Size: %d\n", config.buffer_size);
+    if (!config.oneshot_mode && config.pipeline_depth <= 0)
+        printf("  Pipeline Depth: from profile, 1 without one\n");
+    else
+        printf("  Pipeline Depth: %d\n", config.oneshot_mode ? 0 : (config.pipeline_depth > 1 ? config.pipeline_depth : 1));
+    if (config.pm_qos) {
+        if (config.pm_qos_us > 0)
+            printf("  PM QoS: %d us\n", config.pm_qos_us);
+        else
+            printf("  PM QoS: a tenth of the quantum\n");
+    }
+    if (config.udp_offload)
+        printf("  UDP Offload: GSO and GRO where available\n");
+    if (config.xdp_ifname[0])
+        printf("  AF_XDP: %s queue %d%s\n", config.xdp_ifname, config.xdp_queue, config.xdp_busy_poll ? ", busy polling" : "");
+    printf("  Peer Timeout: %d ms\n", config.peer_timeout_ms > 0 ? config.peer_timeout_ms : 500);
+    if (config.watchdog_ms < 0) {
+        printf("  Watchdog: Disabled\n");
+    } else {
+        static const char *actions[] = { "log only", "flush", "restart" };
+        printf("  Watchdog: %d ms, %s\n", config.watchdog_ms > 0 ? config.watchdog_ms : 50, actions[config.watchdog_action]);
+    }
+    printf("  Recording: %s\n", config.record ? config.record_dir : "Disabled (SIGUSR1 toggles)");
+    for (int t = 0; t < PWAR_THREAD_COUNT; ++t) {
+        const pwar_thread_config_t *tc = &config.threads[t];
+        if (pwar_rt_is_default(tc)) continue;
+        printf("  Thread %s: %s", pwar_rt_thread_name(t),
+               tc->policy == PWAR_SCHED_DEFAULT ? "default policy" : pwar_rt_policy_name(tc->policy));
+        if (tc->priority) printf(" %d", tc->priority);
+        if (tc->policy == PWAR_SCHED_DEADLINE && tc->runtime_us) printf(", runtime %d us", tc->runtime_us);
+        printf(", cpus %s\n", tc->cpus[0] ? tc->cpus : "any");
+    }
 
     char latency[32];
     snprintf(latency, sizeof(latency), "%d/48000", config.buffer_size);
@@ -0,0 +1,124 @@
+/*
+ * pwar_clock_bench.c - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+/*
+ * Cost per timestamp of every clock source on this machine, and how closely
+ * the counter based pwar_clock sources follow CLOCK_MONOTONIC.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "../protocol/pwar_clock.h"
+
+static volatile uint64_t sink;
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t read_posix(clockid_t id) {
+    struct timespec ts;
+    clock_gettime(id, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t read_monotonic(void) { return read_posix(CLOCK_MONOTONIC); }
+static uint64_t read_monotonic_raw(void) { return read_posix(CLOCK_MONOTONIC_RAW); }
+static uint64_t read_monotonic_coarse(void) { return read_posix(CLOCK_MONOTONIC_COARSE); }
+
+static double cost_ns(uint64_t (*read)(void), uint32_t iterations) {
+    uint64_t acc = 0;
+    for (uint32_t i = 0; i < iterations / 10; ++i) acc += read(); // Warm up
+    uint64_t start = monotonic_ns();
+    for (uint32_t i = 0; i < iterations; ++i) acc += read();
+    uint64_t elapsed = monotonic_ns() - start;
+    sink = acc;
+    return (double)elapsed / iterations;
+}
+
+// Largest and average distance from the reference while it runs through a few resyncs
+static void tracking(double seconds, double *max_us, double *avg_us) {
+    uint64_t end = pwar_clock_reference_ns() + (uint64_t)(seconds * 1e9);
+    double max = 0.0, total = 0.0;
+    uint32_t samples = 0;
+    struct timespec pause = { 0, 1000000 };
+    while (pwar_clock_reference_ns() < end) {
+        uint64_t before = pwar_clock_reference_ns();
+        uint64_t now = pwar_clock_now_ns();
+        uint64_t after = pwar_clock_reference_ns();
+        double off = ((double)now - (double)(before / 2 + after / 2)) / 1000.0;
+        if (off < 0) off = -off;
+        if (off > max) max = off;
+        total += off;
+        samples++;
+        nanosleep(&pause, NULL);
+    }
+    *max_us = max;
+    *avg_us = samples ? total / samples : 0.0;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t iterations = 10000000;
+    double seconds = 3.0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        } else {
+            printf("Usage: %s [--iterations N] [--seconds S]\n", argv[0]);
+            printf("  --iterations N Reads per source for the cost (default: 10000000)\n");
+            printf("  --seconds S    Time each counter source is checked against CLOCK_MONOTONIC (default: 3)\n");
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if (iterations < 10) iterations = 10;
+
+    printf("%-28s %10s\n", "source", "ns/call");
+    printf("%-28s %10.1f\n", "CLOCK_MONOTONIC", cost_ns(read_monotonic, iterations));
+    printf("%-28s %10.1f\n", "CLOCK_MONOTONIC_RAW", cost_ns(read_monotonic_raw, iterations));
+    printf("%-28s %10.1f   (jiffy resolution)\n", "CLOCK_MONOTONIC_COARSE", cost_ns(read_monotonic_coarse, iterations));
+
+    static const pwar_clock_source_t sources[] = { PWAR_CLOCK_SOURCE_OS, PWAR_CLOCK_SOURCE_TSC, PWAR_CLOCK_SOURCE_CNTVCT };
+    double max_us[3] = {0}, avg_us[3] = {0};
+    int tracked[3] = {0};
+    for (int i = 0; i < 3; ++i) {
+        char name[64];
+        if (pwar_clock_init(sources[i]) < 0) {
+            printf("%-28s %10s\n", pwar_clock_source_name(sources[i]), "n/a");
+            continue;
+        }
+        // Past the rate measurement, the cost is the one of the steady state
+        uint64_t start = pwar_clock_reference_ns();
+        while (pwar_clock_source() != sources[i] && pwar_clock_reference_ns() - start < 1000000000ULL) pwar_clock_now_ns();
+        if (sources[i] != PWAR_CLOCK_SOURCE_OS) {
+            snprintf(name, sizeof(name), "%s counter only", pwar_clock_source_name(sources[i]));
+            printf("%-28s %10.1f\n", name, cost_ns(pwar_clock_ticks, iterations));
+        }
+        snprintf(name, sizeof(name), "pwar_clock_now_ns (%s)", pwar_clock_source_name(sources[i]));
+        printf("%-28s %10.1f\n", name, cost_ns(pwar_clock_now_ns, iterations));
+        if (sources[i] != PWAR_CLOCK_SOURCE_OS && seconds > 0) {
+            tracking(seconds, &max_us[i], &avg_us[i]);
+            tracked[i] = 1;
+        }
+    }
+
+    int source = pwar_clock_init(PWAR_CLOCK_SOURCE_AUTO);
+    printf("\nAuto selects: %s\n", pwar_clock_source_name(source));
+    for (int i = 0; i < 3; ++i) {
+        if (!tracked[i]) continue;
+        printf("%s vs CLOCK_MONOTONIC over %.1f s: max %.2f us, average %.2f us\n",
+               pwar_clock_source_name(sources[i]), seconds, max_us[i], avg_us[i]);
+    }
+    return 0;
+}
@@ -214,6 +214,49 @@ ApplicationWindow {
                     onCheckedChanged: pwarController.passthroughTest = checked
                 }
 
+                Label { 
+                    text: "Record"
+                    color: textPrimary
+                    font.bold: true
+                }
+                RowLayout {
+                    Layout.fillWidth: true
+                    spacing: 10
+
+                    CheckBox { 
+                        id: recordCheck
+                        checked: pwarController.recording
+                        onCheckedChanged: pwarController.recording = checked
+                    }
+                    TextField {
+                        id: recordDirField
+                        Layout.fillWidth: true
+                        placeholderText: "Recording directory"
+                        color: textPrimary
+                        placeholderTextColor: textSecondary
+                        selectByMouse: true
+                        enabled: !(pwarController.isRunning && pwarController.recording)
+                        text: pwarController.recordDirectory
+                        onTextChanged: {
+                            if (text !== pwarController.recordDirectory) {
+                                pwarController.recordDirectory = text;
+                            }
+                        }
+
+                        background: Rectangle {
+                            color: graphiteMedium
+                            radius: 4
+                            border.color: parent.activeFocus ? orangeAccent : (parent.hovered ? orangeHover : "#555555")
+                            border.width: parent.activeFocus ? 2 : 1
+                        }
+                    }
+                    Label {
+                        visible: pwarController.isRunning && pwarController.recording
+                        text: "Dropped: " + pwarController.recordDroppedBlocks
+                        color: pwarController.recordDroppedBlocks > 0 ? "#FF6B6B" : textSecondary
+                    }
+                }
+
                 // bottom breathing room
                 Item { Layout.columnSpan: 2; height: 4 }
             }
@@ -493,6 +536,47 @@ ApplicationWindow {
                     Layout.leftMargin: statusValueLeftMargin
                 }
 
+                Label { 
+                    text: "Lock-in (ms)"
+                    color: textPrimary
+                    font.bold: true
+                }
+                Label { 
+                    text: pwarController.lockInMs > 0 ? Number(pwarController.lockInMs).toFixed(1) : "-"
+                    color: orangeAccent
+                    font.bold: true
+                    Layout.fillWidth: true
+                    Layout.leftMargin: statusValueLeftMargin
+                }
+
+                Label { 
+                    text: "Lost segments"
+                    color: textPrimary
+                    font.bold: true
+                }
+                Label { 
+                    text: pwarController.lostSegments + (pwarController.recoveredSegments > 0 ? " (" + pwarController.recoveredSegments + " recovered)" : "")
+                    color: pwarController.lostSegments > 0 ? "#FF6B6B" : textSecondary
+                    font.bold: true
+                    Layout.fillWidth: true
+                    Layout.leftMargin: statusValueLeftMargin
+                }
+
+                Label { 
+                    text: "Threads"
+                    color: textPrimary
+                    font.bold: true
+                    Layout.alignment: Qt.AlignTop
+                }
+                Label { 
+                    text: pwarController.threadStatus !== "" ? pwarController.threadStatus : "-"
+                    color: pwarController.threadStatus.indexOf("failed") >= 0 ? "#FF6B6B" : textSecondary
+                    font.pixelSize: 11
+                    wrapMode: Text.Wrap
+                    Layout.fillWidth: true
+                    Layout.leftMargin: statusValueLeftMargin
+                }
+
                 Label { 
                     text: "ASIO Buffer Size"
                     color: textPrimary
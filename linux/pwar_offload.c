@@ -0,0 +1,216 @@
+/*
+ * pwar_offload.c - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+#define _GNU_SOURCE
+#include "pwar_offload.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/udp.h>
+
+// Older libc headers lack them, the kernel has had them since 4.18 and 5.0
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+int pwar_offload_tx_init(pwar_offload_tx_t *tx, int sockfd, int enable) {
+    memset(tx, 0, sizeof(*tx));
+    tx->sockfd = sockfd;
+    if (!enable) return 0;
+    // Kernels without GSO do not know the option at all
+    int size = 0;
+    socklen_t len = sizeof(size);
+    tx->gso = getsockopt(sockfd, SOL_UDP, UDP_SEGMENT, &size, &len) == 0;
+    return tx->gso;
+}
+
+static ssize_t send_segmented(int sockfd, const char *buffer, size_t segment_size, uint32_t count,
+                              const struct sockaddr_in *to) {
+    struct iovec iov = { (void *)buffer, segment_size * count };
+    char control[CMSG_SPACE(sizeof(uint16_t))];
+    memset(control, 0, sizeof(control));
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = (void *)to;
+    msg.msg_namelen = sizeof(*to);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    uint16_t gso_size = (uint16_t)segment_size;
+    memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+    return sendmsg(sockfd, &msg, 0);
+}
+
+int pwar_offload_send(pwar_offload_tx_t *tx, const void *segments, size_t segment_size, uint32_t count,
+                      const struct sockaddr_in *to) {
+    const char *next = (const char *)segments;
+    uint32_t per_call = segment_size ? (uint32_t)(PWAR_OFFLOAD_MAX_BYTES / segment_size) : 0;
+    if (per_call > PWAR_OFFLOAD_MAX_SEGMENTS) per_call = PWAR_OFFLOAD_MAX_SEGMENTS;
+    while (count > 1 && tx->gso && per_call > 1) {
+        uint32_t n = count < per_call ? count : per_call;
+        if (send_segmented(tx->sockfd, next, segment_size, n, to) < 0) {
+            // EIO is a NIC without checksum offload, EINVAL a segment the route's MTU can't carry
+            if (errno != EIO && errno != EINVAL && errno != ENOPROTOOPT && errno != EOPNOTSUPP) return -1;
+            tx->gso = 0;
+            break;
+        }
+        tx->sends++;
+        tx->segments += n;
+        next += segment_size * n;
+        count -= n;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        if (sendto(tx->sockfd, next, segment_size, 0, (const struct sockaddr *)to, sizeof(*to)) < 0) return -1;
+        tx->sends++;
+        tx->segments++;
+        next += segment_size;
+    }
+    return 0;
+}
+
+int pwar_offload_rx_init(pwar_offload_rx_t *rx, int sockfd, int enable) {
+    memset(rx, 0, sizeof(*rx));
+    rx->sockfd = sockfd;
+    if (!enable) return 0;
+    int one = 1;
+    if (setsockopt(sockfd, SOL_UDP, UDP_GRO, &one, sizeof(one)) < 0) return 0;
+    rx->buffer = malloc(PWAR_OFFLOAD_RX_SIZE);
+    if (!rx->buffer) {
+        // A coalesced read into a datagram sized buffer would cut off all but the first
+        int zero = 0;
+        setsockopt(sockfd, SOL_UDP, UDP_GRO, &zero, sizeof(zero));
+        return 0;
+    }
+    rx->gro = 1;
+    return 1;
+}
+
+void pwar_offload_rx_free(pwar_offload_rx_t *rx) {
+    free(rx->buffer);
+    rx->buffer = NULL;
+    rx->gro = 0;
+    rx->length = rx->offset = 0;
+}
+
+int pwar_offload_rx_pending(const pwar_offload_rx_t *rx) {
+    return rx->offset < rx->length || (rx->xdp && pwar_xdp_pending(rx->xdp));
+}
+
+void pwar_offload_rx_attach_xdp(pwar_offload_rx_t *rx, pwar_xdp_t *xdp, int timeout_us, int busy_poll) {
+    rx->xdp = xdp;
+    rx->timeout_us = timeout_us;
+    rx->busy_poll = busy_poll;
+}
+
+static ssize_t read_coalesced(pwar_offload_rx_t *rx, int flags) {
+    struct iovec iov = { rx->buffer, PWAR_OFFLOAD_RX_SIZE };
+    char control[CMSG_SPACE(sizeof(int))];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = &rx->from;
+    msg.msg_namelen = sizeof(rx->from);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    ssize_t n = recvmsg(rx->sockfd, &msg, flags);
+    if (n < 0) return n;
+    rx->length = (size_t)n;
+    rx->offset = 0;
+    rx->segment_size = (size_t)n;
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+            int gso_size;
+            memcpy(&gso_size, CMSG_DATA(cmsg), sizeof(gso_size));
+            if (gso_size > 0) rx->segment_size = (size_t)gso_size;
+        }
+    }
+    rx->reads++;
+    return n;
+}
+
+static ssize_t recv_socket(pwar_offload_rx_t *rx, void *out, size_t size, int flags, struct sockaddr_in *from) {
+    if (rx->offset >= rx->length) {
+        if (!rx->gro) {
+            socklen_t from_len = sizeof(*from);
+            ssize_t n = recvfrom(rx->sockfd, out, size, flags, (struct sockaddr *)from, &from_len);
+            if (n >= 0) {
+                rx->reads++;
+                rx->datagrams++;
+            }
+            return n;
+        }
+        ssize_t n = read_coalesced(rx, flags);
+        if (n < 0) return n;
+        if (n == 0) {
+            *from = rx->from;
+            rx->datagrams++;
+            return 0;
+        }
+    }
+    size_t length = rx->length - rx->offset;
+    if (length > rx->segment_size) length = rx->segment_size;
+    size_t copied = length < size ? length : size;
+    memcpy(out, rx->buffer + rx->offset, copied);
+    rx->offset += length;
+    *from = rx->from;
+    rx->datagrams++;
+    return (ssize_t)copied;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// The ring first, then the socket, and if both are empty wait for either
+static ssize_t recv_xdp(pwar_offload_rx_t *rx, void *out, size_t size, int flags, struct sockaddr_in *from) {
+    uint64_t deadline = 0;
+    for (uint32_t spins = 0;; ++spins) {
+        ssize_t n = pwar_xdp_recv(rx->xdp, out, size, from);
+        if (n >= 0) {
+            rx->datagrams++;
+            return n;
+        }
+        // Spinning checks the socket now and then, it only gets the odd packet the program lets through
+        if (!rx->busy_poll || (spins & 255) == 0) {
+            n = recv_socket(rx, out, size, flags | MSG_DONTWAIT, from);
+            if (n >= 0 || (flags & MSG_DONTWAIT) || errno != EAGAIN) return n;
+            if (!deadline) deadline = now_ns() + (uint64_t)rx->timeout_us * 1000;
+            else if (now_ns() >= deadline) return -1;
+        }
+        if (!rx->busy_poll) {
+            struct pollfd fds[2] = { { rx->xdp->xsk_fd, POLLIN, 0 }, { rx->sockfd, POLLIN, 0 } };
+            int timeout_ms = (rx->timeout_us + 999) / 1000;
+            if (poll(fds, 2, timeout_ms) == 0) {
+                errno = EAGAIN;
+                return -1;
+            }
+        }
+    }
+}
+
+ssize_t pwar_offload_recv(pwar_offload_rx_t *rx, void *out, size_t size, int flags, struct sockaddr_in *from) {
+    if (rx->xdp && rx->offset >= rx->length) return recv_xdp(rx, out, size, flags, from);
+    return recv_socket(rx, out, size, flags, from);
+}
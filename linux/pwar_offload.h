@@ -0,0 +1,96 @@
+/*
+ * pwar_offload.h - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+/*
+ * UDP segmentation offload for blocks sent as many datagrams.
+ *
+ * With GSO (UDP_SEGMENT) the sender hands the kernel all segments of a block in
+ * one buffer and one sendmsg(), and the kernel or the NIC cuts it into
+ * datagrams of segment_size. With GRO (UDP_GRO) the kernel hands a run of
+ * same-sized datagrams from one sender to a single recvmsg(), and the reader
+ * below gives them out one by one. Either way every datagram still goes over
+ * the wire on its own, the remote sees no difference, and the cost of going
+ * through the stack is paid once per run instead of once per datagram.
+ *
+ * Both need Linux 4.18 (GSO) or 5.0 (GRO). Where the kernel or the NIC refuse,
+ * datagrams are sent and read one at a time as before.
+ */
+
+#ifndef PWAR_OFFLOAD
+#define PWAR_OFFLOAD
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <netinet/in.h>
+#include "pwar_xdp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PWAR_OFFLOAD_MAX_SEGMENTS 64      // Per sendmsg(), UDP_MAX_SEGMENTS on older kernels
+#define PWAR_OFFLOAD_MAX_BYTES 65507      // Largest UDP payload over IPv4, the coalesced run included
+#define PWAR_OFFLOAD_RX_SIZE 65536
+
+typedef struct {
+    int sockfd;
+    int gso;                  // Segments go out with UDP_SEGMENT, cleared if the kernel refuses
+    uint32_t sends;           // Stats: sendmsg() and sendto() calls
+    uint32_t segments;        // Stats: datagrams sent
+} pwar_offload_tx_t;
+
+typedef struct {
+    int sockfd;
+    int gro;                  // UDP_GRO is on, reads may return several datagrams
+    char *buffer;             // The last coalesced read, PWAR_OFFLOAD_RX_SIZE
+    size_t length;
+    size_t offset;            // Next datagram in buffer
+    size_t segment_size;      // Size of every datagram in buffer, the last may be shorter
+    struct sockaddr_in from;
+    pwar_xdp_t *xdp;          // AF_XDP ring read ahead of sockfd, NULL = none
+    int timeout_us;           // How long a blocking read waits with xdp, sockfd's own timeout otherwise
+    int busy_poll;            // With xdp, spin on the ring instead of sleeping in poll()
+    uint32_t reads;           // Stats: reads that returned data
+    uint32_t datagrams;       // Stats: datagrams handed out
+} pwar_offload_rx_t;
+
+// GSO on sockfd if enable is set and the kernel has it. Returns whether it is on
+int pwar_offload_tx_init(pwar_offload_tx_t *tx, int sockfd, int enable);
+
+/*
+ * Sends count datagrams of segment_size that follow each other in segments.
+ * With GSO they go out in as few calls as the kernel's limits allow. Returns 0,
+ * or -1 with errno set by the call that failed.
+ */
+int pwar_offload_send(pwar_offload_tx_t *tx, const void *segments, size_t segment_size, uint32_t count,
+                      const struct sockaddr_in *to);
+
+// GRO on sockfd if enable is set and the kernel has it. Returns whether it is on
+int pwar_offload_rx_init(pwar_offload_rx_t *rx, int sockfd, int enable);
+void pwar_offload_rx_free(pwar_offload_rx_t *rx);
+
+/*
+ * Reads xdp's ring before sockfd, which still gets whatever the XDP program
+ * passes on. A blocking read waits on both for up to timeout_us.
+ */
+void pwar_offload_rx_attach_xdp(pwar_offload_rx_t *rx, pwar_xdp_t *xdp, int timeout_us, int busy_poll);
+
+/*
+ * The next datagram, like recvfrom(). Datagrams left from a coalesced read or
+ * waiting in the AF_XDP ring come first without a syscall, flags only apply to
+ * the read that follows them.
+ */
+ssize_t pwar_offload_recv(pwar_offload_rx_t *rx, void *out, size_t size, int flags, struct sockaddr_in *from);
+
+// Datagrams of the last read are still waiting to be handed out
+int pwar_offload_rx_pending(const pwar_offload_rx_t *rx);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* PWAR_OFFLOAD */
@@ -0,0 +1,199 @@
+/*
+ * pwar_offload_bench.c - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+/*
+ * Segments per second per core with and without UDP segmentation offload.
+ *
+ * A sender blasts blocks of --segments audio datagrams over loopback and a
+ * receiver drains them, once with every datagram sent and read on its own,
+ * once with GSO on the sender and once with GRO on the receiver as well. Both
+ * threads' CPU time is measured, so the per core numbers hold even when they
+ * share one CPU. Loopback leaves out the NIC, on real hardware GSO can move the
+ * segmentation into the NIC as well.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "../protocol/pwar_packet.h"
+#include "../protocol/pwar_atomic.h"
+#include "pwar_offload.h"
+
+#define BENCH_PORT 8431
+#define BENCH_MAX_SEGMENTS 32
+
+typedef struct {
+    const char *name;
+    int gso;
+    int gro;
+} bench_mode_t;
+
+static const bench_mode_t modes[] = {
+    { "plain", 0, 0 },
+    { "gso", 1, 0 },
+    { "gso+gro", 1, 1 },
+};
+
+static uint32_t segments = 8;
+static double seconds = 2.0;
+
+static volatile uint32_t running;
+static volatile uint32_t sent, received;
+
+static uint64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t thread_cpu_ns(pthread_t thread) {
+    clockid_t clock;
+    if (pthread_getcpuclockid(thread, &clock) != 0) return 0;
+    return clock_ns(clock);
+}
+
+static int open_socket(uint16_t port, int rcvbuf) {
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sockfd < 0) {
+        perror("socket creation failed");
+        exit(EXIT_FAILURE);
+    }
+    int buf = 4 * 1024 * 1024;
+    setsockopt(sockfd, SOL_SOCKET, rcvbuf ? SO_RCVBUF : SO_SNDBUF, &buf, sizeof(buf));
+    // Lets the receiver notice the end of a run without traffic
+    struct timeval timeout = { 0, 100000 };
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (bind(sockfd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("socket bind failed");
+        exit(EXIT_FAILURE);
+    }
+    return sockfd;
+}
+
+static void *sender_thread(void *userdata) {
+    pwar_offload_tx_t *tx = (pwar_offload_tx_t *)userdata;
+    static pwar_packet_t block[BENCH_MAX_SEGMENTS];
+    memset(block, 0, sizeof(block));
+    struct sockaddr_in dest;
+    memset(&dest, 0, sizeof(dest));
+    dest.sin_family = AF_INET;
+    dest.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    dest.sin_port = htons(BENCH_PORT);
+
+    for (uint32_t seq = 0; pwar_atomic_load_relaxed_u32(&running); ++seq) {
+        for (uint32_t i = 0; i < segments; ++i) {
+            block[i].n_samples = PWAR_PACKET_MAX_CHUNK_SIZE;
+            block[i].seq = seq;
+            block[i].num_packets = segments;
+            block[i].packet_index = i;
+        }
+        // A full socket buffer drops the block, the receiver only counts what arrives
+        if (pwar_offload_send(tx, block, sizeof(block[0]), segments, &dest) == 0)
+            pwar_atomic_fetch_add_u32(&sent, segments);
+    }
+    return NULL;
+}
+
+static void *receiver_thread(void *userdata) {
+    pwar_offload_rx_t *rx = (pwar_offload_rx_t *)userdata;
+    pwar_packet_t packet;
+    while (pwar_atomic_load_relaxed_u32(&running)) {
+        struct sockaddr_in from;
+        ssize_t n = pwar_offload_recv(rx, &packet, sizeof(packet), 0, &from);
+        if (n == (ssize_t)sizeof(packet)) pwar_atomic_fetch_add_u32(&received, 1);
+    }
+    return NULL;
+}
+
+static void run(const bench_mode_t *mode) {
+    int recv_sockfd = open_socket(BENCH_PORT, 1);
+    int send_sockfd = open_socket(0, 0);
+    pwar_offload_tx_t tx;
+    pwar_offload_rx_t rx;
+    int gso = pwar_offload_tx_init(&tx, send_sockfd, mode->gso);
+    int gro = pwar_offload_rx_init(&rx, recv_sockfd, mode->gro);
+    if (gso != mode->gso || gro != mode->gro) {
+        printf("%-8s  not available on this kernel\n", mode->name);
+        pwar_offload_rx_free(&rx);
+        close(send_sockfd);
+        close(recv_sockfd);
+        return;
+    }
+
+    sent = received = 0;
+    running = 1;
+    pthread_t sender, receiver;
+    pthread_create(&receiver, NULL, receiver_thread, &rx);
+    pthread_create(&sender, NULL, sender_thread, &tx);
+
+    // Let the queues fill before measuring
+    usleep(200000);
+    uint32_t sent_start = sent, received_start = received;
+    uint32_t sends_start = tx.sends, reads_start = rx.reads;
+    uint64_t sender_cpu = thread_cpu_ns(sender), receiver_cpu = thread_cpu_ns(receiver);
+    uint64_t start = clock_ns(CLOCK_MONOTONIC);
+    usleep((useconds_t)(seconds * 1000000.0));
+    uint64_t elapsed = clock_ns(CLOCK_MONOTONIC) - start;
+    sender_cpu = thread_cpu_ns(sender) - sender_cpu;
+    receiver_cpu = thread_cpu_ns(receiver) - receiver_cpu;
+    uint32_t n_sent = sent - sent_start, n_received = received - received_start;
+    uint32_t n_sends = tx.sends - sends_start, n_reads = rx.reads - reads_start;
+
+    running = 0;
+    pthread_join(sender, NULL);
+    pthread_join(receiver, NULL);
+    pwar_offload_rx_free(&rx);
+    close(send_sockfd);
+    close(recv_sockfd);
+
+    printf("%-8s  %10.0f  %10.0f  %12.0f  %12.0f  %8.1f  %8.1f  %5.1f%%\n", mode->name,
+           n_sent * 1e9 / elapsed, n_received * 1e9 / elapsed,
+           sender_cpu ? n_sent * 1e9 / sender_cpu : 0.0, receiver_cpu ? n_received * 1e9 / receiver_cpu : 0.0,
+           n_sends ? (double)n_sent / n_sends : 0.0, n_reads ? (double)n_received / n_reads : 0.0,
+           n_sent ? 100.0 * (1.0 - (double)n_received / n_sent) : 0.0);
+}
+
+static void usage(const char *prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("  --segments N   Datagrams per block, %zu bytes each (default: %u, max %d)\n", sizeof(pwar_packet_t), segments, BENCH_MAX_SEGMENTS);
+    printf("  --seconds S    Measuring time per run (default: %.1f)\n", seconds);
+}
+
+int main(int argc, char *argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--segments") == 0 && i + 1 < argc) {
+            segments = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if (segments < 1 || segments > BENCH_MAX_SEGMENTS) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    printf("%u segments of %zu bytes per block over loopback, %.1f s per run\n", segments, sizeof(pwar_packet_t), seconds);
+    printf("%-8s  %10s  %10s  %12s  %12s  %8s  %8s  %6s\n", "mode", "sent/s", "recv/s",
+           "sent/cpu-s", "recv/cpu-s", "per send", "per read", "lost");
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); ++m) run(&modes[m]);
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*
+ * pwar_pm_qos.c - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+#define _GNU_SOURCE
+#include "pwar_pm_qos.h"
+#include "pwar_rt.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define PM_QOS_GLOBAL_PATH "/dev/cpu_dma_latency"
+
+void pwar_pm_qos_init(pwar_pm_qos_t *qos) {
+    memset(qos, 0, sizeof(*qos));
+    qos->fd = -1;
+    qos->latency_us = -1;
+}
+
+int32_t pwar_pm_qos_latency_for_quantum(uint32_t n_samples, uint32_t sample_rate) {
+    if (sample_rate == 0) return 1;
+    uint64_t quantum_us = (uint64_t)n_samples * 1000000ULL / sample_rate;
+    uint64_t latency = quantum_us / PWAR_PM_QOS_QUANTUM_FRACTION;
+    return latency < 1 ? 1 : (int32_t)latency;
+}
+
+static void cpu_path(int cpu, char *path, size_t size) {
+    snprintf(path, size, "/sys/devices/system/cpu/cpu%d/power/pm_qos_resume_latency_us", cpu);
+}
+
+// Writes a whole value, returns 0 or -errno
+static int write_value(const char *path, const char *value) {
+    int fd = open(path, O_WRONLY);
+    if (fd < 0) return -errno;
+    ssize_t len = (ssize_t)strlen(value);
+    int ret = write(fd, value, len) == len ? 0 : -errno;
+    close(fd);
+    return ret;
+}
+
+static int read_value(const char *path, char *out, size_t size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -errno;
+    ssize_t n = read(fd, out, size - 1);
+    int ret = n < 0 ? -errno : 0;
+    close(fd);
+    if (n < 0) n = 0;
+    out[n] = '\0';
+    char *newline = strchr(out, '\n');
+    if (newline) *newline = '\0';
+    return ret;
+}
+
+static void restore_cpus(pwar_pm_qos_t *qos) {
+    char path[128];
+    for (int i = 0; i < qos->num_cpus; ++i) {
+        cpu_path(qos->cpus[i], path, sizeof(path));
+        write_value(path, qos->saved[i]);
+    }
+    qos->num_cpus = 0;
+}
+
+static int hold_cpus(pwar_pm_qos_t *qos, int32_t latency_us, const char *cpus) {
+    // In sysfs "n/a" is the strictest limit and "0" none at all
+    char value[16];
+    if (latency_us == 0)
+        strcpy(value, "n/a");
+    else
+        snprintf(value, sizeof(value), "%d", latency_us);
+
+    char path[128];
+    int count = pwar_rt_count_cpus(cpus);
+    for (int n = 0; n < count && n < PWAR_PM_QOS_MAX_CPUS; ++n) {
+        int cpu = pwar_rt_nth_cpu(cpus, n);
+        cpu_path(cpu, path, sizeof(path));
+        int ret = read_value(path, qos->saved[qos->num_cpus], sizeof(qos->saved[0]));
+        if (ret == 0) ret = write_value(path, value);
+        if (ret < 0) {
+            restore_cpus(qos);
+            return ret;
+        }
+        qos->cpus[qos->num_cpus++] = cpu;
+    }
+    return 0;
+}
+
+static int hold_global(pwar_pm_qos_t *qos, int32_t latency_us) {
+    int fd = open(PM_QOS_GLOBAL_PATH, O_WRONLY);
+    if (fd < 0) return -errno;
+    // The kernel takes a binary s32, the request lasts until the file is closed
+    if (write(fd, &latency_us, sizeof(latency_us)) != (ssize_t)sizeof(latency_us)) {
+        int ret = -errno;
+        close(fd);
+        return ret;
+    }
+    qos->fd = fd;
+    return 0;
+}
+
+int pwar_pm_qos_hold(pwar_pm_qos_t *qos, int32_t latency_us, const char *cpus) {
+    pwar_pm_qos_release(qos);
+    qos->error = 0;
+    if (latency_us < 0) return -1;
+    int ret = -ENOENT;
+    // Pinned threads only need their own CPUs kept awake, the rest may sleep
+    if (cpus && cpus[0] && pwar_rt_count_cpus(cpus) > 0)
+        ret = hold_cpus(qos, latency_us, cpus);
+    if (ret < 0)
+        ret = hold_global(qos, latency_us);
+    if (ret < 0) {
+        qos->error = -ret;
+        return -1;
+    }
+    qos->latency_us = latency_us;
+    return 0;
+}
+
+void pwar_pm_qos_release(pwar_pm_qos_t *qos) {
+    if (qos->fd >= 0) {
+        close(qos->fd);
+        qos->fd = -1;
+    }
+    restore_cpus(qos);
+    qos->latency_us = -1;
+}
+
+void pwar_pm_qos_describe(const pwar_pm_qos_t *qos, char *out, size_t size) {
+    if (qos->latency_us < 0) {
+        snprintf(out, size, "PM QoS: not held (%s)", qos->error ? strerror(qos->error) : "off");
+        return;
+    }
+    if (qos->fd >= 0) {
+        snprintf(out, size, "PM QoS: %d us on every CPU", qos->latency_us);
+        return;
+    }
+    size_t len = (size_t)snprintf(out, size, "PM QoS: %d us on cpus", qos->latency_us);
+    for (int i = 0; i < qos->num_cpus && len < size; ++i) {
+        len += (size_t)snprintf(out + len, size - len, "%s%d", i ? "," : " ", qos->cpus[i]);
+    }
+}
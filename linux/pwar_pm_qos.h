@@ -0,0 +1,61 @@
+/*
+ * pwar_pm_qos.h - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+/*
+ * CPU wake-up latency limit while PWAR runs.
+ *
+ * Deep C-states take tens to hundreds of microseconds to leave, and the receiver
+ * pays that on every packet that finds its CPU idle. A PM QoS constraint keeps
+ * the idle governor out of states slower than the limit. When the receiver or
+ * the audio thread is pinned, only those CPUs are held through their
+ * pm_qos_resume_latency_us, otherwise /dev/cpu_dma_latency holds every CPU for
+ * as long as its file descriptor stays open.
+ *
+ * Both need root or a udev rule. Without permission nothing is held, PWAR runs
+ * as before and the reason is kept for the log.
+ */
+
+#ifndef PWAR_PM_QOS
+#define PWAR_PM_QOS
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PWAR_PM_QOS_MAX_CPUS 64
+#define PWAR_PM_QOS_QUANTUM_FRACTION 10 // Automatic limit, this fraction of the quantum
+
+typedef struct {
+    int fd;                                     // /dev/cpu_dma_latency, -1 if not held
+    int num_cpus;                               // CPUs held through sysfs
+    int cpus[PWAR_PM_QOS_MAX_CPUS];
+    char saved[PWAR_PM_QOS_MAX_CPUS][16];       // Their limits before, written back on release
+    int32_t latency_us;                         // Limit held, -1 = none
+    int error;                                  // errno of the attempt that failed, 0 = none
+} pwar_pm_qos_t;
+
+void pwar_pm_qos_init(pwar_pm_qos_t *qos);
+
+// The automatic limit for a quantum, never below 1 us
+int32_t pwar_pm_qos_latency_for_quantum(uint32_t n_samples, uint32_t sample_rate);
+
+// Holds latency_us on the CPUs of cpus ("2,3", "0-3"), or on every CPU if empty. Returns 0 if held
+int pwar_pm_qos_hold(pwar_pm_qos_t *qos, int32_t latency_us, const char *cpus);
+
+// Gives up whatever is held, safe to call when nothing is
+void pwar_pm_qos_release(pwar_pm_qos_t *qos);
+
+// One line summary like "PM QoS: 133 us on cpus 2,3"
+void pwar_pm_qos_describe(const pwar_pm_qos_t *qos, char *out, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* PWAR_PM_QOS */
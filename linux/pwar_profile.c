@@ -0,0 +1,133 @@
+/*
+ * pwar_profile.c - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+#include "pwar_profile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#define PROFILE_PATH_LEN 512
+
+static int profile_dir(char *dir, size_t len) {
+    const char *cache = getenv("XDG_CACHE_HOME");
+    if (cache && *cache) {
+        snprintf(dir, len, "%s/pwar", cache);
+    } else {
+        const char *home = getenv("HOME");
+        if (!home || !*home) return -1;
+        snprintf(dir, len, "%s/.cache/pwar", home);
+    }
+    return 0;
+}
+
+static int profile_path(const char *ip, int port, char *path, size_t len) {
+    char dir[PROFILE_PATH_LEN];
+    if (profile_dir(dir, sizeof(dir)) < 0) return -1;
+    snprintf(path, len, "%s/%s-%d.profile", dir, ip, port);
+    return 0;
+}
+
+int pwar_profile_load(const char *ip, int port, pwar_profile_t *profile) {
+    char path[PROFILE_PATH_LEN + 64];
+    if (profile_path(ip, port, path, sizeof(path)) < 0) return -1;
+
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+
+    memset(profile, 0, sizeof(*profile));
+    unsigned long long u64;
+    long long i64;
+    unsigned int u32;
+    double d;
+    int version = 0;
+    char line[128];
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "version=%d", &version) == 1) continue;
+        if (sscanf(line, "saved_at=%llu", &u64) == 1) { profile->saved_at = u64; continue; }
+        if (sscanf(line, "sample_rate=%u", &u32) == 1) { profile->sample_rate = u32; continue; }
+        if (sscanf(line, "channels=%u", &u32) == 1) { profile->channels = u32; continue; }
+        if (sscanf(line, "buffer_size=%u", &u32) == 1) { profile->buffer_size = u32; continue; }
+        if (sscanf(line, "oneshot_mode=%u", &u32) == 1) { profile->oneshot_mode = u32; continue; }
+        if (sscanf(line, "windows_buffer_size=%u", &u32) == 1) { profile->windows_buffer_size = u32; continue; }
+        if (sscanf(line, "pipeline_depth=%u", &u32) == 1) { profile->pipeline_depth = u32; continue; }
+        if (sscanf(line, "nack_rtt_ns=%u", &u32) == 1) { profile->nack_rtt_ns = u32; continue; }
+        if (sscanf(line, "rtt_p50_ns=%llu", &u64) == 1) { profile->calibration.rtt_p50_ns = u64; continue; }
+        if (sscanf(line, "rtt_p99_ns=%llu", &u64) == 1) { profile->calibration.rtt_p99_ns = u64; continue; }
+        if (sscanf(line, "rtt_max_ns=%llu", &u64) == 1) { profile->calibration.rtt_max_ns = u64; continue; }
+        if (sscanf(line, "rtt_samples=%u", &u32) == 1) { profile->calibration.rtt_samples = u32; continue; }
+        if (sscanf(line, "clock_offset_ns=%lld", &i64) == 1) { profile->calibration.clock_offset_ns = i64; continue; }
+        if (sscanf(line, "clock_drift_ppm=%lf", &d) == 1) { profile->calibration.clock_drift_ppm = d; continue; }
+    }
+    fclose(f);
+
+    if (version != PWAR_PROFILE_VERSION) return -1;
+    return 0;
+}
+
+int pwar_profile_save(const char *ip, int port, const pwar_profile_t *profile) {
+    char dir[PROFILE_PATH_LEN];
+    char path[PROFILE_PATH_LEN + 64];
+    char tmp_path[PROFILE_PATH_LEN + 72];
+    if (profile_dir(dir, sizeof(dir)) < 0 || profile_path(ip, port, path, sizeof(path)) < 0) return -1;
+
+    // Create $XDG_CACHE_HOME/pwar, and the cache directory itself on a fresh home
+    char *slash = strrchr(dir, '/');
+    if (slash) {
+        *slash = '\0';
+        mkdir(dir, 0700);
+        *slash = '/';
+    }
+    if (mkdir(dir, 0755) < 0 && errno != EEXIST) {
+        perror("pwar_profile: mkdir failed");
+        return -1;
+    }
+
+    // Write to a temporary file first so a crash never leaves a torn profile
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *f = fopen(tmp_path, "w");
+    if (!f) {
+        perror("pwar_profile: fopen failed");
+        return -1;
+    }
+    fprintf(f, "version=%d\n", PWAR_PROFILE_VERSION);
+    fprintf(f, "saved_at=%llu\n", (unsigned long long)profile->saved_at);
+    fprintf(f, "sample_rate=%u\n", profile->sample_rate);
+    fprintf(f, "channels=%u\n", profile->channels);
+    fprintf(f, "buffer_size=%u\n", profile->buffer_size);
+    fprintf(f, "oneshot_mode=%u\n", profile->oneshot_mode);
+    fprintf(f, "windows_buffer_size=%u\n", profile->windows_buffer_size);
+    fprintf(f, "pipeline_depth=%u\n", profile->pipeline_depth);
+    fprintf(f, "nack_rtt_ns=%u\n", profile->nack_rtt_ns);
+    fprintf(f, "rtt_p50_ns=%llu\n", (unsigned long long)profile->calibration.rtt_p50_ns);
+    fprintf(f, "rtt_p99_ns=%llu\n", (unsigned long long)profile->calibration.rtt_p99_ns);
+    fprintf(f, "rtt_max_ns=%llu\n", (unsigned long long)profile->calibration.rtt_max_ns);
+    fprintf(f, "rtt_samples=%u\n", profile->calibration.rtt_samples);
+    fprintf(f, "clock_offset_ns=%lld\n", (long long)profile->calibration.clock_offset_ns);
+    fprintf(f, "clock_drift_ppm=%.6f\n", profile->calibration.clock_drift_ppm);
+    if (fclose(f) != 0 || rename(tmp_path, path) < 0) {
+        perror("pwar_profile: write failed");
+        remove(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+int pwar_profile_is_fresh(const pwar_profile_t *profile, uint32_t sample_rate, uint32_t channels, uint32_t buffer_size,
+                          uint32_t oneshot_mode, uint32_t pipeline_depth) {
+    uint64_t now = (uint64_t)time(NULL);
+    if (profile->saved_at > now || now - profile->saved_at > PWAR_PROFILE_MAX_AGE_S) return 0;
+    if (profile->calibration.rtt_samples < PWAR_PROFILE_MIN_RTT_SAMPLES) return 0;
+    // Round trips measured in another mode or depth say nothing about this one
+    if (!profile->oneshot_mode != !oneshot_mode) return 0;
+    if (pipeline_depth && profile->pipeline_depth != pipeline_depth) return 0;
+    return profile->sample_rate == sample_rate &&
+           profile->channels == channels &&
+           profile->buffer_size == buffer_size;
+}
@@ -0,0 +1,55 @@
+/*
+ * pwar_profile.h - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+/*
+ * Per-peer calibration profile.
+ *
+ * Saved on clean shutdown to $XDG_CACHE_HOME/pwar/<ip>-<port>.profile as plain
+ * key=value lines and loaded on the next start, so a session can begin from the
+ * previous steady state instead of relearning it.
+ */
+
+#ifndef PWAR_PROFILE
+#define PWAR_PROFILE
+
+#include <stdint.h>
+#include "latency_manager.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PWAR_PROFILE_VERSION 1
+#define PWAR_PROFILE_MAX_AGE_S (7 * 24 * 3600) // Older profiles are ignored
+#define PWAR_PROFILE_MIN_RTT_SAMPLES 1000      // Shorter sessions are not worth saving
+
+typedef struct {
+    uint64_t saved_at;                    // Unix time
+    // Negotiated formats
+    uint32_t sample_rate;
+    uint32_t channels;
+    uint32_t buffer_size;                 // PipeWire quantum
+    uint32_t oneshot_mode;
+    // Tuned buffering
+    uint32_t windows_buffer_size;         // Remote block size in samples
+    uint32_t pipeline_depth;              // Blocks in flight, 0 = oneshot or not recorded
+    uint32_t nack_rtt_ns;                 // Time from a NACK to the first resent segment, 0 = never measured
+    latency_manager_calibration_t calibration;
+} pwar_profile_t;
+
+// Returns 0 and fills profile if a usable profile exists for the peer
+int pwar_profile_load(const char *ip, int port, pwar_profile_t *profile);
+int pwar_profile_save(const char *ip, int port, const pwar_profile_t *profile);
+
+// A fresh profile was recorded recently with the same stream format and mode, pipeline_depth 0 = any
+int pwar_profile_is_fresh(const pwar_profile_t *profile, uint32_t sample_rate, uint32_t channels, uint32_t buffer_size,
+                          uint32_t oneshot_mode, uint32_t pipeline_depth);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* PWAR_PROFILE */
@@ -0,0 +1,326 @@
+/*
+ * pwar_recorder.c - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+#define _GNU_SOURCE
+#include "pwar_recorder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "pwar_atomic.h"
+
+#define RECORDER_MAX_CHANNELS 2
+#define RECORDER_RING_FRAMES (1u << 18)            // ~5.4 s at 48 kHz, must be a power of two
+#define RECORDER_WRITE_SIZE (1024 * 1024)          // One large aligned write
+#define RECORDER_ALIGN 4096                        // O_DIRECT alignment
+#define RECORDER_HEADER_SIZE RECORDER_ALIGN        // Sample data starts on an aligned offset
+#define RECORDER_PREALLOC_SIZE (64 * 1024 * 1024)  // Preallocate the file in steps of this size
+#define RECORDER_IDLE_US 10000
+
+typedef struct {
+    // Ring, written by the RT thread and read by the writer thread
+    float *ring;                 // RECORDER_RING_FRAMES * channels, interleaved
+    volatile uint32_t head;      // Frames written
+    volatile uint32_t tail;      // Frames read
+    uint32_t channels;
+
+    // File, only touched by the writer thread
+    int fd;
+    int direct_io;
+    uint8_t *staging;            // RECORDER_WRITE_SIZE, RECORDER_ALIGN aligned
+    uint32_t staging_used;
+    uint64_t data_bytes;
+    uint64_t preallocated;
+} recorder_stream_t;
+
+static struct {
+    recorder_stream_t streams[PWAR_RECORDER_NUM_STREAMS];
+    uint32_t sample_rate;
+    volatile uint32_t active;
+    volatile uint32_t rt_busy;   // RT pushes in flight, stop waits for zero
+    volatile uint32_t running;   // Writer thread keeps going while set
+    pthread_t thread;
+
+    volatile uint32_t blocks_dropped;
+    volatile uint32_t write_errors;
+    uint64_t bytes_written;
+} rec = {0};
+
+static void put_u16(uint8_t *p, uint16_t v) { p[0] = v & 0xff; p[1] = v >> 8; }
+static void put_u32(uint8_t *p, uint32_t v) { for (int i = 0; i < 4; ++i) p[i] = (v >> (8 * i)) & 0xff; }
+static void put_u64(uint8_t *p, uint64_t v) { for (int i = 0; i < 8; ++i) p[i] = (v >> (8 * i)) & 0xff; }
+
+/*
+ * Header layout (RECORDER_HEADER_SIZE bytes):
+ *   RIFF/RF64 | JUNK/ds64 (28 bytes) | fmt (IEEE float) | JUNK padding | data
+ * The first JUNK chunk is the standard placeholder that becomes ds64 when the file
+ * grows past 4 GB.
+ */
+static void build_header(uint8_t *hdr, uint32_t channels, uint32_t sample_rate, uint64_t data_bytes) {
+    const uint32_t block_align = channels * sizeof(float);
+    const uint64_t riff_size = RECORDER_HEADER_SIZE - 8 + data_bytes;
+    const int rf64 = riff_size > 0xFFFFFFFFull;
+
+    memset(hdr, 0, RECORDER_HEADER_SIZE);
+    memcpy(hdr, rf64 ? "RF64" : "RIFF", 4);
+    put_u32(hdr + 4, rf64 ? 0xFFFFFFFFu : (uint32_t)riff_size);
+    memcpy(hdr + 8, "WAVE", 4);
+
+    memcpy(hdr + 12, rf64 ? "ds64" : "JUNK", 4);
+    put_u32(hdr + 16, 28);
+    if (rf64) {
+        put_u64(hdr + 20, riff_size);
+        put_u64(hdr + 28, data_bytes);
+        put_u64(hdr + 36, data_bytes / block_align);
+        put_u32(hdr + 44, 0); // No table
+    }
+
+    memcpy(hdr + 48, "fmt ", 4);
+    put_u32(hdr + 52, 16);
+    put_u16(hdr + 56, 3); // WAVE_FORMAT_IEEE_FLOAT
+    put_u16(hdr + 58, (uint16_t)channels);
+    put_u32(hdr + 60, sample_rate);
+    put_u32(hdr + 64, sample_rate * block_align);
+    put_u16(hdr + 68, (uint16_t)block_align);
+    put_u16(hdr + 70, 32);
+
+    memcpy(hdr + 72, "JUNK", 4);
+    put_u32(hdr + 76, RECORDER_HEADER_SIZE - 8 - 80);
+
+    memcpy(hdr + RECORDER_HEADER_SIZE - 8, "data", 4);
+    put_u32(hdr + RECORDER_HEADER_SIZE - 4, rf64 ? 0xFFFFFFFFu : (uint32_t)data_bytes);
+}
+
+static int open_stream_file(recorder_stream_t *s, const char *path) {
+    s->direct_io = 1;
+    s->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+    if (s->fd < 0 && errno == EINVAL) {
+        // tmpfs and friends do not support O_DIRECT, fall back to buffered writes
+        s->direct_io = 0;
+        s->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    if (s->fd < 0) {
+        perror("pwar_recorder: open failed");
+        return -1;
+    }
+
+    s->preallocated = RECORDER_PREALLOC_SIZE;
+    posix_fallocate(s->fd, 0, (off_t)s->preallocated);
+
+    // The header is written again with the final sizes when the recording stops
+    uint8_t *hdr = s->staging;
+    build_header(hdr, s->channels, rec.sample_rate, 0);
+    if (pwrite(s->fd, hdr, RECORDER_HEADER_SIZE, 0) != RECORDER_HEADER_SIZE) {
+        perror("pwar_recorder: header write failed");
+        close(s->fd);
+        s->fd = -1;
+        return -1;
+    }
+    s->staging_used = 0;
+    s->data_bytes = 0;
+    return 0;
+}
+
+static void flush_staging(recorder_stream_t *s) {
+    if (s->staging_used == 0) return;
+    off_t offset = RECORDER_HEADER_SIZE + (off_t)s->data_bytes;
+    if ((uint64_t)offset + s->staging_used > s->preallocated) {
+        posix_fallocate(s->fd, (off_t)s->preallocated, RECORDER_PREALLOC_SIZE);
+        s->preallocated += RECORDER_PREALLOC_SIZE;
+    }
+    ssize_t n = pwrite(s->fd, s->staging, s->staging_used, offset);
+    if (n != (ssize_t)s->staging_used) {
+        pwar_atomic_fetch_add_u32(&rec.write_errors, 1);
+        if (n < 0) n = 0;
+    }
+    s->data_bytes += (uint64_t)n;
+    rec.bytes_written += (uint64_t)n;
+    s->staging_used = 0;
+}
+
+// Moves whatever is in the ring into the staging buffer, writing every full buffer
+static int drain_ring(recorder_stream_t *s) {
+    uint32_t tail = pwar_atomic_load_relaxed_u32(&s->tail);
+    uint32_t head = pwar_atomic_load_acquire_u32(&s->head);
+    uint32_t frames = head - tail;
+    const uint32_t frame_bytes = s->channels * sizeof(float);
+    int moved = frames > 0;
+
+    while (frames > 0) {
+        uint32_t pos = tail & (RECORDER_RING_FRAMES - 1);
+        uint32_t n = frames;
+        if (n > RECORDER_RING_FRAMES - pos) n = RECORDER_RING_FRAMES - pos;
+        uint32_t room = (RECORDER_WRITE_SIZE - s->staging_used) / frame_bytes;
+        if (n > room) n = room;
+        memcpy(s->staging + s->staging_used, &s->ring[pos * s->channels], n * frame_bytes);
+        s->staging_used += n * frame_bytes;
+        tail += n;
+        frames -= n;
+        pwar_atomic_store_release_u32(&s->tail, tail);
+        if (s->staging_used + frame_bytes > RECORDER_WRITE_SIZE) flush_staging(s);
+    }
+    return moved;
+}
+
+static void finalize_stream(recorder_stream_t *s) {
+    if (s->fd < 0) return;
+    drain_ring(s);
+    if (s->direct_io) {
+        // The tail and the header are not aligned, finish with buffered writes
+        int flags = fcntl(s->fd, F_GETFL);
+        fcntl(s->fd, F_SETFL, flags & ~O_DIRECT);
+    }
+    flush_staging(s);
+    if (ftruncate(s->fd, (off_t)(RECORDER_HEADER_SIZE + s->data_bytes)) < 0) {
+        perror("pwar_recorder: ftruncate failed");
+    }
+    uint8_t hdr[RECORDER_HEADER_SIZE];
+    build_header(hdr, s->channels, rec.sample_rate, s->data_bytes);
+    if (pwrite(s->fd, hdr, RECORDER_HEADER_SIZE, 0) != RECORDER_HEADER_SIZE) {
+        perror("pwar_recorder: header update failed");
+    }
+    close(s->fd);
+    s->fd = -1;
+}
+
+static void *writer_thread(void *userdata) {
+    (void)userdata;
+    while (pwar_atomic_load_acquire_u32(&rec.running)) {
+        int moved = 0;
+        for (int i = 0; i < PWAR_RECORDER_NUM_STREAMS; ++i) {
+            moved |= drain_ring(&rec.streams[i]);
+        }
+        if (!moved) usleep(RECORDER_IDLE_US);
+    }
+    for (int i = 0; i < PWAR_RECORDER_NUM_STREAMS; ++i) {
+        finalize_stream(&rec.streams[i]);
+    }
+    return NULL;
+}
+
+int pwar_recorder_start(const char *directory, uint32_t sample_rate, uint32_t send_channels, uint32_t return_channels) {
+    if (pwar_recorder_is_active()) return -1;
+    if (!directory || !*directory) directory = ".";
+    if (send_channels < 1 || send_channels > RECORDER_MAX_CHANNELS) return -1;
+    if (return_channels < 1 || return_channels > RECORDER_MAX_CHANNELS) return -1;
+
+    const uint32_t channels[PWAR_RECORDER_NUM_STREAMS] = { send_channels, return_channels };
+    const char *names[PWAR_RECORDER_NUM_STREAMS] = { "send", "return" };
+
+    char stamp[32];
+    time_t now = time(NULL);
+    struct tm tm_now;
+    localtime_r(&now, &tm_now);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm_now);
+
+    rec.sample_rate = sample_rate;
+    for (int i = 0; i < PWAR_RECORDER_NUM_STREAMS; ++i) {
+        recorder_stream_t *s = &rec.streams[i];
+        if (!s->ring) {
+            s->ring = calloc((size_t)RECORDER_RING_FRAMES * RECORDER_MAX_CHANNELS, sizeof(float));
+            if (posix_memalign((void **)&s->staging, RECORDER_ALIGN, RECORDER_WRITE_SIZE) != 0) s->staging = NULL;
+            if (!s->ring || !s->staging) return -1;
+        }
+        s->channels = channels[i];
+        s->head = 0;
+        s->tail = 0;
+        s->fd = -1;
+
+        char path[PWAR_MAX_PATH_LEN + 64];
+        snprintf(path, sizeof(path), "%s/pwar-%s-%s.wav", directory, stamp, names[i]);
+        if (open_stream_file(s, path) < 0) {
+            for (int j = 0; j < i; ++j) {
+                close(rec.streams[j].fd);
+                rec.streams[j].fd = -1;
+            }
+            return -1;
+        }
+        printf("[PWAR]: Recording %s stream to %s%s\n", names[i], path, s->direct_io ? " (O_DIRECT)" : "");
+    }
+
+    rec.blocks_dropped = 0;
+    rec.write_errors = 0;
+    rec.bytes_written = 0;
+    pwar_atomic_store_release_u32(&rec.running, 1);
+    if (pthread_create(&rec.thread, NULL, writer_thread, NULL) != 0) {
+        rec.running = 0;
+        for (int i = 0; i < PWAR_RECORDER_NUM_STREAMS; ++i) finalize_stream(&rec.streams[i]);
+        return -1;
+    }
+    pwar_atomic_store_release_u32(&rec.active, 1);
+    return 0;
+}
+
+void pwar_recorder_stop(void) {
+    if (!pwar_recorder_is_active()) return;
+    pwar_atomic_store_release_u32(&rec.active, 0);
+    // Either a push sees active = 0 or this sees its rt_busy, the fences on both sides keep the
+    // store from passing the load
+    pwar_atomic_fence_seq_cst();
+    // Let a push that already saw active = 1 finish before the final drain
+    while (pwar_atomic_load_acquire_u32(&rec.rt_busy)) usleep(100);
+    pwar_atomic_store_release_u32(&rec.running, 0);
+    pthread_join(rec.thread, NULL);
+    printf("[PWAR]: Recording stopped, %llu bytes written, %u blocks dropped\n",
+           (unsigned long long)rec.bytes_written, rec.blocks_dropped);
+}
+
+int pwar_recorder_is_active(void) {
+    return pwar_atomic_load_acquire_u32(&rec.active) != 0;
+}
+
+void pwar_recorder_push(pwar_recorder_stream_t stream, float *const *channels, uint32_t n_channels, uint32_t n_samples) {
+    pwar_atomic_fetch_add_u32(&rec.rt_busy, 1);
+    pwar_atomic_fence_seq_cst();
+    if (!pwar_atomic_load_acquire_u32(&rec.active)) {
+        pwar_atomic_fetch_add_u32(&rec.rt_busy, (uint32_t)-1);
+        return;
+    }
+    recorder_stream_t *s = &rec.streams[stream];
+    uint32_t head = pwar_atomic_load_relaxed_u32(&s->head);
+    uint32_t tail = pwar_atomic_load_acquire_u32(&s->tail);
+    if (RECORDER_RING_FRAMES - (head - tail) < n_samples) {
+        // Disk is behind, drop the whole block rather than wait
+        pwar_atomic_fetch_add_u32(&rec.blocks_dropped, 1);
+    } else {
+        for (uint32_t i = 0; i < n_samples; ++i) {
+            float *frame = &s->ring[((head + i) & (RECORDER_RING_FRAMES - 1)) * s->channels];
+            for (uint32_t ch = 0; ch < s->channels; ++ch) {
+                frame[ch] = (ch < n_channels && channels[ch]) ? channels[ch][i] : 0.0f;
+            }
+        }
+        pwar_atomic_store_release_u32(&s->head, head + n_samples);
+    }
+    // The ring writes are done before stop() sees the push gone
+    pwar_atomic_fence_release();
+    pwar_atomic_fetch_add_u32(&rec.rt_busy, (uint32_t)-1);
+}
+
+void pwar_recorder_get_stats(pwar_recording_stats_t *stats) {
+    if (!stats) return;
+    stats->active = pwar_recorder_is_active();
+    stats->bytes_written = rec.bytes_written;
+    stats->blocks_dropped = rec.blocks_dropped;
+    stats->write_errors = rec.write_errors;
+    stats->direct_io = rec.streams[0].direct_io && rec.streams[1].direct_io;
+}
+
+void pwar_recorder_cleanup(void) {
+    pwar_recorder_stop();
+    for (int i = 0; i < PWAR_RECORDER_NUM_STREAMS; ++i) {
+        free(rec.streams[i].ring);
+        free(rec.streams[i].staging);
+        rec.streams[i].ring = NULL;
+        rec.streams[i].staging = NULL;
+    }
+}
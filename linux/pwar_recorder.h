@@ -0,0 +1,50 @@
+/*
+ * pwar_recorder.h - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+/*
+ * Recording tap for the send and return streams.
+ *
+ * The RT path only copies blocks into a lock-free ring per stream. A background
+ * thread drains the rings into WAV files (promoted to RF64 past 4 GB) using large
+ * aligned O_DIRECT writes on preallocated files. When the disk falls behind, whole
+ * blocks are dropped and counted, the RT path never waits.
+ */
+
+#ifndef PWAR_RECORDER
+#define PWAR_RECORDER
+
+#include <stdint.h>
+#include "libpwar.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    PWAR_RECORDER_STREAM_SEND = 0,   // Linux -> remote
+    PWAR_RECORDER_STREAM_RETURN = 1, // remote -> Linux
+    PWAR_RECORDER_NUM_STREAMS
+} pwar_recorder_stream_t;
+
+// Not RT safe. Creates <directory>/pwar-<time>-send.wav and -return.wav
+int pwar_recorder_start(const char *directory, uint32_t sample_rate, uint32_t send_channels, uint32_t return_channels);
+// Not RT safe. Flushes, finalizes the headers and joins the writer thread
+void pwar_recorder_stop(void);
+int pwar_recorder_is_active(void);
+
+// RT safe. channels[ch] may be NULL for a silent channel
+void pwar_recorder_push(pwar_recorder_stream_t stream, float *const *channels, uint32_t n_channels, uint32_t n_samples);
+
+void pwar_recorder_get_stats(pwar_recording_stats_t *stats);
+
+// Releases the rings, call once the RT path is gone
+void pwar_recorder_cleanup(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* PWAR_RECORDER */
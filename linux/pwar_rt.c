@@ -0,0 +1,251 @@
+/*
+ * pwar_rt.c - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+#define _GNU_SOURCE
+#include "pwar_rt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE 6
+#endif
+
+// Not in every libc yet, the layout is fixed by the kernel ABI
+struct pwar_sched_attr {
+    uint32_t size;
+    uint32_t sched_policy;
+    uint64_t sched_flags;
+    int32_t sched_nice;
+    uint32_t sched_priority;
+    uint64_t sched_runtime;
+    uint64_t sched_deadline;
+    uint64_t sched_period;
+};
+
+static const char *policy_names[] = { "default", "other", "fifo", "rr", "deadline" };
+static const char *thread_names[] = { "receiver", "audio", "main", "watchdog" };
+
+static int parse_cpus(const char *list, cpu_set_t *set) {
+    CPU_ZERO(set);
+    const char *p = list;
+    while (*p) {
+        char *end;
+        long first = strtol(p, &end, 10);
+        if (end == p || first < 0) return -1;
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = strtol(p + 1, &end, 10);
+            if (end == p + 1 || last < first) return -1;
+            p = end;
+        }
+        if (last >= CPU_SETSIZE) return -1;
+        for (long cpu = first; cpu <= last; ++cpu) CPU_SET((int)cpu, set);
+        if (*p == ',') p++;
+        else if (*p) return -1;
+    }
+    return CPU_COUNT(set);
+}
+
+static void format_cpus(const cpu_set_t *set, char *out, size_t size) {
+    size_t len = 0;
+    out[0] = '\0';
+    for (int cpu = 0; cpu < CPU_SETSIZE && len < size; ++cpu) {
+        if (!CPU_ISSET(cpu, set)) continue;
+        int last = cpu;
+        while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, set)) last++;
+        int n = last > cpu ? snprintf(out + len, size - len, "%s%d-%d", len ? "," : "", cpu, last)
+                           : snprintf(out + len, size - len, "%s%d", len ? "," : "", cpu);
+        if (n < 0) break;
+        len += (size_t)n;
+        cpu = last;
+    }
+}
+
+int pwar_rt_count_cpus(const char *list) {
+    cpu_set_t set;
+    return parse_cpus(list, &set);
+}
+
+int pwar_rt_nth_cpu(const char *list, int n) {
+    cpu_set_t set;
+    if (parse_cpus(list, &set) <= n || n < 0) return -1;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &set) && n-- == 0) return cpu;
+    }
+    return -1;
+}
+
+int pwar_rt_policy_from_name(const char *name) {
+    for (int i = 0; i < (int)(sizeof(policy_names) / sizeof(policy_names[0])); ++i) {
+        if (strcmp(name, policy_names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+const char *pwar_rt_policy_name(int policy) {
+    switch (policy) {
+    case PWAR_SCHED_OTHER: return "SCHED_OTHER";
+    case PWAR_SCHED_FIFO: return "SCHED_FIFO";
+    case PWAR_SCHED_RR: return "SCHED_RR";
+    case PWAR_SCHED_DEADLINE: return "SCHED_DEADLINE";
+    default: return "unknown";
+    }
+}
+
+int pwar_rt_thread_from_name(const char *name) {
+    for (int i = 0; i < PWAR_THREAD_COUNT; ++i) {
+        if (strcmp(name, thread_names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+const char *pwar_rt_thread_name(int thread) {
+    return thread >= 0 && thread < PWAR_THREAD_COUNT ? thread_names[thread] : "unknown";
+}
+
+int pwar_rt_is_default(const pwar_thread_config_t *config) {
+    return config->policy == PWAR_SCHED_DEFAULT && config->cpus[0] == '\0';
+}
+
+static int to_os_policy(int policy) {
+    switch (policy) {
+    case PWAR_SCHED_FIFO: return SCHED_FIFO;
+    case PWAR_SCHED_RR: return SCHED_RR;
+    case PWAR_SCHED_DEADLINE: return SCHED_DEADLINE;
+    default: return SCHED_OTHER;
+    }
+}
+
+static int from_os_policy(int policy) {
+    switch (policy & ~SCHED_RESET_ON_FORK) {
+    case SCHED_OTHER: return PWAR_SCHED_OTHER;
+    case SCHED_FIFO: return PWAR_SCHED_FIFO;
+    case SCHED_RR: return PWAR_SCHED_RR;
+    case SCHED_DEADLINE: return PWAR_SCHED_DEADLINE;
+    default: return PWAR_SCHED_DEFAULT;
+    }
+}
+
+static int set_deadline(uint64_t runtime_ns, uint64_t period_ns) {
+#ifdef SYS_sched_setattr
+    struct pwar_sched_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.sched_policy = SCHED_DEADLINE;
+    attr.sched_runtime = runtime_ns;
+    attr.sched_deadline = period_ns;
+    attr.sched_period = period_ns;
+    return syscall(SYS_sched_setattr, 0, &attr, 0) == 0 ? 0 : errno;
+#else
+    (void)runtime_ns;
+    (void)period_ns;
+    return ENOSYS;
+#endif
+}
+
+static void read_back(pthread_t thread, pwar_thread_status_t *status) {
+    int os_policy;
+    struct sched_param sp;
+    if (pthread_equal(thread, pthread_self())) {
+        // glibc caches what pthread_setschedparam set, ask the kernel what it actually runs
+        pid_t tid = (pid_t)syscall(SYS_gettid);
+        os_policy = sched_getscheduler(tid);
+        if (os_policy >= 0 && sched_getparam(tid, &sp) == 0) {
+            status->policy = from_os_policy(os_policy);
+            status->priority = sp.sched_priority;
+        }
+    } else if (pthread_getschedparam(thread, &os_policy, &sp) == 0) {
+        status->policy = from_os_policy(os_policy);
+        status->priority = sp.sched_priority;
+    }
+#ifdef SYS_sched_getattr
+    if (status->policy == PWAR_SCHED_DEADLINE && pthread_equal(thread, pthread_self())) {
+        struct pwar_sched_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        if (syscall(SYS_sched_getattr, 0, &attr, sizeof(attr), 0) == 0) {
+            status->runtime_us = (uint32_t)(attr.sched_runtime / 1000);
+            status->period_us = (uint32_t)(attr.sched_period / 1000);
+        }
+    }
+#endif
+    cpu_set_t set;
+    if (pthread_getaffinity_np(thread, sizeof(set), &set) == 0) {
+        format_cpus(&set, status->cpus, sizeof(status->cpus));
+    }
+}
+
+static void fail(pwar_thread_status_t *status, const char *what, int error) {
+    // Keep the first failure, later ones are usually a consequence
+    if (status->failed) return;
+    status->failed = what;
+    status->error = error;
+}
+
+int pwar_rt_apply(pthread_t thread, int which, const pwar_thread_config_t *config,
+                  int default_policy, int default_priority, uint64_t period_ns,
+                  pwar_thread_status_t *status) {
+    memset(status, 0, sizeof(*status));
+    status->thread = pwar_rt_thread_name(which);
+
+    if (config->cpus[0]) {
+        cpu_set_t set;
+        if (parse_cpus(config->cpus, &set) <= 0) {
+            fail(status, "affinity", EINVAL);
+        } else {
+            int rc = pthread_setaffinity_np(thread, sizeof(set), &set);
+            if (rc != 0) fail(status, "affinity", rc);
+        }
+    }
+
+    int policy = config->policy != PWAR_SCHED_DEFAULT ? config->policy : default_policy;
+    int priority = config->priority ? config->priority : default_priority;
+    if (policy == PWAR_SCHED_DEADLINE) {
+        if (!pthread_equal(thread, pthread_self()) || period_ns == 0) {
+            fail(status, "policy", EINVAL);
+        } else {
+            uint64_t runtime_ns = config->runtime_us > 0 ? (uint64_t)config->runtime_us * 1000 : period_ns / 4;
+            if (runtime_ns < PWAR_RT_MIN_RUNTIME_NS) runtime_ns = PWAR_RT_MIN_RUNTIME_NS;
+            if (runtime_ns > period_ns) runtime_ns = period_ns;
+            int rc = set_deadline(runtime_ns, period_ns);
+            if (rc != 0) fail(status, "policy", rc);
+        }
+    } else if (policy != PWAR_SCHED_DEFAULT) {
+        int os_policy = to_os_policy(policy);
+        struct sched_param sp = { .sched_priority = 0 };
+        if (policy == PWAR_SCHED_FIFO || policy == PWAR_SCHED_RR) {
+            if (!priority) priority = PWAR_RT_DEFAULT_PRIORITY;
+            int lo = sched_get_priority_min(os_policy), hi = sched_get_priority_max(os_policy);
+            sp.sched_priority = priority < lo ? lo : priority > hi ? hi : priority;
+        }
+        int rc = pthread_setschedparam(thread, os_policy, &sp);
+        if (rc != 0) fail(status, "policy", rc);
+    }
+
+    read_back(thread, status);
+    status->applied = 1;
+    return status->failed ? -1 : 0;
+}
+
+void pwar_rt_describe(const pwar_thread_status_t *status, char *out, size_t size) {
+    int n = snprintf(out, size, "%s: %s", status->thread, pwar_rt_policy_name(status->policy));
+    if (n < 0 || (size_t)n >= size) return;
+    if (status->policy == PWAR_SCHED_FIFO || status->policy == PWAR_SCHED_RR) {
+        n += snprintf(out + n, size - n, " %d", status->priority);
+    } else if (status->policy == PWAR_SCHED_DEADLINE && status->period_us) {
+        n += snprintf(out + n, size - n, " %u/%u us", status->runtime_us, status->period_us);
+    }
+    if ((size_t)n >= size) return;
+    n += snprintf(out + n, size - n, ", cpus %s", status->cpus[0] ? status->cpus : "?");
+    if ((size_t)n >= size || !status->failed) return;
+    snprintf(out + n, size - n, " (setting %s failed: %s)", status->failed, strerror(status->error));
+}
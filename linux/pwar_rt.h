@@ -0,0 +1,60 @@
+/*
+ * pwar_rt.h - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+/*
+ * Scheduling policy, priority and CPU affinity for the PWAR threads.
+ *
+ * Settings are applied once when a thread starts, never per cycle. What the
+ * kernel actually granted is read back into a pwar_thread_status_t, together
+ * with the first setting that failed. SCHED_DEADLINE can only be set on the
+ * calling thread, and the kernel refuses it for threads pinned to fewer CPUs
+ * than their root domain, so combine it with a cpuset partition rather than
+ * a CPU list.
+ */
+
+#ifndef PWAR_RT
+#define PWAR_RT
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "libpwar.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PWAR_RT_DEFAULT_PRIORITY 80    // FIFO/RR priority when none is configured
+#define PWAR_RT_MIN_RUNTIME_NS 1024ULL // Smallest SCHED_DEADLINE runtime the kernel accepts
+
+// Checks a CPU list like "2,3" or "0-3,6", returns the number of CPUs or -1
+int pwar_rt_count_cpus(const char *list);
+
+// The n-th CPU of a list, 0 based, or -1 if the list is shorter
+int pwar_rt_nth_cpu(const char *list, int n);
+
+// Names as used on the command line, -1 if unknown
+int pwar_rt_policy_from_name(const char *name);
+const char *pwar_rt_policy_name(int policy);
+int pwar_rt_thread_from_name(const char *name);
+const char *pwar_rt_thread_name(int thread);
+
+int pwar_rt_is_default(const pwar_thread_config_t *config);
+
+// Applies config to thread, PWAR_SCHED_DEFAULT falls back to default_policy and default_priority.
+// period_ns is the quantum, used for SCHED_DEADLINE. Returns 0 if every setting took
+int pwar_rt_apply(pthread_t thread, int which, const pwar_thread_config_t *config,
+                  int default_policy, int default_priority, uint64_t period_ns,
+                  pwar_thread_status_t *status);
+
+// One line summary like "receiver: SCHED_FIFO 90, cpus 2-3"
+void pwar_rt_describe(const pwar_thread_status_t *status, char *out, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* PWAR_RT */
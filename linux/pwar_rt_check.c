@@ -0,0 +1,295 @@
+/*
+ * pwar_rt_check.c - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+/*
+ * The LD_PRELOAD half of the real-time safety checker, see pwar_rt_check.h.
+ *
+ * Every interposer checks whether its thread is inside a section, reports the
+ * call site if so and then does what libc would. The allocator goes straight to
+ * glibc's __libc_* entry points, everything else is looked up with RTLD_NEXT
+ * on first use.
+ */
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include <sys/syscall.h>
+#include "../protocol/pwar_atomic.h"
+
+#define RT_CHECK_MAX_SITES 256 // Call sites reported once each, further ones are only counted
+#define RT_CHECK_MAX_FRAMES 24
+
+// Initial-exec, a TLS lookup must not allocate inside the allocator
+#define RT_CHECK_TLS __thread __attribute__((tls_model("initial-exec")))
+
+static RT_CHECK_TLS uint32_t depth;
+static RT_CHECK_TLS const char *section;
+static RT_CHECK_TLS int reporting;
+static RT_CHECK_TLS uint32_t allowed;
+
+static volatile uint32_t sections_entered;
+static volatile uint32_t violations;
+static volatile uint32_t allowed_calls;
+static void *volatile sites[RT_CHECK_MAX_SITES];
+static int abort_on_violation;
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *ptr);
+
+static __typeof__(pthread_mutex_lock) *real_pthread_mutex_lock;
+static __typeof__(pthread_cond_wait) *real_pthread_cond_wait;
+static __typeof__(pthread_cond_timedwait) *real_pthread_cond_timedwait;
+static __typeof__(puts) *real_puts;
+static __typeof__(putchar) *real_putchar;
+static __typeof__(fwrite) *real_fwrite;
+static __typeof__(perror) *real_perror;
+static __typeof__(write) *real_write;
+static __typeof__(read) *real_read;
+static __typeof__(nanosleep) *real_nanosleep;
+static __typeof__(clock_nanosleep) *real_clock_nanosleep;
+static __typeof__(usleep) *real_usleep;
+static __typeof__(poll) *real_poll;
+static __typeof__(select) *real_select;
+
+// Looked up on first use, another library's constructor may print before ours ran
+static void *lookup(void **real, const char *name) {
+    if (!*real) *real = dlsym(RTLD_NEXT, name);
+    return *real;
+}
+
+#define RT_CHECK_REAL(fn) ((__typeof__(real_##fn))lookup((void **)&real_##fn, #fn))
+
+// Reports go out with the raw syscall, write() itself is interposed
+static void report_text(const char *text, int len) {
+    if (len > 0) syscall(SYS_write, 2, text, (size_t)len);
+}
+
+static int first_at_site(void *site) {
+    for (uint32_t i = 0; i < RT_CHECK_MAX_SITES; ++i) {
+        void *seen = __atomic_load_n(&sites[i], __ATOMIC_ACQUIRE);
+        if (seen == site) return 0;
+        if (!seen) {
+            void *expected = NULL;
+            if (__atomic_compare_exchange_n(&sites[i], &expected, site, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) return 1;
+            if (expected == site) return 0;
+        }
+    }
+    return 0;
+}
+
+__attribute__((noinline)) static void violation(const char *call, void *site) {
+    if (!depth || reporting) return;
+    if (allowed) {
+        pwar_atomic_fetch_add_u32(&allowed_calls, 1);
+        return;
+    }
+    reporting = 1;
+    pwar_atomic_fetch_add_u32(&violations, 1);
+    if (first_at_site(site)) {
+        char line[256];
+        int len = snprintf(line, sizeof(line), "[PWAR RT] %s() in real-time section \"%s\"\n", call, section);
+        report_text(line, len < (int)sizeof(line) ? len : (int)sizeof(line) - 1);
+        void *frames[RT_CHECK_MAX_FRAMES];
+        int n = backtrace(frames, RT_CHECK_MAX_FRAMES);
+        // Leave out the interposer itself
+        if (n > 2) backtrace_symbols_fd(frames + 2, n - 2, 2);
+    }
+    if (abort_on_violation) abort();
+    reporting = 0;
+}
+
+#define RT_CHECK(call) violation(call, __builtin_return_address(0))
+
+void pwar_rt_check_enter(const char *name) {
+    if (depth++ == 0) section = name;
+    pwar_atomic_fetch_add_u32(&sections_entered, 1);
+}
+
+void pwar_rt_check_leave(void) {
+    if (depth) --depth;
+}
+
+// The reason is for whoever reads the call site, the summary only counts
+void pwar_rt_check_allow(const char *reason) {
+    (void)reason;
+    ++allowed;
+}
+
+void pwar_rt_check_disallow(void) {
+    if (allowed) --allowed;
+}
+
+__attribute__((constructor)) static void rt_check_init(void) {
+    const char *abort_env = getenv("PWAR_RT_CHECK_ABORT");
+    abort_on_violation = abort_env && abort_env[0] == '1';
+    // The first backtrace loads the unwinder, better here than in a section
+    void *frame;
+    backtrace(&frame, 1);
+    char line[128];
+    int len = snprintf(line, sizeof(line), "[PWAR RT] Checking real-time sections%s\n",
+                       abort_on_violation ? ", aborting on the first violation" : "");
+    report_text(line, len);
+}
+
+__attribute__((destructor)) static void rt_check_summary(void) {
+    uint32_t sites_seen = 0;
+    while (sites_seen < RT_CHECK_MAX_SITES && sites[sites_seen]) ++sites_seen;
+    char line[192];
+    int len = snprintf(line, sizeof(line), "[PWAR RT] %u sections entered, %u violations at %u call sites, %u allowed calls\n",
+                       sections_entered, violations, sites_seen, allowed_calls);
+    report_text(line, len);
+}
+
+void *malloc(size_t size) {
+    RT_CHECK("malloc");
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size) {
+    RT_CHECK("calloc");
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    RT_CHECK("realloc");
+    return __libc_realloc(ptr, size);
+}
+
+int posix_memalign(void **out, size_t alignment, size_t size) {
+    RT_CHECK("posix_memalign");
+    void *ptr = __libc_memalign(alignment, size);
+    if (!ptr) return 12; // ENOMEM
+    *out = ptr;
+    return 0;
+}
+
+void free(void *ptr) {
+    RT_CHECK("free");
+    __libc_free(ptr);
+}
+
+int pthread_mutex_lock(pthread_mutex_t *mutex) {
+    RT_CHECK("pthread_mutex_lock");
+    return RT_CHECK_REAL(pthread_mutex_lock)(mutex);
+}
+
+int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex) {
+    RT_CHECK("pthread_cond_wait");
+    return RT_CHECK_REAL(pthread_cond_wait)(cond, mutex);
+}
+
+int pthread_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex, const struct timespec *abstime) {
+    RT_CHECK("pthread_cond_timedwait");
+    return RT_CHECK_REAL(pthread_cond_timedwait)(cond, mutex, abstime);
+}
+
+int printf(const char *format, ...) {
+    RT_CHECK("printf");
+    va_list args;
+    va_start(args, format);
+    int ret = vprintf(format, args);
+    va_end(args);
+    return ret;
+}
+
+int fprintf(FILE *stream, const char *format, ...) {
+    RT_CHECK("fprintf");
+    va_list args;
+    va_start(args, format);
+    int ret = vfprintf(stream, format, args);
+    va_end(args);
+    return ret;
+}
+
+// What printf and fprintf become with _FORTIFY_SOURCE
+int __printf_chk(int flag, const char *format, ...) {
+    (void)flag;
+    RT_CHECK("printf");
+    va_list args;
+    va_start(args, format);
+    int ret = vprintf(format, args);
+    va_end(args);
+    return ret;
+}
+
+int __fprintf_chk(FILE *stream, int flag, const char *format, ...) {
+    (void)flag;
+    RT_CHECK("fprintf");
+    va_list args;
+    va_start(args, format);
+    int ret = vfprintf(stream, format, args);
+    va_end(args);
+    return ret;
+}
+
+int puts(const char *s) {
+    RT_CHECK("puts");
+    return RT_CHECK_REAL(puts)(s);
+}
+
+int putchar(int c) {
+    RT_CHECK("putchar");
+    return RT_CHECK_REAL(putchar)(c);
+}
+
+size_t fwrite(const void *ptr, size_t size, size_t n, FILE *stream) {
+    RT_CHECK("fwrite");
+    return RT_CHECK_REAL(fwrite)(ptr, size, n, stream);
+}
+
+void perror(const char *s) {
+    RT_CHECK("perror");
+    RT_CHECK_REAL(perror)(s);
+}
+
+ssize_t write(int fd, const void *buf, size_t count) {
+    RT_CHECK("write");
+    return RT_CHECK_REAL(write)(fd, buf, count);
+}
+
+ssize_t read(int fd, void *buf, size_t count) {
+    RT_CHECK("read");
+    return RT_CHECK_REAL(read)(fd, buf, count);
+}
+
+int nanosleep(const struct timespec *req, struct timespec *rem) {
+    RT_CHECK("nanosleep");
+    return RT_CHECK_REAL(nanosleep)(req, rem);
+}
+
+int clock_nanosleep(clockid_t clock, int flags, const struct timespec *req, struct timespec *rem) {
+    RT_CHECK("clock_nanosleep");
+    return RT_CHECK_REAL(clock_nanosleep)(clock, flags, req, rem);
+}
+
+int usleep(useconds_t usec) {
+    RT_CHECK("usleep");
+    return RT_CHECK_REAL(usleep)(usec);
+}
+
+int poll(struct pollfd *fds, nfds_t nfds, int timeout) {
+    RT_CHECK("poll");
+    return RT_CHECK_REAL(poll)(fds, nfds, timeout);
+}
+
+int select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, struct timeval *timeout) {
+    RT_CHECK("select");
+    return RT_CHECK_REAL(select)(nfds, readfds, writefds, exceptfds, timeout);
+}
@@ -0,0 +1,60 @@
+/*
+ * pwar_rt_check.h - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+/*
+ * Real-time safety checker for test builds.
+ *
+ * Built with PWAR_RT_CHECK, libpwar marks the audio callback and the receiver's
+ * packet handling as real-time sections. libpwar_rtcheck.so, loaded with
+ * LD_PRELOAD, interposes allocation, mutex and condition waits, stdio and
+ * blocking syscalls, and reports every call site that reaches one of them from
+ * inside a section, once, with a backtrace. A summary is printed at exit.
+ *
+ * Without the preloaded checker the markers resolve to nothing and cost a
+ * branch. Without PWAR_RT_CHECK they are not compiled in at all.
+ *
+ * The few blocking calls a section makes on purpose are allow-listed where they
+ * are made, with PWAR_RT_ALLOW_BEGIN/END and the reason. They are counted in the
+ * summary instead of being reported.
+ *
+ * Environment:
+ *   PWAR_RT_CHECK_ABORT=1  Abort on the first violation, for a core dump or a failing test
+ */
+
+#ifndef PWAR_RT_CHECK_H
+#define PWAR_RT_CHECK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef PWAR_RT_CHECK
+
+// Defined by libpwar_rtcheck.so, NULL unless it was preloaded
+extern void pwar_rt_check_enter(const char *section) __attribute__((weak));
+extern void pwar_rt_check_leave(void) __attribute__((weak));
+extern void pwar_rt_check_allow(const char *reason) __attribute__((weak));
+extern void pwar_rt_check_disallow(void) __attribute__((weak));
+
+#define PWAR_RT_SECTION_ENTER(name) do { if (pwar_rt_check_enter) pwar_rt_check_enter(name); } while (0)
+#define PWAR_RT_SECTION_LEAVE() do { if (pwar_rt_check_leave) pwar_rt_check_leave(); } while (0)
+#define PWAR_RT_ALLOW_BEGIN(reason) do { if (pwar_rt_check_allow) pwar_rt_check_allow(reason); } while (0)
+#define PWAR_RT_ALLOW_END() do { if (pwar_rt_check_disallow) pwar_rt_check_disallow(); } while (0)
+
+#else
+
+#define PWAR_RT_SECTION_ENTER(name) ((void)0)
+#define PWAR_RT_SECTION_LEAVE() ((void)0)
+#define PWAR_RT_ALLOW_BEGIN(reason) ((void)0)
+#define PWAR_RT_ALLOW_END() ((void)0)
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* PWAR_RT_CHECK_H */
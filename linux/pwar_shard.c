@@ -0,0 +1,80 @@
+/*
+ * pwar_shard.c - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+#include "pwar_shard.h"
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <linux/filter.h>
+#include "../protocol/pwar_packet.h"
+
+#ifndef SO_ATTACH_REUSEPORT_CBPF
+#define SO_ATTACH_REUSEPORT_CBPF 51
+#endif
+
+// At most seven instructions per route, a session and an address match, plus the preambles
+#define MAX_INSNS (PWAR_SHARD_MAX_ROUTES * 7 + 8)
+
+// Relative to the network header, IPv4 without options. Options only make a route miss
+#define NET_SRC_ADDR (SKF_NET_OFF + 12)
+#define NET_SRC_PORT (SKF_NET_OFF + 20)
+
+// Absolute loads read big endian, session ids are sent in host order
+static uint32_t as_loaded(uint32_t value) {
+    uint8_t b[4];
+    memcpy(b, &value, sizeof(b));
+    return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | b[3];
+}
+
+int pwar_shard_join(int sockfd) {
+    int one = 1;
+    return setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+}
+
+int pwar_shard_steer(int sockfd, const pwar_shard_route_t *routes, uint32_t n_routes) {
+    struct sock_filter insns[MAX_INSNS];
+    uint32_t n = 0, n_sessions = 0;
+    if (n_routes > PWAR_SHARD_MAX_ROUTES) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (uint32_t i = 0; i < n_routes; ++i) {
+        if (routes[i].session_id) n_sessions++;
+    }
+
+    if (n_sessions) {
+        // Only session messages have this size, their id is at a fixed offset
+        insns[n++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_LEN, 0);
+        insns[n++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, sizeof(pwar_session_msg_t), 0, 1 + 2 * n_sessions);
+        insns[n++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(pwar_session_msg_t, session_id));
+        for (uint32_t i = 0; i < n_routes; ++i) {
+            if (!routes[i].session_id) continue;
+            insns[n++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, as_loaded(routes[i].session_id), 0, 1);
+            insns[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, routes[i].worker);
+        }
+    }
+    for (uint32_t i = 0; i < n_routes; ++i) {
+        if (!routes[i].ip || !routes[i].port) continue;
+        insns[n++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS, NET_SRC_ADDR);
+        insns[n++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ntohl(routes[i].ip), 0, 3);
+        insns[n++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_H | BPF_ABS, NET_SRC_PORT);
+        insns[n++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ntohs(routes[i].port), 0, 1);
+        insns[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, routes[i].worker);
+    }
+    insns[n++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS, NET_SRC_ADDR);
+    for (uint32_t i = 0; i < n_routes; ++i) {
+        if (!routes[i].ip || routes[i].port) continue;
+        insns[n++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ntohl(routes[i].ip), 0, 1);
+        insns[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, routes[i].worker);
+    }
+    insns[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, 0);
+
+    struct sock_fprog prog = { .len = (unsigned short)n, .filter = insns };
+    return setsockopt(sockfd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog));
+}
@@ -0,0 +1,51 @@
+/*
+ * pwar_shard.h - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+/*
+ * Steers incoming datagrams to receive workers.
+ *
+ * Every worker has its own socket, all bound to the same port with
+ * SO_REUSEPORT. A classic BPF program attached to the group picks the socket
+ * in the kernel, so a remote's traffic always reaches the worker that owns
+ * its session and slot ring:
+ *
+ *   1. session messages by their session id,
+ *   2. everything else by source address and port, once learned,
+ *   3. or by source address alone.
+ *
+ * Anything unmatched goes to the first socket. The sockets are numbered in the
+ * order they were bound.
+ */
+
+#ifndef PWAR_SHARD
+#define PWAR_SHARD
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PWAR_SHARD_MAX_ROUTES 96
+
+typedef struct {
+    uint32_t session_id; // Session messages with this id, 0 = none
+    uint32_t ip;         // Source address in network order, 0 = none
+    uint16_t port;       // Source port in network order, 0 = any port of ip
+    uint16_t worker;     // Socket index in bind order
+} pwar_shard_route_t;
+
+// Lets sockfd share its port with the other workers, call before bind
+int pwar_shard_join(int sockfd);
+
+// Replaces the steering program of the group sockfd belongs to, returns -1 and sets errno on failure
+int pwar_shard_steer(int sockfd, const pwar_shard_route_t *routes, uint32_t n_routes);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* PWAR_SHARD */
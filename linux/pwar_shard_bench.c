@@ -0,0 +1,300 @@
+/*
+ * pwar_shard_bench.c - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+/*
+ * Receive throughput of the fan-out path with the work sharded over 1..N
+ * workers, the way libpwar runs it: every worker has its own SO_REUSEPORT
+ * socket, the kernel steers each host's returns to the worker owning it, the
+ * worker puts them into the host's slot ring, and one joiner thread collects
+ * every cycle without locks, like the audio thread does.
+ *
+ * Senders blast returns for every host over loopback as fast as they can, so
+ * the numbers show what the receive side can take. Give it at least as many
+ * CPUs as senders plus workers, otherwise the workers only share one core.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "../protocol/pwar_packet.h"
+#include "../protocol/pwar_fanout.h"
+#include "../protocol/pwar_atomic.h"
+#include "pwar_shard.h"
+
+#define BENCH_PORT 8421
+#define BENCH_SOURCE_PORT 28000 // Host h sends from BENCH_SOURCE_PORT + h
+#define BENCH_MAX_WORKERS 16
+#define BENCH_MAX_SENDERS 16
+#define JOIN_LAG 8              // Cycles the joiner stays behind the slowest sender
+
+typedef struct {
+    uint32_t index;
+    uint32_t n_workers;
+    int sockfd;
+    pthread_t thread;
+    volatile uint32_t received;
+    volatile uint32_t misrouted;
+} bench_worker_t;
+
+typedef struct {
+    uint32_t index;
+    pthread_t thread;
+    volatile uint32_t sent_seq; // Every host got this sequence and all before it
+} bench_sender_t;
+
+static uint32_t n_hosts = 16;
+static uint32_t n_senders = 2;
+static uint32_t chunk_size = 32;
+static double seconds = 2.0;
+
+static pwar_fanout_t *fanout;
+static bench_worker_t workers[BENCH_MAX_WORKERS];
+static bench_sender_t senders[BENCH_MAX_SENDERS];
+static volatile uint32_t running;
+static volatile uint32_t joined, complete_joins;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int open_socket(uint16_t port, int shared) {
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sockfd < 0) {
+        perror("socket creation failed");
+        exit(EXIT_FAILURE);
+    }
+    if (shared && pwar_shard_join(sockfd) < 0) {
+        perror("SO_REUSEPORT failed");
+        exit(EXIT_FAILURE);
+    }
+    int buf = 4 * 1024 * 1024;
+    setsockopt(sockfd, SOL_SOCKET, shared ? SO_RCVBUF : SO_SNDBUF, &buf, sizeof(buf));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (bind(sockfd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("socket bind failed");
+        exit(EXIT_FAILURE);
+    }
+    return sockfd;
+}
+
+static void *worker_thread(void *userdata) {
+    bench_worker_t *worker = (bench_worker_t *)userdata;
+    pwar_packet_t packet;
+    while (pwar_atomic_load_relaxed_u32(&running)) {
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        ssize_t n = recvfrom(worker->sockfd, &packet, sizeof(packet), 0, (struct sockaddr *)&from, &from_len);
+        if (n != (ssize_t)sizeof(packet)) continue;
+        uint32_t host = (uint32_t)(ntohs(from.sin_port) - BENCH_SOURCE_PORT);
+        if (host >= n_hosts) continue;
+        if (host % worker->n_workers != worker->index) pwar_atomic_fetch_add_u32(&worker->misrouted, 1);
+        pwar_fanout_put(fanout, host, &packet, now_ns());
+        pwar_atomic_fetch_add_u32(&worker->received, 1);
+    }
+    return NULL;
+}
+
+static void *sender_thread(void *userdata) {
+    bench_sender_t *sender = (bench_sender_t *)userdata;
+    int sockfds[PWAR_FANOUT_MAX_HOSTS];
+    uint32_t hosts[PWAR_FANOUT_MAX_HOSTS], n = 0;
+    for (uint32_t h = sender->index; h < n_hosts; h += n_senders) {
+        hosts[n] = h;
+        sockfds[n++] = open_socket((uint16_t)(BENCH_SOURCE_PORT + h), 0);
+    }
+
+    struct sockaddr_in dest;
+    memset(&dest, 0, sizeof(dest));
+    dest.sin_family = AF_INET;
+    dest.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    dest.sin_port = htons(BENCH_PORT);
+
+    pwar_packet_t packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.n_samples = (uint16_t)chunk_size;
+    packet.num_packets = 1;
+    for (uint32_t seq = 0; pwar_atomic_load_relaxed_u32(&running); ++seq) {
+        packet.seq = seq;
+        packet.seq_timestamp = packet.timestamp = now_ns();
+        for (uint32_t i = 0; i < n; ++i) {
+            packet.samples[0][0] = (float)hosts[i];
+            sendto(sockfds[i], &packet, sizeof(packet), 0, (struct sockaddr *)&dest, sizeof(dest));
+        }
+        pwar_atomic_store_release_u32(&sender->sent_seq, seq);
+    }
+    for (uint32_t i = 0; i < n; ++i) close(sockfds[i]);
+    return NULL;
+}
+
+// The audio thread's side: one lock-free collect per cycle, all hosts joined by sequence
+static void *joiner_thread(void *userdata) {
+    (void)userdata;
+    float out_buf[PWAR_FANOUT_MAX_CHANNELS][PWAR_PACKET_MAX_CHUNK_SIZE];
+    float *out[PWAR_FANOUT_MAX_CHANNELS];
+    for (uint32_t ch = 0; ch < PWAR_FANOUT_MAX_CHANNELS; ++ch) out[ch] = out_buf[ch];
+    uint32_t all = n_hosts == 32 ? 0xffffffffu : (1u << n_hosts) - 1;
+    uint32_t play_seq = JOIN_LAG;
+
+    while (pwar_atomic_load_relaxed_u32(&running)) {
+        uint32_t slowest = UINT32_MAX;
+        for (uint32_t s = 0; s < n_senders; ++s) {
+            uint32_t seq = pwar_atomic_load_acquire_u32(&senders[s].sent_seq);
+            if (seq < slowest) slowest = seq;
+        }
+        if (slowest == UINT32_MAX || slowest < play_seq + JOIN_LAG) {
+            sched_yield();
+            continue;
+        }
+        // Skip what the slot rings no longer hold, the joiner was descheduled
+        if (slowest - play_seq > PWAR_SLOT_RING_MAX_DELAY) play_seq = slowest - JOIN_LAG;
+        if (pwar_fanout_collect(fanout, play_seq, all, out, chunk_size) == n_hosts)
+            pwar_atomic_fetch_add_u32(&complete_joins, 1);
+        pwar_atomic_fetch_add_u32(&joined, 1);
+        play_seq++;
+    }
+    return NULL;
+}
+
+static double run(uint32_t n_workers, uint32_t *misrouted) {
+    pwar_fanout_host_config_t hosts[PWAR_FANOUT_MAX_HOSTS];
+    for (uint32_t h = 0; h < n_hosts; ++h) {
+        hosts[h].first_channel = h * PWAR_CHANNELS;
+        hosts[h].channels = PWAR_CHANNELS;
+        hosts[h].deadline_us = 0;
+        hosts[h].miss_policy = PWAR_FANOUT_MISS_SILENCE;
+    }
+    if (pwar_fanout_init(fanout, hosts, n_hosts, 48000) < 0) {
+        fprintf(stderr, "fan-out init failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    struct timeval timeout = { 0, 100000 };
+    for (uint32_t w = 0; w < n_workers; ++w) {
+        memset(&workers[w], 0, sizeof(workers[w]));
+        workers[w].index = w;
+        workers[w].n_workers = n_workers;
+        workers[w].sockfd = open_socket(BENCH_PORT, 1);
+        setsockopt(workers[w].sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+    pwar_shard_route_t routes[PWAR_FANOUT_MAX_HOSTS];
+    for (uint32_t h = 0; h < n_hosts; ++h) {
+        routes[h].session_id = 0;
+        routes[h].ip = htonl(INADDR_LOOPBACK);
+        routes[h].port = htons((uint16_t)(BENCH_SOURCE_PORT + h));
+        routes[h].worker = (uint16_t)(h % n_workers);
+    }
+    if (n_workers > 1 && pwar_shard_steer(workers[0].sockfd, routes, n_hosts) < 0) {
+        perror("steering failed");
+        exit(EXIT_FAILURE);
+    }
+
+    joined = complete_joins = 0;
+    running = 1;
+    pthread_t joiner;
+    for (uint32_t w = 0; w < n_workers; ++w) pthread_create(&workers[w].thread, NULL, worker_thread, &workers[w]);
+    for (uint32_t s = 0; s < n_senders; ++s) {
+        memset(&senders[s], 0, sizeof(senders[s]));
+        senders[s].index = s;
+        pthread_create(&senders[s].thread, NULL, sender_thread, &senders[s]);
+    }
+    pthread_create(&joiner, NULL, joiner_thread, NULL);
+
+    // Let the queues fill before measuring
+    usleep(200000);
+    uint32_t received_start = 0;
+    for (uint32_t w = 0; w < n_workers; ++w) received_start += pwar_atomic_load_relaxed_u32(&workers[w].received);
+    uint64_t start = now_ns();
+    usleep((useconds_t)(seconds * 1000000.0));
+    uint32_t received = 0;
+    for (uint32_t w = 0; w < n_workers; ++w) received += pwar_atomic_load_relaxed_u32(&workers[w].received);
+    uint64_t elapsed = now_ns() - start;
+
+    running = 0;
+    for (uint32_t s = 0; s < n_senders; ++s) pthread_join(senders[s].thread, NULL);
+    pthread_join(joiner, NULL);
+    *misrouted = 0;
+    for (uint32_t w = 0; w < n_workers; ++w) {
+        pthread_join(workers[w].thread, NULL);
+        close(workers[w].sockfd);
+        *misrouted += workers[w].misrouted;
+    }
+    return (double)(received - received_start) * 1e9 / (double)elapsed;
+}
+
+static void usage(const char *prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("  --hosts N      Remote hosts, %d channels each (default: %u)\n", PWAR_CHANNELS, n_hosts);
+    printf("  --senders N    Sender threads (default: %u)\n", n_senders);
+    printf("  --chunk N      Samples per packet (default: %u)\n", chunk_size);
+    printf("  --seconds S    Measuring time per run (default: %.1f)\n", seconds);
+    printf("  --workers LIST Worker counts to compare (default: 1,2,4)\n");
+}
+
+int main(int argc, char *argv[]) {
+    char worker_list[64] = "1,2,4";
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--hosts") == 0 && i + 1 < argc) {
+            n_hosts = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--senders") == 0 && i + 1 < argc) {
+            n_senders = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--chunk") == 0 && i + 1 < argc) {
+            chunk_size = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            snprintf(worker_list, sizeof(worker_list), "%s", argv[++i]);
+        } else {
+            usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if (n_hosts < 1 || n_hosts > PWAR_FANOUT_MAX_HOSTS || n_senders < 1 || n_senders > BENCH_MAX_SENDERS ||
+        n_senders > n_hosts || chunk_size < 1 || chunk_size > PWAR_PACKET_MAX_CHUNK_SIZE || seconds <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    fanout = calloc(1, sizeof(*fanout));
+    if (!fanout) {
+        perror("calloc failed");
+        return 1;
+    }
+
+    printf("%u hosts x %d channels, %u samples per packet, %u senders, %ld CPUs online\n",
+           n_hosts, PWAR_CHANNELS, chunk_size, n_senders, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("workers   packets/s    MB/s  speedup  complete joins  misrouted\n");
+    double base = 0.0;
+    char *save = NULL;
+    for (char *tok = strtok_r(worker_list, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        int n_workers = atoi(tok);
+        if (n_workers < 1 || n_workers > BENCH_MAX_WORKERS || (uint32_t)n_workers > n_hosts) {
+            fprintf(stderr, "Skipping %s workers, 1..%d and at most one per host\n", tok, BENCH_MAX_WORKERS);
+            continue;
+        }
+        uint32_t misrouted;
+        double rate = run((uint32_t)n_workers, &misrouted);
+        if (base == 0.0) base = rate;
+        double complete = joined ? 100.0 * complete_joins / joined : 0.0;
+        printf("%7d %11.0f %7.1f %7.2fx %14.1f%% %10u\n", n_workers, rate, rate * sizeof(pwar_packet_t) / 1e6,
+               base > 0.0 ? rate / base : 0.0, complete, misrouted);
+    }
+    free(fanout);
+    return 0;
+}
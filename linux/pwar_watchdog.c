@@ -0,0 +1,193 @@
+/*
+ * pwar_watchdog.c - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+#include "pwar_watchdog.h"
+#include <stdio.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+
+#define WATCHDOG_MIN_INTERVAL_MS 1
+
+static const struct {
+    const char *name;
+    int depends_on;   // Only judged while this heartbeat is fresh, -1 = always
+    int recoverable;  // The owner can flush or restart it
+} beat_info[PWAR_WATCHDOG_NUM_BEATS] = {
+    [PWAR_WATCHDOG_BEAT_RECEIVER] = { "receiver", -1, 1 },
+    [PWAR_WATCHDOG_BEAT_PACKET] = { "packets", PWAR_WATCHDOG_BEAT_AUDIO, 1 },
+    [PWAR_WATCHDOG_BEAT_AUDIO] = { "audio", -1, 0 },
+};
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Caller holds the mutex
+static void record_event(pwar_watchdog_t *wd, pwar_watchdog_beat_t beat, const char *event, uint32_t stalled_ms) {
+    pwar_watchdog_event_t *e = &wd->events[wd->event_count % PWAR_WATCHDOG_MAX_EVENTS];
+    e->timestamp_ns = monotonic_ns();
+    e->heartbeat = beat_info[beat].name;
+    e->event = event;
+    e->stalled_ms = stalled_ms;
+    wd->event_count++;
+}
+
+static void log_event(pwar_watchdog_t *wd, pwar_watchdog_beat_t beat, const char *event, uint32_t stalled_ms) {
+    pthread_mutex_lock(&wd->mutex);
+    record_event(wd, beat, event, stalled_ms);
+    pthread_mutex_unlock(&wd->mutex);
+
+    if (strcmp(event, "recovered") == 0) {
+        printf("[PWAR]: Watchdog: %s recovered after %ums\n", beat_info[beat].name, stalled_ms);
+    } else {
+        printf("\033[0;31m[PWAR]: Watchdog: %s %s (%ums without a heartbeat)\033[0m\n", beat_info[beat].name, event, stalled_ms);
+    }
+}
+
+// Age of a heartbeat in ms, or -1 when it is not armed
+static int64_t beat_age(pwar_watchdog_t *wd, int beat, uint32_t now_ms) {
+    uint32_t last = pwar_atomic_load_relaxed_u32(&wd->beats[beat].ms);
+    if (last == 0) return -1;
+    int32_t age = (int32_t)(now_ms - last);
+    return age < 0 ? 0 : age;
+}
+
+static void check_beat(pwar_watchdog_t *wd, pwar_watchdog_beat_t beat, uint32_t now_ms) {
+    int64_t age = beat_age(wd, beat, now_ms);
+    int dep = beat_info[beat].depends_on;
+    int64_t dep_age = dep < 0 ? 0 : beat_age(wd, dep, now_ms);
+    int judged = age >= 0 && dep_age >= 0 && dep_age <= (int64_t)wd->threshold_ms;
+
+    if (!judged) {
+        // Went idle on purpose, nothing to recover from
+        wd->stalled[beat] = 0;
+        wd->judged[beat] = 0;
+        return;
+    }
+    if (!wd->judged[beat]) {
+        wd->judged[beat] = 1;
+        wd->judged_since_ms[beat] = now_ms;
+    }
+    if (!wd->stalled[beat] && age > (int64_t)(now_ms - wd->judged_since_ms[beat])) {
+        // Time spent unjudged does not count towards a stall
+        age = now_ms - wd->judged_since_ms[beat];
+    }
+
+    if (!wd->stalled[beat] && age > (int64_t)wd->threshold_ms) {
+        wd->stalled[beat] = 1;
+        wd->stall_start_ms[beat] = now_ms - (uint32_t)age;
+        pthread_mutex_lock(&wd->mutex);
+        wd->stats.stalls++;
+        pthread_mutex_unlock(&wd->mutex);
+        log_event(wd, beat, "stalled", (uint32_t)age);
+
+        if (wd->action != PWAR_WATCHDOG_ACTION_NONE && beat_info[beat].recoverable && wd->recover) {
+            int flush = wd->action == PWAR_WATCHDOG_ACTION_FLUSH;
+            int rc = wd->recover(beat, wd->action, wd->userdata);
+            pthread_mutex_lock(&wd->mutex);
+            if (rc == 0 && flush) wd->stats.flushes++;
+            if (rc == 0 && !flush) wd->stats.restarts++;
+            pthread_mutex_unlock(&wd->mutex);
+            log_event(wd, beat, rc == 0 ? (flush ? "flushed" : "restarted") : (flush ? "flush failed" : "restart failed"),
+                      now_ms - wd->stall_start_ms[beat]);
+        }
+    } else if (wd->stalled[beat] && age <= (int64_t)wd->threshold_ms) {
+        uint32_t stalled_ms = (now_ms - (uint32_t)age) - wd->stall_start_ms[beat];
+        wd->stalled[beat] = 0;
+        pthread_mutex_lock(&wd->mutex);
+        if (stalled_ms > wd->stats.longest_stall_ms) wd->stats.longest_stall_ms = stalled_ms;
+        pthread_mutex_unlock(&wd->mutex);
+        log_event(wd, beat, "recovered", stalled_ms);
+    }
+}
+
+static void *watchdog_thread(void *userdata) {
+    pwar_watchdog_t *wd = (pwar_watchdog_t *)userdata;
+
+    // Stay out of the way of the RT threads, the watchdog only has to notice eventually
+    struct sched_param sp = { .sched_priority = 0 };
+    pthread_setschedparam(pthread_self(), SCHED_OTHER, &sp);
+
+    uint32_t interval_ms = wd->threshold_ms / 4;
+    if (interval_ms < WATCHDOG_MIN_INTERVAL_MS) interval_ms = WATCHDOG_MIN_INTERVAL_MS;
+    struct timespec interval = { .tv_sec = interval_ms / 1000, .tv_nsec = (long)(interval_ms % 1000) * 1000000L };
+
+    while (pwar_atomic_load_acquire_u32(&wd->running)) {
+        nanosleep(&interval, NULL);
+        uint32_t now_ms = (uint32_t)(monotonic_ns() / 1000000) | 1;
+        for (int beat = 0; beat < PWAR_WATCHDOG_NUM_BEATS; ++beat) {
+            check_beat(wd, (pwar_watchdog_beat_t)beat, now_ms);
+        }
+    }
+    return NULL;
+}
+
+int pwar_watchdog_start(pwar_watchdog_t *wd, uint32_t threshold_ms, pwar_watchdog_action_t action,
+                        pwar_watchdog_recover_fn recover, void *userdata) {
+    memset(wd, 0, sizeof(*wd));
+    wd->threshold_ms = threshold_ms ? threshold_ms : PWAR_WATCHDOG_DEFAULT_MS;
+    wd->action = action;
+    wd->recover = recover;
+    wd->userdata = userdata;
+    wd->stats.enabled = 1;
+    pthread_mutex_init(&wd->mutex, NULL);
+    pwar_atomic_store_release_u32(&wd->running, 1);
+
+    if (pthread_create(&wd->thread, NULL, watchdog_thread, wd) != 0) {
+        perror("Failed to start watchdog thread");
+        pwar_atomic_store_release_u32(&wd->running, 0);
+        wd->stats.enabled = 0;
+        return -1;
+    }
+    return 0;
+}
+
+void pwar_watchdog_stop(pwar_watchdog_t *wd) {
+    if (!pwar_atomic_load_acquire_u32(&wd->running)) return;
+    pwar_atomic_store_release_u32(&wd->running, 0);
+    pthread_join(wd->thread, NULL);
+    pthread_mutex_destroy(&wd->mutex);
+}
+
+int pwar_watchdog_is_running(pwar_watchdog_t *wd) {
+    return pwar_atomic_load_acquire_u32(&wd->running) != 0;
+}
+
+void pwar_watchdog_note_backlog_flush(pwar_watchdog_t *wd, uint32_t dropped, uint32_t behind_ms) {
+    if (!pwar_watchdog_is_running(wd)) return;
+    // The receiver prints its own line, this only keeps the record
+    pthread_mutex_lock(&wd->mutex);
+    wd->stats.backlog_flushes++;
+    wd->stats.backlog_dropped += dropped;
+    record_event(wd, PWAR_WATCHDOG_BEAT_PACKET, "backlog flushed", behind_ms);
+    pthread_mutex_unlock(&wd->mutex);
+}
+
+int pwar_watchdog_get_events(pwar_watchdog_t *wd, pwar_watchdog_event_t *events, int max_events) {
+    if (!pwar_watchdog_is_running(wd) || max_events <= 0) return 0;
+    pthread_mutex_lock(&wd->mutex);
+    uint32_t available = wd->event_count < PWAR_WATCHDOG_MAX_EVENTS ? wd->event_count : PWAR_WATCHDOG_MAX_EVENTS;
+    uint32_t n = (uint32_t)max_events < available ? (uint32_t)max_events : available;
+    for (uint32_t i = 0; i < n; ++i) {
+        events[i] = wd->events[(wd->event_count - n + i) % PWAR_WATCHDOG_MAX_EVENTS];
+    }
+    pthread_mutex_unlock(&wd->mutex);
+    return (int)n;
+}
+
+void pwar_watchdog_get_stats(pwar_watchdog_t *wd, pwar_watchdog_stats_t *stats) {
+    if (!pwar_watchdog_is_running(wd)) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    pthread_mutex_lock(&wd->mutex);
+    *stats = wd->stats;
+    pthread_mutex_unlock(&wd->mutex);
+}
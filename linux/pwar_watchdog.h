@@ -0,0 +1,97 @@
+/*
+ * pwar_watchdog.h - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+/*
+ * Stall watchdog for the receiver and audio threads.
+ *
+ * Each watched thread stamps a heartbeat with a single relaxed store. A normal
+ * priority watchdog thread checks the heartbeats a few times per threshold,
+ * logs stalls and recoveries as events and, if asked to, lets the owner flush
+ * stale state or restart the stalled thread through a callback.
+ */
+
+#ifndef PWAR_WATCHDOG
+#define PWAR_WATCHDOG
+
+#include <stdint.h>
+#include <pthread.h>
+#include "libpwar.h"
+#include "pwar_atomic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PWAR_WATCHDOG_DEFAULT_MS 50   // Heartbeat age counted as a stall
+#define PWAR_WATCHDOG_MAX_EVENTS 64   // Events kept, older ones are overwritten
+#define PWAR_WATCHDOG_CACHE_LINE 64
+
+typedef enum {
+    PWAR_WATCHDOG_BEAT_RECEIVER = 0, // Receiver loop, wakes on every packet or receive timeout
+    PWAR_WATCHDOG_BEAT_PACKET,       // Last packet handled, only judged while audio cycles run
+    PWAR_WATCHDOG_BEAT_AUDIO,        // Last cycle served by the audio callback, logged only
+    PWAR_WATCHDOG_NUM_BEATS
+} pwar_watchdog_beat_t;
+
+// Called on the watchdog thread, returns 0 when the action was carried out
+typedef int (*pwar_watchdog_recover_fn)(pwar_watchdog_beat_t beat, pwar_watchdog_action_t action, void *userdata);
+
+typedef struct {
+    volatile uint32_t ms; // Monotonic ms of the last beat, 0 = not armed
+    char pad[PWAR_WATCHDOG_CACHE_LINE - sizeof(uint32_t)];
+} pwar_watchdog_heartbeat_t;
+
+typedef struct {
+    pwar_watchdog_heartbeat_t beats[PWAR_WATCHDOG_NUM_BEATS];
+
+    // Watchdog thread only
+    uint32_t threshold_ms;
+    pwar_watchdog_action_t action;
+    pwar_watchdog_recover_fn recover;
+    void *userdata;
+    int stalled[PWAR_WATCHDOG_NUM_BEATS];
+    int judged[PWAR_WATCHDOG_NUM_BEATS];
+    uint32_t judged_since_ms[PWAR_WATCHDOG_NUM_BEATS];
+    uint32_t stall_start_ms[PWAR_WATCHDOG_NUM_BEATS];
+    pthread_t thread;
+    volatile uint32_t running;
+
+    // Event log and stats, guarded by mutex
+    pthread_mutex_t mutex;
+    pwar_watchdog_event_t events[PWAR_WATCHDOG_MAX_EVENTS];
+    uint32_t event_count;             // Events ever logged
+    pwar_watchdog_stats_t stats;
+} pwar_watchdog_t;
+
+// Not RT safe. threshold_ms 0 uses PWAR_WATCHDOG_DEFAULT_MS
+int pwar_watchdog_start(pwar_watchdog_t *wd, uint32_t threshold_ms, pwar_watchdog_action_t action,
+                        pwar_watchdog_recover_fn recover, void *userdata);
+void pwar_watchdog_stop(pwar_watchdog_t *wd);
+int pwar_watchdog_is_running(pwar_watchdog_t *wd);
+
+// RT safe, a single relaxed store. now_ns is CLOCK_MONOTONIC
+static inline void pwar_watchdog_beat(pwar_watchdog_t *wd, pwar_watchdog_beat_t beat, uint64_t now_ns) {
+    // The low bit is always set so a beat is never mistaken for "not armed"
+    pwar_atomic_store_relaxed_u32(&wd->beats[beat].ms, (uint32_t)(now_ns / 1000000) | 1);
+}
+
+// Stop judging a heartbeat until the next beat, e.g. when its thread goes idle on purpose
+static inline void pwar_watchdog_disarm(pwar_watchdog_t *wd, pwar_watchdog_beat_t beat) {
+    pwar_atomic_store_relaxed_u32(&wd->beats[beat].ms, 0);
+}
+
+// Not RT safe. Logs that a receiver dropped a run of stale datagrams at once, the oldest behind_ms late
+void pwar_watchdog_note_backlog_flush(pwar_watchdog_t *wd, uint32_t dropped, uint32_t behind_ms);
+
+// Copies up to max_events of the latest events, oldest first, returns the number copied
+int pwar_watchdog_get_events(pwar_watchdog_t *wd, pwar_watchdog_event_t *events, int max_events);
+void pwar_watchdog_get_stats(pwar_watchdog_t *wd, pwar_watchdog_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* PWAR_WATCHDOG */
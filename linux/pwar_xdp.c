@@ -0,0 +1,322 @@
+/*
+ * pwar_xdp.c - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+#define _GNU_SOURCE
+#include "pwar_xdp.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/bpf.h>
+#include <linux/if_link.h>
+#include <linux/if_xdp.h>
+#include "../protocol/pwar_atomic.h"
+
+#ifndef AF_XDP
+#define AF_XDP 44
+#endif
+#ifndef SOL_XDP
+#define SOL_XDP 283
+#endif
+
+// Ethernet, then IPv4 without options, then UDP
+#define ETH_TYPE 12
+#define IP_START 14
+#define IP_FRAG (IP_START + 6)
+#define IP_PROTO (IP_START + 9)
+#define IP_SRC_ADDR (IP_START + 12)
+#define UDP_MIN_START (IP_START + 20)
+#define UDP_MIN_END (UDP_MIN_START + 8)
+#define MAX_QUEUES 64 // XSKMAP entries, one per RX queue
+
+#define INSN(c, d, s, o, i) ((struct bpf_insn){ .code = (c), .dst_reg = (d), .src_reg = (s), .off = (o), .imm = (i) })
+#define LDX(size, dst, src, off) INSN(BPF_LDX | (size) | BPF_MEM, dst, src, off, 0)
+#define MOV_REG(dst, src) INSN(BPF_ALU64 | BPF_MOV | BPF_X, dst, src, 0, 0)
+#define MOV_IMM(dst, imm) INSN(BPF_ALU64 | BPF_MOV | BPF_K, dst, 0, 0, imm)
+#define ALU_IMM(op, dst, imm) INSN(BPF_ALU64 | (op) | BPF_K, dst, 0, 0, imm)
+#define JMP_REG(op, dst, src, off) INSN(BPF_JMP | (op) | BPF_X, dst, src, off, 0)
+#define JMP_IMM(op, dst, imm, off) INSN(BPF_JMP | (op) | BPF_K, dst, 0, off, imm)
+#define LD_MAP_FD(dst, fd) INSN(BPF_LD | BPF_DW | BPF_IMM, dst, BPF_PSEUDO_MAP_FD, 0, fd), INSN(0, 0, 0, 0, 0)
+#define CALL(fn) INSN(BPF_JMP | BPF_CALL, 0, 0, 0, fn)
+#define EXIT() INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0)
+
+static long sys_bpf(int cmd, union bpf_attr *attr) {
+    return syscall(__NR_bpf, cmd, attr, sizeof(*attr));
+}
+
+static int fail(pwar_xdp_t *xdp, const char *step) {
+    xdp->failed = step;
+    xdp->error = errno;
+    return -1;
+}
+
+static int create_map(pwar_xdp_t *xdp) {
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_type = BPF_MAP_TYPE_XSKMAP;
+    attr.key_size = sizeof(uint32_t);
+    attr.value_size = sizeof(int);
+    attr.max_entries = MAX_QUEUES;
+    xdp->map_fd = (int)sys_bpf(BPF_MAP_CREATE, &attr);
+    return xdp->map_fd < 0 ? fail(xdp, "creating the socket map") : 0;
+}
+
+/*
+ * IPv4 UDP to port without IP options and not fragmented goes to the socket of
+ * its RX queue, everything else and every queue without a socket to the stack.
+ * Header fields are compared as loaded, in network order.
+ */
+static int load_program(pwar_xdp_t *xdp) {
+    enum { PASS = 23 };
+    struct bpf_insn insns[] = {
+        /* 0 */ MOV_REG(BPF_REG_6, BPF_REG_1),
+        /* 1 */ LDX(BPF_W, BPF_REG_2, BPF_REG_6, offsetof(struct xdp_md, data)),
+        /* 2 */ LDX(BPF_W, BPF_REG_3, BPF_REG_6, offsetof(struct xdp_md, data_end)),
+        /* 3 */ MOV_REG(BPF_REG_4, BPF_REG_2),
+        /* 4 */ ALU_IMM(BPF_ADD, BPF_REG_4, UDP_MIN_END),
+        /* 5 */ JMP_REG(BPF_JGT, BPF_REG_4, BPF_REG_3, PASS - 6),
+        /* 6 */ LDX(BPF_H, BPF_REG_4, BPF_REG_2, ETH_TYPE),
+        /* 7 */ JMP_IMM(BPF_JNE, BPF_REG_4, htons(0x0800), PASS - 8),
+        /* 8 */ LDX(BPF_B, BPF_REG_4, BPF_REG_2, IP_START),
+        /* 9 */ JMP_IMM(BPF_JNE, BPF_REG_4, 0x45, PASS - 10),
+        /* 10 */ LDX(BPF_B, BPF_REG_4, BPF_REG_2, IP_PROTO),
+        /* 11 */ JMP_IMM(BPF_JNE, BPF_REG_4, IPPROTO_UDP, PASS - 12),
+        /* 12 */ LDX(BPF_H, BPF_REG_4, BPF_REG_2, IP_FRAG),
+        /* 13 */ ALU_IMM(BPF_AND, BPF_REG_4, htons(0x3fff)),
+        /* 14 */ JMP_IMM(BPF_JNE, BPF_REG_4, 0, PASS - 15),
+        /* 15 */ LDX(BPF_H, BPF_REG_4, BPF_REG_2, UDP_MIN_START + 2),
+        /* 16 */ JMP_IMM(BPF_JNE, BPF_REG_4, htons(xdp->port), PASS - 17),
+        /* 17 */ LDX(BPF_W, BPF_REG_2, BPF_REG_6, offsetof(struct xdp_md, rx_queue_index)),
+        /* 18 */ LD_MAP_FD(BPF_REG_1, xdp->map_fd),
+        // The flags are the action when the queue has no socket
+        /* 20 */ MOV_IMM(BPF_REG_3, XDP_PASS),
+        /* 21 */ CALL(BPF_FUNC_redirect_map),
+        /* 22 */ EXIT(),
+        /* 23 */ MOV_IMM(BPF_REG_0, XDP_PASS),
+        /* 24 */ EXIT(),
+    };
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.prog_type = BPF_PROG_TYPE_XDP;
+    attr.insns = (uint64_t)(uintptr_t)insns;
+    attr.insn_cnt = sizeof(insns) / sizeof(insns[0]);
+    attr.license = (uint64_t)(uintptr_t)"GPL";
+    attr.expected_attach_type = BPF_XDP;
+    strncpy(attr.prog_name, "pwar_xdp", sizeof(attr.prog_name) - 1);
+    xdp->prog_fd = (int)sys_bpf(BPF_PROG_LOAD, &attr);
+    return xdp->prog_fd < 0 ? fail(xdp, "loading the XDP program") : 0;
+}
+
+static int attach_program(pwar_xdp_t *xdp) {
+    // Native first, the generic mode works with any driver
+    static const uint32_t modes[] = { XDP_FLAGS_DRV_MODE, XDP_FLAGS_SKB_MODE };
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); ++m) {
+        union bpf_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.link_create.prog_fd = (uint32_t)xdp->prog_fd;
+        attr.link_create.target_ifindex = (uint32_t)xdp->ifindex;
+        attr.link_create.attach_type = BPF_XDP;
+        attr.link_create.flags = modes[m];
+        xdp->link_fd = (int)sys_bpf(BPF_LINK_CREATE, &attr);
+        if (xdp->link_fd >= 0) {
+            xdp->native = modes[m] == XDP_FLAGS_DRV_MODE;
+            return 0;
+        }
+        // Another program on the interface stays, PWAR does not replace it
+        if (errno == EBUSY || errno == EEXIST) break;
+    }
+    return fail(xdp, "attaching the XDP program");
+}
+
+static int map_ring(pwar_xdp_t *xdp, pwar_xdp_ring_t *ring, const struct xdp_ring_offset *offsets,
+                    size_t desc_size, off_t pgoff) {
+    ring->map_size = offsets->desc + PWAR_XDP_RING_SIZE * desc_size;
+    ring->map = mmap(NULL, ring->map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, xdp->xsk_fd, pgoff);
+    if (ring->map == MAP_FAILED) {
+        ring->map = NULL;
+        return fail(xdp, "mapping the rings");
+    }
+    ring->producer = (volatile uint32_t *)((char *)ring->map + offsets->producer);
+    ring->consumer = (volatile uint32_t *)((char *)ring->map + offsets->consumer);
+    ring->ring = (char *)ring->map + offsets->desc;
+    return 0;
+}
+
+static int open_socket(pwar_xdp_t *xdp) {
+    xdp->xsk_fd = socket(AF_XDP, SOCK_RAW, 0);
+    if (xdp->xsk_fd < 0) return fail(xdp, "creating the AF_XDP socket");
+    size_t umem_size = (size_t)PWAR_XDP_NUM_FRAMES * PWAR_XDP_FRAME_SIZE;
+    xdp->umem = mmap(NULL, umem_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (xdp->umem == MAP_FAILED) {
+        xdp->umem = NULL;
+        return fail(xdp, "allocating the UMEM");
+    }
+    struct xdp_umem_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.addr = (uint64_t)(uintptr_t)xdp->umem;
+    reg.len = umem_size;
+    reg.chunk_size = PWAR_XDP_FRAME_SIZE;
+    if (setsockopt(xdp->xsk_fd, SOL_XDP, XDP_UMEM_REG, &reg, sizeof(reg)) < 0) return fail(xdp, "registering the UMEM");
+    int ring_size = PWAR_XDP_RING_SIZE;
+    if (setsockopt(xdp->xsk_fd, SOL_XDP, XDP_UMEM_FILL_RING, &ring_size, sizeof(ring_size)) < 0 ||
+        setsockopt(xdp->xsk_fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &ring_size, sizeof(ring_size)) < 0 ||
+        setsockopt(xdp->xsk_fd, SOL_XDP, XDP_RX_RING, &ring_size, sizeof(ring_size)) < 0) {
+        return fail(xdp, "sizing the rings");
+    }
+    struct xdp_mmap_offsets offsets;
+    socklen_t len = sizeof(offsets);
+    if (getsockopt(xdp->xsk_fd, SOL_XDP, XDP_MMAP_OFFSETS, &offsets, &len) < 0) return fail(xdp, "mapping the rings");
+    if (map_ring(xdp, &xdp->fill, &offsets.fr, sizeof(uint64_t), XDP_UMEM_PGOFF_FILL_RING) < 0 ||
+        map_ring(xdp, &xdp->completion, &offsets.cr, sizeof(uint64_t), XDP_UMEM_PGOFF_COMPLETION_RING) < 0 ||
+        map_ring(xdp, &xdp->rx, &offsets.rx, sizeof(struct xdp_desc), XDP_PGOFF_RX_RING) < 0) {
+        return -1;
+    }
+
+    // Every frame starts out in the fill ring, so it can never overflow
+    uint64_t *fill = (uint64_t *)xdp->fill.ring;
+    for (uint32_t i = 0; i < PWAR_XDP_NUM_FRAMES; ++i) fill[i] = (uint64_t)i * PWAR_XDP_FRAME_SIZE;
+    pwar_atomic_store_release_u32(xdp->fill.producer, PWAR_XDP_NUM_FRAMES);
+
+    // No flags, the kernel takes zero-copy where the driver has it and copies otherwise
+    struct sockaddr_xdp addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sxdp_family = AF_XDP;
+    addr.sxdp_ifindex = (uint32_t)xdp->ifindex;
+    addr.sxdp_queue_id = xdp->queue;
+    // A socket closed just before, by a restart, holds on to the queue until the kernel has torn it down
+    int ret;
+    for (int tries = 0; (ret = bind(xdp->xsk_fd, (struct sockaddr *)&addr, sizeof(addr))) < 0 && errno == EBUSY && tries < 50; ++tries)
+        usleep(10000);
+    if (ret < 0) return fail(xdp, "binding the AF_XDP socket");
+    struct xdp_options options;
+    len = sizeof(options);
+    if (getsockopt(xdp->xsk_fd, SOL_XDP, XDP_OPTIONS, &options, &len) == 0)
+        xdp->zero_copy = (options.flags & XDP_OPTIONS_ZEROCOPY) != 0;
+
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_fd = (uint32_t)xdp->map_fd;
+    attr.key = (uint64_t)(uintptr_t)&xdp->queue;
+    attr.value = (uint64_t)(uintptr_t)&xdp->xsk_fd;
+    if (sys_bpf(BPF_MAP_UPDATE_ELEM, &attr) < 0) return fail(xdp, "adding the socket to the map");
+    return 0;
+}
+
+int pwar_xdp_open(pwar_xdp_t *xdp, const char *ifname, uint32_t queue, uint16_t port) {
+    memset(xdp, 0, sizeof(*xdp));
+    xdp->prog_fd = xdp->map_fd = xdp->link_fd = xdp->xsk_fd = -1;
+    xdp->queue = queue;
+    xdp->port = port;
+    xdp->active = 1;
+    xdp->ifindex = (int)if_nametoindex(ifname);
+    if (!xdp->ifindex) fail(xdp, "looking up the interface");
+    else if (queue >= MAX_QUEUES) {
+        errno = EINVAL;
+        fail(xdp, "looking up the queue");
+    }
+    // The socket is in the map before the program can steer anything to it
+    if (xdp->failed || create_map(xdp) < 0 || open_socket(xdp) < 0 || load_program(xdp) < 0 || attach_program(xdp) < 0) {
+        const char *failed = xdp->failed;
+        int error = xdp->error;
+        pwar_xdp_close(xdp);
+        xdp->failed = failed;
+        xdp->error = error;
+        return -1;
+    }
+    return 0;
+}
+
+static void unmap_ring(pwar_xdp_ring_t *ring) {
+    if (ring->map) munmap(ring->map, ring->map_size);
+    memset(ring, 0, sizeof(*ring));
+}
+
+void pwar_xdp_close(pwar_xdp_t *xdp) {
+    if (!xdp->active) return;
+    // The link goes first, the program stops steering before the socket is gone
+    if (xdp->link_fd >= 0) close(xdp->link_fd);
+    if (xdp->prog_fd >= 0) close(xdp->prog_fd);
+    unmap_ring(&xdp->rx);
+    unmap_ring(&xdp->completion);
+    unmap_ring(&xdp->fill);
+    if (xdp->xsk_fd >= 0) close(xdp->xsk_fd);
+    if (xdp->map_fd >= 0) close(xdp->map_fd);
+    if (xdp->umem) munmap(xdp->umem, (size_t)PWAR_XDP_NUM_FRAMES * PWAR_XDP_FRAME_SIZE);
+    memset(xdp, 0, sizeof(*xdp));
+    xdp->prog_fd = xdp->map_fd = xdp->link_fd = xdp->xsk_fd = -1;
+}
+
+int pwar_xdp_pending(const pwar_xdp_t *xdp) {
+    if (!xdp->active || !xdp->rx.map) return 0;
+    return pwar_atomic_load_acquire_u32(xdp->rx.producer) != *xdp->rx.consumer;
+}
+
+// The UDP payload of an Ethernet frame, NULL if it is not an IPv4 UDP datagram
+static const uint8_t *udp_payload(const uint8_t *frame, uint32_t len, uint32_t *payload_len, struct sockaddr_in *from) {
+    if (len < UDP_MIN_END || frame[ETH_TYPE] != 0x08 || frame[ETH_TYPE + 1] != 0x00) return NULL;
+    if ((frame[IP_START] >> 4) != 4 || frame[IP_PROTO] != IPPROTO_UDP) return NULL;
+    uint32_t udp_start = IP_START + (frame[IP_START] & 0x0f) * 4u;
+    if (udp_start + 8 > len) return NULL;
+    uint32_t udp_len = ((uint32_t)frame[udp_start + 4] << 8) | frame[udp_start + 5];
+    if (udp_len < 8 || udp_start + udp_len > len) return NULL;
+    memset(from, 0, sizeof(*from));
+    from->sin_family = AF_INET;
+    memcpy(&from->sin_addr.s_addr, frame + IP_SRC_ADDR, sizeof(from->sin_addr.s_addr));
+    memcpy(&from->sin_port, frame + udp_start, sizeof(from->sin_port));
+    *payload_len = udp_len - 8;
+    return frame + udp_start + 8;
+}
+
+ssize_t pwar_xdp_recv(pwar_xdp_t *xdp, void *out, size_t size, struct sockaddr_in *from) {
+    if (!xdp->active || !xdp->rx.map) {
+        errno = EAGAIN;
+        return -1;
+    }
+    const struct xdp_desc *descs = (const struct xdp_desc *)xdp->rx.ring;
+    uint64_t *fill = (uint64_t *)xdp->fill.ring;
+    for (;;) {
+        uint32_t consumer = *xdp->rx.consumer;
+        if (pwar_atomic_load_acquire_u32(xdp->rx.producer) == consumer) {
+            errno = EAGAIN;
+            return -1;
+        }
+        struct xdp_desc desc = descs[consumer & (PWAR_XDP_RING_SIZE - 1)];
+        uint32_t payload_len = 0;
+        const uint8_t *payload = udp_payload((const uint8_t *)xdp->umem + desc.addr, desc.len, &payload_len, from);
+        size_t copied = payload ? (payload_len < size ? payload_len : size) : 0;
+        if (copied) memcpy(out, payload, copied);
+
+        // The frame goes straight back to the kernel
+        uint32_t producer = *xdp->fill.producer;
+        fill[producer & (PWAR_XDP_RING_SIZE - 1)] = desc.addr & ~(uint64_t)(PWAR_XDP_FRAME_SIZE - 1);
+        pwar_atomic_store_release_u32(xdp->fill.producer, producer + 1);
+        pwar_atomic_store_release_u32(xdp->rx.consumer, consumer + 1);
+        if (payload) {
+            xdp->received++;
+            return (ssize_t)copied;
+        }
+        xdp->discarded++;
+    }
+}
+
+void pwar_xdp_describe(const pwar_xdp_t *xdp, const char *ifname, char *out, size_t size) {
+    if (xdp->failed) {
+        snprintf(out, size, "AF_XDP on %s not available, %s failed (%s)", ifname, xdp->failed, strerror(xdp->error));
+        return;
+    }
+    if (!xdp->active) {
+        snprintf(out, size, "AF_XDP off");
+        return;
+    }
+    snprintf(out, size, "AF_XDP on %s queue %u, %s mode, %s", ifname, xdp->queue,
+             xdp->native ? "native" : "generic", xdp->zero_copy ? "zero-copy" : "copy");
+}
@@ -0,0 +1,97 @@
+/*
+ * pwar_xdp.h - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+/*
+ * AF_XDP receive path for PWAR's UDP port.
+ *
+ * A small XDP program on the interface hands IPv4 UDP datagrams for the port
+ * straight to an AF_XDP socket, before the kernel's network stack sees them.
+ * The receiver reads them from a ring in shared memory (the UMEM) and gives the
+ * frames back through the fill ring. Everything else, ARP, other ports, IP
+ * options and fragments, and packets on queues without our socket, passes on
+ * to the stack as usual. The regular socket keeps receiving whatever the
+ * program lets through.
+ *
+ * The program is written out instruction by instruction like the reuseport
+ * filter in pwar_shard.c, so there is no compiler or libbpf to depend on. It is
+ * attached through a BPF link, which detaches it when the link's file
+ * descriptor is closed, including when PWAR dies. Needs Linux 5.9 and
+ * CAP_NET_ADMIN plus CAP_BPF (or root). Native mode is tried first, then the
+ * generic mode every driver has. Zero-copy is used where the driver has it.
+ *
+ * Only the queue the socket is bound to is read. On a multi-queue NIC, steer
+ * PWAR's port to that queue (ethtool -N ... dst-port 8321 action N) or reduce
+ * the NIC to one queue.
+ */
+
+#ifndef PWAR_XDP
+#define PWAR_XDP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <netinet/in.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PWAR_XDP_FRAME_SIZE 2048
+#define PWAR_XDP_NUM_FRAMES 2048  // Every frame is in the fill ring or the RX ring, never both
+#define PWAR_XDP_RING_SIZE PWAR_XDP_NUM_FRAMES
+
+typedef struct {
+    volatile uint32_t *producer;
+    volatile uint32_t *consumer;
+    void *ring;
+    void *map;
+    size_t map_size;
+} pwar_xdp_ring_t;
+
+typedef struct {
+    int active;
+    int ifindex;
+    uint32_t queue;
+    uint16_t port;
+    int prog_fd;
+    int map_fd;
+    int link_fd;
+    int xsk_fd;
+    int native;               // Driver mode, otherwise generic
+    int zero_copy;
+    void *umem;
+    pwar_xdp_ring_t fill;
+    pwar_xdp_ring_t completion;
+    pwar_xdp_ring_t rx;
+    const char *failed;       // Step that failed, NULL = none
+    int error;                // Its errno
+    uint32_t received;        // Stats: datagrams handed out
+    uint32_t discarded;       // Stats: frames that were not an IPv4 UDP datagram
+} pwar_xdp_t;
+
+/*
+ * Loads the program on ifname, binds a socket to its queue and steers port to
+ * it. Returns 0, or -1 with failed and error set and nothing left behind.
+ */
+int pwar_xdp_open(pwar_xdp_t *xdp, const char *ifname, uint32_t queue, uint16_t port);
+
+// Detaches the program and frees the rings, safe to call on a backend that never opened
+void pwar_xdp_close(pwar_xdp_t *xdp);
+
+// The next datagram's payload, like recvfrom() with MSG_DONTWAIT. -1 with EAGAIN when the ring is empty
+ssize_t pwar_xdp_recv(pwar_xdp_t *xdp, void *out, size_t size, struct sockaddr_in *from);
+
+// Datagrams are waiting in the RX ring
+int pwar_xdp_pending(const pwar_xdp_t *xdp);
+
+// One line summary like "AF_XDP on eth1 queue 0, native mode, zero-copy"
+void pwar_xdp_describe(const pwar_xdp_t *xdp, const char *ifname, char *out, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* PWAR_XDP */
@@ -0,0 +1,242 @@
+/*
+ * pwar_xdp_bench.c - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+/*
+ * Receive latency and jitter of the AF_XDP path against the regular socket.
+ *
+ * A sender in another network namespace sends one audio datagram per period to
+ * --to, which is an address on --ifname. The receiver reads them the way the
+ * receiver thread does: from the socket, from the AF_XDP ring with poll(), and
+ * from the ring spinning. Every datagram carries its send time, and both ends
+ * share CLOCK_MONOTONIC, so each one's latency is measured directly.
+ *
+ * Needs root. linux/test/xdp_veth.sh runs it over a veth pair between two
+ * namespaces. Without --sender-netns the sender stays in the bench's own
+ * namespace, which only reaches --ifname if the route goes out through it.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "../protocol/pwar_packet.h"
+#include "../protocol/pwar_atomic.h"
+#include "pwar_offload.h"
+#include "pwar_xdp.h"
+
+#define BENCH_PORT 8441
+#define BENCH_TIMEOUT_US 5000 // Like the receiver thread's RECV_TIMEOUT_US
+
+typedef struct {
+    const char *name;
+    int xdp;
+    int busy_poll;
+} bench_mode_t;
+
+static const bench_mode_t modes[] = {
+    { "socket", 0, 0 },
+    { "xdp", 1, 0 },
+    { "xdp-busy", 1, 1 },
+};
+
+static const char *ifname;
+static const char *to_ip;
+static const char *sender_netns;
+static uint32_t queue;
+static uint32_t count = 2000;
+static uint32_t interval_us = 1333; // 64 samples at 48 kHz
+static volatile uint32_t sender_done;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void *sender_thread(void *userdata) {
+    (void)userdata;
+    if (sender_netns) {
+        char path[256];
+        snprintf(path, sizeof(path), "/var/run/netns/%s", sender_netns);
+        int fd = open(path, O_RDONLY);
+        if (fd < 0 || setns(fd, CLONE_NEWNET) < 0) {
+            perror("entering the sender namespace failed");
+            exit(EXIT_FAILURE);
+        }
+        close(fd);
+    }
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sockfd < 0) {
+        perror("socket creation failed");
+        exit(EXIT_FAILURE);
+    }
+    struct sockaddr_in dest;
+    memset(&dest, 0, sizeof(dest));
+    dest.sin_family = AF_INET;
+    dest.sin_addr.s_addr = inet_addr(to_ip);
+    dest.sin_port = htons(BENCH_PORT);
+
+    pwar_packet_t packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.n_samples = 64;
+    packet.num_packets = 1;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    for (uint32_t seq = 0; seq < count; ++seq) {
+        next.tv_nsec += (long)interval_us * 1000;
+        while (next.tv_nsec >= 1000000000) {
+            next.tv_sec += 1;
+            next.tv_nsec -= 1000000000;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        packet.seq = seq;
+        packet.timestamp = now_ns();
+        sendto(sockfd, &packet, sizeof(packet), 0, (struct sockaddr *)&dest, sizeof(dest));
+    }
+    close(sockfd);
+    pwar_atomic_store_release_u32(&sender_done, 1);
+    return NULL;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double percentile_us(const uint64_t *sorted, uint32_t n, double p) {
+    if (n == 0) return 0.0;
+    uint32_t i = (uint32_t)(p * (n - 1) + 0.5);
+    return sorted[i] / 1e3;
+}
+
+static void run(const bench_mode_t *mode, uint64_t *latencies) {
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sockfd < 0) {
+        perror("socket creation failed");
+        exit(EXIT_FAILURE);
+    }
+    struct timeval tv = { .tv_sec = 0, .tv_usec = BENCH_TIMEOUT_US };
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(BENCH_PORT);
+    if (bind(sockfd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("socket bind failed");
+        exit(EXIT_FAILURE);
+    }
+    pwar_offload_rx_t rx;
+    pwar_offload_rx_init(&rx, sockfd, 0);
+    pwar_xdp_t xdp;
+    memset(&xdp, 0, sizeof(xdp));
+    if (mode->busy_poll && sysconf(_SC_NPROCESSORS_ONLN) < 2) {
+        // Spinning at SCHED_FIFO would starve the sender and the softirq that fills the ring
+        printf("%-9s needs a CPU of its own, this machine has one\n", mode->name);
+        close(sockfd);
+        return;
+    }
+    if (mode->xdp) {
+        char line[192];
+        int ret = pwar_xdp_open(&xdp, ifname, queue, BENCH_PORT);
+        pwar_xdp_describe(&xdp, ifname, line, sizeof(line));
+        if (ret < 0) {
+            printf("%-9s %s\n", mode->name, line);
+            close(sockfd);
+            return;
+        }
+        pwar_offload_rx_attach_xdp(&rx, &xdp, BENCH_TIMEOUT_US, mode->busy_poll);
+        if (!mode->busy_poll) printf("%s\n", line);
+    }
+
+    sender_done = 0;
+    pthread_t sender;
+    pthread_create(&sender, NULL, sender_thread, NULL);
+    uint32_t n = 0, from_socket = 0;
+    while (n < count) {
+        pwar_packet_t packet;
+        struct sockaddr_in from;
+        uint32_t xdp_before = xdp.received;
+        ssize_t len = pwar_offload_recv(&rx, &packet, sizeof(packet), 0, &from);
+        uint64_t now = now_ns();
+        if (len == (ssize_t)sizeof(packet)) {
+            latencies[n++] = now > packet.timestamp ? now - packet.timestamp : 0;
+            if (mode->xdp && xdp.received == xdp_before) from_socket++;
+        } else if (len < 0 && pwar_atomic_load_acquire_u32(&sender_done)) {
+            break;
+        }
+    }
+    pthread_join(sender, NULL);
+    pwar_xdp_close(&xdp);
+    close(sockfd);
+
+    qsort(latencies, n, sizeof(latencies[0]), compare_u64);
+    double p50 = percentile_us(latencies, n, 0.5);
+    printf("%-9s %6u/%-6u %8.1f %8.1f %8.1f %8.1f %8.1f %8.1f", mode->name, n, count,
+           percentile_us(latencies, n, 0.0), p50, percentile_us(latencies, n, 0.99),
+           percentile_us(latencies, n, 0.999), percentile_us(latencies, n, 1.0),
+           percentile_us(latencies, n, 0.99) - p50);
+    if (from_socket) printf("  (%u through the socket)", from_socket);
+    printf("\n");
+}
+
+static void usage(const char *prog) {
+    printf("Usage: %s --ifname IF --to IP [options]\n", prog);
+    printf("  --ifname IF         Interface the datagrams arrive on\n");
+    printf("  --to IP             Address of IF the sender sends to\n");
+    printf("  --queue N           RX queue of IF to read (default: 0)\n");
+    printf("  --sender-netns NAME Send from this network namespace (ip netns)\n");
+    printf("  --count N           Datagrams per run (default: %u)\n", count);
+    printf("  --interval-us US    Time between datagrams (default: %u)\n", interval_us);
+}
+
+int main(int argc, char *argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--ifname") == 0 && i + 1 < argc) {
+            ifname = argv[++i];
+        } else if (strcmp(argv[i], "--to") == 0 && i + 1 < argc) {
+            to_ip = argv[++i];
+        } else if (strcmp(argv[i], "--queue") == 0 && i + 1 < argc) {
+            queue = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--sender-netns") == 0 && i + 1 < argc) {
+            sender_netns = argv[++i];
+        } else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+            count = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--interval-us") == 0 && i + 1 < argc) {
+            interval_us = (uint32_t)atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if (!ifname || !to_ip || count == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    uint64_t *latencies = malloc(count * sizeof(uint64_t));
+    if (!latencies) return 1;
+    // Like the receiver thread, which runs SCHED_FIFO 90 by default
+    struct sched_param sp = { .sched_priority = 90 };
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp) != 0)
+        printf("Running without SCHED_FIFO, expect more jitter\n");
+
+    printf("%u datagrams to %s:%d every %u us, latency in us\n", count, to_ip, BENCH_PORT, interval_us);
+    printf("%-9s %13s %8s %8s %8s %8s %8s %8s\n", "mode", "received", "min", "p50", "p99", "p99.9", "max", "jitter");
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); ++m) run(&modes[m], latencies);
+    free(latencies);
+    return 0;
+}
@@ -45,6 +45,7 @@ struct data {
     int pattern_detected_in;
     int pattern_detected_in2;
     uint64_t global_sample_idx; // Absolute sample counter
+    int failed;                 // pwar died, e.g. aborted by the real-time checker
 };
 
 static void on_process(void *userdata, struct spa_io_position *position) {
@@ -91,6 +92,19 @@ static const struct pw_filter_events filter_events = {
     .process = on_process,
 };
 
+// Anything but a clean exit or the SIGTERM sent at the end fails the test
+static int check_pwar_status(struct data *data, int status) {
+    if (WIFSIGNALED(status) && WTERMSIG(status) != SIGTERM && WTERMSIG(status) != SIGKILL) {
+        printf("[integration_test] FAIL: pwar killed by signal %d%s\n", WTERMSIG(status),
+               WTERMSIG(status) == SIGABRT ? ", see the [PWAR RT] report above" : "");
+        data->failed = 1;
+    } else if (WIFEXITED(status) && WEXITSTATUS(status) != 0) {
+        printf("[integration_test] FAIL: pwar exited with status %d\n", WEXITSTATUS(status));
+        data->failed = 1;
+    }
+    return data->failed;
+}
+
 static void do_quit(void *userdata, int signal_number) {
     struct data *data = (struct data *)userdata;
     int status;
@@ -107,6 +121,7 @@ static void do_quit(void *userdata, int signal_number) {
             kill(data->pid_pipewire, SIGKILL);
             waitpid(data->pid_pipewire, &status, 0);
         }
+        check_pwar_status(data, status);
     }
     if (data->pid_windows_sim > 0) {
         printf("Killing windows_sim process with PID %d\n", data->pid_windows_sim);
@@ -132,6 +147,11 @@ void *test_thread_func(void *arg) {
 
     data->pid_pipewire = fork();
     if (data->pid_pipewire == 0) {
+#ifdef PWAR_RT_CHECK_LIB
+        // Allocations, locks and blocking calls on pwar's audio path abort it, which fails the test
+        setenv("LD_PRELOAD", PWAR_RT_CHECK_LIB, 1);
+        setenv("PWAR_RT_CHECK_ABORT", "1", 1);
+#endif
         // Child process: exec pwar with arguments
         //execl("build/pwar_cli", "pwar_cli", "--ip", "127.0.0.1", "--port", "8322", "--oneshot", "--buffer_size", "64", (char *)NULL);
         execl("build/pwar_cli", "pwar_cli", "--ip", "127.0.0.1", "--port", "8322", "--buffer_size", "128", (char *)NULL);
@@ -173,6 +193,16 @@ void *test_thread_func(void *arg) {
         timeout.tv_sec = 0;
         timeout.tv_usec = 100000; // 100ms
         int rv = select(1, &set, NULL, NULL, &timeout);
+        int status;
+        if (data->pid_pipewire > 0 && waitpid(data->pid_pipewire, &status, WNOHANG) == data->pid_pipewire) {
+            data->pid_pipewire = 0;
+            if (!check_pwar_status(data, status))
+                printf("[integration_test] FAIL: pwar exited early\n");
+            data->failed = 1;
+            // do_quit runs on the main loop and stops windows_sim
+            kill(getpid(), SIGTERM);
+            return NULL;
+        }
         if (rv > 0) {
             int c = getchar();
             (void)c;
@@ -284,5 +314,5 @@ int main(int argc, char *argv[]) {
     pw_filter_destroy(data.filter);
     pw_main_loop_destroy(data.loop);
     pw_deinit();
-    return 0;
+    return data.failed ? 1 : 0;
 }
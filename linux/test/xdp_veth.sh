@@ -0,0 +1,34 @@
+#!/bin/bash
+# Runs pwar_xdp_bench over a veth pair between two network namespaces
+#
+# Usage: sudo linux/test/xdp_veth.sh [path/to/pwar_xdp_bench] [bench options]
+#
+# pwar-xdp-rx holds the receiving end (10.77.0.1), pwar-xdp-tx the sending
+# end (10.77.0.2). Both are removed again when the script exits.
+
+set -e
+
+BENCH=${1:-./build/linux/pwar_xdp_bench}
+shift || true
+
+RX_NS=pwar-xdp-rx
+TX_NS=pwar-xdp-tx
+
+cleanup() {
+    ip netns del "$RX_NS" 2>/dev/null || true
+    ip netns del "$TX_NS" 2>/dev/null || true
+}
+trap cleanup EXIT
+cleanup
+
+ip netns add "$RX_NS"
+ip netns add "$TX_NS"
+ip link add veth-pwar-rx netns "$RX_NS" type veth peer name veth-pwar-tx netns "$TX_NS"
+ip -n "$RX_NS" addr add 10.77.0.1/24 dev veth-pwar-rx
+ip -n "$TX_NS" addr add 10.77.0.2/24 dev veth-pwar-tx
+ip -n "$RX_NS" link set lo up
+ip -n "$TX_NS" link set lo up
+ip -n "$RX_NS" link set veth-pwar-rx up
+ip -n "$TX_NS" link set veth-pwar-tx up
+
+ip netns exec "$RX_NS" "$BENCH" --ifname veth-pwar-rx --to 10.77.0.1 --sender-netns "$TX_NS" "$@"
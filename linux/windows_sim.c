@@ -5,18 +5,55 @@
  * This file is part of the PipeWire ASIO Relay (PWAR) project.
  */
 
+/*
+ * Simulates the Windows (ASIO) side of PWAR.
+ *
+ * The network thread only drains the socket, timestamps and reassembles packets.
+ * Completed blocks are handed to the audio thread through lock-free SPSC queues,
+ * where the simulated host callback runs and the result is sent back.
+ *
+ * Options:
+ *   --dsp-load-us N   Busy-wait N microseconds in the host callback (simulated DSP load)
+ *   --inline          Run the host callback on the network thread (legacy behavior, for comparison)
+ *   --rcvbuf BYTES    Socket receive buffer size (the ASIO driver uses 1024)
+ *   --stats           Print network/audio thread statistics once per second
+ *   --host-inputs N   Number of simulated host input channels, each mapped to its own protocol channel
+ *   --pace-burst N    Send blocks of more than N segments in paced groups of N (0 = back to back)
+ *   --pace-spread F   Fraction of the block period the paced groups are spread over (default 0.5)
+ *   --listen-port N   Port to receive the stream on (default 8322), to run one simulator per fanned out host
+ *   --redundant-ip IP Linux's address on a second path, every return is sent over both
+ *   --redundant-bind IP  Local address the second path's returns leave from
+ *   --drop-returns N  Drop every Nth return segment the first time it is sent, resent ones go through
+ *   --clock-master    Run the host callback on its own period timer, like a sound card clocking the remote,
+ *                     with the newest input block. Linux in driver mode follows its returns.
+ *                     A receive-only session gets a 440 Hz tone every period, as from an instrument
+ *   --clock-ppm P     How far the simulated sound card clock is off, in ppm
+ *   --udp-offload     Send each block's returns with GSO and read the stream with GRO where the kernel has them
+ */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <semaphore.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <time.h>
+#include <math.h>
 #include "../protocol/pwar_packet.h"
 #include "../protocol/pwar_router.h"
+#include "../protocol/pwar_spsc_queue.h"
+#include "../protocol/pwar_atomic.h"
+#include "../protocol/pwar_channel_map.h"
+#include "../protocol/pwar_session.h"
+#include "../protocol/pwar_pacer.h"
+#include "../protocol/pwar_clock.h"
+#include "../protocol/pwar_paths.h"
+#include "../protocol/pwar_retransmit.h"
+#include "pwar_offload.h"
 
 #include "latency_manager.h"
 
@@ -26,24 +63,92 @@
 
 #define CHANNELS 2
 #define BUFFER_SIZE 512
+#define NUM_BLOCKS 8 // Blocks in flight between the network and the audio thread
+#define MAX_HOST_INPUTS 16
+#define MAX_BLOCK_ARRIVALS 32 // Packet arrivals a block carries to the audio thread's jitter stats
+#define DEFAULT_SAMPLE_RATE 48000 // Until a session tells us otherwise
+
+typedef struct {
+    uint64_t seq;
+    uint64_t seq_timestamp;
+    uint32_t chunk_size;
+    uint32_t n_samples;
+    uint32_t return_channels; // 0 = send-only session, the host records and nothing goes back
+    uint32_t num_arrivals;
+    uint64_t arrival_ns[MAX_BLOCK_ARRIVALS];       // When each packet of the block arrived
+    uint64_t packet_timestamp[MAX_BLOCK_ARRIVALS]; // And when Linux sent it
+    float samples[CHANNELS * BUFFER_SIZE];
+} sim_block_t;
+
+static struct {
+    int dsp_load_us;
+    int inline_processing;
+    int rcvbuf;
+    int print_stats;
+    int host_inputs;
+    int pace_burst;
+    double pace_spread;
+    int listen_port;
+    const char *redundant_ip;
+    const char *redundant_bind;
+    int drop_returns;
+    int clock_master;
+    double clock_ppm;
+    int udp_offload;
+} sim_config = { 0, 0, 1024 * 1024, 0, CHANNELS, 0, PWAR_PACER_DEFAULT_SPREAD, SIM_PORT, NULL, NULL, 0, 0, 0.0, 0 };
+
+static struct {
+    volatile uint32_t packets_received;
+    volatile uint32_t blocks_completed;
+    volatile uint32_t blocks_processed;
+    volatile uint32_t blocks_dropped; // No free block, the audio thread is too far behind
+    volatile uint32_t max_drain_gap_us; // Longest time the network thread spent away from recvfrom
+    volatile uint32_t returns_dropped;  // First sends left out by --drop-returns
+    volatile uint32_t periods_idle;     // Clock master periods without a new input block
+    volatile uint32_t blocks_superseded; // Clock master, blocks a newer one replaced before their period
+    float host_input_peak[MAX_HOST_INPUTS];
+} stats;
 
 static int recv_sockfd;
-static pthread_mutex_t packet_mutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t packet_cond = PTHREAD_COND_INITIALIZER;
-static pwar_packet_t latest_packet;
-static int packet_available = 0;
+static pwar_offload_rx_t recv_rx; // Owned by the network thread
 static pwar_router_t router;
+static pwar_session_t session; // Owned by the network thread
+static pwar_pacer_t pacer;     // Owned by whichever thread runs the host callback
+static volatile uint32_t stream_sample_rate = DEFAULT_SAMPLE_RATE;
+static volatile uint32_t stream_receive_only; // Linux sends nothing, the clock master plays on its own
+static volatile uint32_t stream_chunk_size;
 static struct sockaddr_in servaddr;
 static int sockfd;
 
+// Redundant paths, path 0 is sockfd to servaddr
+static uint32_t num_paths = 1;
+static int path_sockfd[PWAR_PATHS_MAX];
+static struct sockaddr_in path_addr[PWAR_PATHS_MAX];
+static pwar_offload_tx_t path_tx[PWAR_PATHS_MAX]; // Owned by whichever thread sends returns
+static pwar_paths_t paths; // Incoming copies, owned by the network thread
+static pwar_retransmit_ring_t retransmit_ring; // Filled by whichever thread sends returns, NACKs are answered by the network thread
+
+static sim_block_t blocks[NUM_BLOCKS];
+static pwar_spsc_queue_t free_queue;  // audio thread -> network thread
+static pwar_spsc_queue_t ready_queue; // network thread -> audio thread
+static sem_t ready_sem;
+
+// Simulated host input buffers, like the ASIO inputBuffers
+static float host_inputs[MAX_HOST_INPUTS][BUFFER_SIZE];
+static float *host_input_ptrs[MAX_HOST_INPUTS];
+static long host_input_map[MAX_HOST_INPUTS];
+
 static void setup_recv_socket(int port) {
     recv_sockfd = socket(AF_INET, SOCK_DGRAM, 0);
     if (recv_sockfd < 0) {
         perror("recv socket creation failed");
         exit(EXIT_FAILURE);
     }
-    int rcvbuf = 1024 * 1024;
+    int rcvbuf = sim_config.rcvbuf;
     setsockopt(recv_sockfd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    // Wake up without traffic too, keepalives and liveness run on this thread
+    struct timeval tv = { .tv_sec = 0, .tv_usec = 50000 };
+    setsockopt(recv_sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
     struct sockaddr_in recv_addr;
     memset(&recv_addr, 0, sizeof(recv_addr));
     recv_addr.sin_family = AF_INET;
@@ -55,80 +160,465 @@ static void setup_recv_socket(int port) {
     }
 }
 
+static void simulate_dsp_load(void) {
+    if (sim_config.dsp_load_us <= 0) return;
+    uint64_t end = latency_manager_timestamp_now() + (uint64_t)sim_config.dsp_load_us * 1000;
+    while (latency_manager_timestamp_now() < end) {
+        // Busy wait, like a plugin chain would
+    }
+}
+
+// The latency manager is single threaded, the network thread's arrivals are counted here
+static void note_arrivals(const sim_block_t *block) {
+    for (uint32_t i = 0; i < block->num_arrivals; ++i) {
+        latency_manager_process_arrival_client(block->packet_timestamp[i], block->arrival_ns[i]);
+    }
+}
+
+// The simulated host callback followed by sending the result back
+static void process_block(sim_block_t *block) {
+    static uint32_t returns_sent;
+    pwar_packet_t output_packets[32];
+    uint32_t packets_to_send = 0;
+
+    note_arrivals(block);
+    latency_manager_start_audio_cbk_begin();
+    // Hand every received channel to its own host input, as the ASIO driver does
+    pwar_channel_map_inputs(block->samples, CHANNELS, block->n_samples,
+                            host_input_ptrs, host_input_map, sim_config.host_inputs, BUFFER_SIZE);
+    for (int ch = 0; ch < sim_config.host_inputs; ++ch) {
+        for (uint32_t i = 0; i < block->n_samples; ++i) {
+            float v = host_inputs[ch][i] < 0 ? -host_inputs[ch][i] : host_inputs[ch][i];
+            if (v > stats.host_input_peak[ch]) stats.host_input_peak[ch] = v;
+        }
+    }
+    // Process the output buffers as needed
+    // Loop back host input 0 to both output channels for testing
+    for (uint32_t i = 0; i < block->n_samples; ++i) {
+        block->samples[i] = host_inputs[0][i];
+        block->samples[block->n_samples + i] = host_inputs[0][i];
+    }
+    simulate_dsp_load();
+    latency_manager_start_audio_cbk_end();
+
+    if (block->return_channels > 0)
+        pwar_router_send_buffer(&router, block->chunk_size, block->samples, block->n_samples, CHANNELS, output_packets, 32, &packets_to_send);
+
+    uint64_t timestamp = latency_manager_timestamp_now();
+    // Set seq for all packets in this buffer
+    for (uint32_t i = 0; i < packets_to_send; ++i) {
+        output_packets[i].seq = block->seq;
+        output_packets[i].seq_timestamp = block->seq_timestamp;
+        output_packets[i].timestamp = timestamp;
+    }
+    uint64_t period_ns = (uint64_t)block->n_samples * 1000000000ULL / stream_sample_rate;
+    pwar_pacer_begin_block(&pacer, packets_to_send, period_ns, timestamp);
+    // Each paced group, or the whole block, goes out in runs of segments that are not dropped
+    uint32_t group = pwar_pacer_enabled(&pacer) ? pacer.burst : packets_to_send;
+    for (uint32_t first = 0; first < packets_to_send; first += group) {
+        uint32_t end = first + group < packets_to_send ? first + group : packets_to_send;
+        pwar_pacer_wait(&pacer, first);
+        uint32_t run = first;
+        for (uint32_t i = first; i <= end; ++i) {
+            int dropped = 0;
+            if (i < end) {
+                pwar_retransmit_store(&retransmit_ring, &output_packets[i]);
+                dropped = sim_config.drop_returns > 0 && ++returns_sent % (uint32_t)sim_config.drop_returns == 0;
+                if (dropped) pwar_atomic_fetch_add_u32(&stats.returns_dropped, 1);
+                else continue;
+            }
+            for (uint32_t p = 0; p < num_paths && i > run; ++p) {
+                if (pwar_offload_send(&path_tx[p], &output_packets[run], sizeof(output_packets[0]), i - run, &path_addr[p]) < 0) {
+                    perror("sendto failed");
+                }
+            }
+            run = i + 1;
+        }
+    }
+
+    pwar_latency_info_t latency_info;
+    if (latency_manager_time_for_sending_latency_info(&latency_info)) {
+        ssize_t sent = sendto(sockfd, &latency_info, sizeof(latency_info), 0, (struct sockaddr *)&servaddr, sizeof(servaddr));
+        if (sent < 0) {
+            perror("sendto latency info failed");
+        }
+    }
+    pwar_atomic_fetch_add_u32(&stats.blocks_processed, 1);
+}
+
+// Receive-only, the host input is an instrument playing a tone and the answers carry sequences of their own
+static sim_block_t *instrument_block(void) {
+    static sim_block_t block;
+    static uint64_t seq;
+    static double phase;
+    uint32_t chunk_size = stream_chunk_size;
+    if (chunk_size == 0 || chunk_size > BUFFER_SIZE || BUFFER_SIZE % chunk_size) return NULL;
+    memset(block.samples, 0, sizeof(block.samples));
+    for (uint32_t i = 0; i < BUFFER_SIZE; ++i) {
+        block.samples[i] = 0.5f * (float)sin(phase);
+        phase += 2.0 * M_PI * 440.0 / stream_sample_rate;
+    }
+    phase = fmod(phase, 2.0 * M_PI);
+    block.seq = seq;
+    seq += BUFFER_SIZE / chunk_size;
+    block.seq_timestamp = latency_manager_timestamp_now();
+    block.chunk_size = chunk_size;
+    block.n_samples = BUFFER_SIZE;
+    block.return_channels = CHANNELS;
+    return &block;
+}
+
+// Like a sound card, one host callback per period with whatever input came in, and no input no callback
+static void clock_master_loop(void) {
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (1) {
+        uint64_t period_ns = (uint64_t)(BUFFER_SIZE * 1e9 / stream_sample_rate / (1.0 + sim_config.clock_ppm * 1e-6));
+        next.tv_nsec += (long)period_ns;
+        while (next.tv_nsec >= 1000000000) {
+            next.tv_sec += 1;
+            next.tv_nsec -= 1000000000;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        sim_block_t *newest = NULL, *block;
+        while ((block = pwar_spsc_queue_pop(&ready_queue)) != NULL) {
+            if (newest) {
+                pwar_atomic_fetch_add_u32(&stats.blocks_superseded, 1);
+                note_arrivals(newest);
+                pwar_spsc_queue_push(&free_queue, newest);
+            }
+            newest = block;
+        }
+        if (!newest && stream_receive_only && pwar_session_audio_allowed(&session)) {
+            // No input is coming, the period runs anyway
+            block = instrument_block();
+            if (block) process_block(block);
+            continue;
+        }
+        if (!newest) {
+            pwar_atomic_fetch_add_u32(&stats.periods_idle, 1);
+            continue;
+        }
+        process_block(newest);
+        pwar_spsc_queue_push(&free_queue, newest);
+    }
+}
+
+static void *audio_thread(void *userdata) {
+    (void)userdata;
+    struct sched_param sp = { .sched_priority = 80 };
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+    if (sim_config.clock_master) {
+        clock_master_loop();
+        return NULL;
+    }
+    while (1) {
+        sem_wait(&ready_sem);
+        sim_block_t *block;
+        while ((block = pwar_spsc_queue_pop(&ready_queue)) != NULL) {
+            process_block(block);
+            pwar_spsc_queue_push(&free_queue, block);
+        }
+    }
+    return NULL;
+}
+
+static void send_session_message(const pwar_session_msg_t *msg) {
+    if (sendto(sockfd, msg, sizeof(*msg), 0, (struct sockaddr *)&servaddr, sizeof(servaddr)) < 0) {
+        perror("sendto session message failed");
+    }
+}
+
+static void resend_return(const pwar_packet_t *packet, void *userdata) {
+    (void)userdata;
+    for (uint32_t p = 0; p < num_paths; ++p) {
+        if (sendto(path_sockfd[p], packet, sizeof(*packet), 0, (struct sockaddr *)&path_addr[p], sizeof(path_addr[p])) < 0) {
+            perror("sendto resend failed");
+        }
+    }
+}
+
+static void handle_nack(const pwar_nack_msg_t *nack) {
+    // A NACK from before a renegotiation names segments of another stream
+    if (session.state == PWAR_SESSION_STATE_ESTABLISHED && nack->generation != session.generation) return;
+    pwar_session_note_traffic(&session, latency_manager_timestamp_now());
+    pwar_retransmit_answer(&retransmit_ring, nack, resend_return, NULL);
+}
+
+static void report_session_state(uint32_t before) {
+    static uint32_t stream_session_id, stream_generation;
+    if (session.state == PWAR_SESSION_STATE_ESTABLISHED &&
+        (session.session_id != stream_session_id || session.generation != stream_generation)) {
+        // New stream, forget any half assembled block from before
+        stream_session_id = session.session_id;
+        stream_generation = session.generation;
+        pwar_router_init(&router, CHANNELS);
+        pwar_paths_reset(&paths);
+        if (session.negotiated.sample_rate)
+            stream_sample_rate = session.negotiated.sample_rate;
+        stream_chunk_size = session.negotiated.linux_block_size;
+        stream_receive_only = session.negotiated.send_channels == 0;
+    }
+    if (session.state != before) {
+        printf("[windows_sim] Session %08x.%u %s", session.session_id, session.generation, pwar_session_state_name(session.state));
+        if (session.state == PWAR_SESSION_STATE_REJECTED)
+            printf(" (reason %u)", session.reject_reason);
+        printf("\n");
+    }
+}
+
+static void handle_session_message(const pwar_session_msg_t *msg) {
+    pwar_session_msg_t reply;
+    uint32_t before = session.state;
+    if (pwar_session_handle_message(&session, msg, latency_manager_timestamp_now(), &reply)) {
+        send_session_message(&reply);
+    }
+    report_session_state(before);
+}
+
 static void *receiver_thread(void *userdata) {
+    (void)userdata;
     struct sched_param sp = { .sched_priority = 90 };
     pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+    union {
+        pwar_packet_t packet;
+        pwar_session_msg_t session_msg;
+        pwar_nack_msg_t nack;
+    } recv_buffer;
     pwar_packet_t packet;
+    sim_block_t inline_block;
+    sim_block_t *block = NULL;
 
-    pwar_packet_t output_packets[32];
-    uint32_t packets_to_send = 0;
     while (1) {
-        ssize_t n = recvfrom(recv_sockfd, &packet, sizeof(packet), 0, NULL, NULL);
-        if (n == (ssize_t)sizeof(packet)) {
-            pthread_mutex_lock(&packet_mutex);
-            latest_packet = packet;
-            packet_available = 1;
-            float output_buffers[CHANNELS * BUFFER_SIZE] = {0};
+        struct sockaddr_in from;
+        ssize_t n = pwar_offload_recv(&recv_rx, &recv_buffer, sizeof(recv_buffer), 0, &from);
+        uint64_t recv_returned = latency_manager_timestamp_now();
+        pwar_session_msg_t retry;
+        uint32_t before = session.state;
+        if (pwar_session_poll(&session, recv_returned, &retry)) {
+            send_session_message(&retry);
+        }
+        report_session_state(before);
+        if (n == (ssize_t)sizeof(pwar_session_msg_t) && pwar_session_is_message(&recv_buffer, (uint32_t)n)) {
+            handle_session_message(&recv_buffer.session_msg);
+        } else if (n > 0 && pwar_retransmit_is_nack(&recv_buffer, (uint32_t)n)) {
+            handle_nack(&recv_buffer.nack);
+        } else if (n == (ssize_t)sizeof(packet) && num_paths > 1 &&
+                   !pwar_paths_accept(&paths, from.sin_addr.s_addr == path_addr[1].sin_addr.s_addr,
+                                      pwar_paths_key(&recv_buffer.packet), recv_returned, 0)) {
+            // Already came over the other path
+            pwar_session_note_traffic(&session, recv_returned);
+        } else if (n == (ssize_t)sizeof(packet)) {
+            packet = recv_buffer.packet;
+            pwar_session_note_traffic(&session, recv_returned);
+            pwar_atomic_fetch_add_u32(&stats.packets_received, 1);
             uint32_t chunk_size = packet.n_samples;
+            // Without a session (older Linux side) the block layout is inferred from the packet
+            if (pwar_session_audio_allowed(&session))
+                chunk_size = session.negotiated.linux_block_size;
             packet.num_packets = BUFFER_SIZE / chunk_size;
-            latency_manager_process_packet_client(&packet);
-            int samples_ready = pwar_router_process_streaming_packet(&router, &packet, output_buffers, BUFFER_SIZE, CHANNELS);
-            if (samples_ready > 0) {
-                uint32_t seq = packet.seq;
-
-                latency_manager_start_audio_cbk_begin();
-                // Process the output buffers as needed
-                // Loop back.
-                // But first copy channel 0 to channel 1 for testing
-                for (uint32_t i = 0; i < samples_ready; ++i)
-                    output_buffers[BUFFER_SIZE + i] = output_buffers[i];
-                latency_manager_start_audio_cbk_end();
-
-                pwar_router_send_buffer(&router, chunk_size, output_buffers, samples_ready, CHANNELS, output_packets, 32, &packets_to_send);
-
-                uint64_t timestamp = latency_manager_timestamp_now();
-                // Set seq for all packets in this buffer
-                for (uint32_t i = 0; i < packets_to_send; ++i) {
-                    output_packets[i].seq = seq;
-                    output_packets[i].timestamp = timestamp;
-                }
-                for (uint32_t i = 0; i < packets_to_send; ++i) {
-                    ssize_t sent = sendto(sockfd, &output_packets[i], sizeof(output_packets[i]), 0, (struct sockaddr *)&servaddr, sizeof(servaddr));
-                    if (sent < 0) {
-                        perror("sendto failed");
-                    }
-                }
+
+            if (!block) {
+                block = sim_config.inline_processing ? &inline_block : pwar_spsc_queue_pop(&free_queue);
+                if (block) block->num_arrivals = 0;
             }
-            pwar_latency_info_t latency_info;
-            if (latency_manager_time_for_sending_latency_info(&latency_info)) {
-                ssize_t sent = sendto(sockfd, &latency_info, sizeof(latency_info), 0, (struct sockaddr *)&servaddr, sizeof(servaddr));
-                if (sent < 0) {
-                    perror("sendto latency info failed");
+            // The audio thread owns the latency stats, the arrival goes along with the block
+            if (block && block->num_arrivals < MAX_BLOCK_ARRIVALS) {
+                block->arrival_ns[block->num_arrivals] = recv_returned;
+                block->packet_timestamp[block->num_arrivals] = packet.timestamp;
+                block->num_arrivals++;
+            }
+            if (!block) {
+                // The audio thread is holding every block, keep draining the socket regardless
+                float scratch[CHANNELS * BUFFER_SIZE];
+                if (pwar_router_process_streaming_packet(&router, &packet, scratch, BUFFER_SIZE, CHANNELS) > 0)
+                    pwar_atomic_fetch_add_u32(&stats.blocks_dropped, 1);
+            } else {
+                int samples_ready = pwar_router_process_streaming_packet(&router, &packet, block->samples, BUFFER_SIZE, CHANNELS);
+                if (samples_ready > 0) {
+                    pwar_atomic_fetch_add_u32(&stats.blocks_completed, 1);
+                    block->seq = packet.seq;
+                    block->seq_timestamp = router.seq_timestamp;
+                    block->chunk_size = chunk_size;
+                    block->n_samples = samples_ready;
+                    block->return_channels = pwar_session_audio_allowed(&session) ? session.negotiated.return_channels : CHANNELS;
+                    if (sim_config.inline_processing) {
+                        process_block(block);
+                    } else {
+                        pwar_spsc_queue_push(&ready_queue, block);
+                        sem_post(&ready_sem);
+                    }
+                    block = NULL;
                 }
             }
-            pthread_cond_signal(&packet_cond);
-            pthread_mutex_unlock(&packet_mutex);
         }
+        uint32_t gap_us = (uint32_t)((latency_manager_timestamp_now() - recv_returned) / 1000);
+        if (gap_us > stats.max_drain_gap_us) stats.max_drain_gap_us = gap_us;
     }
     return NULL;
 }
 
-int main() {
+int main(int argc, char *argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--dsp-load-us") == 0 && i + 1 < argc) {
+            sim_config.dsp_load_us = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--inline") == 0) {
+            sim_config.inline_processing = 1;
+        } else if (strcmp(argv[i], "--rcvbuf") == 0 && i + 1 < argc) {
+            sim_config.rcvbuf = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            sim_config.print_stats = 1;
+        } else if (strcmp(argv[i], "--host-inputs") == 0 && i + 1 < argc) {
+            sim_config.host_inputs = atoi(argv[++i]);
+            if (sim_config.host_inputs < 1) sim_config.host_inputs = 1;
+            if (sim_config.host_inputs > MAX_HOST_INPUTS) sim_config.host_inputs = MAX_HOST_INPUTS;
+        } else if (strcmp(argv[i], "--pace-burst") == 0 && i + 1 < argc) {
+            sim_config.pace_burst = atoi(argv[++i]);
+            if (sim_config.pace_burst < 0) sim_config.pace_burst = 0;
+        } else if (strcmp(argv[i], "--pace-spread") == 0 && i + 1 < argc) {
+            sim_config.pace_spread = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--listen-port") == 0 && i + 1 < argc) {
+            sim_config.listen_port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--redundant-ip") == 0 && i + 1 < argc) {
+            sim_config.redundant_ip = argv[++i];
+        } else if (strcmp(argv[i], "--redundant-bind") == 0 && i + 1 < argc) {
+            sim_config.redundant_bind = argv[++i];
+        } else if (strcmp(argv[i], "--drop-returns") == 0 && i + 1 < argc) {
+            sim_config.drop_returns = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--clock-master") == 0) {
+            sim_config.clock_master = 1;
+        } else if (strcmp(argv[i], "--clock-ppm") == 0 && i + 1 < argc) {
+            sim_config.clock_ppm = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--udp-offload") == 0) {
+            sim_config.udp_offload = 1;
+        }
+    }
+    if (sim_config.clock_master && sim_config.inline_processing) {
+        printf("[windows_sim] --inline has no period of its own, ignored with --clock-master\n");
+        sim_config.inline_processing = 0;
+    }
+    pwar_clock_init(PWAR_CLOCK_SOURCE_AUTO);
+
     sockfd = socket(AF_INET, SOCK_DGRAM, 0);
     if (sockfd < 0) { perror("socket"); exit(1); }
     memset(&servaddr, 0, sizeof(servaddr));
     servaddr.sin_family = AF_INET;
     servaddr.sin_port = htons(DEFAULT_STREAM_PORT);
     servaddr.sin_addr.s_addr = inet_addr(DEFAULT_STREAM_IP);
+    path_sockfd[0] = sockfd;
+    path_addr[0] = servaddr;
+    if (sim_config.redundant_ip) {
+        // Copies of Linux's stream come from this address, the returns go back to it
+        path_sockfd[1] = socket(AF_INET, SOCK_DGRAM, 0);
+        if (path_sockfd[1] < 0) { perror("socket"); exit(1); }
+        if (sim_config.redundant_bind) {
+            struct sockaddr_in local;
+            memset(&local, 0, sizeof(local));
+            local.sin_family = AF_INET;
+            local.sin_addr.s_addr = inet_addr(sim_config.redundant_bind);
+            if (bind(path_sockfd[1], (struct sockaddr *)&local, sizeof(local)) < 0) {
+                perror("redundant path bind failed");
+                exit(1);
+            }
+        }
+        path_addr[1] = servaddr;
+        path_addr[1].sin_addr.s_addr = inet_addr(sim_config.redundant_ip);
+        num_paths = 2;
+    }
+    pwar_paths_init(&paths, num_paths);
+    pwar_retransmit_init(&retransmit_ring);
 
     pwar_router_init(&router, CHANNELS);
+    pwar_pacer_init(&pacer, (uint32_t)sim_config.pace_burst, sim_config.pace_spread);
+
+    pwar_session_params_t local;
+    memset(&local, 0, sizeof(local));
+    local.sample_rate = 0; // The simulator follows whatever rate Linux runs at
+    local.remote_block_size = BUFFER_SIZE;
+    local.send_channels = (uint16_t)sim_config.host_inputs;
+    local.return_channels = CHANNELS;
+    local.sample_formats = PWAR_SAMPLE_FORMAT_F32;
+    local.features = PWAR_FEATURE_RETRANSMIT;
+    if (sim_config.clock_master)
+        local.features |= PWAR_FEATURE_CLOCK_MASTER;
+    pwar_session_init(&session, PWAR_SESSION_ROLE_RESPONDER, &local);
 
-    setup_recv_socket(SIM_PORT);
-    pthread_t recv_thread;
+    for (int i = 0; i < MAX_HOST_INPUTS; ++i) {
+        host_input_ptrs[i] = host_inputs[i];
+        host_input_map[i] = i;
+    }
+
+    pwar_spsc_queue_init(&free_queue);
+    pwar_spsc_queue_init(&ready_queue);
+    for (int i = 0; i < NUM_BLOCKS; ++i)
+        pwar_spsc_queue_push(&free_queue, &blocks[i]);
+    sem_init(&ready_sem, 0, 0);
+
+    setup_recv_socket(sim_config.listen_port);
+    int gso = 1;
+    for (uint32_t p = 0; p < num_paths; ++p)
+        gso &= pwar_offload_tx_init(&path_tx[p], path_sockfd[p], sim_config.udp_offload);
+    int gro = pwar_offload_rx_init(&recv_rx, recv_sockfd, sim_config.udp_offload);
+    // Let a running Linux side know we (re)started so it resumes right away
+    pwar_session_msg_t announce;
+    if (pwar_session_announce(&session, &announce)) {
+        send_session_message(&announce);
+    }
+    pthread_t recv_thread, proc_thread;
+    if (!sim_config.inline_processing)
+        pthread_create(&proc_thread, NULL, audio_thread, NULL);
     pthread_create(&recv_thread, NULL, receiver_thread, NULL);
 
+    printf("[windows_sim] %s processing on port %d, simulated DSP load %d us\n",
+           sim_config.inline_processing ? "Inline" : "Split network/audio thread", sim_config.listen_port, sim_config.dsp_load_us);
+    if (pwar_pacer_enabled(&pacer))
+        printf("[windows_sim] Pacing sends in groups of %u over %.0f%% of the block\n", pacer.burst, pacer.spread * 100.0);
+    if (sim_config.clock_master)
+        printf("[windows_sim] Clock master, %u frames per period, clock off by %.1f ppm\n", BUFFER_SIZE, sim_config.clock_ppm);
+    if (sim_config.udp_offload)
+        printf("[windows_sim] UDP offload: GSO %s, GRO %s\n", gso ? "on" : "not available", gro ? "on" : "not available");
+    if (num_paths > 1)
+        printf("[windows_sim] Redundant path to %s from %s\n", sim_config.redundant_ip,
+               sim_config.redundant_bind ? sim_config.redundant_bind : "any address");
+
     while (1) {
         sleep(1);
+        if (sim_config.print_stats) {
+            printf("[windows_sim] packets=%u blocks=%u processed=%u dropped=%u max_drain_gap=%uus\n",
+                   stats.packets_received, stats.blocks_completed, stats.blocks_processed,
+                   stats.blocks_dropped, stats.max_drain_gap_us);
+            stats.max_drain_gap_us = 0;
+            printf("[windows_sim] incoming blocks incomplete=%u segments lost=%u duplicates=%u\n",
+                   router.blocks_incomplete, router.packets_lost, router.duplicates);
+            if (sim_config.udp_offload) {
+                printf("[windows_sim] datagrams received=%u in %u reads, sent=%u in %u sends\n",
+                       recv_rx.datagrams, recv_rx.reads, path_tx[0].segments, path_tx[0].sends);
+            }
+            for (uint32_t p = 0; p < num_paths && num_paths > 1; ++p) {
+                printf("[windows_sim] path %u received=%u first=%u lost=%u lag=%.1fus\n", p,
+                       paths.stats[p].received, paths.stats[p].first, paths.stats[p].lost, paths.stats[p].lag_ns / 1e3);
+            }
+            if (retransmit_ring.requested || stats.returns_dropped) {
+                printf("[windows_sim] returns dropped=%u asked for again=%u resent=%u gone=%u\n", stats.returns_dropped,
+                       retransmit_ring.requested, retransmit_ring.resent, retransmit_ring.expired);
+            }
+            if (sim_config.clock_master) {
+                printf("[windows_sim] clock master periods idle=%u blocks superseded=%u\n",
+                       stats.periods_idle, stats.blocks_superseded);
+            }
+            if (pwar_pacer_enabled(&pacer)) {
+                printf("[windows_sim] paced blocks=%u wait=%.1fms max_behind=%.1fus\n",
+                       pacer.blocks_paced, pacer.total_wait_ns / 1e6, pacer.max_behind_ns / 1e3);
+                pacer.max_behind_ns = 0;
+            }
+            printf("[windows_sim] host input peaks:");
+            for (int ch = 0; ch < sim_config.host_inputs; ++ch) {
+                printf(" %d=%.3f", ch, stats.host_input_peak[ch]);
+                stats.host_input_peak[ch] = 0.0f;
+            }
+            printf("\n");
+            fflush(stdout);
+        }
     }
     return 0;
-}
\ No newline at end of file
+}
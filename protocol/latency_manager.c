@@ -1,12 +1,7 @@
 #include "latency_manager.h"
+#include "pwar_clock.h"
 #include <stdio.h>
-
-#ifdef __linux__
-#include <time.h>
-#elif defined(_WIN32)
-#include <windows.h>
-#define WIN32_LEAN_AND_MEAN
-#endif
+#include <string.h>
 
 typedef struct {
     uint64_t min;
@@ -16,6 +11,31 @@ typedef struct {
     uint64_t count;
 } latency_stat_t;
 
+#define RTT_HIST_BIN_NS 50000   // 50 us per bin
+#define RTT_HIST_BINS 400       // Covers 0-20 ms, the last bin takes everything above
+#define RTT_SEED_WEIGHT 1000    // A seeded profile counts as this many samples
+#define CLOCK_WINDOW_NS 2000000000ULL
+#define CLOCK_DRIFT_ALPHA 0.1
+
+typedef struct {
+    uint32_t bins[RTT_HIST_BINS];
+    uint32_t count;
+    uint32_t seeded; // Part of count that came from a seed, not from measurements
+    uint64_t max;
+} rtt_histogram_t;
+
+typedef struct {
+    // Best (lowest RTT) sample in the current window
+    uint64_t window_start;
+    uint64_t window_best_rtt;
+    int64_t window_best_offset;
+
+    int valid;
+    uint64_t last_window_time;
+    int64_t offset;
+    double drift_ppm;
+} clock_estimate_t;
+
 static struct {
     uint64_t last_latency_info_sent; // Timestamp of the last latency info sent
 
@@ -38,8 +58,68 @@ static struct {
     uint32_t xruns_2sec; // Number of xruns in the last 2 seconds
     uint32_t xruns;
 
+    // ----
+    rtt_histogram_t rtt_hist; // Session wide RTT distribution
+    clock_estimate_t clock;   // Remote clock offset and drift
+
 } internal = {0};
 
+static void rtt_histogram_add(rtt_histogram_t *hist, uint64_t rtt, uint32_t weight) {
+    uint64_t bin = rtt / RTT_HIST_BIN_NS;
+    if (bin >= RTT_HIST_BINS) bin = RTT_HIST_BINS - 1;
+    hist->bins[bin] += weight;
+    hist->count += weight;
+    if (rtt > hist->max) hist->max = rtt;
+}
+
+static uint64_t rtt_histogram_percentile(const rtt_histogram_t *hist, uint32_t percent) {
+    if (hist->count == 0) return 0;
+    uint64_t target = ((uint64_t)hist->count * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < RTT_HIST_BINS; ++i) {
+        seen += hist->bins[i];
+        if (seen >= target) {
+            // Report the upper edge of the bin, i.e. a conservative value
+            uint64_t edge = (uint64_t)(i + 1) * RTT_HIST_BIN_NS;
+            return edge < hist->max ? edge : hist->max;
+        }
+    }
+    return hist->max;
+}
+
+/*
+ * NTP style estimate: the packet left Linux at seq_timestamp, was stamped by the
+ * remote at timestamp and arrived back at now. The sample with the lowest RTT in
+ * each window has the least queueing and gives the offset, drift follows from the
+ * change of offset between windows.
+ */
+static void clock_estimate_add(clock_estimate_t *clock, uint64_t local_send, uint64_t remote_ts, uint64_t now) {
+    uint64_t rtt = now - local_send;
+    int64_t offset = (int64_t)(remote_ts - (local_send + rtt / 2));
+
+    if (clock->window_start == 0) {
+        clock->window_start = now;
+        clock->window_best_rtt = UINT64_MAX;
+    }
+    if (rtt < clock->window_best_rtt) {
+        clock->window_best_rtt = rtt;
+        clock->window_best_offset = offset;
+    }
+    if (now - clock->window_start < CLOCK_WINDOW_NS) return;
+
+    if (clock->valid && clock->last_window_time) {
+        double elapsed = (double)(now - clock->last_window_time);
+        double ppm = (double)(clock->window_best_offset - clock->offset) / elapsed * 1e6;
+        clock->drift_ppm += CLOCK_DRIFT_ALPHA * (ppm - clock->drift_ppm);
+    }
+    clock->offset = clock->window_best_offset;
+    clock->last_window_time = now;
+    clock->valid = 1;
+
+    clock->window_start = now;
+    clock->window_best_rtt = UINT64_MAX;
+}
+
 void latency_manager_init() {
 
 }
@@ -63,9 +143,10 @@ void latency_manager_start_audio_cbk_end() {
 }
 
 void latency_manager_process_packet_client(pwar_packet_t *packet) {
-    uint64_t packet_ts = packet->timestamp;
-    uint64_t nowNs = latency_manager_timestamp_now();
+    latency_manager_process_arrival_client(packet->timestamp, latency_manager_timestamp_now());
+}
 
+void latency_manager_process_arrival_client(uint64_t packet_ts, uint64_t nowNs) {
     uint64_t time_since_last_local_packet = nowNs - internal.last_local_packet_timestamp;
     internal.last_local_packet_timestamp = nowNs;
 
@@ -87,7 +168,10 @@ void latency_manager_process_packet_client(pwar_packet_t *packet) {
 
 void latency_manager_process_packet_server(pwar_packet_t *packet) {
     if (packet->packet_index == packet->num_packets - 1) {
-        uint64_t round_trip_time = latency_manager_timestamp_now() - packet->seq_timestamp;
+        uint64_t now = latency_manager_timestamp_now();
+        uint64_t round_trip_time = now - packet->seq_timestamp;
+        rtt_histogram_add(&internal.rtt_hist, round_trip_time, 1);
+        clock_estimate_add(&internal.clock, packet->seq_timestamp, packet->timestamp, now);
         internal.round_trip_time.total += round_trip_time;
         internal.round_trip_time.count++;
         if (round_trip_time < internal.round_trip_time.min || internal.round_trip_time.count == 1) {
@@ -201,16 +285,52 @@ void latency_manager_report_xrun() {
     internal.xruns++;
 }
 
+static void reset_stat(latency_stat_t *stat) {
+    memset(stat, 0, sizeof(*stat));
+    stat->min = UINT64_MAX;
+}
+
+void latency_manager_reset_window() {
+    reset_stat(&internal.audio_proc);
+    reset_stat(&internal.network_jitter);
+    reset_stat(&internal.round_trip_time);
+    internal.xruns = 0;
+    internal.xruns_2sec = 0;
+    internal.last_latency_info_sent = latency_manager_timestamp_now();
+}
+
+void latency_manager_get_calibration(latency_manager_calibration_t *calibration) {
+    if (!calibration) return;
+    calibration->rtt_p50_ns = rtt_histogram_percentile(&internal.rtt_hist, 50);
+    calibration->rtt_p99_ns = rtt_histogram_percentile(&internal.rtt_hist, 99);
+    calibration->rtt_max_ns = internal.rtt_hist.max;
+    calibration->clock_offset_ns = internal.clock.offset;
+    calibration->clock_drift_ppm = internal.clock.drift_ppm;
+    calibration->rtt_samples = internal.rtt_hist.count - internal.rtt_hist.seeded;
+}
+
+void latency_manager_seed_calibration(const latency_manager_calibration_t *calibration) {
+    if (!calibration || calibration->rtt_samples == 0) return;
+    latency_manager_reset_calibration();
+
+    // Rebuild a coarse distribution: half at p50, the upper tail at p99 and the max
+    rtt_histogram_add(&internal.rtt_hist, calibration->rtt_p50_ns, RTT_SEED_WEIGHT / 2);
+    rtt_histogram_add(&internal.rtt_hist, calibration->rtt_p99_ns, RTT_SEED_WEIGHT / 2 - RTT_SEED_WEIGHT / 100);
+    rtt_histogram_add(&internal.rtt_hist, calibration->rtt_max_ns, RTT_SEED_WEIGHT / 100);
+    internal.rtt_hist.seeded = internal.rtt_hist.count;
+
+    // The offset is re-measured in the first window, the drift carries over as is
+    internal.clock.offset = calibration->clock_offset_ns;
+    internal.clock.drift_ppm = calibration->clock_drift_ppm;
+    internal.clock.valid = 1;
+}
+
+void latency_manager_reset_calibration() {
+    memset(&internal.rtt_hist, 0, sizeof(internal.rtt_hist));
+    memset(&internal.clock, 0, sizeof(internal.clock));
+}
+
 uint64_t latency_manager_timestamp_now() {
-#ifdef __linux__
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
-#elif defined(_WIN32)
-    LARGE_INTEGER freq, counter;
-    QueryPerformanceFrequency(&freq);
-    QueryPerformanceCounter(&counter);
-    return (uint64_t)((counter.QuadPart * 1000000000ULL) / freq.QuadPart);
-#endif
+    return pwar_clock_now_ns();
 }
 
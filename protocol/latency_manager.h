@@ -14,6 +14,8 @@ void latency_manager_init();
 uint64_t latency_manager_timestamp_now();
 
 void latency_manager_process_packet_client(pwar_packet_t *packet);
+// Same, for a packet that arrived at arrival_ns and is accounted for later on another thread
+void latency_manager_process_arrival_client(uint64_t packet_timestamp, uint64_t arrival_ns);
 void latency_manager_process_packet_server(pwar_packet_t *packet);
 
 void latency_manager_start_audio_cbk_begin();
@@ -27,6 +29,24 @@ void latency_manager_get_current_metrics(pwar_latency_metrics_t *metrics);
 
 void latency_manager_report_xrun();
 
+// Starts a clean stats window and clears the xrun counts, the calibration is kept
+void latency_manager_reset_window();
+
+// Long-running calibration, kept across the 2 second stat windows
+typedef struct {
+    uint64_t rtt_p50_ns;
+    uint64_t rtt_p99_ns;
+    uint64_t rtt_max_ns;
+    int64_t clock_offset_ns;  // Remote clock minus local clock
+    double clock_drift_ppm;   // Rate of change of clock_offset_ns
+    uint32_t rtt_samples;     // Number of RTT samples behind the estimate
+} latency_manager_calibration_t;
+
+void latency_manager_get_calibration(latency_manager_calibration_t *calibration);
+// Warm-start from a previous session, live measurements gradually take over
+void latency_manager_seed_calibration(const latency_manager_calibration_t *calibration);
+void latency_manager_reset_calibration();
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,117 @@
+/*
+ * pwar_atomic.h - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+/*
+ * Minimal atomic helpers shared by the Linux (GCC/Clang) and Windows (MSVC) builds.
+ * The protocol sources are compiled as C99 on Linux and as C by MSVC, so <stdatomic.h>
+ * is not an option. On MSVC we rely on x86/x64 ordering plus compiler barriers.
+ */
+
+#ifndef PWAR_ATOMIC
+#define PWAR_ATOMIC
+
+#include <stdint.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(__cplusplus)
+#define PWAR_INLINE static __inline
+#else
+#define PWAR_INLINE static inline
+#endif
+
+PWAR_INLINE uint32_t pwar_atomic_load_acquire_u32(const volatile uint32_t *p) {
+#if defined(_MSC_VER)
+    uint32_t v = *p;
+    _ReadWriteBarrier();
+    return v;
+#else
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#endif
+}
+
+PWAR_INLINE void pwar_atomic_store_release_u32(volatile uint32_t *p, uint32_t v) {
+#if defined(_MSC_VER)
+    _ReadWriteBarrier();
+    *p = v;
+#else
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+#endif
+}
+
+PWAR_INLINE uint32_t pwar_atomic_load_relaxed_u32(const volatile uint32_t *p) {
+#if defined(_MSC_VER)
+    return *p;
+#else
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+#endif
+}
+
+PWAR_INLINE void pwar_atomic_store_relaxed_u32(volatile uint32_t *p, uint32_t v) {
+#if defined(_MSC_VER)
+    *p = v;
+#else
+    __atomic_store_n(p, v, __ATOMIC_RELAXED);
+#endif
+}
+
+PWAR_INLINE uint32_t pwar_atomic_fetch_add_u32(volatile uint32_t *p, uint32_t v) {
+#if defined(_MSC_VER)
+    return (uint32_t)_InterlockedExchangeAdd((volatile long *)p, (long)v);
+#else
+    return __atomic_fetch_add(p, v, __ATOMIC_RELAXED);
+#endif
+}
+
+// Acquire and release, 1 if *p held expected and now holds desired
+PWAR_INLINE int pwar_atomic_cas_u32(volatile uint32_t *p, uint32_t expected, uint32_t desired) {
+#if defined(_MSC_VER)
+    return (uint32_t)_InterlockedCompareExchange((volatile long *)p, (long)desired, (long)expected) == expected;
+#else
+    return __atomic_compare_exchange_n(p, &expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#endif
+}
+
+// Acquire and release, returns the previous value. Serves as a try-lock
+PWAR_INLINE uint32_t pwar_atomic_exchange_u32(volatile uint32_t *p, uint32_t v) {
+#if defined(_MSC_VER)
+    return (uint32_t)_InterlockedExchange((volatile long *)p, (long)v);
+#else
+    return __atomic_exchange_n(p, v, __ATOMIC_ACQ_REL);
+#endif
+}
+
+// Orders plain accesses around a relaxed one, as a seqlock needs
+PWAR_INLINE void pwar_atomic_fence_acquire(void) {
+#if defined(_MSC_VER)
+    _ReadWriteBarrier();
+#else
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+#endif
+}
+
+PWAR_INLINE void pwar_atomic_fence_release(void) {
+#if defined(_MSC_VER)
+    _ReadWriteBarrier();
+#else
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+#endif
+}
+
+// Orders a store before a later load, as a flag handshake between two threads needs
+PWAR_INLINE void pwar_atomic_fence_seq_cst(void) {
+#if defined(_MSC_VER)
+    volatile long barrier = 0;
+    _InterlockedExchange(&barrier, 0); // Locked instructions are full barriers on x86/x64
+#else
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+}
+
+#endif /* PWAR_ATOMIC */
@@ -0,0 +1,44 @@
+/*
+ * pwar_channel_map.c - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+#include "pwar_channel_map.h"
+#include <string.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define PWAR_CHANNEL_MAP_SSE 1
+#endif
+
+void pwar_channel_map_zero(float *dest, uint32_t n_samples) {
+    uint32_t s = 0;
+#ifdef PWAR_CHANNEL_MAP_SSE
+    const __m128 zero = _mm_setzero_ps();
+    for (; s + 8 <= n_samples; s += 8) {
+        _mm_storeu_ps(dest + s, zero);
+        _mm_storeu_ps(dest + s + 4, zero);
+    }
+#endif
+    for (; s < n_samples; ++s) dest[s] = 0.0f;
+}
+
+void pwar_channel_map_inputs(const float *src, uint32_t src_channels, uint32_t n_samples,
+                             float *const *dest, const long *map, uint32_t n_dest, uint32_t dest_frames) {
+    // n_samples stays the source stride, only the copy is cut to the host buffer
+    uint32_t n_copy = n_samples < dest_frames ? n_samples : dest_frames;
+    for (uint32_t i = 0; i < n_dest; ++i) {
+        float *out = dest[i];
+        if (!out) continue;
+        long ch = map ? map[i] : (long)i;
+        if (ch < 0 || (uint32_t)ch >= src_channels) {
+            // Nothing received for this host channel, clear it once for this buffer swap
+            pwar_channel_map_zero(out, dest_frames);
+            continue;
+        }
+        memcpy(out, &src[(uint32_t)ch * n_samples], n_copy * sizeof(float));
+        if (n_copy < dest_frames) pwar_channel_map_zero(out + n_copy, dest_frames - n_copy);
+    }
+}
@@ -0,0 +1,33 @@
+/*
+ * pwar_channel_map.h - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+#ifndef PWAR_CHANNEL_MAP
+#define PWAR_CHANNEL_MAP
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+// Maps every received protocol channel to its own host input buffer.
+// src: flat array, channel-major order: src[channel * n_samples + sample]
+// src_channels: number of protocol channels present in src
+// dest: host input buffers, dest[i] receives protocol channel map[i]
+// map: protocol channel for each host buffer, channels >= src_channels are unused and zeroed
+// n_dest: number of host buffers
+// dest_frames: size of each host buffer, samples past n_samples are zeroed
+void pwar_channel_map_inputs(const float *src, uint32_t src_channels, uint32_t n_samples,
+                             float *const *dest, const long *map, uint32_t n_dest, uint32_t dest_frames);
+
+// Zero a buffer using vector stores where available
+void pwar_channel_map_zero(float *dest, uint32_t n_samples);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* PWAR_CHANNEL_MAP */
@@ -0,0 +1,311 @@
+/*
+ * pwar_clock.c - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+#include "pwar_clock.h"
+#include "pwar_atomic.h"
+#include <string.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <stdio.h>
+#include <time.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define PWAR_CLOCK_HAS_TSC 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+#endif
+
+#if defined(__aarch64__) && !defined(_MSC_VER)
+#define PWAR_CLOCK_HAS_CNTVCT 1
+#endif
+
+#define MAX_CORRECTION 0.1 // Largest rate change a resync makes to slew out an error
+
+enum {
+    PHASE_REFERENCE = 0, // Timestamps come from the reference clock
+    PHASE_CALIBRATING,   // Same, while the counter rate is measured
+    PHASE_COUNTER        // Timestamps come from the counter
+};
+
+static struct {
+    volatile uint32_t phase;
+    volatile uint32_t seq;  // Seqlock over base_ticks, base_ns and mult, odd while written
+    volatile uint32_t busy; // Held by whoever calibrates or resyncs
+    uint32_t source;        // Counter being calibrated or in use
+    uint32_t use_rdtscp;    // For calibration pairs, the hot path takes the cheaper rdtsc
+
+    uint64_t base_ticks;    // The counter read base_ticks at base_ns
+    uint64_t base_ns;
+    uint64_t mult;          // Nanoseconds per tick << PWAR_CLOCK_SHIFT
+    uint64_t resync_ticks;  // Ticks per PWAR_CLOCK_RESYNC_NS
+
+    // Last counter and reference pair, for measuring the rate
+    uint64_t sync_ticks;
+    uint64_t sync_ns;
+} clock_state;
+
+uint64_t pwar_clock_scale(uint64_t ticks, uint64_t mult) {
+#if defined(__SIZEOF_INT128__)
+    return (uint64_t)(((unsigned __int128)ticks * mult) >> PWAR_CLOCK_SHIFT);
+#else
+    // The four 32 bit partial products, shifted down by PWAR_CLOCK_SHIFT (32). Exact while the result fits
+    uint64_t a_hi = ticks >> 32, a_lo = ticks & 0xffffffffu;
+    uint64_t b_hi = mult >> 32, b_lo = mult & 0xffffffffu;
+    return ((a_hi * b_hi) << 32) + a_hi * b_lo + a_lo * b_hi + ((a_lo * b_lo) >> 32);
+#endif
+}
+
+uint64_t pwar_clock_reference_ns(void) {
+#if defined(_WIN32)
+    // The frequency is fixed at boot, read it once instead of dividing by it every call
+    static volatile uint64_t qpc_mult;
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    uint64_t mult = qpc_mult;
+    if (!mult) {
+        LARGE_INTEGER freq;
+        QueryPerformanceFrequency(&freq);
+        mult = (1000000000ULL << PWAR_CLOCK_SHIFT) / (uint64_t)freq.QuadPart;
+        qpc_mult = mult;
+    }
+    return pwar_clock_scale((uint64_t)counter.QuadPart, mult);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static inline uint64_t read_counter(uint32_t source) {
+#if defined(PWAR_CLOCK_HAS_TSC)
+    if (source == PWAR_CLOCK_SOURCE_TSC) return __rdtsc();
+#endif
+#if defined(PWAR_CLOCK_HAS_CNTVCT)
+    if (source == PWAR_CLOCK_SOURCE_CNTVCT) {
+        uint64_t v;
+        __asm__ __volatile__("isb; mrs %0, cntvct_el0" : "=r"(v) : : "memory");
+        return v;
+    }
+#endif
+    (void)source;
+    return pwar_clock_reference_ns();
+}
+
+#if defined(PWAR_CLOCK_HAS_TSC)
+static void cpuid(uint32_t leaf, uint32_t regs[4]) {
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuid(r, (int)leaf);
+    for (int i = 0; i < 4; ++i) regs[i] = (uint32_t)r[i];
+#else
+    if (!__get_cpuid(leaf, &regs[0], &regs[1], &regs[2], &regs[3])) memset(regs, 0, 4 * sizeof(uint32_t));
+#endif
+}
+#endif
+
+// Ticks at the same rate in every P- and C-state, so it can stand in for wall time
+static int tsc_invariant(void) {
+#if defined(PWAR_CLOCK_HAS_TSC)
+    uint32_t regs[4];
+    cpuid(0x80000000u, regs);
+    if (regs[0] < 0x80000007u) return 0;
+    cpuid(0x80000007u, regs);
+    return (regs[3] >> 8) & 1;
+#else
+    return 0;
+#endif
+}
+
+static int has_rdtscp(void) {
+#if defined(PWAR_CLOCK_HAS_TSC)
+    uint32_t regs[4];
+    cpuid(0x80000001u, regs);
+    return (regs[3] >> 27) & 1;
+#else
+    return 0;
+#endif
+}
+
+#if defined(__linux__)
+// The kernel stops using a counter it finds unsynchronized across cores, or unstable under a hypervisor
+static int kernel_uses(const char *clocksource) {
+    char current[64] = {0};
+    FILE *f = fopen("/sys/devices/system/clocksource/clocksource0/current_clocksource", "r");
+    if (!f) return 0;
+    int ok = fgets(current, sizeof(current), f) != NULL;
+    fclose(f);
+    current[strcspn(current, "\n")] = '\0';
+    return ok && strcmp(current, clocksource) == 0;
+}
+#endif
+
+static pwar_clock_source_t auto_source(void) {
+#if defined(__linux__)
+    if (tsc_invariant() && kernel_uses("tsc")) return PWAR_CLOCK_SOURCE_TSC;
+#if defined(PWAR_CLOCK_HAS_CNTVCT)
+    if (kernel_uses("arch_sys_counter")) return PWAR_CLOCK_SOURCE_CNTVCT;
+#endif
+#endif
+    // QueryPerformanceCounter already reads the TSC wherever Windows trusts it
+    return PWAR_CLOCK_SOURCE_OS;
+}
+
+// Waits for the instructions before it, so it cannot drift into the reference read
+static inline uint64_t read_counter_ordered(uint32_t source) {
+#if defined(PWAR_CLOCK_HAS_TSC)
+    unsigned int aux;
+    if (source == PWAR_CLOCK_SOURCE_TSC && clock_state.use_rdtscp) return __rdtscp(&aux);
+#endif
+    return read_counter(source);
+}
+
+// A counter and reference reading taken as close together as a few tries allow
+static void read_pair(uint32_t source, uint64_t *ticks, uint64_t *ns) {
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < 3; ++i) {
+        uint64_t before = read_counter_ordered(source);
+        uint64_t ref = pwar_clock_reference_ns();
+        uint64_t after = read_counter_ordered(source);
+        if (after - before < best) {
+            best = after - before;
+            *ticks = before + (after - before) / 2;
+            *ns = ref;
+        }
+    }
+}
+
+static void publish(uint64_t base_ticks, uint64_t base_ns, uint64_t mult) {
+    uint32_t seq = pwar_atomic_load_relaxed_u32(&clock_state.seq);
+    pwar_atomic_store_relaxed_u32(&clock_state.seq, seq + 1);
+    pwar_atomic_fence_release();
+    clock_state.base_ticks = base_ticks;
+    clock_state.base_ns = base_ns;
+    clock_state.mult = mult;
+    pwar_atomic_store_release_u32(&clock_state.seq, seq + 2);
+}
+
+static uint64_t to_mult(double ns_per_tick) {
+    return (uint64_t)(ns_per_tick * (double)(1ULL << PWAR_CLOCK_SHIFT) + 0.5);
+}
+
+int pwar_clock_init(pwar_clock_source_t source) {
+    if (source == PWAR_CLOCK_SOURCE_AUTO) source = auto_source();
+    if (source == PWAR_CLOCK_SOURCE_TSC && !tsc_invariant()) return -1;
+#if !defined(PWAR_CLOCK_HAS_CNTVCT)
+    if (source == PWAR_CLOCK_SOURCE_CNTVCT) return -1;
+#endif
+    if (source > PWAR_CLOCK_SOURCE_CNTVCT) return -1;
+
+    // Back on the reference while the new counter is measured
+    pwar_atomic_store_release_u32(&clock_state.phase, PHASE_REFERENCE);
+    clock_state.source = (uint32_t)source;
+    clock_state.use_rdtscp = source == PWAR_CLOCK_SOURCE_TSC && has_rdtscp();
+    if (source == PWAR_CLOCK_SOURCE_OS) return (int)source;
+
+    read_pair(clock_state.source, &clock_state.sync_ticks, &clock_state.sync_ns);
+    pwar_atomic_store_release_u32(&clock_state.phase, PHASE_CALIBRATING);
+    return (int)source;
+}
+
+// Once the counter ran for PWAR_CLOCK_CALIBRATE_NS its rate is known well enough to switch over
+static void calibrate(void) {
+    if (pwar_clock_reference_ns() - clock_state.sync_ns < PWAR_CLOCK_CALIBRATE_NS) return;
+    if (pwar_atomic_exchange_u32(&clock_state.busy, 1)) return;
+    if (pwar_atomic_load_acquire_u32(&clock_state.phase) == PHASE_CALIBRATING) {
+        uint64_t ticks, ns;
+        read_pair(clock_state.source, &ticks, &ns);
+        if (ticks > clock_state.sync_ticks) {
+            double ns_per_tick = (double)(ns - clock_state.sync_ns) / (double)(ticks - clock_state.sync_ticks);
+            publish(ticks, ns, to_mult(ns_per_tick));
+            clock_state.resync_ticks = (uint64_t)((double)PWAR_CLOCK_RESYNC_NS / ns_per_tick);
+            clock_state.sync_ticks = ticks;
+            clock_state.sync_ns = ns;
+            pwar_atomic_store_release_u32(&clock_state.phase, PHASE_COUNTER);
+        }
+    }
+    pwar_atomic_store_release_u32(&clock_state.busy, 0);
+}
+
+/*
+ * Measures the rate over the last period and compares the extrapolated time with
+ * the reference. The error is slewed out over the next period by adjusting the
+ * rate, so timestamps never jump. Only a large lead of the reference is stepped.
+ */
+static void resync(void) {
+    if (pwar_atomic_exchange_u32(&clock_state.busy, 1)) return;
+    uint64_t ticks, ns;
+    read_pair(clock_state.source, &ticks, &ns);
+    // Whoever held the lock before may have just done it
+    if (ticks - clock_state.base_ticks >= clock_state.resync_ticks && ticks > clock_state.sync_ticks) {
+        uint64_t extrapolated = clock_state.base_ns + pwar_clock_scale(ticks - clock_state.base_ticks, clock_state.mult);
+        double ns_per_tick = (double)(ns - clock_state.sync_ns) / (double)(ticks - clock_state.sync_ticks);
+        int64_t error = (int64_t)(ns - extrapolated);
+        if (error > (int64_t)PWAR_CLOCK_STEP_NS) {
+            publish(ticks, ns, to_mult(ns_per_tick));
+        } else {
+            double correction = (double)error / (double)PWAR_CLOCK_RESYNC_NS;
+            if (correction > MAX_CORRECTION) correction = MAX_CORRECTION;
+            if (correction < -MAX_CORRECTION) correction = -MAX_CORRECTION;
+            publish(ticks, extrapolated, to_mult(ns_per_tick * (1.0 + correction)));
+        }
+        clock_state.resync_ticks = (uint64_t)((double)PWAR_CLOCK_RESYNC_NS / ns_per_tick);
+        clock_state.sync_ticks = ticks;
+        clock_state.sync_ns = ns;
+    }
+    pwar_atomic_store_release_u32(&clock_state.busy, 0);
+}
+
+uint64_t pwar_clock_now_ns(void) {
+    uint32_t phase = pwar_atomic_load_acquire_u32(&clock_state.phase);
+    if (phase != PHASE_COUNTER) {
+        if (phase == PHASE_CALIBRATING) calibrate();
+        return pwar_clock_reference_ns();
+    }
+
+    uint64_t ticks = read_counter(clock_state.source);
+    uint64_t base_ticks, base_ns, mult;
+    for (;;) {
+        uint32_t before = pwar_atomic_load_acquire_u32(&clock_state.seq);
+        if (before & 1) continue;
+        base_ticks = clock_state.base_ticks;
+        base_ns = clock_state.base_ns;
+        mult = clock_state.mult;
+        pwar_atomic_fence_acquire();
+        if (pwar_atomic_load_relaxed_u32(&clock_state.seq) == before) break;
+    }
+    // Read just before another thread moved the base forward
+    if ((int64_t)(ticks - base_ticks) < 0) return base_ns;
+    if (ticks - base_ticks >= clock_state.resync_ticks) resync();
+    return base_ns + pwar_clock_scale(ticks - base_ticks, mult);
+}
+
+uint64_t pwar_clock_ticks(void) {
+    return read_counter(clock_state.source);
+}
+
+pwar_clock_source_t pwar_clock_source(void) {
+    if (pwar_atomic_load_acquire_u32(&clock_state.phase) != PHASE_COUNTER) return PWAR_CLOCK_SOURCE_OS;
+    return (pwar_clock_source_t)clock_state.source;
+}
+
+const char *pwar_clock_source_name(int source) {
+    switch (source) {
+    case PWAR_CLOCK_SOURCE_AUTO: return "auto";
+    case PWAR_CLOCK_SOURCE_OS: return "os";
+    case PWAR_CLOCK_SOURCE_TSC: return "tsc";
+    case PWAR_CLOCK_SOURCE_CNTVCT: return "cntvct";
+    default: return "unknown";
+    }
+}
@@ -0,0 +1,70 @@
+/*
+ * pwar_clock.h - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+/*
+ * Cheap monotonic timestamps for the hot paths.
+ *
+ * Reads a free running hardware counter (the invariant TSC on x86, the
+ * virtual counter on ARM64) and turns ticks into nanoseconds with a fixed
+ * point multiplier, no division and no system call. The counter is tied to
+ * the OS reference clock (CLOCK_MONOTONIC, QueryPerformanceCounter on
+ * Windows): its rate is measured over a short window first, then every
+ * PWAR_CLOCK_RESYNC_NS the error is folded into the rate for the next period,
+ * so the timestamps stay continuous and within microseconds of the reference.
+ * Timestamps can therefore be mixed with CLOCK_MONOTONIC ones.
+ *
+ * Until pwar_clock_init ran, and while the rate is still measured, the
+ * reference clock is used. The reference itself never divides per call, the
+ * QueryPerformanceCounter frequency is read once.
+ *
+ * Any thread can read, resyncs are done by whichever reader notices one is due.
+ */
+
+#ifndef PWAR_CLOCK
+#define PWAR_CLOCK
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define PWAR_CLOCK_SHIFT 32                          // Fixed point fraction bits of the multiplier
+#define PWAR_CLOCK_CALIBRATE_NS 20000000ULL          // First rate measurement
+#define PWAR_CLOCK_RESYNC_NS 1000000000ULL           // Period of the error corrections
+#define PWAR_CLOCK_STEP_NS 1000000ULL                // Larger errors are stepped out, forward only
+
+typedef enum {
+    PWAR_CLOCK_SOURCE_AUTO = 0, // The cheapest counter the OS also trusts
+    PWAR_CLOCK_SOURCE_OS,       // The reference clock itself
+    PWAR_CLOCK_SOURCE_TSC,      // x86 time stamp counter, must be invariant
+    PWAR_CLOCK_SOURCE_CNTVCT    // ARM64 virtual counter
+} pwar_clock_source_t;
+
+// Not RT safe, call at startup. Returns the source used, or -1 if the requested one is not available
+int pwar_clock_init(pwar_clock_source_t source);
+
+// RT safe. Nanoseconds on the timeline of the reference clock
+uint64_t pwar_clock_now_ns(void);
+
+// RT safe. The reference clock, CLOCK_MONOTONIC or QueryPerformanceCounter
+uint64_t pwar_clock_reference_ns(void);
+
+// Raw counter of the active source, in its own ticks
+uint64_t pwar_clock_ticks(void);
+
+// The source in use, which is PWAR_CLOCK_SOURCE_OS while a counter is still calibrated
+pwar_clock_source_t pwar_clock_source(void);
+const char *pwar_clock_source_name(int source);
+
+// (ticks * mult) >> PWAR_CLOCK_SHIFT without overflowing the intermediate product
+uint64_t pwar_clock_scale(uint64_t ticks, uint64_t mult);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* PWAR_CLOCK */
@@ -0,0 +1,68 @@
+/*
+ * pwar_driver_clock.c - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+#include "pwar_driver_clock.h"
+#include <string.h>
+
+void pwar_driver_clock_init(pwar_driver_clock_t *clock, uint32_t rate) {
+    memset(clock, 0, sizeof(*clock));
+    clock->rate = rate ? rate : 48000;
+    clock->rate_diff = 1.0;
+}
+
+static uint64_t period_ns(const pwar_driver_clock_t *clock, uint32_t duration) {
+    return (uint64_t)duration * 1000000000ULL / clock->rate;
+}
+
+static void anchor(pwar_driver_clock_t *clock, uint64_t now_ns) {
+    clock->anchor_ns = now_ns;
+    clock->anchor_position = clock->position;
+    clock->next_anchor_ns = 0;
+}
+
+void pwar_driver_clock_cycle(pwar_driver_clock_t *clock, uint32_t duration, uint64_t now_ns) {
+    if (!clock->nsec) {
+        clock->duration = duration;
+        clock->nsec = now_ns;
+        anchor(clock, now_ns);
+        return;
+    }
+    clock->position += clock->duration;
+    uint64_t late_ns = PWAR_DRIVER_CLOCK_GAP_CYCLES * period_ns(clock, clock->duration);
+    int gap = now_ns <= clock->nsec || now_ns - clock->nsec > late_ns;
+    int resized = duration != clock->duration;
+    clock->duration = duration;
+    clock->nsec = now_ns;
+    if (gap || resized) {
+        // The cycles since the anchor no longer follow the remote's clock alone
+        anchor(clock, now_ns);
+        return;
+    }
+
+    uint64_t span_ns = now_ns - clock->anchor_ns;
+    if (span_ns >= PWAR_DRIVER_CLOCK_MIN_SPAN_NS) {
+        double nominal_ns = (double)(clock->position - clock->anchor_position) * 1e9 / clock->rate;
+        double rate_diff = nominal_ns / (double)span_ns;
+        if (rate_diff > 1.0 + PWAR_DRIVER_CLOCK_MAX_DEVIATION) rate_diff = 1.0 + PWAR_DRIVER_CLOCK_MAX_DEVIATION;
+        if (rate_diff < 1.0 - PWAR_DRIVER_CLOCK_MAX_DEVIATION) rate_diff = 1.0 - PWAR_DRIVER_CLOCK_MAX_DEVIATION;
+        clock->rate_diff = rate_diff;
+    }
+    if (!clock->next_anchor_ns && span_ns >= PWAR_DRIVER_CLOCK_MAX_SPAN_NS / 2) {
+        clock->next_anchor_ns = now_ns;
+        clock->next_anchor_position = clock->position;
+    }
+    if (span_ns >= PWAR_DRIVER_CLOCK_MAX_SPAN_NS) {
+        // Keep the newer half, the measurement stays long enough
+        clock->anchor_ns = clock->next_anchor_ns;
+        clock->anchor_position = clock->next_anchor_position;
+        clock->next_anchor_ns = 0;
+    }
+}
+
+uint64_t pwar_driver_clock_next_ns(const pwar_driver_clock_t *clock) {
+    return clock->nsec + (uint64_t)((double)period_ns(clock, clock->duration) / clock->rate_diff);
+}
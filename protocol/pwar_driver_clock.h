@@ -0,0 +1,59 @@
+/*
+ * pwar_driver_clock.h - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+/*
+ * Clock of a PipeWire graph that PWAR drives.
+ *
+ * As the driver, PWAR starts a graph cycle whenever a return from a remote that
+ * runs on its own clock is in, so the graph follows that clock. PipeWire needs
+ * to know how fast it runs against CLOCK_MONOTONIC to resample other devices:
+ * rate_diff is the samples the cycles covered over the monotonic time they took,
+ * measured from an anchor far enough back that network jitter averages out.
+ * A gap or a new quantum moves the anchor, the last measurement is kept until
+ * the new one is long enough.
+ *
+ * One thread, the audio thread, uses it.
+ */
+
+#ifndef PWAR_DRIVER_CLOCK
+#define PWAR_DRIVER_CLOCK
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define PWAR_DRIVER_CLOCK_MIN_SPAN_NS 500000000ULL   // Shorter measurements keep the previous rate_diff
+#define PWAR_DRIVER_CLOCK_MAX_SPAN_NS 16000000000ULL // The anchor moves up after this, to follow drift changes
+#define PWAR_DRIVER_CLOCK_MAX_DEVIATION 0.005        // rate_diff is held within 1 +- this
+#define PWAR_DRIVER_CLOCK_GAP_CYCLES 4               // A cycle this many periods late starts a new measurement
+
+typedef struct {
+    uint32_t rate;             // Samples per second
+    uint32_t duration;         // Samples in the current cycle
+    uint64_t position;         // Samples before the current cycle
+    uint64_t nsec;             // Start of the current cycle, 0 = none yet
+    uint64_t anchor_ns;        // Start of the measurement
+    uint64_t anchor_position;
+    uint64_t next_anchor_ns;   // Halfway point, becomes the anchor once the span is too long
+    uint64_t next_anchor_position;
+    double rate_diff;          // Remote samples per nominal sample of monotonic time, 1.0 until measured
+} pwar_driver_clock_t;
+
+void pwar_driver_clock_init(pwar_driver_clock_t *clock, uint32_t rate);
+
+// A cycle of duration samples starts at now_ns
+void pwar_driver_clock_cycle(pwar_driver_clock_t *clock, uint32_t duration, uint64_t now_ns);
+
+// When the cycle after the current one is expected to start
+uint64_t pwar_driver_clock_next_ns(const pwar_driver_clock_t *clock);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* PWAR_DRIVER_CLOCK */
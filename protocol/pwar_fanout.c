@@ -0,0 +1,153 @@
+/*
+ * pwar_fanout.c - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+#include "pwar_fanout.h"
+#include "pwar_atomic.h"
+#include <string.h>
+
+#define PWAR_FANOUT_HISTORY_MASK (PWAR_FANOUT_HISTORY - 1)
+
+int pwar_fanout_init(pwar_fanout_t *fanout, const pwar_fanout_host_config_t *hosts, uint32_t n_hosts, uint32_t sample_rate) {
+    if (n_hosts == 0 || n_hosts > PWAR_FANOUT_MAX_HOSTS || sample_rate == 0) return -1;
+    uint32_t used[PWAR_FANOUT_MAX_CHANNELS] = {0};
+    uint32_t channels = 0;
+    for (uint32_t h = 0; h < n_hosts; ++h) {
+        const pwar_fanout_host_config_t *c = &hosts[h];
+        if (c->channels == 0 || c->channels > PWAR_CHANNELS) return -1;
+        if (c->first_channel + c->channels > PWAR_FANOUT_MAX_CHANNELS) return -1;
+        if (c->miss_policy > PWAR_FANOUT_MISS_DRY) return -1;
+        for (uint32_t ch = c->first_channel; ch < c->first_channel + c->channels; ++ch) {
+            if (used[ch]++) return -1;
+        }
+        if (c->first_channel + c->channels > channels) channels = c->first_channel + c->channels;
+    }
+
+    memset(fanout, 0, sizeof(*fanout));
+    fanout->n_hosts = n_hosts;
+    fanout->channels = channels;
+    fanout->sample_rate = sample_rate;
+    for (uint32_t h = 0; h < n_hosts; ++h) {
+        fanout->hosts[h].config = hosts[h];
+        pwar_slot_ring_init(&fanout->hosts[h].ring);
+    }
+    return 0;
+}
+
+void pwar_fanout_reset_host(pwar_fanout_t *fanout, uint32_t host) {
+    if (host >= fanout->n_hosts) return;
+    pwar_slot_ring_reset(&fanout->hosts[host].ring);
+}
+
+void pwar_fanout_build_packet(pwar_fanout_t *fanout, uint32_t host, uint32_t seq, float *const *in,
+                              uint32_t n_samples, uint64_t now_ns, pwar_packet_t *packet) {
+    pwar_fanout_host_t *h = &fanout->hosts[host];
+    if (n_samples > PWAR_PACKET_MAX_CHUNK_SIZE) n_samples = PWAR_PACKET_MAX_CHUNK_SIZE;
+
+    packet->seq = seq;
+    packet->n_samples = (uint16_t)n_samples;
+    packet->num_packets = 1;
+    packet->packet_index = 0;
+    packet->timestamp = now_ns;
+    packet->seq_timestamp = now_ns;
+    for (uint32_t ch = 0; ch < PWAR_CHANNELS; ++ch) {
+        const float *src = ch < h->config.channels ? in[h->config.first_channel + ch] : NULL;
+        if (src) {
+            memcpy(packet->samples[ch], src, n_samples * sizeof(float));
+        } else {
+            // The remote maps every channel to a host input
+            memset(packet->samples[ch], 0, n_samples * sizeof(float));
+        }
+    }
+
+    uint32_t slot = seq & PWAR_FANOUT_HISTORY_MASK;
+    memcpy(h->history[slot], packet->samples, sizeof(h->history[slot]));
+    h->history_seq_plus_one[slot] = seq + 1;
+}
+
+int pwar_fanout_put(pwar_fanout_t *fanout, uint32_t host, const pwar_packet_t *packet, uint64_t now_ns) {
+    if (host >= fanout->n_hosts) return 0;
+    pwar_fanout_host_t *h = &fanout->hosts[host];
+
+    // seq_timestamp echoes when the first chunk of the block was sent, the remote could
+    // only start once the last one was there
+    uint64_t chunk_ns = (uint64_t)packet->n_samples * 1000000000ULL / fanout->sample_rate;
+    uint64_t complete_ns = packet->seq_timestamp + (packet->num_packets ? packet->num_packets - 1 : 0) * chunk_ns;
+    uint32_t return_us = now_ns > complete_ns ? (uint32_t)((now_ns - complete_ns) / 1000) : 0;
+    pwar_atomic_store_relaxed_u32(&h->last_return_us, return_us);
+    if (h->config.deadline_us && return_us > h->config.deadline_us) {
+        pwar_atomic_fetch_add_u32(&h->past_deadline, 1);
+        return 0;
+    }
+    return pwar_slot_ring_put(&h->ring, packet);
+}
+
+static void cover_miss(pwar_fanout_host_t *h, uint32_t play_seq, float *const *out, uint32_t n_samples) {
+    uint32_t slot = play_seq & PWAR_FANOUT_HISTORY_MASK;
+    for (uint32_t ch = 0; ch < h->config.channels; ++ch) {
+        float *dst = out[h->config.first_channel + ch];
+        if (!dst) continue;
+        if (h->config.miss_policy == PWAR_FANOUT_MISS_HOLD && h->has_last_good) {
+            memcpy(dst, h->last_good[ch], n_samples * sizeof(float));
+        } else if (h->config.miss_policy == PWAR_FANOUT_MISS_DRY && h->history_seq_plus_one[slot] == play_seq + 1) {
+            memcpy(dst, h->history[slot][ch], n_samples * sizeof(float));
+        } else {
+            memset(dst, 0, n_samples * sizeof(float));
+        }
+    }
+}
+
+uint32_t pwar_fanout_collect(pwar_fanout_t *fanout, uint32_t play_seq, uint32_t active_mask,
+                             float *const *out, uint32_t n_samples) {
+    float block[PWAR_CHANNELS * PWAR_PACKET_MAX_CHUNK_SIZE];
+    uint32_t delivered = 0;
+    if (n_samples > PWAR_PACKET_MAX_CHUNK_SIZE) n_samples = PWAR_PACKET_MAX_CHUNK_SIZE;
+
+    for (uint32_t host = 0; host < fanout->n_hosts; ++host) {
+        pwar_fanout_host_t *h = &fanout->hosts[host];
+        int found = 0;
+        if (active_mask & (1u << host)) {
+            found = pwar_slot_ring_get(&h->ring, play_seq, block, PWAR_CHANNELS, n_samples);
+        }
+        if (found) {
+            for (uint32_t ch = 0; ch < h->config.channels; ++ch) {
+                float *dst = out[h->config.first_channel + ch];
+                if (dst) memcpy(dst, &block[ch * n_samples], n_samples * sizeof(float));
+                memcpy(h->last_good[ch], &block[ch * n_samples], n_samples * sizeof(float));
+            }
+            h->has_last_good = 1;
+            h->consecutive_misses = 0;
+            pwar_atomic_fetch_add_u32(&h->delivered, 1);
+            delivered++;
+        } else {
+            cover_miss(h, play_seq, out, n_samples);
+            h->consecutive_misses++;
+            if (h->consecutive_misses > h->max_consecutive_misses)
+                pwar_atomic_store_relaxed_u32(&h->max_consecutive_misses, h->consecutive_misses);
+            pwar_atomic_fetch_add_u32(&h->missed, 1);
+        }
+    }
+    return delivered;
+}
+
+void pwar_fanout_clear_counts(pwar_fanout_t *fanout) {
+    for (uint32_t host = 0; host < fanout->n_hosts; ++host) {
+        pwar_fanout_host_t *h = &fanout->hosts[host];
+        h->consecutive_misses = 0;
+        pwar_atomic_store_relaxed_u32(&h->delivered, 0);
+        pwar_atomic_store_relaxed_u32(&h->missed, 0);
+        pwar_atomic_store_relaxed_u32(&h->max_consecutive_misses, 0);
+    }
+}
+
+const char *pwar_fanout_miss_name(uint32_t policy) {
+    switch (policy) {
+    case PWAR_FANOUT_MISS_SILENCE: return "silence";
+    case PWAR_FANOUT_MISS_HOLD: return "hold";
+    case PWAR_FANOUT_MISS_DRY: return "dry";
+    default: return "unknown";
+    }
+}
@@ -0,0 +1,106 @@
+/*
+ * pwar_fanout.h - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+/*
+ * Fans the channels of one stream out to several remote hosts.
+ *
+ * Every host processes its own group of consecutive channels. Each cycle the
+ * audio thread builds one packet per host from its group, and plays the
+ * returns of the sequence sent a fixed number of cycles ago, merged from every
+ * host into one set of outputs. Each host has its own slot ring, so its block
+ * size and segmentation are independent of the others.
+ *
+ * A return is a miss if it was not there in time for playout, or if it came
+ * back later than the host's deadline. A miss is covered by the host's miss
+ * policy on its own group only, the other groups play normally.
+ *
+ * The receiver thread puts, the audio thread builds and collects, no locks.
+ */
+
+#ifndef PWAR_FANOUT
+#define PWAR_FANOUT
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "pwar_packet.h"
+#include "pwar_slot_ring.h"
+
+#define PWAR_FANOUT_MAX_HOSTS 32 // Hosts are a bit mask
+#define PWAR_FANOUT_MAX_CHANNELS (PWAR_FANOUT_MAX_HOSTS * PWAR_CHANNELS)
+#define PWAR_FANOUT_HISTORY PWAR_SLOT_RING_SLOTS // Sent blocks kept for the dry policy, power of two
+
+typedef enum {
+    PWAR_FANOUT_MISS_SILENCE = 0, // The group plays silence
+    PWAR_FANOUT_MISS_HOLD,        // The group repeats its last good block
+    PWAR_FANOUT_MISS_DRY          // The group plays its own input, unprocessed
+} pwar_fanout_miss_t;
+
+typedef struct {
+    uint32_t first_channel; // First channel of the group, the same for inputs and outputs
+    uint32_t channels;      // 1..PWAR_CHANNELS
+    uint32_t deadline_us;   // Longest time from sending the last chunk of a block to its return, 0 = none
+    uint32_t miss_policy;   // pwar_fanout_miss_t
+} pwar_fanout_host_config_t;
+
+typedef struct {
+    pwar_fanout_host_config_t config;
+    pwar_slot_ring_t ring;
+
+    // Audio thread only
+    uint32_t history_seq_plus_one[PWAR_FANOUT_HISTORY];
+    float history[PWAR_FANOUT_HISTORY][PWAR_CHANNELS][PWAR_PACKET_MAX_CHUNK_SIZE];
+    float last_good[PWAR_CHANNELS][PWAR_PACKET_MAX_CHUNK_SIZE];
+    uint32_t has_last_good;
+    uint32_t consecutive_misses;
+
+    // Counters, each written by one side only
+    volatile uint32_t delivered;        // Audio thread
+    volatile uint32_t missed;           // Audio thread, covered by the miss policy
+    volatile uint32_t max_consecutive_misses;
+    volatile uint32_t past_deadline;    // Receiver thread, returns dropped for their deadline
+    volatile uint32_t last_return_us;   // Receiver thread, last block's send to return time
+} pwar_fanout_host_t;
+
+typedef struct {
+    uint32_t n_hosts;
+    uint32_t channels;    // Total channels, the end of the highest group
+    uint32_t sample_rate;
+    pwar_fanout_host_t hosts[PWAR_FANOUT_MAX_HOSTS];
+} pwar_fanout_t;
+
+// Returns -1 if a group is empty, too wide or overlaps another
+int pwar_fanout_init(pwar_fanout_t *fanout, const pwar_fanout_host_config_t *hosts, uint32_t n_hosts, uint32_t sample_rate);
+
+// Forgets the returns held for one host, for when its stream restarts. Safe against a running audio thread
+void pwar_fanout_reset_host(pwar_fanout_t *fanout, uint32_t host);
+
+// Audio thread. Fills packet with the host's group of in (one pointer per channel, NULL = silence)
+// and keeps the block for the dry policy. n_samples must be <= PWAR_PACKET_MAX_CHUNK_SIZE
+void pwar_fanout_build_packet(pwar_fanout_t *fanout, uint32_t host, uint32_t seq, float *const *in,
+                              uint32_t n_samples, uint64_t now_ns, pwar_packet_t *packet);
+
+// Receiver thread. Stores a packet returned by host, returns 1 if stored
+int pwar_fanout_put(pwar_fanout_t *fanout, uint32_t host, const pwar_packet_t *packet, uint64_t now_ns);
+
+// Audio thread. Writes the merged returns for play_seq to out (one pointer per channel, NULL is
+// skipped), covering every miss with its host's policy. Hosts missing from active_mask are not
+// streaming and always miss. Returns the number of hosts that delivered
+uint32_t pwar_fanout_collect(pwar_fanout_t *fanout, uint32_t play_seq, uint32_t active_mask,
+                             float *const *out, uint32_t n_samples);
+
+// Audio thread. Starts the delivered and missed counts over, e.g. once a warm-up is done
+void pwar_fanout_clear_counts(pwar_fanout_t *fanout);
+
+const char *pwar_fanout_miss_name(uint32_t policy);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* PWAR_FANOUT */
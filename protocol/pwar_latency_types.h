@@ -13,6 +13,9 @@ typedef struct {
     double rtt_avg_ms;
 
     uint32_t xruns;
+    double lock_in_ms; // Time from the first cycle to a steady return stream, 0 until locked
+    uint32_t lost_segments; // Returned segments that never arrived since the stream started
+    uint32_t recovered_segments; // Lost returned segments that were asked for again and arrived
 } pwar_latency_metrics_t;
 
 #endif /* PWAR_LATENCY_TYPES */
@@ -0,0 +1,76 @@
+/*
+ * pwar_pacer.c - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+#include "pwar_pacer.h"
+#include "latency_manager.h"
+#include <string.h>
+
+#ifdef __linux__
+#include <time.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+void pwar_pacer_init(pwar_pacer_t *pacer, uint32_t burst, double spread) {
+    memset(pacer, 0, sizeof(*pacer));
+    pacer->burst = burst;
+    if (spread <= 0.0) spread = PWAR_PACER_DEFAULT_SPREAD;
+    if (spread > PWAR_PACER_MAX_SPREAD) spread = PWAR_PACER_MAX_SPREAD;
+    pacer->spread = spread;
+}
+
+int pwar_pacer_enabled(const pwar_pacer_t *pacer) {
+    return pacer->burst > 0;
+}
+
+void pwar_pacer_begin_block(pwar_pacer_t *pacer, uint32_t n_segments, uint64_t period_ns, uint64_t now_ns) {
+    pacer->n_segments = n_segments;
+    pacer->block_start_ns = now_ns;
+    pacer->group_gap_ns = 0;
+    if (!pwar_pacer_enabled(pacer) || n_segments <= pacer->burst) return;
+
+    // The first group goes out now, the rest evenly within the spread window
+    uint32_t groups = (n_segments + pacer->burst - 1) / pacer->burst;
+    pacer->group_gap_ns = (uint64_t)(period_ns * pacer->spread) / groups;
+    pacer->blocks_paced++;
+}
+
+uint64_t pwar_pacer_segment_time(const pwar_pacer_t *pacer, uint32_t segment) {
+    if (!pacer->group_gap_ns) return pacer->block_start_ns;
+    return pacer->block_start_ns + (uint64_t)(segment / pacer->burst) * pacer->group_gap_ns;
+}
+
+static void wait_until(uint64_t deadline_ns) {
+    uint64_t now = latency_manager_timestamp_now();
+#ifdef __linux__
+    if (deadline_ns > now + PWAR_PACER_SLEEP_SLACK_NS) {
+        // Both sides use CLOCK_MONOTONIC, wake a little early and spin the rest
+        uint64_t wake = deadline_ns - PWAR_PACER_SLEEP_SLACK_NS;
+        struct timespec ts = { (time_t)(wake / 1000000000ULL), (long)(wake % 1000000000ULL) };
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    }
+#endif
+    // Sleep granularity on Windows is far too coarse, spin there
+    while ((now = latency_manager_timestamp_now()) < deadline_ns) {
+#ifdef _WIN32
+        YieldProcessor();
+#endif
+    }
+}
+
+void pwar_pacer_wait(pwar_pacer_t *pacer, uint32_t segment) {
+    if (!pacer->group_gap_ns || segment % pacer->burst != 0 || segment == 0) return;
+
+    uint64_t due = pwar_pacer_segment_time(pacer, segment);
+    uint64_t now = latency_manager_timestamp_now();
+    if (now >= due) {
+        if (now - due > pacer->max_behind_ns) pacer->max_behind_ns = now - due;
+        return;
+    }
+    wait_until(due);
+    pacer->total_wait_ns += due - now;
+}
@@ -0,0 +1,61 @@
+/*
+ * pwar_pacer.h - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+/*
+ * Sender side pacing for blocks that are split into several segments.
+ *
+ * Instead of firing every segment of a block back to back, segments go out in
+ * groups of at most `burst`, and the groups are spread evenly over `spread` of
+ * the block period. This keeps small switch buffers and NIC rings from
+ * overflowing, at the cost of the last segment leaving up to spread * period
+ * later.
+ */
+
+#ifndef PWAR_PACER
+#define PWAR_PACER
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define PWAR_PACER_DEFAULT_SPREAD 0.5
+#define PWAR_PACER_MAX_SPREAD 0.9           // Leave time for the host callback
+#define PWAR_PACER_SLEEP_SLACK_NS 200000ULL // Closer than this to a send time we spin
+
+typedef struct {
+    uint32_t burst;          // Segments sent back to back, 0 = pacing off
+    double spread;           // Fraction of the period a block is spread over
+
+    // Current block
+    uint32_t n_segments;
+    uint64_t block_start_ns;
+    uint64_t group_gap_ns;
+
+    // Stats
+    uint32_t blocks_paced;
+    uint64_t total_wait_ns;
+    uint64_t max_behind_ns;  // Largest lag behind the schedule, the sender could not keep up
+} pwar_pacer_t;
+
+void pwar_pacer_init(pwar_pacer_t *pacer, uint32_t burst, double spread);
+int pwar_pacer_enabled(const pwar_pacer_t *pacer);
+
+// Plans the sends of one block, period_ns is the time the block covers
+void pwar_pacer_begin_block(pwar_pacer_t *pacer, uint32_t n_segments, uint64_t period_ns, uint64_t now_ns);
+
+// When segment may be sent, per the current plan
+uint64_t pwar_pacer_segment_time(const pwar_pacer_t *pacer, uint32_t segment);
+
+// Waits until segment may be sent, sleeping while far away and spinning when close
+void pwar_pacer_wait(pwar_pacer_t *pacer, uint32_t segment);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* PWAR_PACER */
@@ -49,4 +49,72 @@ typedef struct {
 
 } pwar_latency_info_t;
 
+/*
+ * Session control messages. Told apart from audio and latency info by their size,
+ * and checked with the magic before being trusted.
+ */
+#define PWAR_SESSION_MAGIC 0x53525750u // "PWRS"
+#define PWAR_PROTOCOL_VERSION 1
+#define PWAR_PROTOCOL_MIN_VERSION 1
+
+typedef enum {
+    PWAR_SESSION_MSG_HELLO = 1,       // Linux -> remote, offer
+    PWAR_SESSION_MSG_ACCEPT = 2,      // remote -> Linux, negotiated parameters
+    PWAR_SESSION_MSG_ACK = 3,         // Linux -> remote, audio may flow
+    PWAR_SESSION_MSG_REJECT = 4,      // remote -> Linux, see reject_reason
+    PWAR_SESSION_MSG_RENEGOTIATE = 5, // remote -> Linux, please send a new HELLO
+    PWAR_SESSION_MSG_BYE = 6,         // Either side, session ends
+    PWAR_SESSION_MSG_KEEPALIVE = 7    // Either side, the peer is still there
+} pwar_session_msg_type_t;
+
+typedef enum {
+    PWAR_SESSION_REJECT_NONE = 0,
+    PWAR_SESSION_REJECT_VERSION = 1,
+    PWAR_SESSION_REJECT_SAMPLE_RATE = 2,
+    PWAR_SESSION_REJECT_BLOCK_SIZE = 3,
+    PWAR_SESSION_REJECT_CHANNELS = 4,
+    PWAR_SESSION_REJECT_FORMAT = 5,
+    PWAR_SESSION_REJECT_CLOCK = 6      // Receive-only needs a remote running on its own clock
+} pwar_session_reject_t;
+
+// Sample formats, offered as a mask, negotiated to exactly one bit
+#define PWAR_SAMPLE_FORMAT_F32 (1u << 0)
+#define PWAR_SAMPLE_FORMAT_S16 (1u << 1)
+
+// Optional features, negotiated to the intersection of both sides
+#define PWAR_FEATURE_COMPRESSION (1u << 0)
+#define PWAR_FEATURE_FEC (1u << 1)
+#define PWAR_FEATURE_RETRANSMIT (1u << 2) // The remote resends return segments Linux asks for again
+#define PWAR_FEATURE_CLOCK_MASTER (1u << 3) // The remote runs on its own clock, Linux may follow its returns
+
+typedef struct {
+    uint32_t magic;              // PWAR_SESSION_MAGIC
+    uint16_t version;            // Offered (HELLO) or negotiated (ACCEPT) protocol version
+    uint16_t type;               // pwar_session_msg_type_t
+    uint32_t session_id;         // Chosen by Linux, echoed by the remote
+    uint32_t generation;         // Bumped on every renegotiation
+    uint32_t sample_rate;
+    uint32_t linux_block_size;   // Samples per packet sent by Linux
+    uint32_t remote_block_size;  // Remote host buffer size, a multiple of linux_block_size
+    uint16_t send_channels;      // Linux -> remote, 0 = receive-only session
+    uint16_t return_channels;    // remote -> Linux, 0 = send-only session
+    uint32_t sample_formats;
+    uint32_t features;
+    uint32_t reject_reason;      // pwar_session_reject_t
+} pwar_session_msg_t;
+
+/*
+ * Linux -> remote, asks for return segments again. Told apart by its size like
+ * the session messages, and checked with the magic before being trusted.
+ */
+#define PWAR_NACK_MAGIC 0x4b4e5750u // "PWNK"
+
+typedef struct {
+    uint32_t magic;      // PWAR_NACK_MAGIC
+    uint32_t generation; // Session generation the buffer belongs to
+    uint64_t seq;        // Buffer the segments belong to
+    uint64_t missing;    // Bit per packet_index to send again
+    uint64_t reserved;   // Zero, keeps the size apart from pwar_latency_info_t
+} pwar_nack_msg_t;
+
 #endif /* PWAR_PACKET */
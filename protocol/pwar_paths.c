@@ -0,0 +1,86 @@
+/*
+ * pwar_paths.c - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+#include "pwar_paths.h"
+#include "pwar_atomic.h"
+#include <string.h>
+
+#define PWAR_PATHS_MASK (PWAR_PATHS_WINDOW - 1)
+#define PWAR_PATHS_STALE_WINDOWS 4 // A copy this far behind is stale, further back the sequence restarted
+#define PWAR_PATHS_SMOOTHING 3     // Averages move 1/8 of the way per sample
+
+void pwar_paths_init(pwar_paths_t *paths, uint32_t num_paths) {
+    memset(paths, 0, sizeof(*paths));
+    if (num_paths < 1) num_paths = 1;
+    paths->num_paths = num_paths > PWAR_PATHS_MAX ? PWAR_PATHS_MAX : num_paths;
+}
+
+void pwar_paths_reset(pwar_paths_t *paths) {
+    memset(paths->window, 0, sizeof(paths->window));
+}
+
+uint32_t pwar_paths_key(const pwar_packet_t *packet) {
+    return (uint32_t)packet->seq + packet->packet_index;
+}
+
+static void smooth(volatile uint32_t *average, uint64_t sample_ns) {
+    uint32_t sample = sample_ns > UINT32_MAX ? UINT32_MAX : (uint32_t)sample_ns;
+    uint32_t old = pwar_atomic_load_relaxed_u32(average);
+    int64_t next = old ? (int64_t)old + (((int64_t)sample - old) >> PWAR_PATHS_SMOOTHING) : sample;
+    pwar_atomic_store_relaxed_u32(average, (uint32_t)next);
+}
+
+// The segment leaves the window, every path that never delivered it lost it
+static void retire(pwar_paths_t *paths, const pwar_paths_entry_t *entry) {
+    for (uint32_t p = 0; p < paths->num_paths; ++p) {
+        if (!(entry->seen & (1u << p))) pwar_atomic_fetch_add_u32(&paths->stats[p].lost, 1);
+    }
+}
+
+int pwar_paths_accept(pwar_paths_t *paths, uint32_t path, uint32_t key, uint64_t now_ns, uint64_t latency_ns) {
+    if (path >= paths->num_paths) path = 0;
+    pwar_path_stats_t *stats = &paths->stats[path];
+    uint32_t bit = 1u << path;
+    pwar_atomic_fetch_add_u32(&stats->received, 1);
+    if (latency_ns) smooth(&stats->latency_ns, latency_ns);
+
+    pwar_paths_entry_t *entry = &paths->window[key & PWAR_PATHS_MASK];
+    if (entry->key_plus_one == key + 1) {
+        // Already used, or a copy the network itself duplicated
+        if (!(entry->seen & bit)) {
+            entry->seen |= bit;
+            smooth(&stats->lag_ns, now_ns > entry->first_ns ? now_ns - entry->first_ns : 0);
+        }
+        return 0;
+    }
+    if (entry->key_plus_one) {
+        int32_t ahead = (int32_t)(key - (entry->key_plus_one - 1));
+        if (ahead < 0 && ahead >= -(int32_t)(PWAR_PATHS_WINDOW * PWAR_PATHS_STALE_WINDOWS)) {
+            // Older than what the window remembers, its turn is long gone
+            return 0;
+        }
+        retire(paths, entry);
+    }
+    entry->key_plus_one = key + 1;
+    entry->seen = bit;
+    entry->first_ns = now_ns;
+    pwar_atomic_fetch_add_u32(&stats->first, 1);
+    return 1;
+}
+
+int pwar_paths_leader(const pwar_paths_t *paths, const uint32_t *first_before) {
+    int leader = -1;
+    uint32_t most = 0;
+    for (uint32_t p = 0; p < paths->num_paths; ++p) {
+        uint32_t won = pwar_atomic_load_relaxed_u32(&paths->stats[p].first) - first_before[p];
+        if (won > most) {
+            most = won;
+            leader = (int)p;
+        }
+    }
+    return leader;
+}
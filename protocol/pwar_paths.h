@@ -0,0 +1,73 @@
+/*
+ * pwar_paths.h - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+/*
+ * Redundant transmission over several network paths.
+ *
+ * Every audio datagram is sent once per path, for example over two NICs, and
+ * the receiver keeps whichever copy arrives first. Segments are told apart by
+ * the sequence they carry (seq + packet_index), a small window remembers the
+ * recent ones so a duplicate costs one compare.
+ *
+ * Per path it counts the copies that arrived, the ones that were first and the
+ * segments only other paths delivered, and follows how late its copies come.
+ * A segment counts as lost on a path once it leaves the window.
+ *
+ * One thread accepts, counters may be read from any thread.
+ */
+
+#ifndef PWAR_PATHS
+#define PWAR_PATHS
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "pwar_packet.h"
+
+#define PWAR_PATHS_MAX 2
+#define PWAR_PATHS_WINDOW 256 // Segments remembered, must be a power of two
+
+typedef struct {
+    uint32_t key_plus_one; // Segment held by the entry + 1, 0 = empty
+    uint32_t seen;         // Bit per path that delivered it
+    uint64_t first_ns;     // Arrival of the first copy
+} pwar_paths_entry_t;
+
+typedef struct {
+    volatile uint32_t received;   // Copies that arrived on this path
+    volatile uint32_t first;      // Copies that were first, the ones used
+    volatile uint32_t lost;       // Segments only other paths delivered
+    volatile uint32_t latency_ns; // Smoothed transit time reported by the caller, 0 = unknown
+    volatile uint32_t lag_ns;     // Smoothed time its copies arrived after the first one
+} pwar_path_stats_t;
+
+typedef struct {
+    uint32_t num_paths;
+    pwar_paths_entry_t window[PWAR_PATHS_WINDOW];
+    pwar_path_stats_t stats[PWAR_PATHS_MAX];
+} pwar_paths_t;
+
+void pwar_paths_init(pwar_paths_t *paths, uint32_t num_paths);
+// Forgets the window but keeps the counters, for when sequence numbers restart
+void pwar_paths_reset(pwar_paths_t *paths);
+
+// Sequence a segment stands for, the same on every path
+uint32_t pwar_paths_key(const pwar_packet_t *packet);
+
+// Returns 1 for the first copy of segment key, which is to be used, 0 for a duplicate.
+// latency_ns is how long the copy was underway if the caller can tell, or 0
+int pwar_paths_accept(pwar_paths_t *paths, uint32_t path, uint32_t key, uint64_t now_ns, uint64_t latency_ns);
+
+// Path with the most first copies between two snapshots of the counters, -1 if none
+int pwar_paths_leader(const pwar_paths_t *paths, const uint32_t *first_before);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* PWAR_PATHS */
@@ -9,24 +9,58 @@
 static struct {
     float buffers[2][PWAR_RCV_BUFFER_MAX_CHANNELS][PWAR_RCV_BUFFER_MAX_SAMPLES];
     uint32_t n_samples[2];
+    uint32_t ready[2]; // Samples at the start of the buffer that are in
     uint32_t channels;
     uint32_t chunk_pos;
     int buffer_ready[2];
     int ping_pong; // 0 or 1
+    // Block being published by add_prefix, it stays in its buffer even if the reader swaps to it
+    int write_idx;
+    int write_valid;
+    uint64_t write_seq;
 } rcv = {0};
 
-int pwar_rcv_buffer_add_buffer(float *buffer, uint32_t n_samples, uint32_t channels) {
-    if (channels > PWAR_RCV_BUFFER_MAX_CHANNELS || n_samples > PWAR_RCV_BUFFER_MAX_SAMPLES) return -1;
-    int idx = rcv.ping_pong;
+static void copy_samples(int idx, const float *buffer, uint32_t from, uint32_t to, uint32_t channels, uint32_t stride) {
     for (uint32_t ch = 0; ch < channels; ++ch) {
-        memcpy(rcv.buffers[idx][ch], &buffer[ch * n_samples], n_samples * sizeof(float));
+        memcpy(&rcv.buffers[idx][ch][from], &buffer[ch * stride + from], (to - from) * sizeof(float));
     }
+}
+
+int pwar_rcv_buffer_add_buffer(const float *buffer, uint32_t n_samples, uint32_t channels, uint32_t stride) {
+    if (channels > PWAR_RCV_BUFFER_MAX_CHANNELS || n_samples > PWAR_RCV_BUFFER_MAX_SAMPLES) return -1;
+    int idx = rcv.ping_pong;
+    copy_samples(idx, buffer, 0, n_samples, channels, stride);
     rcv.n_samples[idx] = n_samples;
+    rcv.ready[idx] = n_samples;
     rcv.channels = channels;
     rcv.buffer_ready[idx] = 1;
+    rcv.write_valid = 0;
     return 0;
 }
 
+int pwar_rcv_buffer_add_prefix(uint64_t seq, const float *buffer, uint32_t ready, uint32_t n_samples, uint32_t channels, uint32_t stride) {
+    if (channels > PWAR_RCV_BUFFER_MAX_CHANNELS || n_samples > PWAR_RCV_BUFFER_MAX_SAMPLES || ready > n_samples) return -1;
+    int idx;
+    if (!rcv.write_valid || seq != rcv.write_seq) {
+        // A new block, it goes where add_buffer would put it
+        idx = rcv.ping_pong;
+        rcv.n_samples[idx] = n_samples;
+        rcv.ready[idx] = 0;
+        rcv.channels = channels;
+        rcv.buffer_ready[idx] = 1;
+        rcv.write_idx = idx;
+        rcv.write_seq = seq;
+        rcv.write_valid = 1;
+    } else {
+        idx = rcv.write_idx;
+        // Played out already, or nothing new
+        if (!rcv.buffer_ready[idx] || ready <= rcv.ready[idx]) return 0;
+    }
+    copy_samples(idx, buffer, rcv.ready[idx], ready, channels, stride);
+    rcv.ready[idx] = ready;
+    return 1;
+}
+
 int pwar_rcv_get_chunk(float *chunks, uint32_t channels, uint32_t chunk_size) {
     int idx = !rcv.ping_pong; // read from the other buffer
     if (!rcv.buffer_ready[idx] || channels > rcv.channels) {
@@ -39,10 +73,13 @@ int pwar_rcv_get_chunk(float *chunks, uint32_t channels, uint32_t chunk_size) {
     }
     uint32_t n_samples = rcv.n_samples[idx];
     uint32_t start = rcv.chunk_pos * chunk_size;
+    uint32_t remain = n_samples - start;
+    uint32_t to_copy = remain < chunk_size ? remain : chunk_size;
+    // The chunk's segments may not be in yet, its turn passes all the same
+    int got_chunk = start + to_copy <= rcv.ready[idx];
+    if (!got_chunk) to_copy = 0;
     // Copy chunk
     for (uint32_t ch = 0; ch < channels; ++ch) {
-        uint32_t remain = n_samples - start;
-        uint32_t to_copy = remain < chunk_size ? remain : chunk_size;
         memcpy(&chunks[ch * chunk_size], &rcv.buffers[idx][ch][start], to_copy * sizeof(float));
         if (to_copy < chunk_size) {
             memset(&chunks[ch * chunk_size + to_copy], 0, (chunk_size - to_copy) * sizeof(float));
@@ -55,5 +92,16 @@ int pwar_rcv_get_chunk(float *chunks, uint32_t channels, uint32_t chunk_size) {
         rcv.chunk_pos = 0;
         rcv.ping_pong = !rcv.ping_pong; // swap buffers
     }
-    return 1;
-}
\ No newline at end of file
+    return got_chunk;
+}
+void pwar_rcv_buffer_reset(void) {
+    rcv.buffer_ready[0] = 0;
+    rcv.buffer_ready[1] = 0;
+    rcv.n_samples[0] = 0;
+    rcv.n_samples[1] = 0;
+    rcv.ready[0] = 0;
+    rcv.ready[1] = 0;
+    rcv.chunk_pos = 0;
+    rcv.ping_pong = 0;
+    rcv.write_valid = 0;
+}
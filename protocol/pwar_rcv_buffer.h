@@ -4,8 +4,15 @@
 #include <stdint.h>
 
 // No init needed, always static
-// buffer: flat array, channel-major order: buffer[channel * n_samples + sample]
-int pwar_rcv_buffer_add_buffer(float *buffer, uint32_t n_samples, uint32_t channels);
+// buffer: flat array, channel-major order: buffer[channel * stride + sample]
+int pwar_rcv_buffer_add_buffer(const float *buffer, uint32_t n_samples, uint32_t channels, uint32_t stride);
+// Cut-through: publishes the first ready samples of block seq, n_samples long, while its
+// tail is still arriving. Later calls for the same seq extend it, pwar_rcv_get_chunk serves
+// every chunk that is in. Returns 1 if anything new was published
+int pwar_rcv_buffer_add_prefix(uint64_t seq, const float *buffer, uint32_t ready, uint32_t n_samples, uint32_t channels, uint32_t stride);
+// Returns 1 for a chunk of audio, 0 for silence: no block ready, or its chunk not in yet
 int pwar_rcv_get_chunk(float *chunks, uint32_t channels, uint32_t chunk_size);
+// Drops anything buffered, e.g. when the stream resumes after the peer was lost
+void pwar_rcv_buffer_reset(void);
 
 #endif /* PWAR_RCV_BUFFER */
@@ -0,0 +1,139 @@
+/*
+ * pwar_retransmit.c - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+#include "pwar_retransmit.h"
+#include "pwar_atomic.h"
+#include <string.h>
+
+#define PWAR_RETRANSMIT_MASK (PWAR_RETRANSMIT_SLOTS - 1)
+#define PWAR_RETRANSMIT_SMOOTHING 3 // The RTT moves 1/8 of the way per sample
+
+void pwar_retransmit_init(pwar_retransmit_ring_t *ring) {
+    memset(ring, 0, sizeof(*ring));
+}
+
+static uint32_t slot_of(uint64_t seq, uint32_t index) {
+    return (uint32_t)(seq + index) & PWAR_RETRANSMIT_MASK;
+}
+
+void pwar_retransmit_store(pwar_retransmit_ring_t *ring, const pwar_packet_t *packet) {
+    pwar_retransmit_slot_t *slot = &ring->slots[slot_of(packet->seq, packet->packet_index)];
+    uint32_t version = pwar_atomic_load_relaxed_u32(&slot->version);
+    pwar_atomic_store_relaxed_u32(&slot->version, version + 1);
+    pwar_atomic_fence_release();
+    slot->packet = *packet;
+    pwar_atomic_store_release_u32(&slot->version, version + 2);
+}
+
+int pwar_retransmit_find(pwar_retransmit_ring_t *ring, uint64_t seq, uint32_t index, pwar_packet_t *out) {
+    pwar_retransmit_slot_t *slot = &ring->slots[slot_of(seq, index)];
+    uint32_t version = pwar_atomic_load_acquire_u32(&slot->version);
+    if (version == 0 || (version & 1)) return 0; // Empty, or being overwritten by a newer segment
+    *out = slot->packet;
+    pwar_atomic_fence_acquire();
+    if (pwar_atomic_load_relaxed_u32(&slot->version) != version) return 0;
+    return out->seq == seq && out->packet_index == index;
+}
+
+uint32_t pwar_retransmit_answer(pwar_retransmit_ring_t *ring, const pwar_nack_msg_t *nack,
+                                void (*send)(const pwar_packet_t *packet, void *userdata), void *userdata) {
+    pwar_packet_t packet;
+    uint32_t resent = 0;
+    for (uint32_t i = 0; i < 64; ++i) {
+        if (!(nack->missing & (1ULL << i))) continue;
+        pwar_atomic_fetch_add_u32(&ring->requested, 1);
+        if (pwar_retransmit_find(ring, nack->seq, i, &packet)) {
+            send(&packet, userdata);
+            resent++;
+        } else {
+            pwar_atomic_fetch_add_u32(&ring->expired, 1);
+        }
+    }
+    pwar_atomic_fetch_add_u32(&ring->resent, resent);
+    return resent;
+}
+
+int pwar_retransmit_is_nack(const void *buffer, uint32_t size) {
+    if (size != sizeof(pwar_nack_msg_t)) return 0;
+    return ((const pwar_nack_msg_t *)buffer)->magic == PWAR_NACK_MAGIC;
+}
+
+void pwar_nack_tracker_init(pwar_nack_tracker_t *tracker) {
+    memset(tracker, 0, sizeof(*tracker));
+}
+
+void pwar_nack_tracker_reset(pwar_nack_tracker_t *tracker) {
+    memset(tracker->pending, 0, sizeof(tracker->pending));
+}
+
+void pwar_nack_tracker_seed_rtt(pwar_nack_tracker_t *tracker, uint64_t rtt_ns) {
+    if (!rtt_ns || pwar_atomic_load_relaxed_u32(&tracker->rtt_ns)) return;
+    if (rtt_ns > UINT32_MAX) rtt_ns = UINT32_MAX;
+    pwar_atomic_store_relaxed_u32(&tracker->rtt_ns, (uint32_t)rtt_ns);
+    tracker->rtt_seeded = 1;
+}
+
+static uint32_t count_bits(uint64_t mask) {
+    uint32_t count = 0;
+    for (; mask; mask &= mask - 1) count++;
+    return count;
+}
+
+int pwar_nack_tracker_request(pwar_nack_tracker_t *tracker, uint64_t seq, uint64_t missing, uint32_t generation,
+                              uint64_t first_deadline_ns, uint64_t segment_ns, uint64_t now_ns, pwar_nack_msg_t *out) {
+    uint64_t rtt = pwar_atomic_load_relaxed_u32(&tracker->rtt_ns);
+    uint64_t worth = 0;
+    for (uint32_t i = 0; i < 64; ++i) {
+        if (!(missing & (1ULL << i))) continue;
+        uint64_t deadline = first_deadline_ns + i * segment_ns;
+        // Until a NACK was answered the RTT is unknown, any time left is worth a try
+        if (deadline > now_ns && deadline - now_ns > rtt) worth |= 1ULL << i;
+    }
+    uint32_t skipped = count_bits(missing & ~worth);
+    if (skipped) pwar_atomic_fetch_add_u32(&tracker->too_late, skipped);
+    if (!worth) return 0;
+
+    pwar_nack_pending_t *pending = &tracker->pending[tracker->next_pending];
+    tracker->next_pending = (tracker->next_pending + 1) % PWAR_RETRANSMIT_PENDING;
+    pending->seq = seq;
+    pending->missing = worth;
+    pending->asked_ns = now_ns ? now_ns : 1;
+    pending->answered = 0;
+    pwar_atomic_fetch_add_u32(&tracker->nacks, 1);
+    pwar_atomic_fetch_add_u32(&tracker->asked, count_bits(worth));
+
+    memset(out, 0, sizeof(*out));
+    out->magic = PWAR_NACK_MAGIC;
+    out->generation = generation;
+    out->seq = seq;
+    out->missing = worth;
+    return 1;
+}
+
+int pwar_nack_tracker_arrived(pwar_nack_tracker_t *tracker, uint64_t seq, uint32_t index, uint64_t now_ns) {
+    if (index >= 64) return 0;
+    uint64_t bit = 1ULL << index;
+    for (uint32_t i = 0; i < PWAR_RETRANSMIT_PENDING; ++i) {
+        pwar_nack_pending_t *pending = &tracker->pending[i];
+        if (!pending->asked_ns || pending->seq != seq || !(pending->missing & bit)) continue;
+        pending->missing &= ~bit;
+        if (!pending->answered) {
+            pending->answered = 1;
+            uint64_t sample = now_ns > pending->asked_ns ? now_ns - pending->asked_ns : 0;
+            if (sample > UINT32_MAX) sample = UINT32_MAX;
+            uint32_t old = pwar_atomic_load_relaxed_u32(&tracker->rtt_ns);
+            int64_t next = old && !tracker->rtt_seeded ? (int64_t)old + (((int64_t)sample - old) >> PWAR_RETRANSMIT_SMOOTHING)
+                                                       : (int64_t)sample;
+            tracker->rtt_seeded = 0;
+            pwar_atomic_store_relaxed_u32(&tracker->rtt_ns, (uint32_t)(next ? next : 1));
+        }
+        if (!pending->missing) pending->asked_ns = 0;
+        pwar_atomic_fetch_add_u32(&tracker->recovered, 1);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,100 @@
+/*
+ * pwar_retransmit.h - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+/*
+ * Selective retransmission of lost return segments.
+ *
+ * The remote keeps its most recent return segments in a small ring. When the
+ * Linux receiver finds a segment missing from a buffer (pwar_router_take_missing)
+ * it sends a NACK naming it, but only if asking can still pay off: the time left
+ * before the segment is played has to exceed the measured round trip of asking.
+ * The remote resends whatever it still holds. Nothing extra goes over the wire
+ * while nothing is lost.
+ *
+ * The ring has one writer, the thread sending the returns, and one reader, the
+ * thread answering NACKs. Every slot is a seqlock.
+ */
+
+#ifndef PWAR_RETRANSMIT
+#define PWAR_RETRANSMIT
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "pwar_packet.h"
+
+#define PWAR_RETRANSMIT_SLOTS 64  // Segments the remote keeps, must be a power of two
+#define PWAR_RETRANSMIT_PENDING 8 // NACKs Linux follows until their segments arrive
+
+typedef struct {
+    volatile uint32_t version; // Odd while the writer fills the slot
+    pwar_packet_t packet;
+} pwar_retransmit_slot_t;
+
+// Remote side
+typedef struct {
+    pwar_retransmit_slot_t slots[PWAR_RETRANSMIT_SLOTS];
+    volatile uint32_t requested; // Segments NACKs asked for
+    volatile uint32_t resent;
+    volatile uint32_t expired;   // Asked for after they left the ring
+} pwar_retransmit_ring_t;
+
+typedef struct {
+    uint64_t seq;
+    uint64_t missing;  // Segments asked for that have not arrived yet
+    uint64_t asked_ns; // 0 = free
+    uint32_t answered; // A segment came back, the RTT was sampled
+} pwar_nack_pending_t;
+
+// Linux side
+typedef struct {
+    pwar_nack_pending_t pending[PWAR_RETRANSMIT_PENDING];
+    uint32_t next_pending;
+    volatile uint32_t rtt_ns;    // Smoothed time from asking to the first segment back, 0 = not measured yet
+    uint32_t rtt_seeded;         // rtt_ns is a previous session's estimate, the first measurement replaces it
+    volatile uint32_t nacks;     // NACKs sent
+    volatile uint32_t asked;     // Segments asked for
+    volatile uint32_t recovered; // Asked for and arrived
+    volatile uint32_t too_late;  // Missing, but not worth asking for anymore
+} pwar_nack_tracker_t;
+
+void pwar_retransmit_init(pwar_retransmit_ring_t *ring);
+// Writer. Keeps a copy of a return segment as it is sent
+void pwar_retransmit_store(pwar_retransmit_ring_t *ring, const pwar_packet_t *packet);
+// Reader. Copies segment index of buffer seq into *out, returns 1 if the ring still holds it
+int pwar_retransmit_find(pwar_retransmit_ring_t *ring, uint64_t seq, uint32_t index, pwar_packet_t *out);
+
+// Reader. Hands every segment the NACK asks for that the ring still holds to send, returns how many
+uint32_t pwar_retransmit_answer(pwar_retransmit_ring_t *ring, const pwar_nack_msg_t *nack,
+                                void (*send)(const pwar_packet_t *packet, void *userdata), void *userdata);
+
+// A received datagram is a NACK
+int pwar_retransmit_is_nack(const void *buffer, uint32_t size);
+
+void pwar_nack_tracker_init(pwar_nack_tracker_t *tracker);
+// Forgets outstanding NACKs but keeps the RTT and counters, for when sequence numbers restart
+void pwar_nack_tracker_reset(pwar_nack_tracker_t *tracker);
+// Starts from an RTT known from before, so hopeless NACKs are not sent until one is answered
+void pwar_nack_tracker_seed_rtt(pwar_nack_tracker_t *tracker, uint64_t rtt_ns);
+
+/*
+ * Returns 1 and fills *out if a NACK for the missing segments of buffer seq is
+ * worth sending. Segment i is played at first_deadline_ns + i * segment_ns, it is
+ * only asked for while more than the measured RTT is left before that.
+ */
+int pwar_nack_tracker_request(pwar_nack_tracker_t *tracker, uint64_t seq, uint64_t missing, uint32_t generation,
+                              uint64_t first_deadline_ns, uint64_t segment_ns, uint64_t now_ns, pwar_nack_msg_t *out);
+
+// A segment arrived. Returns 1 if it was asked for, the first one back for a NACK measures the RTT
+int pwar_nack_tracker_arrived(pwar_nack_tracker_t *tracker, uint64_t seq, uint32_t index, uint64_t now_ns);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* PWAR_RETRANSMIT */
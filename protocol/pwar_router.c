@@ -16,39 +16,106 @@ void pwar_router_init(pwar_router_t *router, uint32_t channel_count) {
     const uint32_t max_packets = sizeof(router->packet_received) / sizeof(router->packet_received[0]);
     for (uint32_t i = 0; i < max_packets; ++i) router->packet_received[i] = 0;
     router->current_seq = (uint64_t)(-1); // Initialize to invalid seq
+    router->expected_packets = 0;
+    router->segment_samples = 0;
+    router->requested = 0;
+    router->blocks_completed = 0;
+    router->blocks_incomplete = 0;
+    router->packets_lost = 0;
+    router->duplicates = 0;
 }
 
 int pwar_router_process_streaming_packet(pwar_router_t *router, pwar_packet_t *input_packet, float *output_buffers, uint32_t max_samples, uint32_t channel_count) {
+    if (input_packet->packet_index) {
+        // Segmented by the sender, seq already names its block
+        return pwar_router_process_packet(router, input_packet, output_buffers, max_samples, channel_count);
+    }
     int index = input_packet->seq - router->current_seq;
-    if (index >= 0 && index < input_packet->num_packets) {
+    if (router->current_seq != (uint64_t)(-1) && index >= 0 && index < input_packet->num_packets) {
         input_packet->packet_index = index;
         input_packet->seq = router->current_seq;
     }
     return pwar_router_process_packet(router, input_packet, output_buffers, max_samples, channel_count);
 }
 
-int pwar_router_process_packet(pwar_router_t *router, pwar_packet_t *input_packet, float *output_buffers, uint32_t max_samples, uint32_t channel_count) {
-    if (!input_packet || !output_buffers) return -1;
+// Returns 1 for a new segment, which is marked as received, 0 for one already held or a late copy
+static int accept_segment(pwar_router_t *router, const pwar_packet_t *input_packet) {
     if (input_packet->num_packets == 0 || input_packet->packet_index >= input_packet->num_packets) return -2;
     if (input_packet->n_samples > PWAR_PACKET_MAX_CHUNK_SIZE) return -3;
+    if (input_packet->seq < router->current_seq && router->current_seq - input_packet->seq <= PWAR_ROUTER_LATE_WINDOW) {
+        // A copy of a buffer that was already replaced, starting over for it would lose the current one
+        router->duplicates++;
+        return 0;
+    }
     // Reset state if new buffer sequence detected
     if (input_packet->seq != router->current_seq) {
+        if (router->received_packets < router->expected_packets) {
+            // The previous buffer never completed, whatever is missing is lost
+            router->blocks_incomplete++;
+            router->packets_lost += router->expected_packets - router->received_packets;
+        }
+        router->expected_packets = input_packet->num_packets;
+        router->segment_samples = input_packet->n_samples;
         router->current_seq = input_packet->seq;
         router->received_packets = 0;
+        router->requested = 0;
         router->seq_timestamp = input_packet->seq_timestamp; // Update the sequence timestamp
         const uint32_t max_packets = sizeof(router->packet_received) / sizeof(router->packet_received[0]);
         for (uint32_t i = 0; i < max_packets; ++i) router->packet_received[i] = 0;
     }
-    if (!router->packet_received[input_packet->packet_index]) {
-        // Copy samples to internal buffer
-        uint32_t offset = input_packet->packet_index * input_packet->n_samples;
-        for (uint32_t ch = 0; ch < router->channel_count && ch < PWAR_CHANNELS; ++ch) {
-            for (uint32_t s = 0; s < input_packet->n_samples; ++s) {
-                router->buffers[ch][offset + s] = input_packet->samples[ch][s];
-            }
+    if (router->packet_received[input_packet->packet_index]) {
+        // Held already, a duplicate never hands the buffer out a second time
+        router->duplicates++;
+        return 0;
+    }
+    router->packet_received[input_packet->packet_index] = 1;
+    router->received_packets++;
+    if (router->received_packets == input_packet->num_packets) router->blocks_completed++;
+    return 1;
+}
+
+int pwar_router_track_packet(pwar_router_t *router, const pwar_packet_t *input_packet) {
+    if (!input_packet) return -1;
+    return accept_segment(router, input_packet);
+}
+
+uint32_t pwar_router_ready_samples(const pwar_router_t *router) {
+    uint32_t segments = 0;
+    while (segments < router->received_packets && router->packet_received[segments]) segments++;
+    return segments * router->segment_samples;
+}
+
+uint64_t pwar_router_take_missing(pwar_router_t *router, const pwar_packet_t *next) {
+    if (router->received_packets >= router->expected_packets) return 0;
+    uint32_t before;
+    if (next->seq == router->current_seq) {
+        before = next->packet_index;
+    } else if (next->seq > router->current_seq || router->current_seq - next->seq > PWAR_ROUTER_LATE_WINDOW) {
+        before = router->expected_packets;
+    } else {
+        return 0; // A late copy says nothing about the current buffer
+    }
+    if (before > router->expected_packets) before = router->expected_packets;
+    if (before > 64) before = 64;
+    uint64_t missing = 0;
+    for (uint32_t i = 0; i < before; ++i) {
+        if (!router->packet_received[i]) missing |= 1ULL << i;
+    }
+    missing &= ~router->requested;
+    router->requested |= missing;
+    return missing;
+}
+
+int pwar_router_process_packet(pwar_router_t *router, pwar_packet_t *input_packet, float *output_buffers, uint32_t max_samples, uint32_t channel_count) {
+    if (!input_packet || !output_buffers) return -1;
+    int accepted = accept_segment(router, input_packet);
+    if (accepted <= 0) return accepted;
+    // Copy samples to internal buffer
+    uint32_t offset = input_packet->packet_index * input_packet->n_samples;
+    for (uint32_t ch = 0; ch < router->channel_count && ch < PWAR_CHANNELS; ++ch) {
+        for (uint32_t s = 0; s < input_packet->n_samples; ++s) {
+            router->buffers[ch][offset + s] = input_packet->samples[ch][s];
         }
-        router->packet_received[input_packet->packet_index] = 1;
-        router->received_packets++;
     }
     // Check if all packets for this buffer are received
     if (router->received_packets == input_packet->num_packets) {
@@ -63,6 +130,16 @@ int pwar_router_process_packet(pwar_router_t *router, pwar_packet_t *input_packe
     return 0; // Not ready yet
 }
 
+uint32_t pwar_router_segment_size(uint32_t n_samples) {
+    if (n_samples == 0 || n_samples > PWAR_ROUTER_MAX_BUFFER_SIZE) return 0;
+    const uint32_t max_segments = sizeof(((pwar_router_t *)0)->packet_received) / sizeof(((pwar_router_t *)0)->packet_received[0]);
+    for (uint32_t segments = (n_samples + PWAR_PACKET_MAX_CHUNK_SIZE - 1) / PWAR_PACKET_MAX_CHUNK_SIZE;
+         segments <= max_segments && segments <= n_samples; ++segments) {
+        if (n_samples % segments == 0) return n_samples / segments;
+    }
+    return 0;
+}
+
 // Returns 0 on success, -1 if not enough space in packets array, -2 if invalid arguments
 int pwar_router_send_buffer(pwar_router_t *router, uint32_t chunk_size, float *samples, uint32_t n_samples, uint32_t channel_count, pwar_packet_t *packets, const uint32_t packet_count, uint32_t *packets_to_send) {
     (void)router; // Unused in this implementation, but could be used for future enhancements
@@ -18,6 +18,7 @@ extern "C" {
 
 #define PWAR_ROUTER_MAX_CHANNELS 16
 #define PWAR_ROUTER_MAX_BUFFER_SIZE 4096
+#define PWAR_ROUTER_LATE_WINDOW 256 // Sequences behind the current buffer that are late copies, not a restart
 
 typedef struct {
     uint32_t channel_count;
@@ -29,17 +30,48 @@ typedef struct {
     uint8_t packet_received[PWAR_ROUTER_MAX_BUFFER_SIZE / PWAR_PACKET_MIN_CHUNK_SIZE];
     uint64_t current_seq; // Track current buffer sequence number
     uint64_t seq_timestamp; // Timestamp for the current sequence
+    uint32_t expected_packets; // num_packets of the buffer being assembled
+    uint32_t segment_samples;  // n_samples of its segments
+    uint64_t requested;        // Bit per segment of the buffer being assembled that was asked for again
+
+    // Loss counters since init
+    uint32_t blocks_completed;
+    uint32_t blocks_incomplete; // Replaced by a newer buffer before every packet arrived
+    uint32_t packets_lost;      // Packets missing from incomplete buffers
+    uint32_t duplicates;        // Packets already held, or late copies of an earlier buffer, dropped
 } pwar_router_t;
 
 void pwar_router_init(pwar_router_t *router, uint32_t channel_count);
 
-// Returns the number of samples ready when all packets have been processed, 0 if more packets are needed
+// Returns the number of samples ready when all packets have been processed, 0 if more packets are needed.
+// A buffer is returned once, by the packet that completed it, duplicates return 0
 // output_buffers: flat array, channel-major order: output_buffers[channel * n_samples + sample]
 // max_samples: maximum number of samples per channel to write to output_buffers
 int pwar_router_process_packet(pwar_router_t *router, pwar_packet_t *input_packet, float *output_buffers, uint32_t max_samples, uint32_t channel_count);
 
+// Bookkeeping of pwar_router_process_packet without assembling the samples, for when
+// another structure holds them. Returns 1 for a new segment, 0 for a duplicate or late copy
+int pwar_router_track_packet(pwar_router_t *router, const pwar_packet_t *input_packet);
+
+// Samples at the start of the buffer being assembled whose segments are all in, held in
+// router->buffers by pwar_router_process_packet. Lets a block be played before its last
+// segment arrives
+uint32_t pwar_router_ready_samples(const pwar_router_t *router);
+
+// Call before handing next to the router. Bit per segment of the buffer being assembled
+// (router->current_seq) that next shows to be missing: the earlier ones of the same
+// buffer, or every one still missing once next starts a newer buffer. A segment is
+// returned once, as it is marked as asked for
+uint64_t pwar_router_take_missing(pwar_router_t *router, const pwar_packet_t *next);
+
+// Chunks sent one per sequence number are grouped into blocks of num_packets. Segments of a
+// block split by the sender carry the block's seq and their packet_index, like the returns
 int pwar_router_process_streaming_packet(pwar_router_t *router, pwar_packet_t *input_packet, float *output_buffers, uint32_t max_samples, uint32_t channel_count);
 
+// Largest segment size up to PWAR_PACKET_MAX_CHUNK_SIZE that splits n_samples into equal
+// segments the router can reassemble, 0 if there is none
+uint32_t pwar_router_segment_size(uint32_t n_samples);
+
 // samples: flat array, channel-major order: samples[channel * n_samples + sample]
 // n_samples: number of samples per channel
 // channel_count: number of channels
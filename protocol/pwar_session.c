@@ -0,0 +1,391 @@
+/*
+ * pwar_session.c - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+#include "pwar_session.h"
+#include "pwar_atomic.h"
+#include <string.h>
+
+static void set_state(pwar_session_t *session, pwar_session_state_t state) {
+    pwar_atomic_store_release_u32(&session->state, (uint32_t)state);
+}
+
+static uint32_t get_state(const pwar_session_t *session) {
+    return pwar_atomic_load_acquire_u32(&session->state);
+}
+
+static void fill_message(const pwar_session_t *session, pwar_session_msg_type_t type,
+                         const pwar_session_params_t *params, pwar_session_msg_t *out) {
+    memset(out, 0, sizeof(*out));
+    out->magic = PWAR_SESSION_MAGIC;
+    out->version = session->version;
+    out->type = (uint16_t)type;
+    out->session_id = session->session_id;
+    out->generation = session->generation;
+    if (params) {
+        out->sample_rate = params->sample_rate;
+        out->linux_block_size = params->linux_block_size;
+        out->remote_block_size = params->remote_block_size;
+        out->send_channels = params->send_channels;
+        out->return_channels = params->return_channels;
+        out->sample_formats = params->sample_formats;
+        out->features = params->features;
+    }
+}
+
+static void params_from_message(const pwar_session_msg_t *msg, pwar_session_params_t *params) {
+    params->sample_rate = msg->sample_rate;
+    params->linux_block_size = msg->linux_block_size;
+    params->remote_block_size = msg->remote_block_size;
+    params->send_channels = msg->send_channels;
+    params->return_channels = msg->return_channels;
+    params->sample_formats = msg->sample_formats;
+    params->features = msg->features;
+}
+
+static uint16_t min_u16(uint16_t a, uint16_t b) {
+    return a < b ? a : b;
+}
+
+// Responder side: fit the offer to what we support, or say why not
+static pwar_session_reject_t negotiate(const pwar_session_params_t *local, const pwar_session_msg_t *offer,
+                                       pwar_session_params_t *result) {
+    if (offer->version < PWAR_PROTOCOL_MIN_VERSION) {
+        return PWAR_SESSION_REJECT_VERSION;
+    }
+    if (local->sample_rate != 0 && offer->sample_rate != local->sample_rate) {
+        return PWAR_SESSION_REJECT_SAMPLE_RATE;
+    }
+    if (offer->linux_block_size == 0 || offer->linux_block_size > PWAR_PACKET_MAX_CHUNK_SIZE) {
+        return PWAR_SESSION_REJECT_BLOCK_SIZE;
+    }
+    // The remote block is built from whole Linux packets
+    if (local->remote_block_size != 0 && local->remote_block_size % offer->linux_block_size != 0) {
+        return PWAR_SESSION_REJECT_BLOCK_SIZE;
+    }
+
+    result->sample_rate = offer->sample_rate;
+    result->linux_block_size = offer->linux_block_size;
+    result->remote_block_size = local->remote_block_size;
+    result->send_channels = min_u16(offer->send_channels, local->send_channels);
+    result->return_channels = min_u16(offer->return_channels, local->return_channels);
+    // One direction may be left out, a session carrying nothing is not one
+    if (result->send_channels == 0 && result->return_channels == 0) {
+        return PWAR_SESSION_REJECT_CHANNELS;
+    }
+
+    uint32_t formats = offer->sample_formats & local->sample_formats;
+    if (formats == 0) {
+        return PWAR_SESSION_REJECT_FORMAT;
+    }
+    result->sample_formats = formats & (~formats + 1); // Lowest common bit, F32 first
+    result->features = offer->features & local->features;
+    // Without input to answer, only a remote on its own clock knows when to send
+    if (result->send_channels == 0 && !(result->features & PWAR_FEATURE_CLOCK_MASTER)) {
+        return PWAR_SESSION_REJECT_CLOCK;
+    }
+    return PWAR_SESSION_REJECT_NONE;
+}
+
+void pwar_session_init(pwar_session_t *session, pwar_session_role_t role, const pwar_session_params_t *local) {
+    memset(session, 0, sizeof(*session));
+    session->role = role;
+    session->local = *local;
+    session->version = PWAR_PROTOCOL_VERSION;
+    session->liveness_timeout_ns = PWAR_SESSION_DEFAULT_LIVENESS_NS;
+    set_state(session, PWAR_SESSION_STATE_IDLE);
+}
+
+void pwar_session_set_liveness_timeout(pwar_session_t *session, uint64_t timeout_ns) {
+    session->liveness_timeout_ns = timeout_ns;
+}
+
+void pwar_session_note_traffic(pwar_session_t *session, uint64_t now_ns) {
+    session->last_received_ns = now_ns;
+}
+
+static void set_established(pwar_session_t *session, uint64_t now_ns) {
+    if (get_state(session) == PWAR_SESSION_STATE_PEER_LOST) {
+        session->resumes++;
+    }
+    session->last_received_ns = now_ns;
+    session->last_keepalive_ns = now_ns;
+    set_state(session, PWAR_SESSION_STATE_ESTABLISHED);
+}
+
+int pwar_session_announce(pwar_session_t *session, pwar_session_msg_t *out) {
+    // Session id 0 matches whatever session the initiator has
+    fill_message(session, PWAR_SESSION_MSG_RENEGOTIATE, &session->local, out);
+    out->session_id = 0;
+    return 1;
+}
+
+void pwar_session_start(pwar_session_t *session, uint32_t session_id, uint64_t now_ns, pwar_session_msg_t *out) {
+    session->session_id = session_id;
+    session->generation = 0;
+    session->version = PWAR_PROTOCOL_VERSION;
+    session->reject_reason = PWAR_SESSION_REJECT_NONE;
+    memset(&session->negotiated, 0, sizeof(session->negotiated));
+    fill_message(session, PWAR_SESSION_MSG_HELLO, &session->local, &session->pending);
+    session->hello_started_ns = now_ns;
+    session->last_sent_ns = now_ns;
+    set_state(session, PWAR_SESSION_STATE_HELLO_SENT);
+    *out = session->pending;
+}
+
+void pwar_session_renegotiate(pwar_session_t *session, const pwar_session_params_t *local, uint64_t now_ns, pwar_session_msg_t *out) {
+    if (local) {
+        session->local = *local;
+    }
+    session->generation++;
+    session->version = PWAR_PROTOCOL_VERSION;
+    fill_message(session, PWAR_SESSION_MSG_HELLO, &session->local, &session->pending);
+    session->hello_started_ns = now_ns;
+    session->last_sent_ns = now_ns;
+    set_state(session, PWAR_SESSION_STATE_HELLO_SENT);
+    *out = session->pending;
+}
+
+int pwar_session_request_renegotiation(pwar_session_t *session, const pwar_session_params_t *local, uint64_t now_ns, pwar_session_msg_t *out) {
+    if (local) {
+        session->local = *local;
+    }
+    uint32_t state = get_state(session);
+    if (state == PWAR_SESSION_STATE_IDLE || state == PWAR_SESSION_STATE_REJECTED) {
+        return 0; // Nobody to ask, the next HELLO uses the new parameters anyway
+    }
+    fill_message(session, PWAR_SESSION_MSG_RENEGOTIATE, &session->local, &session->pending);
+    session->last_sent_ns = now_ns;
+    set_state(session, PWAR_SESSION_STATE_RENEGOTIATE_SENT);
+    *out = session->pending;
+    return 1;
+}
+
+int pwar_session_stop(pwar_session_t *session, pwar_session_msg_t *out) {
+    uint32_t state = get_state(session);
+    set_state(session, PWAR_SESSION_STATE_IDLE);
+    if (state == PWAR_SESSION_STATE_IDLE || state == PWAR_SESSION_STATE_REJECTED || state == PWAR_SESSION_STATE_LEGACY) {
+        return 0;
+    }
+    fill_message(session, PWAR_SESSION_MSG_BYE, NULL, out);
+    return 1;
+}
+
+static int handle_initiator(pwar_session_t *session, const pwar_session_msg_t *msg, uint64_t now_ns, pwar_session_msg_t *out) {
+    uint32_t state = get_state(session);
+    if (msg->session_id != session->session_id &&
+        !(msg->type == PWAR_SESSION_MSG_RENEGOTIATE && msg->session_id == 0)) {
+        return 0; // Left over from an earlier session
+    }
+
+    switch (msg->type) {
+    case PWAR_SESSION_MSG_ACCEPT:
+        if (msg->generation != session->generation) {
+            return 0;
+        }
+        if (state == PWAR_SESSION_STATE_HELLO_SENT || state == PWAR_SESSION_STATE_LEGACY ||
+            state == PWAR_SESSION_STATE_PEER_LOST) {
+            params_from_message(msg, &session->negotiated);
+            session->version = msg->version;
+            set_established(session, now_ns);
+        } else if (state != PWAR_SESSION_STATE_ESTABLISHED) {
+            return 0;
+        }
+        // Also answers a resent ACCEPT, our ACK was lost
+        fill_message(session, PWAR_SESSION_MSG_ACK, &session->negotiated, out);
+        return 1;
+
+    case PWAR_SESSION_MSG_REJECT:
+        if (msg->generation != session->generation || state != PWAR_SESSION_STATE_HELLO_SENT) {
+            return 0;
+        }
+        session->reject_reason = msg->reject_reason;
+        set_state(session, PWAR_SESSION_STATE_REJECTED);
+        return 0;
+
+    case PWAR_SESSION_MSG_RENEGOTIATE:
+        if (state == PWAR_SESSION_STATE_PEER_LOST) {
+            // The remote is back, answer with the pending offer right away
+            session->last_sent_ns = now_ns;
+            *out = session->pending;
+            return 1;
+        }
+        if (state != PWAR_SESSION_STATE_ESTABLISHED && state != PWAR_SESSION_STATE_HELLO_SENT) {
+            return 0;
+        }
+        if (state == PWAR_SESSION_STATE_HELLO_SENT && msg->generation != session->generation) {
+            return 0; // Already renegotiating because of this request
+        }
+        pwar_session_renegotiate(session, NULL, now_ns, out);
+        return 1;
+
+    case PWAR_SESSION_MSG_BYE:
+        set_state(session, PWAR_SESSION_STATE_IDLE);
+        return 0;
+
+    default:
+        return 0; // KEEPALIVE only refreshes liveness
+    }
+}
+
+static int handle_responder(pwar_session_t *session, const pwar_session_msg_t *msg, uint64_t now_ns, pwar_session_msg_t *out) {
+    uint32_t state = get_state(session);
+
+    switch (msg->type) {
+    case PWAR_SESSION_MSG_HELLO: {
+        // A resent HELLO for the generation we already accepted gets the same answer
+        if (msg->session_id == session->session_id && msg->generation == session->generation &&
+            (state == PWAR_SESSION_STATE_ACCEPT_SENT || state == PWAR_SESSION_STATE_ESTABLISHED)) {
+            *out = session->pending;
+            return 1;
+        }
+        session->session_id = msg->session_id;
+        session->generation = msg->generation;
+        session->version = msg->version < PWAR_PROTOCOL_VERSION ? msg->version : PWAR_PROTOCOL_VERSION;
+
+        pwar_session_params_t result;
+        memset(&result, 0, sizeof(result));
+        pwar_session_reject_t reason = negotiate(&session->local, msg, &result);
+        if (reason != PWAR_SESSION_REJECT_NONE) {
+            fill_message(session, PWAR_SESSION_MSG_REJECT, &session->local, out);
+            out->reject_reason = reason;
+            session->reject_reason = reason;
+            set_state(session, PWAR_SESSION_STATE_REJECTED);
+            return 1;
+        }
+        session->negotiated = result;
+        session->reject_reason = PWAR_SESSION_REJECT_NONE;
+        fill_message(session, PWAR_SESSION_MSG_ACCEPT, &result, &session->pending);
+        session->last_sent_ns = now_ns;
+        set_state(session, PWAR_SESSION_STATE_ACCEPT_SENT);
+        *out = session->pending;
+        return 1;
+    }
+
+    case PWAR_SESSION_MSG_ACK:
+        if (msg->session_id == session->session_id && msg->generation == session->generation &&
+            state == PWAR_SESSION_STATE_ACCEPT_SENT) {
+            set_established(session, now_ns);
+        }
+        return 0;
+
+    case PWAR_SESSION_MSG_KEEPALIVE:
+        if (state == PWAR_SESSION_STATE_ESTABLISHED || state == PWAR_SESSION_STATE_ACCEPT_SENT ||
+            state == PWAR_SESSION_STATE_RENEGOTIATE_SENT) {
+            return 0;
+        }
+        // Linux thinks it has a session we do not know (we restarted or lost it), ask for a new one
+        session->session_id = msg->session_id;
+        session->generation = msg->generation;
+        fill_message(session, PWAR_SESSION_MSG_RENEGOTIATE, &session->local, out);
+        return 1;
+
+    case PWAR_SESSION_MSG_BYE:
+        if (msg->session_id == session->session_id) {
+            set_state(session, PWAR_SESSION_STATE_IDLE);
+        }
+        return 0;
+
+    default:
+        return 0;
+    }
+}
+
+int pwar_session_handle_message(pwar_session_t *session, const pwar_session_msg_t *msg, uint64_t now_ns, pwar_session_msg_t *out) {
+    if (msg->magic != PWAR_SESSION_MAGIC) {
+        return 0;
+    }
+    session->last_received_ns = now_ns;
+    if (session->role == PWAR_SESSION_ROLE_INITIATOR) {
+        return handle_initiator(session, msg, now_ns, out);
+    }
+    return handle_responder(session, msg, now_ns, out);
+}
+
+static int peer_lost(pwar_session_t *session, uint64_t now_ns, pwar_session_msg_t *out) {
+    session->peer_losses++;
+    set_state(session, PWAR_SESSION_STATE_PEER_LOST);
+    if (session->role != PWAR_SESSION_ROLE_INITIATOR) {
+        return 0; // Linux drives the resume
+    }
+    // Offer a new generation, whoever answers first gets fresh state on both sides
+    session->generation++;
+    fill_message(session, PWAR_SESSION_MSG_HELLO, &session->local, &session->pending);
+    session->last_sent_ns = now_ns;
+    *out = session->pending;
+    return 1;
+}
+
+int pwar_session_poll(pwar_session_t *session, uint64_t now_ns, pwar_session_msg_t *out) {
+    uint32_t state = get_state(session);
+    if (state == PWAR_SESSION_STATE_ESTABLISHED || state == PWAR_SESSION_STATE_ACCEPT_SENT ||
+        state == PWAR_SESSION_STATE_RENEGOTIATE_SENT) {
+        if (session->liveness_timeout_ns && now_ns - session->last_received_ns > session->liveness_timeout_ns) {
+            return peer_lost(session, now_ns, out);
+        }
+    }
+    if (state == PWAR_SESSION_STATE_ESTABLISHED) {
+        uint64_t interval = session->liveness_timeout_ns ? session->liveness_timeout_ns / 4 : PWAR_SESSION_DEFAULT_LIVENESS_NS / 4;
+        if (now_ns - session->last_keepalive_ns < interval) {
+            return 0;
+        }
+        session->last_keepalive_ns = now_ns;
+        fill_message(session, PWAR_SESSION_MSG_KEEPALIVE, NULL, out);
+        return 1;
+    }
+    if (state == PWAR_SESSION_STATE_PEER_LOST) {
+        if (session->role != PWAR_SESSION_ROLE_INITIATOR || now_ns - session->last_sent_ns < PWAR_SESSION_RESUME_RETRY_NS) {
+            return 0;
+        }
+        session->last_sent_ns = now_ns;
+        *out = session->pending;
+        return 1;
+    }
+    if (state == PWAR_SESSION_STATE_HELLO_SENT) {
+        // A peer that never answers predates sessions, let audio flow without options
+        if (session->generation == 0 && now_ns - session->hello_started_ns >= PWAR_SESSION_LEGACY_TIMEOUT_NS) {
+            session->negotiated = session->local;
+            session->negotiated.sample_formats = PWAR_SAMPLE_FORMAT_F32;
+            session->negotiated.features = 0;
+            set_state(session, PWAR_SESSION_STATE_LEGACY);
+            return 0;
+        }
+    } else if (state != PWAR_SESSION_STATE_ACCEPT_SENT && state != PWAR_SESSION_STATE_RENEGOTIATE_SENT) {
+        return 0;
+    }
+    if (now_ns - session->last_sent_ns < PWAR_SESSION_RETRY_NS) {
+        return 0;
+    }
+    session->last_sent_ns = now_ns;
+    *out = session->pending;
+    return 1;
+}
+
+int pwar_session_audio_allowed(const pwar_session_t *session) {
+    uint32_t state = get_state(session);
+    return state == PWAR_SESSION_STATE_ESTABLISHED || state == PWAR_SESSION_STATE_LEGACY;
+}
+
+int pwar_session_is_message(const void *buffer, uint32_t size) {
+    if (size != sizeof(pwar_session_msg_t)) {
+        return 0;
+    }
+    return ((const pwar_session_msg_t *)buffer)->magic == PWAR_SESSION_MAGIC;
+}
+
+const char *pwar_session_state_name(uint32_t state) {
+    switch (state) {
+    case PWAR_SESSION_STATE_IDLE: return "idle";
+    case PWAR_SESSION_STATE_HELLO_SENT: return "hello sent";
+    case PWAR_SESSION_STATE_ACCEPT_SENT: return "accept sent";
+    case PWAR_SESSION_STATE_RENEGOTIATE_SENT: return "renegotiating";
+    case PWAR_SESSION_STATE_ESTABLISHED: return "established";
+    case PWAR_SESSION_STATE_LEGACY: return "legacy peer";
+    case PWAR_SESSION_STATE_REJECTED: return "rejected";
+    case PWAR_SESSION_STATE_PEER_LOST: return "peer lost";
+    default: return "unknown";
+    }
+}
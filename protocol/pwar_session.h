@@ -0,0 +1,128 @@
+/*
+ * pwar_session.h - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+/*
+ * Session setup on the control path.
+ *
+ * Linux (initiator) sends HELLO with what it offers, the remote (responder)
+ * answers ACCEPT with the negotiated parameters or REJECT, and Linux confirms
+ * with ACK before any audio flows. Either side may ask for a new negotiation,
+ * e.g. when the quantum or the host buffer size changes; audio is held until the
+ * new generation is acknowledged.
+ *
+ * Once established both sides send keepalives. A peer that goes quiet for longer
+ * than the liveness timeout is considered lost, audio stops and Linux keeps
+ * offering a new generation until the peer answers again. A restarted remote
+ * announces itself so the session resumes without waiting for a retry.
+ *
+ * A session offering no channels in one direction is half-duplex: send-only
+ * when nothing returns, receive-only when Linux sends nothing. Receive-only has
+ * no input to pace the remote, it needs a remote running on its own clock.
+ *
+ * The state machine does no I/O. Every call that returns 1 has filled *out with a
+ * message for the caller to send to the peer.
+ */
+
+#ifndef PWAR_SESSION
+#define PWAR_SESSION
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "pwar_packet.h"
+
+#define PWAR_SESSION_RETRY_NS 250000000ULL          // Resend unanswered messages every 250 ms
+#define PWAR_SESSION_LEGACY_TIMEOUT_NS 2000000000ULL // No answer to HELLO, assume a peer without sessions
+#define PWAR_SESSION_DEFAULT_LIVENESS_NS 500000000ULL // Peer silent this long is considered lost
+#define PWAR_SESSION_RESUME_RETRY_NS 5000000ULL      // Offer a resume this often while the peer is lost
+
+typedef enum {
+    PWAR_SESSION_ROLE_INITIATOR = 0, // Linux
+    PWAR_SESSION_ROLE_RESPONDER = 1  // Remote
+} pwar_session_role_t;
+
+typedef enum {
+    PWAR_SESSION_STATE_IDLE = 0,
+    PWAR_SESSION_STATE_HELLO_SENT,       // Initiator waits for ACCEPT
+    PWAR_SESSION_STATE_ACCEPT_SENT,      // Responder waits for ACK
+    PWAR_SESSION_STATE_RENEGOTIATE_SENT, // Responder waits for a new HELLO
+    PWAR_SESSION_STATE_ESTABLISHED,
+    PWAR_SESSION_STATE_LEGACY,           // Peer never answered, audio flows without optional features
+    PWAR_SESSION_STATE_REJECTED,
+    PWAR_SESSION_STATE_PEER_LOST         // Nothing heard within the liveness timeout
+} pwar_session_state_t;
+
+typedef struct {
+    uint32_t sample_rate;        // 0 on the responder accepts any rate
+    uint32_t linux_block_size;
+    uint32_t remote_block_size;
+    uint16_t send_channels;
+    uint16_t return_channels;
+    uint32_t sample_formats;
+    uint32_t features;
+} pwar_session_params_t;
+
+typedef struct {
+    pwar_session_role_t role;
+    volatile uint32_t state;           // pwar_session_state_t, read by the audio path
+    pwar_session_params_t local;       // What this side offers/supports
+    pwar_session_params_t negotiated;  // Valid in ESTABLISHED (and LEGACY on the initiator)
+    uint16_t version;
+    uint32_t session_id;
+    uint32_t generation;
+    uint32_t reject_reason;
+    uint64_t hello_started_ns;
+    uint64_t last_sent_ns;
+    uint64_t last_received_ns;         // Any traffic from the peer, audio included
+    uint64_t last_keepalive_ns;
+    uint64_t liveness_timeout_ns;      // 0 disables loss detection
+    uint32_t peer_losses;
+    uint32_t resumes;
+    pwar_session_msg_t pending;        // Last message that needs an answer, for resending
+} pwar_session_t;
+
+void pwar_session_init(pwar_session_t *session, pwar_session_role_t role, const pwar_session_params_t *local);
+
+// Initiator: begin a new session
+void pwar_session_start(pwar_session_t *session, uint32_t session_id, uint64_t now_ns, pwar_session_msg_t *out);
+
+// Initiator: negotiate again with new local parameters, audio is held until acknowledged
+void pwar_session_renegotiate(pwar_session_t *session, const pwar_session_params_t *local, uint64_t now_ns, pwar_session_msg_t *out);
+
+// Responder: ask the initiator for a new negotiation with new local parameters
+int pwar_session_request_renegotiation(pwar_session_t *session, const pwar_session_params_t *local, uint64_t now_ns, pwar_session_msg_t *out);
+
+// Responder: tell the configured peer that we (re)started, returns 1 if *out should be sent
+int pwar_session_announce(pwar_session_t *session, pwar_session_msg_t *out);
+
+// Either side: traffic other than session messages (audio, latency info) also proves liveness
+void pwar_session_note_traffic(pwar_session_t *session, uint64_t now_ns);
+void pwar_session_set_liveness_timeout(pwar_session_t *session, uint64_t timeout_ns);
+
+// Either side: end the session, returns 1 if a BYE should be sent
+int pwar_session_stop(pwar_session_t *session, pwar_session_msg_t *out);
+
+// Handles a message from the peer, returns 1 if *out should be sent back
+int pwar_session_handle_message(pwar_session_t *session, const pwar_session_msg_t *msg, uint64_t now_ns, pwar_session_msg_t *out);
+
+// Call periodically, returns 1 if *out should be (re)sent
+int pwar_session_poll(pwar_session_t *session, uint64_t now_ns, pwar_session_msg_t *out);
+
+// Audio may flow with the negotiated parameters
+int pwar_session_audio_allowed(const pwar_session_t *session);
+
+// A received datagram is a session message
+int pwar_session_is_message(const void *buffer, uint32_t size);
+
+const char *pwar_session_state_name(uint32_t state);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* PWAR_SESSION */
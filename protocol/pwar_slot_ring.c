@@ -0,0 +1,70 @@
+/*
+ * pwar_slot_ring.c - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+#include "pwar_slot_ring.h"
+#include "pwar_atomic.h"
+#include <string.h>
+
+#define PWAR_SLOT_RING_MASK (PWAR_SLOT_RING_SLOTS - 1)
+
+void pwar_slot_ring_init(pwar_slot_ring_t *ring) {
+    memset(ring, 0, sizeof(*ring));
+}
+
+void pwar_slot_ring_reset(pwar_slot_ring_t *ring) {
+    for (uint32_t i = 0; i < PWAR_SLOT_RING_SLOTS; ++i) {
+        pwar_atomic_store_release_u32(&ring->slots[i].seq_plus_one, 0);
+    }
+    pwar_atomic_store_release_u32(&ring->next_play, 0);
+}
+
+static int store_chunk(pwar_slot_ring_t *ring, uint32_t seq, const pwar_packet_t *packet) {
+    uint32_t next_play = pwar_atomic_load_acquire_u32(&ring->next_play);
+    int32_t ahead = (int32_t)(seq - next_play);
+    if (ahead < 0) {
+        pwar_atomic_fetch_add_u32(&ring->late, 1);
+        return 0;
+    }
+    // Further ahead would share a slot with a chunk the consumer may still want
+    if (ahead >= PWAR_SLOT_RING_SLOTS) return 0;
+
+    pwar_slot_t *slot = &ring->slots[seq & PWAR_SLOT_RING_MASK];
+    if (pwar_atomic_load_acquire_u32(&slot->seq_plus_one) == seq + 1) {
+        pwar_atomic_fetch_add_u32(&ring->duplicates, 1);
+        return 0;
+    }
+    pwar_atomic_store_release_u32(&slot->seq_plus_one, 0);
+    for (uint32_t ch = 0; ch < PWAR_CHANNELS; ++ch) {
+        memcpy(slot->samples[ch], packet->samples[ch], packet->n_samples * sizeof(float));
+    }
+    slot->n_samples = packet->n_samples;
+    pwar_atomic_store_release_u32(&slot->seq_plus_one, seq + 1);
+    return 1;
+}
+
+int pwar_slot_ring_put(pwar_slot_ring_t *ring, const pwar_packet_t *packet) {
+    if (!packet || packet->n_samples > PWAR_PACKET_MAX_CHUNK_SIZE) return 0;
+    // Every packet of a returned block answers one sent chunk, in order
+    return store_chunk(ring, (uint32_t)packet->seq + packet->packet_index, packet);
+}
+
+int pwar_slot_ring_get(pwar_slot_ring_t *ring, uint32_t play_seq, float *out, uint32_t channels, uint32_t n_samples) {
+    pwar_slot_t *slot = &ring->slots[play_seq & PWAR_SLOT_RING_MASK];
+    int found = pwar_atomic_load_acquire_u32(&slot->seq_plus_one) == play_seq + 1 && slot->n_samples >= n_samples;
+
+    for (uint32_t ch = 0; ch < channels; ++ch) {
+        if (found && ch < PWAR_CHANNELS) {
+            memcpy(&out[ch * n_samples], slot->samples[ch], n_samples * sizeof(float));
+        } else {
+            memset(&out[ch * n_samples], 0, n_samples * sizeof(float));
+        }
+    }
+    pwar_atomic_fetch_add_u32(found ? &ring->delivered : &ring->missing, 1);
+    // From here on anything for play_seq or older is late
+    pwar_atomic_store_release_u32(&ring->next_play, play_seq + 1);
+    return found;
+}
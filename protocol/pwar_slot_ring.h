@@ -0,0 +1,65 @@
+/*
+ * pwar_slot_ring.h - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+/*
+ * Sequence-indexed slots for pipelined streaming.
+ *
+ * Every returned chunk is stored in the slot of the sequence number it answers,
+ * and the audio thread plays the slot of (current seq - delay). Audio therefore
+ * always comes back a fixed number of cycles after it was sent, however many
+ * blocks are in flight. A chunk that is not there in time is played as silence
+ * and counted, one that arrives after its turn is dropped and counted.
+ *
+ * One thread puts, one thread gets, no locks.
+ */
+
+#ifndef PWAR_SLOT_RING
+#define PWAR_SLOT_RING
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "pwar_packet.h"
+
+#define PWAR_SLOT_RING_SLOTS 128                           // Must be a power of two
+#define PWAR_SLOT_RING_MAX_DELAY (PWAR_SLOT_RING_SLOTS / 2) // Cycles, leaves room for early chunks
+
+typedef struct {
+    volatile uint32_t seq_plus_one; // Sequence held by the slot + 1, 0 = empty
+    uint32_t n_samples;
+    float samples[PWAR_CHANNELS][PWAR_PACKET_MAX_CHUNK_SIZE];
+} pwar_slot_t;
+
+typedef struct {
+    pwar_slot_t slots[PWAR_SLOT_RING_SLOTS];
+    volatile uint32_t next_play;  // Oldest sequence the consumer still wants
+
+    // Counters, each written by one side only
+    volatile uint32_t delivered;  // Get found its chunk
+    volatile uint32_t missing;    // Get played silence
+    volatile uint32_t late;       // Put after the chunk's turn had passed
+    volatile uint32_t duplicates; // Put for a chunk already held
+} pwar_slot_ring_t;
+
+void pwar_slot_ring_init(pwar_slot_ring_t *ring);
+// Forgets every held chunk, for when sequence numbers restart. Safe against a running consumer
+void pwar_slot_ring_reset(pwar_slot_ring_t *ring);
+
+// Producer. Stores every chunk of a returned packet, packet->seq + packet_index is the
+// sequence the chunk answers. Returns 1 if stored, 0 if late, duplicate or out of range
+int pwar_slot_ring_put(pwar_slot_ring_t *ring, const pwar_packet_t *packet);
+
+// Consumer. Copies the chunk answering play_seq into out (channel-major, n_samples per
+// channel) and returns 1, or writes silence and returns 0 if it did not arrive in time
+int pwar_slot_ring_get(pwar_slot_ring_t *ring, uint32_t play_seq, float *out, uint32_t channels, uint32_t n_samples);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* PWAR_SLOT_RING */
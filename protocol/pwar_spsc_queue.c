@@ -0,0 +1,40 @@
+/*
+ * pwar_spsc_queue.c - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+#include "pwar_spsc_queue.h"
+#include "pwar_atomic.h"
+#include <string.h>
+
+#define PWAR_SPSC_QUEUE_MASK (PWAR_SPSC_QUEUE_CAPACITY - 1)
+
+void pwar_spsc_queue_init(pwar_spsc_queue_t *queue) {
+    memset(queue, 0, sizeof(*queue));
+}
+
+int pwar_spsc_queue_push(pwar_spsc_queue_t *queue, void *item) {
+    uint32_t head = pwar_atomic_load_relaxed_u32(&queue->head);
+    uint32_t tail = pwar_atomic_load_acquire_u32(&queue->tail);
+    if (head - tail >= PWAR_SPSC_QUEUE_CAPACITY) return 0; // Full
+    queue->items[head & PWAR_SPSC_QUEUE_MASK] = item;
+    pwar_atomic_store_release_u32(&queue->head, head + 1);
+    return 1;
+}
+
+void *pwar_spsc_queue_pop(pwar_spsc_queue_t *queue) {
+    uint32_t tail = pwar_atomic_load_relaxed_u32(&queue->tail);
+    uint32_t head = pwar_atomic_load_acquire_u32(&queue->head);
+    if (head == tail) return NULL; // Empty
+    void *item = queue->items[tail & PWAR_SPSC_QUEUE_MASK];
+    pwar_atomic_store_release_u32(&queue->tail, tail + 1);
+    return item;
+}
+
+uint32_t pwar_spsc_queue_size(pwar_spsc_queue_t *queue) {
+    uint32_t head = pwar_atomic_load_acquire_u32(&queue->head);
+    uint32_t tail = pwar_atomic_load_acquire_u32(&queue->tail);
+    return head - tail;
+}
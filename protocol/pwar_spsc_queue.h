@@ -0,0 +1,49 @@
+/*
+ * pwar_spsc_queue.h - PipeWire ASIO Relay (PWAR) project
+ *
+ * (c) 2025 Philip K. Gisslow
+ * This file is part of the PipeWire ASIO Relay (PWAR) project.
+ */
+
+/*
+ * Lock-free single-producer/single-consumer queue of pointers.
+ * Used to hand audio blocks between the network thread and the audio thread
+ * without locks or allocations. Exactly one thread may push and exactly one
+ * thread may pop.
+ */
+
+#ifndef PWAR_SPSC_QUEUE
+#define PWAR_SPSC_QUEUE
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define PWAR_SPSC_QUEUE_CAPACITY 16 // Must be a power of two
+#define PWAR_SPSC_QUEUE_CACHE_LINE 64
+
+typedef struct {
+    volatile uint32_t head; // Next slot to write, owned by the producer
+    char pad0[PWAR_SPSC_QUEUE_CACHE_LINE - sizeof(uint32_t)];
+    volatile uint32_t tail; // Next slot to read, owned by the consumer
+    char pad1[PWAR_SPSC_QUEUE_CACHE_LINE - sizeof(uint32_t)];
+    void *items[PWAR_SPSC_QUEUE_CAPACITY];
+} pwar_spsc_queue_t;
+
+void pwar_spsc_queue_init(pwar_spsc_queue_t *queue);
+
+// Returns 1 if the item was queued, 0 if the queue is full
+int pwar_spsc_queue_push(pwar_spsc_queue_t *queue, void *item);
+
+// Returns the oldest item, or NULL if the queue is empty
+void *pwar_spsc_queue_pop(pwar_spsc_queue_t *queue);
+
+// Number of queued items (approximate when called from a third thread)
+uint32_t pwar_spsc_queue_size(pwar_spsc_queue_t *queue);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* PWAR_SPSC_QUEUE */
@@ -0,0 +1,147 @@
+#define _GNU_SOURCE
+#include <check.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include "../latency_manager.h"
+
+#define TEST_RTT_NS 1000000        // 1 ms
+#define TEST_OFFSET_NS 5000000000LL // Remote clock 5 s ahead
+
+static void sleep_us(long us) {
+    struct timespec ts = { us / 1000000, (us % 1000000) * 1000 };
+    nanosleep(&ts, NULL);
+}
+
+// Test: A seeded calibration reads back as it was saved, and does not count as measurements
+START_TEST(test_calibration_seed_roundtrip)
+{
+    latency_manager_calibration_t seed = {0};
+    seed.rtt_p50_ns = 1200000;
+    seed.rtt_p99_ns = 3100000;
+    seed.rtt_max_ns = 7000000;
+    seed.clock_offset_ns = -123456;
+    seed.clock_drift_ppm = 12.5;
+    seed.rtt_samples = 50000;
+
+    latency_manager_seed_calibration(&seed);
+
+    latency_manager_calibration_t cal;
+    latency_manager_get_calibration(&cal);
+    // The histogram has 50 us bins, percentiles report the upper bin edge
+    ck_assert_int_ge(cal.rtt_p50_ns, seed.rtt_p50_ns);
+    ck_assert_int_le(cal.rtt_p50_ns, seed.rtt_p50_ns + 50000);
+    ck_assert_int_ge(cal.rtt_p99_ns, seed.rtt_p99_ns);
+    ck_assert_int_le(cal.rtt_p99_ns, seed.rtt_p99_ns + 50000);
+    ck_assert_uint_eq(cal.rtt_max_ns, seed.rtt_max_ns);
+    ck_assert_int_eq(cal.clock_offset_ns, seed.clock_offset_ns);
+    ck_assert_double_eq_tol(cal.clock_drift_ppm, seed.clock_drift_ppm, 0.0001);
+    ck_assert_uint_eq(cal.rtt_samples, 0);
+}
+END_TEST
+
+// Test: Measured round trips build the RTT distribution
+START_TEST(test_calibration_rtt_percentiles)
+{
+    latency_manager_reset_calibration();
+
+    pwar_packet_t packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.num_packets = 1;
+    packet.packet_index = 0;
+    for (int i = 0; i < 200; ++i) {
+        packet.seq_timestamp = latency_manager_timestamp_now() - TEST_RTT_NS;
+        packet.timestamp = packet.seq_timestamp;
+        latency_manager_process_packet_server(&packet);
+    }
+
+    latency_manager_calibration_t cal;
+    latency_manager_get_calibration(&cal);
+    ck_assert_uint_eq(cal.rtt_samples, 200);
+    ck_assert_int_ge(cal.rtt_p50_ns, TEST_RTT_NS);
+    ck_assert_int_le(cal.rtt_p50_ns, TEST_RTT_NS + 200000);
+    ck_assert_int_ge(cal.rtt_max_ns, cal.rtt_p99_ns);
+}
+END_TEST
+
+// Test: The remote clock offset is recovered from the packet timestamps
+START_TEST(test_calibration_clock_offset)
+{
+    latency_manager_reset_calibration();
+
+    pwar_packet_t packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.num_packets = 1;
+    packet.packet_index = 0;
+    uint64_t start = latency_manager_timestamp_now();
+    // The estimate is committed once per 2 second window
+    while (latency_manager_timestamp_now() - start < 2100000000ULL) {
+        uint64_t now = latency_manager_timestamp_now();
+        packet.seq_timestamp = now - TEST_RTT_NS;
+        packet.timestamp = packet.seq_timestamp + TEST_RTT_NS / 2 + TEST_OFFSET_NS;
+        latency_manager_process_packet_server(&packet);
+        sleep_us(5000);
+    }
+
+    latency_manager_calibration_t cal;
+    latency_manager_get_calibration(&cal);
+    // Symmetric paths: only the time between stamping and processing is error
+    ck_assert_int_ge(cal.clock_offset_ns, TEST_OFFSET_NS - 500000);
+    ck_assert_int_le(cal.clock_offset_ns, TEST_OFFSET_NS + 500000);
+}
+END_TEST
+
+// Test: A reset window drops everything measured before it, but not the calibration
+START_TEST(test_reset_window)
+{
+    latency_manager_reset_calibration();
+
+    pwar_packet_t packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.num_packets = 1;
+    packet.packet_index = 0;
+    packet.seq_timestamp = latency_manager_timestamp_now() - 50 * TEST_RTT_NS;
+    latency_manager_process_packet_server(&packet);
+    latency_manager_report_xrun();
+    latency_manager_report_xrun();
+
+    pwar_latency_metrics_t metrics;
+    latency_manager_get_current_metrics(&metrics);
+    ck_assert_uint_eq(metrics.xruns, 2);
+    ck_assert(metrics.rtt_max_ms >= 50.0);
+
+    latency_manager_reset_window();
+    latency_manager_get_current_metrics(&metrics);
+    ck_assert_uint_eq(metrics.xruns, 0);
+    ck_assert(metrics.rtt_max_ms == 0.0);
+    ck_assert(metrics.rtt_avg_ms == 0.0);
+
+    latency_manager_calibration_t cal;
+    latency_manager_get_calibration(&cal);
+    ck_assert_uint_eq(cal.rtt_samples, 1);
+}
+END_TEST
+
+// Test suite setup
+Suite *latency_manager_suite(void) {
+    Suite *s = suite_create("latency_manager");
+    TCase *tc_core = tcase_create("Core");
+    tcase_add_test(tc_core, test_calibration_seed_roundtrip);
+    tcase_add_test(tc_core, test_calibration_rtt_percentiles);
+    tcase_add_test(tc_core, test_calibration_clock_offset);
+    tcase_add_test(tc_core, test_reset_window);
+    tcase_set_timeout(tc_core, 10);
+    suite_add_tcase(s, tc_core);
+    return s;
+}
+
+// Main entry for running the test suite
+int main(void) {
+    int number_failed;
+    Suite *s = latency_manager_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? 0 : 1;
+}
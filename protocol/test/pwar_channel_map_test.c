@@ -0,0 +1,112 @@
+#include <check.h>
+#include <string.h>
+#include <stdio.h>
+#include "../pwar_channel_map.h"
+
+#define TEST_CHANNELS 2
+#define TEST_FRAMES 256
+
+static void fill_samples(float *samples, uint32_t channels, uint32_t n_samples, float value) {
+    for (uint32_t ch = 0; ch < channels; ++ch) {
+        for (uint32_t s = 0; s < n_samples; ++s) {
+            samples[ch * n_samples + s] = value + ch * 1000 + s;
+        }
+    }
+}
+
+// Test: Every protocol channel ends up in its own host buffer
+START_TEST(test_channel_map_independent_channels)
+{
+    float src[TEST_CHANNELS * TEST_FRAMES];
+    float host[TEST_CHANNELS][TEST_FRAMES];
+    float *dest[TEST_CHANNELS] = { host[0], host[1] };
+    long map[TEST_CHANNELS] = { 0, 1 };
+    fill_samples(src, TEST_CHANNELS, TEST_FRAMES, 1.0f);
+
+    pwar_channel_map_inputs(src, TEST_CHANNELS, TEST_FRAMES, dest, map, TEST_CHANNELS, TEST_FRAMES);
+    for (int ch = 0; ch < TEST_CHANNELS; ++ch)
+        for (int s = 0; s < TEST_FRAMES; ++s)
+            ck_assert_float_eq_tol(host[ch][s], 1.0f + ch * 1000 + s, 0.0001f);
+}
+END_TEST
+
+// Test: The host map may reorder channels
+START_TEST(test_channel_map_reordered)
+{
+    float src[TEST_CHANNELS * TEST_FRAMES];
+    float host[TEST_CHANNELS][TEST_FRAMES];
+    float *dest[TEST_CHANNELS] = { host[0], host[1] };
+    long map[TEST_CHANNELS] = { 1, 0 };
+    fill_samples(src, TEST_CHANNELS, TEST_FRAMES, 1.0f);
+
+    pwar_channel_map_inputs(src, TEST_CHANNELS, TEST_FRAMES, dest, map, TEST_CHANNELS, TEST_FRAMES);
+    for (int s = 0; s < TEST_FRAMES; ++s) {
+        ck_assert_float_eq_tol(host[0][s], 1.0f + 1000 + s, 0.0001f);
+        ck_assert_float_eq_tol(host[1][s], 1.0f + s, 0.0001f);
+    }
+}
+END_TEST
+
+// Test: Host channels without a received channel, and frames past the block, are zeroed
+START_TEST(test_channel_map_unused_zeroed)
+{
+    float src[1 * 100];
+    float host[3][TEST_FRAMES + 3];
+    float *dest[3] = { host[0], host[1], host[2] };
+    long map[3] = { 0, 1, 2 };
+    fill_samples(src, 1, 100, 5.0f);
+    for (int ch = 0; ch < 3; ++ch)
+        for (int s = 0; s < TEST_FRAMES + 3; ++s)
+            host[ch][s] = 42.0f;
+
+    pwar_channel_map_inputs(src, 1, 100, dest, map, 3, TEST_FRAMES + 3);
+    for (int s = 0; s < TEST_FRAMES + 3; ++s) {
+        ck_assert_float_eq_tol(host[0][s], s < 100 ? 5.0f + s : 0.0f, 0.0001f);
+        ck_assert_float_eq_tol(host[1][s], 0.0f, 0.0001f);
+        ck_assert_float_eq_tol(host[2][s], 0.0f, 0.0001f);
+    }
+}
+END_TEST
+
+// Test: A block longer than the host buffer is cut, every channel from its own offset
+START_TEST(test_channel_map_longer_than_host)
+{
+    float src[TEST_CHANNELS * TEST_FRAMES];
+    float host[TEST_CHANNELS][TEST_FRAMES / 2 + 1];
+    float *dest[TEST_CHANNELS] = { host[0], host[1] };
+    long map[TEST_CHANNELS] = { 0, 1 };
+    fill_samples(src, TEST_CHANNELS, TEST_FRAMES, 1.0f);
+    host[0][TEST_FRAMES / 2] = host[1][TEST_FRAMES / 2] = 42.0f;
+
+    pwar_channel_map_inputs(src, TEST_CHANNELS, TEST_FRAMES, dest, map, TEST_CHANNELS, TEST_FRAMES / 2);
+    for (int ch = 0; ch < TEST_CHANNELS; ++ch) {
+        for (int s = 0; s < TEST_FRAMES / 2; ++s)
+            ck_assert_float_eq_tol(host[ch][s], 1.0f + ch * 1000 + s, 0.0001f);
+        // Nothing past the host buffer is written
+        ck_assert_float_eq_tol(host[ch][TEST_FRAMES / 2], 42.0f, 0.0001f);
+    }
+}
+END_TEST
+
+// Test suite setup
+Suite *channel_map_suite(void) {
+    Suite *s = suite_create("pwar_channel_map");
+    TCase *tc_core = tcase_create("Core");
+    tcase_add_test(tc_core, test_channel_map_independent_channels);
+    tcase_add_test(tc_core, test_channel_map_reordered);
+    tcase_add_test(tc_core, test_channel_map_unused_zeroed);
+    tcase_add_test(tc_core, test_channel_map_longer_than_host);
+    suite_add_tcase(s, tc_core);
+    return s;
+}
+
+// Main entry for running the test suite
+int main(void) {
+    int number_failed;
+    Suite *s = channel_map_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+#include <check.h>
+#include <stdint.h>
+#include "../pwar_clock.h"
+
+#define ONE_SECOND_NS 1000000000ULL
+
+static uint64_t abs_diff(uint64_t a, uint64_t b) {
+    return a > b ? a - b : b - a;
+}
+
+// Keeps reading until a counter source took over, or gives up after timeout_ns
+static pwar_clock_source_t wait_for_counter(uint64_t timeout_ns) {
+    uint64_t start = pwar_clock_reference_ns();
+    while (pwar_clock_source() == PWAR_CLOCK_SOURCE_OS && pwar_clock_reference_ns() - start < timeout_ns) {
+        pwar_clock_now_ns();
+    }
+    return pwar_clock_source();
+}
+
+// Test: Fixed point conversion, including products that do not fit in 64 bits
+START_TEST(test_clock_scale)
+{
+    // A 3 GHz counter for one second
+    uint64_t mult = (uint64_t)(ONE_SECOND_NS * 4294967296.0 / 3000000000.0 + 0.5);
+    ck_assert_uint_lt(abs_diff(pwar_clock_scale(3000000000ULL, mult), ONE_SECOND_NS), 2);
+
+    // A 10 MHz counter after a year, ticks * 1e9 would have overflowed after half an hour
+    uint64_t year_ticks = 10000000ULL * 3600 * 24 * 365;
+    ck_assert_uint_eq(pwar_clock_scale(year_ticks, 100ULL << PWAR_CLOCK_SHIFT), year_ticks * 100);
+
+    // Fractions below a nanosecond are dropped
+    ck_assert_uint_eq(pwar_clock_scale(3, 1ULL << (PWAR_CLOCK_SHIFT - 1)), 1);
+}
+END_TEST
+
+// Test: The reference source is the reference clock
+START_TEST(test_clock_reference)
+{
+    ck_assert_int_eq(pwar_clock_init(PWAR_CLOCK_SOURCE_OS), PWAR_CLOCK_SOURCE_OS);
+    ck_assert_int_eq(pwar_clock_source(), PWAR_CLOCK_SOURCE_OS);
+    uint64_t before = pwar_clock_reference_ns();
+    uint64_t now = pwar_clock_now_ns();
+    uint64_t after = pwar_clock_reference_ns();
+    ck_assert_uint_ge(now, before);
+    ck_assert_uint_ge(after, now);
+    ck_assert_int_eq(pwar_clock_init((pwar_clock_source_t)99), -1);
+}
+END_TEST
+
+// Test: A counter source stays monotonic and on the reference timeline
+START_TEST(test_clock_counter)
+{
+    int source = pwar_clock_init(PWAR_CLOCK_SOURCE_AUTO);
+    ck_assert_int_ge(source, PWAR_CLOCK_SOURCE_OS);
+    if (source == PWAR_CLOCK_SOURCE_OS) return; // Nothing better on this machine
+
+    // The reference stands in while the rate is measured
+    ck_assert_int_eq(pwar_clock_source(), PWAR_CLOCK_SOURCE_OS);
+    ck_assert_int_eq(wait_for_counter(ONE_SECOND_NS), source);
+
+    uint64_t last = pwar_clock_now_ns();
+    for (int i = 0; i < 100000; ++i) {
+        uint64_t now = pwar_clock_now_ns();
+        ck_assert_uint_ge(now, last);
+        last = now;
+    }
+    // Through at least one resync
+    uint64_t end = pwar_clock_reference_ns() + PWAR_CLOCK_RESYNC_NS + PWAR_CLOCK_RESYNC_NS / 2;
+    while (pwar_clock_reference_ns() < end) {
+        uint64_t now = pwar_clock_now_ns();
+        ck_assert_uint_ge(now, last);
+        last = now;
+    }
+    ck_assert_uint_lt(abs_diff(pwar_clock_now_ns(), pwar_clock_reference_ns()), 200000);
+}
+END_TEST
+
+Suite *clock_suite(void) {
+    Suite *s = suite_create("pwar_clock");
+    TCase *tc_core = tcase_create("Core");
+    tcase_set_timeout(tc_core, 10);
+    tcase_add_test(tc_core, test_clock_scale);
+    tcase_add_test(tc_core, test_clock_reference);
+    tcase_add_test(tc_core, test_clock_counter);
+    suite_add_tcase(s, tc_core);
+    return s;
+}
+
+int main(void) {
+    int number_failed;
+    Suite *s = clock_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+#include <check.h>
+#include "../pwar_driver_clock.h"
+
+#define MS 1000000ULL
+
+// Runs cycles of 512 samples for seconds at a remote clock off by ppm, arrivals jittered by up to jitter_ns
+static uint64_t run(pwar_driver_clock_t *clock, uint64_t start_ns, double seconds, double ppm, uint64_t jitter_ns) {
+    double period = 512 * 1e9 / 48000 / (1.0 + ppm * 1e-6);
+    uint32_t cycles = (uint32_t)(seconds * 1e9 / period);
+    uint32_t lcg = 12345;
+    uint64_t now = start_ns;
+    for (uint32_t i = 0; i < cycles; ++i) {
+        lcg = lcg * 1103515245u + 12345u;
+        now = start_ns + (uint64_t)(i * period) + (jitter_ns ? (lcg >> 8) % jitter_ns : 0);
+        pwar_driver_clock_cycle(clock, 512, now);
+    }
+    return now;
+}
+
+// Test: The rate of a remote clock running fast is found through the jitter of the network
+START_TEST(test_driver_clock_rate)
+{
+    pwar_driver_clock_t clock;
+    pwar_driver_clock_init(&clock, 48000);
+    run(&clock, 1000 * MS, 0.2, 100.0, 0);
+    ck_assert(clock.rate_diff == 1.0); // Too short to tell
+    run(&clock, 1000 * MS, 8.0, 100.0, 200000);
+    ck_assert_double_eq_tol(clock.rate_diff, 1.0001, 0.00003);
+    ck_assert_uint_eq(clock.duration, 512);
+}
+END_TEST
+
+// Test: A gap starts a new measurement and keeps the last rate until it is long enough
+START_TEST(test_driver_clock_gap)
+{
+    pwar_driver_clock_t clock;
+    pwar_driver_clock_init(&clock, 48000);
+    uint64_t end = run(&clock, 1000 * MS, 4.0, -50.0, 0);
+    ck_assert_double_eq_tol(clock.rate_diff, 0.99995, 0.000001);
+    uint64_t position = clock.position;
+    // The remote stalls for a while, then runs at the nominal rate
+    end = run(&clock, end + 500 * MS, 0.3, 0.0, 0);
+    ck_assert_uint_gt(clock.position, position);
+    ck_assert_double_eq_tol(clock.rate_diff, 0.99995, 0.000001);
+    run(&clock, end + 512 * 1000000000ULL / 48000, 2.0, 0.0, 0);
+    ck_assert_double_eq_tol(clock.rate_diff, 1.0, 0.000001);
+}
+END_TEST
+
+// Test: Way off rates are held to the limit, the next cycle follows the measured rate
+START_TEST(test_driver_clock_limits)
+{
+    pwar_driver_clock_t clock;
+    pwar_driver_clock_init(&clock, 48000);
+    run(&clock, 1000 * MS, 1.0, 20000.0, 0);
+    ck_assert_double_eq_tol(clock.rate_diff, 1.0 + PWAR_DRIVER_CLOCK_MAX_DEVIATION, 1e-9);
+
+    pwar_driver_clock_init(&clock, 48000);
+    pwar_driver_clock_cycle(&clock, 480, 1000 * MS);
+    ck_assert_uint_eq(pwar_driver_clock_next_ns(&clock), 1010 * MS);
+    // A new quantum restarts the measurement
+    pwar_driver_clock_cycle(&clock, 240, 1010 * MS);
+    ck_assert_uint_eq(clock.position, 480);
+    ck_assert_uint_eq(clock.anchor_ns, 1010 * MS);
+    ck_assert_uint_eq(pwar_driver_clock_next_ns(&clock), 1015 * MS);
+}
+END_TEST
+
+Suite *driver_clock_suite(void) {
+    Suite *s = suite_create("pwar_driver_clock");
+    TCase *tc_core = tcase_create("Core");
+    tcase_add_test(tc_core, test_driver_clock_rate);
+    tcase_add_test(tc_core, test_driver_clock_gap);
+    tcase_add_test(tc_core, test_driver_clock_limits);
+    suite_add_tcase(s, tc_core);
+    return s;
+}
+
+int main(void) {
+    int number_failed;
+    Suite *s = driver_clock_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+#include <check.h>
+#include <string.h>
+#include <stdio.h>
+#include "../pwar_fanout.h"
+
+#define CHUNK 64
+#define RATE 48000
+#define CHUNK_NS (CHUNK * 1000000000ULL / RATE)
+
+static pwar_fanout_t fanout;
+static float in_buf[4][CHUNK];
+static float out_buf[4][CHUNK];
+static float *in[4] = { in_buf[0], in_buf[1], in_buf[2], in_buf[3] };
+static float *out[4] = { out_buf[0], out_buf[1], out_buf[2], out_buf[3] };
+
+// Two hosts with two channels each
+static void setup_two_hosts(uint32_t miss0, uint32_t miss1, uint32_t deadline1_us) {
+    pwar_fanout_host_config_t hosts[2] = {
+        { 0, 2, 0, miss0 },
+        { 2, 2, deadline1_us, miss1 },
+    };
+    ck_assert_int_eq(pwar_fanout_init(&fanout, hosts, 2, RATE), 0);
+}
+
+// The remote processing: return the packet it got, every sample plus offset
+static void remote_return(uint32_t host, const pwar_packet_t *sent, float offset, uint64_t now_ns) {
+    pwar_packet_t ret = *sent;
+    for (uint32_t ch = 0; ch < PWAR_CHANNELS; ++ch)
+        for (uint32_t s = 0; s < ret.n_samples; ++s)
+            ret.samples[ch][s] += offset;
+    pwar_fanout_put(&fanout, host, &ret, now_ns);
+}
+
+static void fill_input(uint32_t seq) {
+    for (uint32_t ch = 0; ch < 4; ++ch)
+        for (uint32_t s = 0; s < CHUNK; ++s)
+            in_buf[ch][s] = (float)(seq * 10 + ch);
+}
+
+START_TEST(test_fanout_config)
+{
+    pwar_fanout_host_config_t overlap[2] = { { 0, 2, 0, 0 }, { 1, 2, 0, 0 } };
+    ck_assert_int_eq(pwar_fanout_init(&fanout, overlap, 2, RATE), -1);
+    pwar_fanout_host_config_t wide[1] = { { 0, PWAR_CHANNELS + 1, 0, 0 } };
+    ck_assert_int_eq(pwar_fanout_init(&fanout, wide, 1, RATE), -1);
+    pwar_fanout_host_config_t gap[2] = { { 0, 1, 0, 0 }, { 3, 1, 0, 0 } };
+    ck_assert_int_eq(pwar_fanout_init(&fanout, gap, 2, RATE), 0);
+    ck_assert_uint_eq(fanout.channels, 4);
+}
+END_TEST
+
+// Test: Every host gets its own group, returns are merged by sequence
+START_TEST(test_fanout_merge)
+{
+    setup_two_hosts(PWAR_FANOUT_MISS_SILENCE, PWAR_FANOUT_MISS_SILENCE, 0);
+    pwar_packet_t packets[2];
+    uint64_t now = 1000000;
+
+    fill_input(5);
+    for (uint32_t h = 0; h < 2; ++h)
+        pwar_fanout_build_packet(&fanout, h, 5, in, CHUNK, now, &packets[h]);
+    ck_assert_float_eq(packets[0].samples[1][0], 51.0f);
+    ck_assert_float_eq(packets[1].samples[0][0], 52.0f);
+
+    // Host 1 answers before host 0, the order does not matter
+    remote_return(1, &packets[1], 1000.0f, now + 500000);
+    remote_return(0, &packets[0], 2000.0f, now + 800000);
+    ck_assert_uint_eq(pwar_fanout_collect(&fanout, 5, 0x3, out, CHUNK), 2);
+    ck_assert_float_eq(out_buf[0][0], 2050.0f);
+    ck_assert_float_eq(out_buf[1][CHUNK - 1], 2051.0f);
+    ck_assert_float_eq(out_buf[2][0], 1052.0f);
+    ck_assert_float_eq(out_buf[3][0], 1053.0f);
+}
+END_TEST
+
+// Test: A miss is covered by its own host's policy only
+START_TEST(test_fanout_miss_policies)
+{
+    pwar_packet_t packets[2];
+    uint64_t now = 1000000;
+
+    setup_two_hosts(PWAR_FANOUT_MISS_HOLD, PWAR_FANOUT_MISS_DRY, 0);
+    fill_input(1);
+    for (uint32_t h = 0; h < 2; ++h) {
+        pwar_fanout_build_packet(&fanout, h, 1, in, CHUNK, now, &packets[h]);
+        remote_return(h, &packets[h], 100.0f, now);
+    }
+    ck_assert_uint_eq(pwar_fanout_collect(&fanout, 1, 0x3, out, CHUNK), 2);
+
+    // Only host 0 answers seq 2, host 1 plays its dry input
+    fill_input(2);
+    for (uint32_t h = 0; h < 2; ++h)
+        pwar_fanout_build_packet(&fanout, h, 2, in, CHUNK, now, &packets[h]);
+    remote_return(0, &packets[0], 100.0f, now);
+    ck_assert_uint_eq(pwar_fanout_collect(&fanout, 2, 0x3, out, CHUNK), 1);
+    ck_assert_float_eq(out_buf[0][0], 120.0f);
+    ck_assert_float_eq(out_buf[2][0], 22.0f);
+    ck_assert_float_eq(out_buf[3][0], 23.0f);
+
+    // Host 0 is not streaming for seq 3, it holds its last good block
+    fill_input(3);
+    ck_assert_uint_eq(pwar_fanout_collect(&fanout, 3, 0x2, out, CHUNK), 0);
+    ck_assert_float_eq(out_buf[0][0], 120.0f);
+    ck_assert_uint_eq(fanout.hosts[0].missed, 1);
+    ck_assert_uint_eq(fanout.hosts[1].missed, 2);
+    ck_assert_uint_eq(fanout.hosts[1].max_consecutive_misses, 2);
+    pwar_fanout_clear_counts(&fanout);
+    ck_assert_uint_eq(fanout.hosts[1].missed, 0);
+    ck_assert_uint_eq(fanout.hosts[0].delivered, 0);
+
+    // Silence without anything to fall back on
+    setup_two_hosts(PWAR_FANOUT_MISS_HOLD, PWAR_FANOUT_MISS_SILENCE, 0);
+    out_buf[0][0] = out_buf[2][0] = 1.0f;
+    ck_assert_uint_eq(pwar_fanout_collect(&fanout, 0, 0x3, out, CHUNK), 0);
+    ck_assert_float_eq(out_buf[0][0], 0.0f);
+    ck_assert_float_eq(out_buf[2][0], 0.0f);
+}
+END_TEST
+
+// Test: Returns past a host's deadline are dropped, counted from the last chunk of the block
+START_TEST(test_fanout_deadline)
+{
+    setup_two_hosts(PWAR_FANOUT_MISS_SILENCE, PWAR_FANOUT_MISS_SILENCE, 2000);
+    pwar_packet_t packet;
+    uint64_t now = 1000000;
+
+    fill_input(7);
+    pwar_fanout_build_packet(&fanout, 1, 7, in, CHUNK, now, &packet);
+    remote_return(1, &packet, 0.0f, now + 2500000);
+    ck_assert_uint_eq(fanout.hosts[1].past_deadline, 1);
+    ck_assert_uint_eq(pwar_fanout_collect(&fanout, 7, 0x2, out, CHUNK), 0);
+
+    // A block of four chunks: the deadline starts once the fourth one was sent
+    pwar_packet_t block = packet;
+    block.seq = 8;
+    block.num_packets = 4;
+    for (uint32_t p = 0; p < 4; ++p) {
+        block.packet_index = p;
+        ck_assert_int_eq(pwar_fanout_put(&fanout, 1, &block, now + 3 * CHUNK_NS + 1500000), 1);
+    }
+    ck_assert_uint_eq(fanout.hosts[1].past_deadline, 1);
+    ck_assert_uint_eq(pwar_fanout_collect(&fanout, 11, 0x2, out, CHUNK), 1);
+}
+END_TEST
+
+Suite *fanout_suite(void) {
+    Suite *s = suite_create("pwar_fanout");
+    TCase *tc_core = tcase_create("Core");
+    tcase_add_test(tc_core, test_fanout_config);
+    tcase_add_test(tc_core, test_fanout_merge);
+    tcase_add_test(tc_core, test_fanout_miss_policies);
+    tcase_add_test(tc_core, test_fanout_deadline);
+    suite_add_tcase(s, tc_core);
+    return s;
+}
+
+int main(void) {
+    int number_failed;
+    Suite *s = fanout_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+#include <check.h>
+#include <stdio.h>
+#include "../pwar_pacer.h"
+#include "../latency_manager.h"
+
+#define PERIOD_NS 10666666ULL // 512 samples at 48 kHz
+
+// Test: Disabled or small blocks go out back to back
+START_TEST(test_pacer_off)
+{
+    pwar_pacer_t pacer;
+    pwar_pacer_init(&pacer, 0, 0.5);
+    ck_assert_int_eq(pwar_pacer_enabled(&pacer), 0);
+    pwar_pacer_begin_block(&pacer, 16, PERIOD_NS, 1000);
+    ck_assert_uint_eq(pwar_pacer_segment_time(&pacer, 15), 1000);
+
+    pwar_pacer_init(&pacer, 4, 0.5);
+    pwar_pacer_begin_block(&pacer, 4, PERIOD_NS, 1000);
+    ck_assert_uint_eq(pwar_pacer_segment_time(&pacer, 3), 1000);
+    ck_assert_uint_eq(pacer.blocks_paced, 0);
+}
+END_TEST
+
+// Test: Groups of burst segments are spread evenly within the spread window
+START_TEST(test_pacer_schedule)
+{
+    pwar_pacer_t pacer;
+    pwar_pacer_init(&pacer, 4, 0.5);
+    pwar_pacer_begin_block(&pacer, 16, PERIOD_NS, 1000);
+
+    uint64_t gap = (uint64_t)(PERIOD_NS * 0.5) / 4;
+    ck_assert_uint_eq(pwar_pacer_segment_time(&pacer, 0), 1000);
+    ck_assert_uint_eq(pwar_pacer_segment_time(&pacer, 3), 1000);
+    ck_assert_uint_eq(pwar_pacer_segment_time(&pacer, 4), 1000 + gap);
+    ck_assert_uint_eq(pwar_pacer_segment_time(&pacer, 15), 1000 + 3 * gap);
+    // The last group leaves inside the window
+    ck_assert_uint_lt(pwar_pacer_segment_time(&pacer, 15), 1000 + PERIOD_NS / 2);
+    ck_assert_uint_eq(pacer.blocks_paced, 1);
+}
+END_TEST
+
+// Test: The spread is clamped so the host callback keeps its time
+START_TEST(test_pacer_spread_clamp)
+{
+    pwar_pacer_t pacer;
+    pwar_pacer_init(&pacer, 1, 2.0);
+    ck_assert(pacer.spread <= PWAR_PACER_MAX_SPREAD);
+    pwar_pacer_init(&pacer, 1, 0.0);
+    ck_assert(pacer.spread == PWAR_PACER_DEFAULT_SPREAD);
+}
+END_TEST
+
+// Test: Waiting holds each group back until its time
+START_TEST(test_pacer_wait)
+{
+    pwar_pacer_t pacer;
+    pwar_pacer_init(&pacer, 2, 0.5);
+    uint64_t start = latency_manager_timestamp_now();
+    pwar_pacer_begin_block(&pacer, 8, 4000000ULL, start);
+
+    for (uint32_t i = 0; i < 8; ++i) {
+        pwar_pacer_wait(&pacer, i);
+        ck_assert_uint_ge(latency_manager_timestamp_now(), pwar_pacer_segment_time(&pacer, i));
+    }
+    // Four groups, 0.5 ms apart
+    ck_assert_uint_ge(latency_manager_timestamp_now() - start, 1500000ULL);
+    ck_assert_uint_gt(pacer.total_wait_ns, 0);
+}
+END_TEST
+
+Suite *pwar_pacer_suite(void) {
+    Suite *s = suite_create("pwar_pacer");
+    TCase *tc_core = tcase_create("Core");
+    tcase_add_test(tc_core, test_pacer_off);
+    tcase_add_test(tc_core, test_pacer_schedule);
+    tcase_add_test(tc_core, test_pacer_spread_clamp);
+    tcase_add_test(tc_core, test_pacer_wait);
+    suite_add_tcase(s, tc_core);
+    return s;
+}
+
+int main(void) {
+    int number_failed;
+    Suite *s = pwar_pacer_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,157 @@
+#include <check.h>
+#include <string.h>
+#include "../pwar_paths.h"
+#include "../pwar_router.h"
+
+#define US 1000ULL
+
+// Test: The first copy of a segment wins, whichever path it came over
+START_TEST(test_paths_first_copy_wins)
+{
+    pwar_paths_t paths;
+    pwar_paths_init(&paths, 2);
+    ck_assert_int_eq(pwar_paths_accept(&paths, 0, 10, 1000 * US, 0), 1);
+    ck_assert_int_eq(pwar_paths_accept(&paths, 1, 10, 1300 * US, 0), 0);
+    ck_assert_int_eq(pwar_paths_accept(&paths, 1, 11, 2000 * US, 0), 1);
+    ck_assert_int_eq(pwar_paths_accept(&paths, 0, 11, 2100 * US, 0), 0);
+    // The network itself duplicated it, still only used once
+    ck_assert_int_eq(pwar_paths_accept(&paths, 0, 11, 2200 * US, 0), 0);
+
+    ck_assert_uint_eq(paths.stats[0].received, 3);
+    ck_assert_uint_eq(paths.stats[0].first, 1);
+    ck_assert_uint_eq(paths.stats[1].received, 2);
+    ck_assert_uint_eq(paths.stats[1].first, 1);
+    ck_assert_uint_eq(paths.stats[1].lag_ns, 300 * US);
+    ck_assert_uint_eq(paths.stats[0].lag_ns, 100 * US);
+}
+END_TEST
+
+// Test: A segment only one path delivered counts as lost on the other once it leaves the window
+START_TEST(test_paths_loss)
+{
+    pwar_paths_t paths;
+    pwar_paths_init(&paths, 2);
+    for (uint32_t key = 0; key < 100; ++key) {
+        ck_assert_int_eq(pwar_paths_accept(&paths, 0, key, key * US, 0), 1);
+        if (key % 10) pwar_paths_accept(&paths, 1, key, key * US + 50, 0);
+    }
+    ck_assert_uint_eq(paths.stats[1].lost, 0); // Still in the window
+    for (uint32_t key = 100; key < 100 + PWAR_PATHS_WINDOW; ++key) {
+        pwar_paths_accept(&paths, 0, key, key * US, 0);
+        pwar_paths_accept(&paths, 1, key, key * US + 50, 0);
+    }
+    ck_assert_uint_eq(paths.stats[0].lost, 0);
+    ck_assert_uint_eq(paths.stats[1].lost, 10);
+    ck_assert_uint_eq(paths.stats[0].first, 100 + PWAR_PATHS_WINDOW);
+    ck_assert_int_eq(pwar_paths_leader(&paths, (uint32_t[]){ 0, 0 }), 0);
+}
+END_TEST
+
+// Test: Copies older than the window are dropped, a restarted sequence is not
+START_TEST(test_paths_stale_and_restart)
+{
+    pwar_paths_t paths;
+    pwar_paths_init(&paths, 2);
+    for (uint32_t key = 5000; key < 5000 + PWAR_PATHS_WINDOW; ++key) {
+        pwar_paths_accept(&paths, 0, key, 0, 0);
+    }
+    // Same slot, one window behind
+    ck_assert_int_eq(pwar_paths_accept(&paths, 1, 5000 - PWAR_PATHS_WINDOW, 0, 0), 0);
+    // Far behind, the other side started over
+    ck_assert_int_eq(pwar_paths_accept(&paths, 0, 0, 0, 0), 1);
+    // After a reset the same keys are new again
+    pwar_paths_reset(&paths);
+    ck_assert_int_eq(pwar_paths_accept(&paths, 0, 5001, 0, 0), 1);
+    ck_assert_uint_eq(paths.stats[0].first, PWAR_PATHS_WINDOW + 2);
+}
+END_TEST
+
+// Test: Transit times are smoothed per path, the leader follows who wins
+START_TEST(test_paths_latency_and_leader)
+{
+    pwar_paths_t paths;
+    pwar_paths_init(&paths, 2);
+    uint32_t before[PWAR_PATHS_MAX] = { 0, 0 };
+    for (uint32_t key = 0; key < 200; ++key) {
+        pwar_paths_accept(&paths, 1, key, key * 1000 * US, 400 * US);
+        pwar_paths_accept(&paths, 0, key, key * 1000 * US + 900 * US, 1300 * US);
+    }
+    ck_assert_uint_eq(paths.stats[1].latency_ns, 400 * US);
+    ck_assert_uint_eq(paths.stats[0].latency_ns, 1300 * US);
+    ck_assert_int_eq(pwar_paths_leader(&paths, before), 1);
+    before[0] = paths.stats[0].first;
+    before[1] = paths.stats[1].first;
+    ck_assert_int_eq(pwar_paths_leader(&paths, before), -1);
+    // Path 1 goes down
+    for (uint32_t key = 200; key < 210; ++key) pwar_paths_accept(&paths, 0, key, 0, 1300 * US);
+    ck_assert_int_eq(pwar_paths_leader(&paths, before), 0);
+}
+END_TEST
+
+static void fill_packet(pwar_packet_t *packet, uint64_t seq, uint32_t index, uint32_t count, float value) {
+    memset(packet, 0, sizeof(*packet));
+    packet->seq = seq;
+    packet->packet_index = index;
+    packet->num_packets = count;
+    packet->n_samples = 64;
+    for (uint32_t s = 0; s < 64; ++s) packet->samples[0][s] = value + s;
+}
+
+// Test: The router hands a buffer out once, however many copies of its segments arrive
+START_TEST(test_router_duplicates)
+{
+    static pwar_router_t router;
+    float out[2 * 128];
+    pwar_packet_t packet;
+    pwar_router_init(&router, 2);
+
+    fill_packet(&packet, 10, 0, 2, 1.0f);
+    ck_assert_int_eq(pwar_router_process_packet(&router, &packet, out, 128, 2), 0);
+    ck_assert_int_eq(pwar_router_process_packet(&router, &packet, out, 128, 2), 0);
+    fill_packet(&packet, 10, 1, 2, 100.0f);
+    ck_assert_int_eq(pwar_router_process_packet(&router, &packet, out, 128, 2), 128);
+    ck_assert_float_eq(out[64], 100.0f);
+    // The copy of the last segment from the other path
+    ck_assert_int_eq(pwar_router_process_packet(&router, &packet, out, 128, 2), 0);
+
+    // The next buffer starts, then a late copy of the previous one arrives
+    fill_packet(&packet, 12, 0, 2, 200.0f);
+    ck_assert_int_eq(pwar_router_process_packet(&router, &packet, out, 128, 2), 0);
+    fill_packet(&packet, 10, 0, 2, 1.0f);
+    ck_assert_int_eq(pwar_router_process_packet(&router, &packet, out, 128, 2), 0);
+    fill_packet(&packet, 12, 1, 2, 300.0f);
+    ck_assert_int_eq(pwar_router_process_packet(&router, &packet, out, 128, 2), 128);
+    ck_assert_float_eq(out[0], 200.0f);
+    ck_assert_float_eq(out[64], 300.0f);
+    ck_assert_uint_eq(router.duplicates, 3);
+    ck_assert_uint_eq(router.blocks_incomplete, 0);
+
+    // Far behind is a restarted sequence, not a copy
+    fill_packet(&packet, 1000, 0, 1, 4.0f);
+    ck_assert_int_eq(pwar_router_process_packet(&router, &packet, out, 128, 2), 64);
+    fill_packet(&packet, 0, 0, 1, 5.0f);
+    ck_assert_int_eq(pwar_router_process_packet(&router, &packet, out, 128, 2), 64);
+}
+END_TEST
+
+Suite *paths_suite(void) {
+    Suite *s = suite_create("pwar_paths");
+    TCase *tc_core = tcase_create("Core");
+    tcase_add_test(tc_core, test_paths_first_copy_wins);
+    tcase_add_test(tc_core, test_paths_loss);
+    tcase_add_test(tc_core, test_paths_stale_and_restart);
+    tcase_add_test(tc_core, test_paths_latency_and_leader);
+    tcase_add_test(tc_core, test_router_duplicates);
+    suite_add_tcase(s, tc_core);
+    return s;
+}
+
+int main(void) {
+    int number_failed;
+    Suite *s = paths_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? 0 : 1;
+}
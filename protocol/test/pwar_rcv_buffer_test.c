@@ -33,9 +33,12 @@ START_TEST(test_rcv_buffer_fill_and_read)
 {
     float buf[TEST_CHANNELS * TEST_BUF_SIZE];
     fill_samples(buf, TEST_CHANNELS, TEST_BUF_SIZE, TEST_BUF_SIZE, 1.0f);
+    pwar_rcv_buffer_reset();
     pwar_rcv_buffer_add_buffer(buf, TEST_BUF_SIZE, TEST_CHANNELS, TEST_BUF_SIZE);
 
     float chunks[TEST_CHANNELS * TEST_CHUNK_SIZE];
+    // The block went to the buffer not being read, the first read swaps to it
+    ck_assert_int_eq(pwar_rcv_get_chunk(chunks, TEST_CHANNELS, TEST_CHUNK_SIZE), 0);
     for (int i = 0; i < 4; ++i) {
         int ret = pwar_rcv_get_chunk(chunks, TEST_CHANNELS, TEST_CHUNK_SIZE);
         ck_assert_int_eq(ret, 1); // Should indicate data was read
@@ -51,12 +54,84 @@ START_TEST(test_rcv_buffer_fill_and_read)
 }
 END_TEST
 
+// Checks chunk i of a block filled by fill_samples
+static void check_chunk(const float *chunks, uint32_t i, float value) {
+    for (int ch = 0; ch < TEST_CHANNELS; ++ch)
+        for (int s = 0; s < TEST_CHUNK_SIZE; ++s)
+            ck_assert_float_eq_tol(chunks[ch * TEST_CHUNK_SIZE + s], value + ch * 1000 + i * TEST_CHUNK_SIZE + s, 0.0001f);
+}
+
+// Test: Chunks of a block are served as soon as the segments leading up to them are in
+START_TEST(test_rcv_buffer_cut_through)
+{
+    float buf[TEST_CHANNELS * TEST_BUF_SIZE];
+    float chunks[TEST_CHANNELS * TEST_CHUNK_SIZE];
+    fill_samples(buf, TEST_CHANNELS, TEST_BUF_SIZE, TEST_BUF_SIZE, 1.0f);
+    pwar_rcv_buffer_reset();
+
+    ck_assert_int_eq(pwar_rcv_buffer_add_prefix(7, buf, TEST_CHUNK_SIZE, TEST_BUF_SIZE, TEST_CHANNELS, TEST_BUF_SIZE), 1);
+    ck_assert_int_eq(pwar_rcv_get_chunk(chunks, TEST_CHANNELS, TEST_CHUNK_SIZE), 0); // Other buffer, empty
+    ck_assert_int_eq(pwar_rcv_get_chunk(chunks, TEST_CHANNELS, TEST_CHUNK_SIZE), 1);
+    check_chunk(chunks, 0, 1.0f);
+
+    ck_assert_int_eq(pwar_rcv_buffer_add_prefix(7, buf, 2 * TEST_CHUNK_SIZE, TEST_BUF_SIZE, TEST_CHANNELS, TEST_BUF_SIZE), 1);
+    ck_assert_int_eq(pwar_rcv_buffer_add_prefix(7, buf, 2 * TEST_CHUNK_SIZE, TEST_BUF_SIZE, TEST_CHANNELS, TEST_BUF_SIZE), 0);
+    ck_assert_int_eq(pwar_rcv_get_chunk(chunks, TEST_CHANNELS, TEST_CHUNK_SIZE), 1);
+    check_chunk(chunks, 1, 1.0f);
+
+    // The third chunk is not in when its turn comes
+    ck_assert_int_eq(pwar_rcv_get_chunk(chunks, TEST_CHANNELS, TEST_CHUNK_SIZE), 0);
+    for (int i = 0; i < TEST_CHANNELS * TEST_CHUNK_SIZE; ++i)
+        ck_assert_float_eq_tol(chunks[i], 0.0f, 0.0001f);
+    ck_assert_int_eq(pwar_rcv_buffer_add_prefix(7, buf, TEST_BUF_SIZE, TEST_BUF_SIZE, TEST_CHANNELS, TEST_BUF_SIZE), 1);
+    ck_assert_int_eq(pwar_rcv_get_chunk(chunks, TEST_CHANNELS, TEST_CHUNK_SIZE), 1);
+    check_chunk(chunks, 3, 1.0f);
+
+    // Played out, a late call for the same block changes nothing
+    ck_assert_int_eq(pwar_rcv_buffer_add_prefix(7, buf, TEST_BUF_SIZE, TEST_BUF_SIZE, TEST_CHANNELS, TEST_BUF_SIZE), 0);
+    ck_assert_int_eq(pwar_rcv_get_chunk(chunks, TEST_CHANNELS, TEST_CHUNK_SIZE), 0);
+}
+END_TEST
+
+// Test: The next block starts in the other buffer while the one being played is still read
+START_TEST(test_rcv_buffer_cut_through_next_block)
+{
+    float first[TEST_CHANNELS * TEST_BUF_SIZE];
+    float second[TEST_CHANNELS * TEST_BUF_SIZE];
+    float chunks[TEST_CHANNELS * TEST_CHUNK_SIZE];
+    fill_samples(first, TEST_CHANNELS, TEST_BUF_SIZE, TEST_BUF_SIZE, 1.0f);
+    fill_samples(second, TEST_CHANNELS, TEST_BUF_SIZE, TEST_BUF_SIZE, 2.0f);
+    pwar_rcv_buffer_reset();
+
+    pwar_rcv_buffer_add_prefix(1, first, TEST_CHUNK_SIZE, TEST_BUF_SIZE, TEST_CHANNELS, TEST_BUF_SIZE);
+    ck_assert_int_eq(pwar_rcv_get_chunk(chunks, TEST_CHANNELS, TEST_CHUNK_SIZE), 0);
+    ck_assert_int_eq(pwar_rcv_get_chunk(chunks, TEST_CHANNELS, TEST_CHUNK_SIZE), 1);
+    check_chunk(chunks, 0, 1.0f);
+
+    // The rest of the first block goes where its start is, the reader is in it already
+    ck_assert_int_eq(pwar_rcv_buffer_add_prefix(1, first, TEST_BUF_SIZE, TEST_BUF_SIZE, TEST_CHANNELS, TEST_BUF_SIZE), 1);
+    ck_assert_int_eq(pwar_rcv_get_chunk(chunks, TEST_CHANNELS, TEST_CHUNK_SIZE), 1);
+    check_chunk(chunks, 1, 1.0f);
+    ck_assert_int_eq(pwar_rcv_buffer_add_prefix(2, second, TEST_BUF_SIZE, TEST_BUF_SIZE, TEST_CHANNELS, TEST_BUF_SIZE), 1);
+    for (uint32_t i = 2; i < 4; ++i) {
+        ck_assert_int_eq(pwar_rcv_get_chunk(chunks, TEST_CHANNELS, TEST_CHUNK_SIZE), 1);
+        check_chunk(chunks, i, 1.0f);
+    }
+    for (uint32_t i = 0; i < 4; ++i) {
+        ck_assert_int_eq(pwar_rcv_get_chunk(chunks, TEST_CHANNELS, TEST_CHUNK_SIZE), 1);
+        check_chunk(chunks, i, 2.0f);
+    }
+}
+END_TEST
+
 // Test suite setup
 Suite *rcv_buffer_suite(void) {
     Suite *s = suite_create("pwar_rcv_buffer");
     TCase *tc_core = tcase_create("Core");
     tcase_add_test(tc_core, test_rcv_buffer_silence_before_fill);
     tcase_add_test(tc_core, test_rcv_buffer_fill_and_read);
+    tcase_add_test(tc_core, test_rcv_buffer_cut_through);
+    tcase_add_test(tc_core, test_rcv_buffer_cut_through_next_block);
     suite_add_tcase(s, tc_core);
     return s;
 }
@@ -0,0 +1,205 @@
+#include <check.h>
+#include <string.h>
+#include "../pwar_retransmit.h"
+#include "../pwar_router.h"
+
+#define US 1000ULL
+
+static void fill_packet(pwar_packet_t *packet, uint64_t seq, uint32_t index, uint32_t count) {
+    memset(packet, 0, sizeof(*packet));
+    packet->seq = seq;
+    packet->packet_index = index;
+    packet->num_packets = count;
+    packet->n_samples = 64;
+    packet->samples[0][0] = (float)(seq + index);
+}
+
+// Test: Gaps inside a buffer and at its end are reported once each
+START_TEST(test_router_take_missing)
+{
+    static pwar_router_t router;
+    pwar_packet_t packet;
+    pwar_router_init(&router, 2);
+
+    fill_packet(&packet, 10, 0, 4);
+    ck_assert_uint_eq(pwar_router_take_missing(&router, &packet), 0);
+    ck_assert_int_eq(pwar_router_track_packet(&router, &packet), 1);
+    fill_packet(&packet, 10, 2, 4);
+    ck_assert_uint_eq(pwar_router_take_missing(&router, &packet), 1ULL << 1);
+    ck_assert_int_eq(pwar_router_track_packet(&router, &packet), 1);
+    // Already asked for
+    fill_packet(&packet, 10, 3, 4);
+    ck_assert_uint_eq(pwar_router_take_missing(&router, &packet), 0);
+    pwar_router_track_packet(&router, &packet);
+    // The resent segment completes the buffer
+    fill_packet(&packet, 10, 1, 4);
+    ck_assert_int_eq(pwar_router_track_packet(&router, &packet), 1);
+    ck_assert_uint_eq(router.blocks_completed, 1);
+
+    // The tail goes missing, the next buffer shows it
+    fill_packet(&packet, 14, 0, 4);
+    ck_assert_uint_eq(pwar_router_take_missing(&router, &packet), 0);
+    pwar_router_track_packet(&router, &packet);
+    fill_packet(&packet, 14, 1, 4);
+    pwar_router_track_packet(&router, &packet);
+    fill_packet(&packet, 18, 0, 4);
+    ck_assert_uint_eq(pwar_router_take_missing(&router, &packet), (1ULL << 2) | (1ULL << 3));
+    pwar_router_track_packet(&router, &packet);
+    // A late copy of the previous buffer tells nothing about the current one
+    fill_packet(&packet, 14, 2, 4);
+    ck_assert_uint_eq(pwar_router_take_missing(&router, &packet), 0);
+    ck_assert_int_eq(pwar_router_track_packet(&router, &packet), 0);
+    ck_assert_uint_eq(router.blocks_incomplete, 1);
+}
+END_TEST
+
+// Test: The ring holds the most recent segments only
+START_TEST(test_ring_store_find)
+{
+    static pwar_retransmit_ring_t ring;
+    pwar_packet_t packet, out;
+    pwar_retransmit_init(&ring);
+    ck_assert_int_eq(pwar_retransmit_find(&ring, 0, 0, &out), 0);
+    for (uint64_t seq = 0; seq < 2 * PWAR_RETRANSMIT_SLOTS; seq += 4) {
+        for (uint32_t i = 0; i < 4; ++i) {
+            fill_packet(&packet, seq, i, 4);
+            pwar_retransmit_store(&ring, &packet);
+        }
+    }
+    ck_assert_int_eq(pwar_retransmit_find(&ring, 2 * PWAR_RETRANSMIT_SLOTS - 4, 3, &out), 1);
+    ck_assert_float_eq(out.samples[0][0], (float)(2 * PWAR_RETRANSMIT_SLOTS - 1));
+    ck_assert_int_eq(pwar_retransmit_find(&ring, PWAR_RETRANSMIT_SLOTS, 0, &out), 1);
+    // Overwritten by a newer buffer
+    ck_assert_int_eq(pwar_retransmit_find(&ring, PWAR_RETRANSMIT_SLOTS - 4, 0, &out), 0);
+    // Never sent
+    ck_assert_int_eq(pwar_retransmit_find(&ring, PWAR_RETRANSMIT_SLOTS, 5, &out), 0);
+}
+END_TEST
+
+static uint32_t sent_count;
+static pwar_packet_t sent[8];
+
+static void collect(const pwar_packet_t *packet, void *userdata) {
+    (void)userdata;
+    if (sent_count < 8) sent[sent_count] = *packet;
+    sent_count++;
+}
+
+// Test: A NACK is answered with whatever the ring still holds
+START_TEST(test_ring_answer)
+{
+    static pwar_retransmit_ring_t ring;
+    pwar_packet_t packet;
+    pwar_retransmit_init(&ring);
+    for (uint32_t i = 0; i < 4; ++i) {
+        fill_packet(&packet, 100, i, 4);
+        pwar_retransmit_store(&ring, &packet);
+    }
+    pwar_nack_msg_t nack;
+    memset(&nack, 0, sizeof(nack));
+    nack.magic = PWAR_NACK_MAGIC;
+    nack.seq = 100;
+    nack.missing = (1ULL << 1) | (1ULL << 3);
+    ck_assert_int_eq(pwar_retransmit_is_nack(&nack, sizeof(nack)), 1);
+    ck_assert_int_eq(pwar_retransmit_is_nack(&nack, sizeof(pwar_latency_info_t)), 0);
+
+    sent_count = 0;
+    ck_assert_uint_eq(pwar_retransmit_answer(&ring, &nack, collect, NULL), 2);
+    ck_assert_uint_eq(sent_count, 2);
+    ck_assert_uint_eq(sent[0].packet_index, 1);
+    ck_assert_uint_eq(sent[1].packet_index, 3);
+
+    nack.seq = 40;
+    ck_assert_uint_eq(pwar_retransmit_answer(&ring, &nack, collect, NULL), 0);
+    ck_assert_uint_eq(ring.requested, 4);
+    ck_assert_uint_eq(ring.resent, 2);
+    ck_assert_uint_eq(ring.expired, 2);
+}
+END_TEST
+
+// Test: Only segments with more time left than the RTT are asked for, answers measure the RTT
+START_TEST(test_tracker_deadline_and_rtt)
+{
+    pwar_nack_tracker_t tracker;
+    pwar_nack_msg_t nack;
+    pwar_nack_tracker_init(&tracker);
+
+    // RTT unknown, anything not yet due is worth asking for
+    ck_assert_int_eq(pwar_nack_tracker_request(&tracker, 10, 0x3, 7, 1000 * US, 1000 * US, 1500 * US, &nack), 1);
+    ck_assert_uint_eq(nack.magic, PWAR_NACK_MAGIC);
+    ck_assert_uint_eq(nack.generation, 7);
+    ck_assert_uint_eq(nack.seq, 10);
+    ck_assert_uint_eq(nack.missing, 0x2);
+    ck_assert_uint_eq(tracker.too_late, 1);
+
+    ck_assert_int_eq(pwar_nack_tracker_arrived(&tracker, 10, 0, 1800 * US), 0);
+    ck_assert_int_eq(pwar_nack_tracker_arrived(&tracker, 10, 1, 1800 * US), 1);
+    ck_assert_uint_eq(tracker.rtt_ns, 300 * US);
+    ck_assert_uint_eq(tracker.recovered, 1);
+    // Answered already
+    ck_assert_int_eq(pwar_nack_tracker_arrived(&tracker, 10, 1, 1900 * US), 0);
+
+    // 250 us left is less than the RTT, 1250 us is enough
+    ck_assert_int_eq(pwar_nack_tracker_request(&tracker, 20, 0x1, 7, 5250 * US, 1000 * US, 5000 * US, &nack), 0);
+    ck_assert_int_eq(pwar_nack_tracker_request(&tracker, 20, 0x2, 7, 5250 * US, 1000 * US, 5000 * US, &nack), 1);
+    ck_assert_uint_eq(tracker.nacks, 2);
+    ck_assert_uint_eq(tracker.asked, 2);
+    ck_assert_uint_eq(tracker.too_late, 2);
+
+    // Later answers only move the RTT a little
+    pwar_nack_tracker_arrived(&tracker, 20, 1, 5000 * US + 1100 * US);
+    ck_assert_uint_eq(tracker.rtt_ns, 400 * US);
+
+    // A restarted sequence forgets what was asked but not the RTT
+    pwar_nack_tracker_request(&tracker, 30, 0x1, 7, 9000 * US, 1000 * US, 6000 * US, &nack);
+    pwar_nack_tracker_reset(&tracker);
+    ck_assert_int_eq(pwar_nack_tracker_arrived(&tracker, 30, 0, 6500 * US), 0);
+    ck_assert_uint_eq(tracker.rtt_ns, 400 * US);
+}
+END_TEST
+
+// Test: A seeded RTT holds back hopeless NACKs, the first answer replaces it
+START_TEST(test_tracker_seeded_rtt)
+{
+    pwar_nack_tracker_t tracker;
+    pwar_nack_msg_t nack;
+    pwar_nack_tracker_init(&tracker);
+    pwar_nack_tracker_seed_rtt(&tracker, 2000 * US);
+    ck_assert_uint_eq(tracker.rtt_ns, 2000 * US);
+
+    // 1500 us left is less than the seeded RTT, 2500 us is enough
+    ck_assert_int_eq(pwar_nack_tracker_request(&tracker, 10, 0x1, 7, 1600 * US, 1000 * US, 100 * US, &nack), 0);
+    ck_assert_int_eq(pwar_nack_tracker_request(&tracker, 10, 0x2, 7, 1600 * US, 1000 * US, 100 * US, &nack), 1);
+
+    // Measured, not smoothed towards
+    pwar_nack_tracker_arrived(&tracker, 10, 1, 400 * US);
+    ck_assert_uint_eq(tracker.rtt_ns, 300 * US);
+    ck_assert_uint_eq(tracker.rtt_seeded, 0);
+
+    // A measured RTT is not overwritten by a seed
+    pwar_nack_tracker_seed_rtt(&tracker, 2000 * US);
+    ck_assert_uint_eq(tracker.rtt_ns, 300 * US);
+}
+END_TEST
+
+Suite *retransmit_suite(void) {
+    Suite *s = suite_create("pwar_retransmit");
+    TCase *tc_core = tcase_create("Core");
+    tcase_add_test(tc_core, test_router_take_missing);
+    tcase_add_test(tc_core, test_ring_store_find);
+    tcase_add_test(tc_core, test_ring_answer);
+    tcase_add_test(tc_core, test_tracker_deadline_and_rtt);
+    tcase_add_test(tc_core, test_tracker_seeded_rtt);
+    suite_add_tcase(s, tc_core);
+    return s;
+}
+
+int main(void) {
+    int number_failed;
+    Suite *s = retransmit_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+#include <check.h>
+#include <string.h>
+#include "../pwar_router.h"
+
+// Test: Quanta are split into the largest equal segments that fit a packet
+START_TEST(test_segment_size)
+{
+    ck_assert_uint_eq(pwar_router_segment_size(64), 64);
+    ck_assert_uint_eq(pwar_router_segment_size(128), 128);
+    ck_assert_uint_eq(pwar_router_segment_size(256), 128);
+    ck_assert_uint_eq(pwar_router_segment_size(1024), 128);
+    ck_assert_uint_eq(pwar_router_segment_size(192), 96);
+    ck_assert_uint_eq(pwar_router_segment_size(384), 128);
+    ck_assert_uint_eq(pwar_router_segment_size(4096), 128);
+    ck_assert_uint_eq(pwar_router_segment_size(0), 0);
+    ck_assert_uint_eq(pwar_router_segment_size(8192), 0);
+}
+END_TEST
+
+// One oneshot cycle the way Linux sends it
+static uint32_t send_cycle(pwar_packet_t *packets, uint64_t first_seq, uint32_t n_samples) {
+    uint32_t segment = pwar_router_segment_size(n_samples);
+    uint32_t segments = n_samples / segment;
+    for (uint32_t i = 0; i < segments; ++i) {
+        memset(&packets[i], 0, sizeof(packets[i]));
+        packets[i].seq = first_seq;
+        packets[i].packet_index = i;
+        packets[i].num_packets = segments;
+        packets[i].n_samples = segment;
+        for (uint32_t s = 0; s < segment; ++s) packets[i].samples[0][s] = (float)(first_seq * 10000 + i * segment + s);
+    }
+    return segments;
+}
+
+// Test: A segmented quantum is reassembled on the remote and its segmented answer on Linux
+START_TEST(test_segmented_round_trip)
+{
+    static pwar_router_t remote, linux_side;
+    static float block[2 * 512], answer[2 * 512];
+    pwar_packet_t packets[8], returns[8];
+    pwar_router_init(&remote, 2);
+    pwar_router_init(&linux_side, 2);
+
+    for (uint64_t cycle = 0; cycle < 3; ++cycle) {
+        uint64_t first_seq = cycle * 4;
+        uint32_t segments = send_cycle(packets, first_seq, 512);
+        ck_assert_uint_eq(segments, 4);
+        int ready = 0;
+        // Out of order on the way
+        uint32_t order[4] = { 1, 0, 3, 2 };
+        for (uint32_t i = 0; i < segments; ++i) {
+            ck_assert_int_eq(ready, 0);
+            pwar_packet_t pkt = packets[order[i]];
+            pkt.num_packets = 512 / 128; // What the remote sets from its own block size
+            ready = pwar_router_process_streaming_packet(&remote, &pkt, block, 512, 2);
+        }
+        ck_assert_int_eq(ready, 512);
+        ck_assert_uint_eq(remote.current_seq, first_seq);
+        ck_assert_float_eq(block[0], (float)(first_seq * 10000));
+        ck_assert_float_eq(block[511], (float)(first_seq * 10000 + 511));
+
+        uint32_t to_send = 0;
+        pwar_router_send_buffer(&remote, 128, block, 512, 2, returns, 8, &to_send);
+        ck_assert_uint_eq(to_send, 4);
+        ready = 0;
+        for (uint32_t i = 0; i < to_send; ++i) {
+            returns[i].seq = remote.current_seq;
+            ready = pwar_router_process_packet(&linux_side, &returns[i], answer, 512, 2);
+        }
+        ck_assert_int_eq(ready, 512);
+        ck_assert_uint_eq(linux_side.current_seq, first_seq);
+        ck_assert_float_eq(answer[300], (float)(first_seq * 10000 + 300));
+    }
+    ck_assert_uint_eq(remote.blocks_incomplete, 0);
+}
+END_TEST
+
+// Test: Chunks sent one per sequence still group from the first one, as they did before
+START_TEST(test_streaming_chunks)
+{
+    static pwar_router_t remote;
+    static float block[2 * 256];
+    pwar_packet_t pkt;
+    pwar_router_init(&remote, 2);
+    int ready = 0;
+    for (uint64_t seq = 0; seq < 4; ++seq) {
+        memset(&pkt, 0, sizeof(pkt));
+        pkt.seq = seq;
+        pkt.num_packets = 2;
+        pkt.n_samples = 128;
+        pkt.samples[0][0] = (float)seq;
+        ready = pwar_router_process_streaming_packet(&remote, &pkt, block, 256, 2);
+        if (seq % 2 == 1) {
+            ck_assert_int_eq(ready, 256);
+            ck_assert_uint_eq(remote.current_seq, seq - 1);
+            ck_assert_float_eq(block[128], (float)seq);
+        } else {
+            ck_assert_int_eq(ready, 0);
+        }
+    }
+}
+END_TEST
+
+// Test: The leading segments of a block are usable before the rest arrive
+START_TEST(test_ready_prefix)
+{
+    static pwar_router_t router;
+    static float out[2 * 512];
+    pwar_packet_t packets[4];
+    pwar_router_init(&router, 2);
+    ck_assert_uint_eq(pwar_router_ready_samples(&router), 0);
+    send_cycle(packets, 40, 512);
+
+    ck_assert_int_eq(pwar_router_process_packet(&router, &packets[1], out, 512, 2), 0);
+    ck_assert_uint_eq(pwar_router_ready_samples(&router), 0);
+    ck_assert_int_eq(pwar_router_process_packet(&router, &packets[0], out, 512, 2), 0);
+    ck_assert_uint_eq(pwar_router_ready_samples(&router), 256);
+    ck_assert_float_eq(router.buffers[0][255], 400255.0f);
+    ck_assert_int_eq(pwar_router_process_packet(&router, &packets[3], out, 512, 2), 0);
+    ck_assert_uint_eq(pwar_router_ready_samples(&router), 256);
+    ck_assert_int_eq(pwar_router_process_packet(&router, &packets[2], out, 512, 2), 512);
+    ck_assert_uint_eq(pwar_router_ready_samples(&router), 512);
+
+    // The next block starts over
+    send_cycle(packets, 44, 512);
+    pwar_router_process_packet(&router, &packets[2], out, 512, 2);
+    ck_assert_uint_eq(pwar_router_ready_samples(&router), 0);
+}
+END_TEST
+
+Suite *segment_suite(void) {
+    Suite *s = suite_create("pwar_segment");
+    TCase *tc_core = tcase_create("Core");
+    tcase_add_test(tc_core, test_segment_size);
+    tcase_add_test(tc_core, test_segmented_round_trip);
+    tcase_add_test(tc_core, test_streaming_chunks);
+    tcase_add_test(tc_core, test_ready_prefix);
+    suite_add_tcase(s, tc_core);
+    return s;
+}
+
+int main(void) {
+    int number_failed;
+    Suite *s = segment_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,317 @@
+#include <check.h>
+#include <string.h>
+#include <stdio.h>
+#include "../pwar_session.h"
+
+#define MS 1000000ULL
+
+static pwar_session_t linux_side;
+static pwar_session_t remote_side;
+
+static void setup_sessions(uint32_t linux_block, uint32_t remote_block, uint32_t remote_rate) {
+    pwar_session_params_t local;
+    memset(&local, 0, sizeof(local));
+    local.sample_rate = 48000;
+    local.linux_block_size = linux_block;
+    local.send_channels = 2;
+    local.return_channels = 2;
+    local.sample_formats = PWAR_SAMPLE_FORMAT_F32 | PWAR_SAMPLE_FORMAT_S16;
+    local.features = PWAR_FEATURE_COMPRESSION | PWAR_FEATURE_FEC;
+    pwar_session_init(&linux_side, PWAR_SESSION_ROLE_INITIATOR, &local);
+
+    memset(&local, 0, sizeof(local));
+    local.sample_rate = remote_rate;
+    local.remote_block_size = remote_block;
+    local.send_channels = 1;
+    local.return_channels = 2;
+    local.sample_formats = PWAR_SAMPLE_FORMAT_F32;
+    local.features = PWAR_FEATURE_FEC;
+    pwar_session_init(&remote_side, PWAR_SESSION_ROLE_RESPONDER, &local);
+}
+
+// Runs HELLO -> ACCEPT -> ACK starting from the given HELLO
+static void complete_handshake(const pwar_session_msg_t *hello, uint64_t now) {
+    pwar_session_msg_t accept, ack;
+    ck_assert_int_eq(pwar_session_handle_message(&remote_side, hello, now, &accept), 1);
+    ck_assert_int_eq(accept.type, PWAR_SESSION_MSG_ACCEPT);
+    ck_assert_int_eq(pwar_session_handle_message(&linux_side, &accept, now, &ack), 1);
+    ck_assert_int_eq(ack.type, PWAR_SESSION_MSG_ACK);
+    ck_assert_int_eq(pwar_session_handle_message(&remote_side, &ack, now, &accept), 0);
+}
+
+// Test: A full handshake negotiates the common parameters and only then lets audio flow
+START_TEST(test_session_handshake)
+{
+    pwar_session_msg_t hello, accept, ack;
+    setup_sessions(64, 256, 48000);
+
+    pwar_session_start(&linux_side, 0x1234, 0, &hello);
+    ck_assert_int_eq(hello.type, PWAR_SESSION_MSG_HELLO);
+    ck_assert(pwar_session_is_message(&hello, sizeof(hello)));
+    ck_assert_int_eq(pwar_session_audio_allowed(&linux_side), 0);
+
+    ck_assert_int_eq(pwar_session_handle_message(&remote_side, &hello, 1 * MS, &accept), 1);
+    ck_assert_int_eq(accept.type, PWAR_SESSION_MSG_ACCEPT);
+    ck_assert_int_eq(pwar_session_audio_allowed(&remote_side), 0);
+
+    ck_assert_int_eq(pwar_session_handle_message(&linux_side, &accept, 2 * MS, &ack), 1);
+    ck_assert_int_eq(ack.type, PWAR_SESSION_MSG_ACK);
+    ck_assert_int_eq(pwar_session_audio_allowed(&linux_side), 1);
+
+    pwar_session_handle_message(&remote_side, &ack, 3 * MS, &accept);
+    ck_assert_int_eq(pwar_session_audio_allowed(&remote_side), 1);
+
+    const pwar_session_params_t *n = &linux_side.negotiated;
+    ck_assert_uint_eq(n->sample_rate, 48000);
+    ck_assert_uint_eq(n->linux_block_size, 64);
+    ck_assert_uint_eq(n->remote_block_size, 256);
+    ck_assert_uint_eq(n->send_channels, 1);
+    ck_assert_uint_eq(n->return_channels, 2);
+    ck_assert_uint_eq(n->sample_formats, PWAR_SAMPLE_FORMAT_F32);
+    ck_assert_uint_eq(n->features, PWAR_FEATURE_FEC);
+    ck_assert_uint_eq(remote_side.session_id, 0x1234);
+}
+END_TEST
+
+// Test: Parameters the remote cannot run with are rejected with a reason
+START_TEST(test_session_reject)
+{
+    pwar_session_msg_t hello, reply, none;
+
+    setup_sessions(64, 256, 44100);
+    pwar_session_start(&linux_side, 1, 0, &hello);
+    ck_assert_int_eq(pwar_session_handle_message(&remote_side, &hello, 0, &reply), 1);
+    ck_assert_int_eq(reply.type, PWAR_SESSION_MSG_REJECT);
+    ck_assert_uint_eq(reply.reject_reason, PWAR_SESSION_REJECT_SAMPLE_RATE);
+    ck_assert_int_eq(pwar_session_handle_message(&linux_side, &reply, 0, &none), 0);
+    ck_assert_uint_eq(linux_side.state, PWAR_SESSION_STATE_REJECTED);
+    ck_assert_int_eq(pwar_session_audio_allowed(&linux_side), 0);
+
+    // The remote block must be built from whole Linux packets
+    setup_sessions(128, 192, 48000);
+    pwar_session_start(&linux_side, 2, 0, &hello);
+    pwar_session_handle_message(&remote_side, &hello, 0, &reply);
+    ck_assert_int_eq(reply.type, PWAR_SESSION_MSG_REJECT);
+    ck_assert_uint_eq(reply.reject_reason, PWAR_SESSION_REJECT_BLOCK_SIZE);
+}
+END_TEST
+
+// Test: Half-duplex sessions leave one direction out, receive-only needs a remote on its own clock
+START_TEST(test_session_half_duplex)
+{
+    pwar_session_msg_t hello, reply;
+
+    // Send-only, nothing comes back
+    setup_sessions(128, 256, 48000);
+    linux_side.local.return_channels = 0;
+    pwar_session_start(&linux_side, 1, 0, &hello);
+    complete_handshake(&hello, 0);
+    ck_assert_uint_eq(remote_side.negotiated.send_channels, 1);
+    ck_assert_uint_eq(remote_side.negotiated.return_channels, 0);
+    ck_assert_uint_eq(linux_side.negotiated.return_channels, 0);
+    ck_assert_int_eq(pwar_session_audio_allowed(&linux_side), 1);
+
+    // Receive-only from a remote that only answers input
+    setup_sessions(128, 256, 48000);
+    linux_side.local.send_channels = 0;
+    linux_side.local.features |= PWAR_FEATURE_CLOCK_MASTER;
+    pwar_session_start(&linux_side, 2, 0, &hello);
+    pwar_session_handle_message(&remote_side, &hello, 0, &reply);
+    ck_assert_int_eq(reply.type, PWAR_SESSION_MSG_REJECT);
+    ck_assert_uint_eq(reply.reject_reason, PWAR_SESSION_REJECT_CLOCK);
+
+    // Receive-only from a remote that runs on its own clock
+    setup_sessions(128, 256, 48000);
+    linux_side.local.send_channels = 0;
+    linux_side.local.features |= PWAR_FEATURE_CLOCK_MASTER;
+    remote_side.local.features |= PWAR_FEATURE_CLOCK_MASTER;
+    pwar_session_start(&linux_side, 3, 0, &hello);
+    complete_handshake(&hello, 0);
+    ck_assert_uint_eq(linux_side.negotiated.send_channels, 0);
+    ck_assert_uint_eq(linux_side.negotiated.return_channels, 2);
+    ck_assert_uint_eq(linux_side.negotiated.features & PWAR_FEATURE_CLOCK_MASTER, PWAR_FEATURE_CLOCK_MASTER);
+
+    // Neither direction
+    setup_sessions(128, 256, 48000);
+    linux_side.local.send_channels = 0;
+    linux_side.local.return_channels = 0;
+    pwar_session_start(&linux_side, 4, 0, &hello);
+    pwar_session_handle_message(&remote_side, &hello, 0, &reply);
+    ck_assert_int_eq(reply.type, PWAR_SESSION_MSG_REJECT);
+    ck_assert_uint_eq(reply.reject_reason, PWAR_SESSION_REJECT_CHANNELS);
+}
+END_TEST
+
+// Test: Lost messages are resent, a lost ACK is recovered by the resent ACCEPT
+START_TEST(test_session_retries)
+{
+    pwar_session_msg_t hello, accept, retry, ack;
+    setup_sessions(64, 256, 48000);
+
+    pwar_session_start(&linux_side, 7, 0, &hello);
+    ck_assert_int_eq(pwar_session_poll(&linux_side, 100 * MS, &retry), 0);
+    ck_assert_int_eq(pwar_session_poll(&linux_side, 300 * MS, &retry), 1);
+    ck_assert_int_eq(retry.type, PWAR_SESSION_MSG_HELLO);
+
+    pwar_session_handle_message(&remote_side, &retry, 300 * MS, &accept);
+    pwar_session_handle_message(&linux_side, &accept, 301 * MS, &ack);
+    // ACK lost, the remote resends ACCEPT and Linux acknowledges again
+    ck_assert_int_eq(pwar_session_poll(&remote_side, 600 * MS, &retry), 1);
+    ck_assert_int_eq(retry.type, PWAR_SESSION_MSG_ACCEPT);
+    ck_assert_int_eq(pwar_session_handle_message(&linux_side, &retry, 600 * MS, &ack), 1);
+    ck_assert_int_eq(ack.type, PWAR_SESSION_MSG_ACK);
+    pwar_session_handle_message(&remote_side, &ack, 601 * MS, &retry);
+    ck_assert_int_eq(pwar_session_audio_allowed(&remote_side), 1);
+}
+END_TEST
+
+// Test: A remote that never answers is treated as a legacy peer without options
+START_TEST(test_session_legacy_peer)
+{
+    pwar_session_msg_t hello, retry;
+    setup_sessions(64, 256, 48000);
+
+    pwar_session_start(&linux_side, 9, 0, &hello);
+    pwar_session_poll(&linux_side, 1000 * MS, &retry);
+    ck_assert_int_eq(pwar_session_audio_allowed(&linux_side), 0);
+    pwar_session_poll(&linux_side, 2100 * MS, &retry);
+    ck_assert_uint_eq(linux_side.state, PWAR_SESSION_STATE_LEGACY);
+    ck_assert_int_eq(pwar_session_audio_allowed(&linux_side), 1);
+    ck_assert_uint_eq(linux_side.negotiated.features, 0);
+}
+END_TEST
+
+// Test: Either side can renegotiate, audio is held until the new generation is acknowledged
+START_TEST(test_session_renegotiation)
+{
+    pwar_session_msg_t hello, request, none;
+    setup_sessions(64, 256, 48000);
+    pwar_session_start(&linux_side, 11, 0, &hello);
+    complete_handshake(&hello, 0);
+
+    // Remote host switched to 512 frames
+    pwar_session_params_t remote_local = remote_side.local;
+    remote_local.remote_block_size = 512;
+    ck_assert_int_eq(pwar_session_request_renegotiation(&remote_side, &remote_local, 10 * MS, &request), 1);
+    ck_assert_int_eq(request.type, PWAR_SESSION_MSG_RENEGOTIATE);
+    ck_assert_int_eq(pwar_session_audio_allowed(&remote_side), 0);
+
+    ck_assert_int_eq(pwar_session_handle_message(&linux_side, &request, 11 * MS, &hello), 1);
+    ck_assert_int_eq(hello.type, PWAR_SESSION_MSG_HELLO);
+    ck_assert_uint_eq(hello.generation, 1);
+    ck_assert_int_eq(pwar_session_audio_allowed(&linux_side), 0);
+    // A resent request for the same change does not start yet another round
+    ck_assert_int_eq(pwar_session_handle_message(&linux_side, &request, 12 * MS, &none), 0);
+
+    complete_handshake(&hello, 13 * MS);
+    ck_assert_int_eq(pwar_session_audio_allowed(&linux_side), 1);
+    ck_assert_int_eq(pwar_session_audio_allowed(&remote_side), 1);
+    ck_assert_uint_eq(linux_side.negotiated.remote_block_size, 512);
+
+    // Linux quantum change
+    pwar_session_params_t linux_local = linux_side.local;
+    linux_local.linux_block_size = 128;
+    pwar_session_renegotiate(&linux_side, &linux_local, 20 * MS, &hello);
+    ck_assert_uint_eq(hello.generation, 2);
+    complete_handshake(&hello, 21 * MS);
+    ck_assert_uint_eq(remote_side.negotiated.linux_block_size, 128);
+    ck_assert_uint_eq(remote_side.generation, 2);
+}
+END_TEST
+
+// Test: Keepalives flow while established, silence past the timeout loses the peer and a reply resumes
+START_TEST(test_session_peer_loss_and_resume)
+{
+    pwar_session_msg_t hello, out;
+    setup_sessions(64, 256, 48000);
+    pwar_session_start(&linux_side, 21, 0, &hello);
+    complete_handshake(&hello, 0);
+
+    ck_assert_int_eq(pwar_session_poll(&linux_side, 200 * MS, &out), 1);
+    ck_assert_int_eq(out.type, PWAR_SESSION_MSG_KEEPALIVE);
+    ck_assert_int_eq(pwar_session_handle_message(&remote_side, &out, 200 * MS, &out), 0);
+
+    // Audio keeps the peer alive on its own
+    pwar_session_note_traffic(&linux_side, 400 * MS);
+    pwar_session_poll(&linux_side, 800 * MS, &out);
+    ck_assert_int_eq(pwar_session_audio_allowed(&linux_side), 1);
+
+    // Nothing more from the remote
+    ck_assert_int_eq(pwar_session_poll(&linux_side, 1000 * MS, &hello), 1);
+    ck_assert_uint_eq(linux_side.state, PWAR_SESSION_STATE_PEER_LOST);
+    ck_assert_int_eq(pwar_session_audio_allowed(&linux_side), 0);
+    ck_assert_int_eq(hello.type, PWAR_SESSION_MSG_HELLO);
+    ck_assert_uint_eq(hello.generation, 1);
+    ck_assert_int_eq(pwar_session_poll(&linux_side, 1002 * MS, &out), 0);
+    ck_assert_int_eq(pwar_session_poll(&linux_side, 1006 * MS, &out), 1);
+    ck_assert_int_eq(out.type, PWAR_SESSION_MSG_HELLO);
+
+    // The remote lost Linux as well, then the network comes back
+    pwar_session_poll(&remote_side, 1000 * MS, &out);
+    ck_assert_uint_eq(remote_side.state, PWAR_SESSION_STATE_PEER_LOST);
+    complete_handshake(&hello, 1010 * MS);
+    ck_assert_int_eq(pwar_session_audio_allowed(&linux_side), 1);
+    ck_assert_int_eq(pwar_session_audio_allowed(&remote_side), 1);
+    ck_assert_uint_eq(linux_side.resumes, 1);
+    ck_assert_uint_eq(linux_side.peer_losses, 1);
+}
+END_TEST
+
+// Test: A restarted remote announces itself and the pending offer goes out immediately
+START_TEST(test_session_remote_restart)
+{
+    pwar_session_msg_t hello, out, announce;
+    setup_sessions(64, 256, 48000);
+    pwar_session_start(&linux_side, 31, 0, &hello);
+    complete_handshake(&hello, 0);
+    pwar_session_poll(&linux_side, 600 * MS, &hello);
+    ck_assert_uint_eq(linux_side.state, PWAR_SESSION_STATE_PEER_LOST);
+
+    // Fresh remote process
+    pwar_session_params_t remote_local = remote_side.local;
+    pwar_session_init(&remote_side, PWAR_SESSION_ROLE_RESPONDER, &remote_local);
+    ck_assert_int_eq(pwar_session_announce(&remote_side, &announce), 1);
+    ck_assert_int_eq(pwar_session_handle_message(&linux_side, &announce, 601 * MS, &out), 1);
+    ck_assert_int_eq(out.type, PWAR_SESSION_MSG_HELLO);
+    complete_handshake(&out, 601 * MS);
+    ck_assert_int_eq(pwar_session_audio_allowed(&linux_side), 1);
+
+    // A remote that restarted faster than the timeout learns about the session from a keepalive
+    pwar_session_init(&remote_side, PWAR_SESSION_ROLE_RESPONDER, &remote_local);
+    ck_assert_int_eq(pwar_session_poll(&linux_side, 800 * MS, &out), 1);
+    ck_assert_int_eq(out.type, PWAR_SESSION_MSG_KEEPALIVE);
+    ck_assert_int_eq(pwar_session_handle_message(&remote_side, &out, 800 * MS, &announce), 1);
+    ck_assert_int_eq(announce.type, PWAR_SESSION_MSG_RENEGOTIATE);
+    ck_assert_int_eq(pwar_session_handle_message(&linux_side, &announce, 801 * MS, &hello), 1);
+    ck_assert_int_eq(hello.type, PWAR_SESSION_MSG_HELLO);
+    complete_handshake(&hello, 801 * MS);
+    ck_assert_int_eq(pwar_session_audio_allowed(&remote_side), 1);
+}
+END_TEST
+
+// Test suite setup
+Suite *session_suite(void) {
+    Suite *s = suite_create("pwar_session");
+    TCase *tc_core = tcase_create("Core");
+    tcase_add_test(tc_core, test_session_handshake);
+    tcase_add_test(tc_core, test_session_reject);
+    tcase_add_test(tc_core, test_session_half_duplex);
+    tcase_add_test(tc_core, test_session_retries);
+    tcase_add_test(tc_core, test_session_legacy_peer);
+    tcase_add_test(tc_core, test_session_renegotiation);
+    tcase_add_test(tc_core, test_session_peer_loss_and_resume);
+    tcase_add_test(tc_core, test_session_remote_restart);
+    suite_add_tcase(s, tc_core);
+    return s;
+}
+
+// Main entry for running the test suite
+int main(void) {
+    int number_failed;
+    Suite *s = session_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,123 @@
+#include <check.h>
+#include <string.h>
+#include <stdio.h>
+#include "../pwar_slot_ring.h"
+
+#define CHUNK 64
+
+static pwar_slot_ring_t ring;
+
+// A returned block of num_packets chunks, chunk i holds the value seq + i everywhere
+static void return_block(uint32_t seq, uint32_t num_packets) {
+    for (uint32_t i = 0; i < num_packets; ++i) {
+        pwar_packet_t packet;
+        memset(&packet, 0, sizeof(packet));
+        packet.seq = seq;
+        packet.packet_index = i;
+        packet.num_packets = num_packets;
+        packet.n_samples = CHUNK;
+        for (uint32_t ch = 0; ch < PWAR_CHANNELS; ++ch)
+            for (uint32_t s = 0; s < CHUNK; ++s)
+                packet.samples[ch][s] = (float)(seq + i);
+        pwar_slot_ring_put(&ring, &packet);
+    }
+}
+
+START_TEST(test_slot_ring_fixed_delay) {
+    const uint32_t delay = 3;
+    float out[PWAR_CHANNELS * CHUNK];
+    pwar_slot_ring_init(&ring);
+
+    // The remote answers each chunk two cycles later, less than the delay
+    for (uint32_t cycle = 0; cycle < 50; ++cycle) {
+        if (cycle >= 2) return_block(cycle - 2, 1);
+        if (cycle < delay) continue;
+        ck_assert_int_eq(pwar_slot_ring_get(&ring, cycle - delay, out, PWAR_CHANNELS, CHUNK), 1);
+        ck_assert_float_eq(out[0], (float)(cycle - delay));
+        ck_assert_float_eq(out[CHUNK + CHUNK - 1], (float)(cycle - delay));
+    }
+    ck_assert_uint_eq(ring.missing, 0);
+    ck_assert_uint_eq(ring.late, 0);
+}
+END_TEST
+
+START_TEST(test_slot_ring_segmented_blocks) {
+    float out[PWAR_CHANNELS * CHUNK];
+    pwar_slot_ring_init(&ring);
+
+    // One remote block spans four chunks, every chunk lands in its own slot
+    return_block(0, 4);
+    return_block(4, 4);
+    for (uint32_t seq = 0; seq < 8; ++seq) {
+        ck_assert_int_eq(pwar_slot_ring_get(&ring, seq, out, PWAR_CHANNELS, CHUNK), 1);
+        ck_assert_float_eq(out[0], (float)seq);
+    }
+}
+END_TEST
+
+START_TEST(test_slot_ring_missing_and_late) {
+    float out[PWAR_CHANNELS * CHUNK];
+    pwar_slot_ring_init(&ring);
+
+    return_block(0, 1);
+    ck_assert_int_eq(pwar_slot_ring_get(&ring, 0, out, PWAR_CHANNELS, CHUNK), 1);
+    // Nothing for seq 1 yet, silence is played
+    out[0] = 1.0f;
+    ck_assert_int_eq(pwar_slot_ring_get(&ring, 1, out, PWAR_CHANNELS, CHUNK), 0);
+    ck_assert_float_eq(out[0], 0.0f);
+    ck_assert_uint_eq(ring.missing, 1);
+
+    // Its turn has passed, it must not be played later
+    return_block(1, 1);
+    ck_assert_uint_eq(ring.late, 1);
+
+    // Duplicates are ignored, far future chunks are refused
+    return_block(2, 1);
+    return_block(2, 1);
+    ck_assert_uint_eq(ring.duplicates, 1);
+    return_block(2 + PWAR_SLOT_RING_SLOTS, 1);
+    ck_assert_int_eq(pwar_slot_ring_get(&ring, 2, out, PWAR_CHANNELS, CHUNK), 1);
+    ck_assert_float_eq(out[0], 2.0f);
+}
+END_TEST
+
+START_TEST(test_slot_ring_reset) {
+    float out[PWAR_CHANNELS * CHUNK];
+    pwar_slot_ring_init(&ring);
+
+    for (uint32_t seq = 0; seq < 10; ++seq) {
+        return_block(seq, 1);
+        pwar_slot_ring_get(&ring, seq, out, PWAR_CHANNELS, CHUNK);
+    }
+    return_block(10, 1);
+    // Sequence numbers restart, old chunks must not be mistaken for new ones
+    pwar_slot_ring_reset(&ring);
+    ck_assert_int_eq(pwar_slot_ring_get(&ring, 10, out, PWAR_CHANNELS, CHUNK), 0);
+    pwar_slot_ring_reset(&ring);
+    return_block(0, 1);
+    ck_assert_int_eq(pwar_slot_ring_get(&ring, 0, out, PWAR_CHANNELS, CHUNK), 1);
+}
+END_TEST
+
+// Test suite setup
+Suite *slot_ring_suite(void) {
+    Suite *s = suite_create("pwar_slot_ring");
+    TCase *tc_core = tcase_create("Core");
+    tcase_add_test(tc_core, test_slot_ring_fixed_delay);
+    tcase_add_test(tc_core, test_slot_ring_segmented_blocks);
+    tcase_add_test(tc_core, test_slot_ring_missing_and_late);
+    tcase_add_test(tc_core, test_slot_ring_reset);
+    suite_add_tcase(s, tc_core);
+    return s;
+}
+
+// Main entry for running the test suite
+int main(void) {
+    int number_failed;
+    Suite *s = slot_ring_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? 0 : 1;
+}
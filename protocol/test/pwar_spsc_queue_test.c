@@ -0,0 +1,102 @@
+#include <check.h>
+#include <stdint.h>
+#include "../pwar_spsc_queue.h"
+
+static pwar_spsc_queue_t queue;
+static int items[PWAR_SPSC_QUEUE_CAPACITY * 4];
+
+START_TEST(test_spsc_queue_empty) {
+    pwar_spsc_queue_init(&queue);
+    ck_assert_ptr_null(pwar_spsc_queue_pop(&queue));
+    ck_assert_uint_eq(pwar_spsc_queue_size(&queue), 0);
+
+    ck_assert_int_eq(pwar_spsc_queue_push(&queue, &items[0]), 1);
+    ck_assert_uint_eq(pwar_spsc_queue_size(&queue), 1);
+    ck_assert_ptr_eq(pwar_spsc_queue_pop(&queue), &items[0]);
+    // Drained again
+    ck_assert_ptr_null(pwar_spsc_queue_pop(&queue));
+    ck_assert_uint_eq(pwar_spsc_queue_size(&queue), 0);
+}
+END_TEST
+
+START_TEST(test_spsc_queue_full) {
+    pwar_spsc_queue_init(&queue);
+    for (int i = 0; i < PWAR_SPSC_QUEUE_CAPACITY; ++i) {
+        ck_assert_int_eq(pwar_spsc_queue_push(&queue, &items[i]), 1);
+    }
+    ck_assert_uint_eq(pwar_spsc_queue_size(&queue), PWAR_SPSC_QUEUE_CAPACITY);
+    // A full queue refuses without overwriting the oldest item
+    ck_assert_int_eq(pwar_spsc_queue_push(&queue, &items[PWAR_SPSC_QUEUE_CAPACITY]), 0);
+    ck_assert_uint_eq(pwar_spsc_queue_size(&queue), PWAR_SPSC_QUEUE_CAPACITY);
+    ck_assert_ptr_eq(pwar_spsc_queue_pop(&queue), &items[0]);
+    // One slot free again
+    ck_assert_int_eq(pwar_spsc_queue_push(&queue, &items[PWAR_SPSC_QUEUE_CAPACITY]), 1);
+    for (int i = 1; i <= PWAR_SPSC_QUEUE_CAPACITY; ++i) {
+        ck_assert_ptr_eq(pwar_spsc_queue_pop(&queue), &items[i]);
+    }
+    ck_assert_ptr_null(pwar_spsc_queue_pop(&queue));
+}
+END_TEST
+
+START_TEST(test_spsc_queue_wrap) {
+    pwar_spsc_queue_init(&queue);
+    // Several times around the ring, with the fill level changing as it goes
+    int next_push = 0, next_pop = 0;
+    for (int round = 0; round < PWAR_SPSC_QUEUE_CAPACITY * 4; ++round) {
+        int n = 1 + round % 3;
+        for (int i = 0; i < n && pwar_spsc_queue_size(&queue) < PWAR_SPSC_QUEUE_CAPACITY; ++i) {
+            ck_assert_int_eq(pwar_spsc_queue_push(&queue, &items[next_push % (PWAR_SPSC_QUEUE_CAPACITY * 4)]), 1);
+            next_push++;
+        }
+        for (int i = 0; i < 2 && next_pop < next_push; ++i) {
+            ck_assert_ptr_eq(pwar_spsc_queue_pop(&queue), &items[next_pop % (PWAR_SPSC_QUEUE_CAPACITY * 4)]);
+            next_pop++;
+        }
+    }
+    ck_assert_uint_eq(pwar_spsc_queue_size(&queue), (uint32_t)(next_push - next_pop));
+    while (next_pop < next_push) {
+        ck_assert_ptr_eq(pwar_spsc_queue_pop(&queue), &items[next_pop % (PWAR_SPSC_QUEUE_CAPACITY * 4)]);
+        next_pop++;
+    }
+    ck_assert_ptr_null(pwar_spsc_queue_pop(&queue));
+}
+END_TEST
+
+START_TEST(test_spsc_queue_index_overflow) {
+    pwar_spsc_queue_init(&queue);
+    // The free-running indices wrap around 2^32 without the queue noticing
+    queue.head = queue.tail = UINT32_MAX - 2;
+    for (int i = 0; i < PWAR_SPSC_QUEUE_CAPACITY; ++i) {
+        ck_assert_int_eq(pwar_spsc_queue_push(&queue, &items[i]), 1);
+    }
+    ck_assert_int_eq(pwar_spsc_queue_push(&queue, &items[PWAR_SPSC_QUEUE_CAPACITY]), 0);
+    ck_assert_uint_eq(pwar_spsc_queue_size(&queue), PWAR_SPSC_QUEUE_CAPACITY);
+    for (int i = 0; i < PWAR_SPSC_QUEUE_CAPACITY; ++i) {
+        ck_assert_ptr_eq(pwar_spsc_queue_pop(&queue), &items[i]);
+    }
+    ck_assert_ptr_null(pwar_spsc_queue_pop(&queue));
+}
+END_TEST
+
+// Test suite setup
+Suite *spsc_queue_suite(void) {
+    Suite *s = suite_create("pwar_spsc_queue");
+    TCase *tc_core = tcase_create("Core");
+    tcase_add_test(tc_core, test_spsc_queue_empty);
+    tcase_add_test(tc_core, test_spsc_queue_full);
+    tcase_add_test(tc_core, test_spsc_queue_wrap);
+    tcase_add_test(tc_core, test_spsc_queue_index_overflow);
+    suite_add_tcase(s, tc_core);
+    return s;
+}
+
+// Main entry for running the test suite
+int main(void) {
+    int number_failed;
+    Suite *s = spsc_queue_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? 0 : 1;
+}
@@ -22,6 +22,7 @@
 
 #include "../../protocol/pwar_packet.h"
 #include "../../protocol/pwar_router.h"
+#include "../../protocol/pwar_channel_map.h"
 #include "../../protocol/latency_manager.h"
 
 #include <avrt.h>
@@ -119,11 +120,19 @@ pwarASIO::pwarASIO(LPUNKNOWN pUnk, HRESULT* phr)
     // Initialize internal buffers to null
     input_buffers = nullptr;
     output_buffers = nullptr;
+    for (long i = 0; i < kNumClientBlocks; ++i) {
+        clientBlocks[i].samples = nullptr;
+    }
+    pwar_spsc_queue_init(&freeBlocks);
+    pwar_spsc_queue_init(&readyBlocks);
+    blockReadyEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
     
     callbacks = nullptr;
     strcpy(errorMessage, "No error");
     
     parseConfigFile();
+    pwar_pacer_init(&pacer, paceBurst, paceSpread);
+    pwar_retransmit_init(&retransmitRing);
     initUdpSender();
     startUdpListener();
 }
@@ -133,6 +142,10 @@ pwarASIO::~pwarASIO() {
     stopUdpListener();
     stop();
     disposeBuffers();
+    if (blockReadyEvent) {
+        CloseHandle(blockReadyEvent);
+        blockReadyEvent = nullptr;
+    }
 }
 
 void pwarASIO::getDriverName(char* name) {
@@ -371,11 +384,25 @@ error:
         return ASE_NoMemory;
     }
     this->callbacks = callbacks;
+    // Only parked after a disposeBuffers, unless the host skipped it
+    parkListener();
     // Initialize the router with the number of output channels
     pwar_router_init(&router, PWAR_MAX_CHANNELS);
     input_buffers = new float[PWAR_MAX_CHANNELS * blockFrames];
     output_buffers = new float[PWAR_MAX_CHANNELS * blockFrames];
 
+    // Blocks handed between the network thread and the audio thread
+    pwar_spsc_queue_init(&freeBlocks);
+    pwar_spsc_queue_init(&readyBlocks);
+    for (long i = 0; i < kNumClientBlocks; ++i) {
+        clientBlocks[i].samples = new float[PWAR_MAX_CHANNELS * blockFrames];
+        pwar_spsc_queue_push(&freeBlocks, &clientBlocks[i]);
+    }
+    InterlockedIncrement(&sessionParamsChanged);
+    audioThreadRunning = true;
+    audioThread = std::thread(&pwarASIO::audio_processing_thread, this);
+    unparkListener();
+
     if (callbacks->asioMessage(kAsioSupportsTimeInfo, 0, 0, 0)) {
         timeInfoMode = true;
         asioTime.timeInfo.speed = 1.0;
@@ -396,6 +423,15 @@ ASIOError pwarASIO::disposeBuffers() {
     // Stop audio processing first
     stop();
     
+    // Stop the audio thread before any buffer it touches goes away
+    audioThreadRunning = false;
+    if (blockReadyEvent) SetEvent(blockReadyEvent);
+    if (audioThread.joinable()) {
+        audioThread.join();
+    }
+    // Neither thread is left on the queues, they can be reset from here
+    parkListener();
+
     // Clear callbacks to prevent any more audio callbacks
     callbacks = nullptr;
     
@@ -426,6 +462,12 @@ ASIOError pwarASIO::disposeBuffers() {
         delete[] output_buffers;
         output_buffers = nullptr;
     }
+    pwar_spsc_queue_init(&freeBlocks);
+    pwar_spsc_queue_init(&readyBlocks);
+    for (long i = 0; i < kNumClientBlocks; ++i) {
+        delete[] clientBlocks[i].samples;
+        clientBlocks[i].samples = nullptr;
+    }
     
     return ASE_OK;
 }
@@ -464,6 +506,16 @@ ASIOError pwarASIO::future(long selector, void* opt) {
 }
 
 void pwarASIO::output(const pwar_packet_t& packet) {
+    // Kept until Linux had its chance to ask for it again
+    pwar_retransmit_store(&retransmitRing, &packet);
+    sendReturn(packet);
+}
+
+void pwarASIO::resendReturn(const pwar_packet_t* packet, void* userdata) {
+    static_cast<pwarASIO*>(userdata)->sendReturn(*packet);
+}
+
+void pwarASIO::sendReturn(const pwar_packet_t& packet) {
     if (udpSendSocket != INVALID_SOCKET) {
         WSABUF buffer;
         buffer.buf = reinterpret_cast<CHAR*>(const_cast<pwar_packet_t*>(&packet));
@@ -472,9 +524,37 @@ void pwarASIO::output(const pwar_packet_t& packet) {
         int flags = 0;
         WSASendTo(udpSendSocket, &buffer, 1, &bytesSent, flags,
                   reinterpret_cast<sockaddr*>(&udpSendAddr), sizeof(udpSendAddr), NULL, NULL);
+        // Linux keeps whichever copy arrives first
+        if (redundantSocket != INVALID_SOCKET) {
+            WSASendTo(redundantSocket, &buffer, 1, &bytesSent, flags,
+                      reinterpret_cast<sockaddr*>(&redundantAddr), sizeof(redundantAddr), NULL, NULL);
+        }
     }
 }
 
+void pwarASIO::sendSessionMessage(const pwar_session_msg_t& msg) {
+    if (udpSendSocket != INVALID_SOCKET) {
+        WSABUF buffer;
+        buffer.buf = reinterpret_cast<CHAR*>(const_cast<pwar_session_msg_t*>(&msg));
+        buffer.len = sizeof(pwar_session_msg_t);
+        DWORD bytesSent = 0;
+        WSASendTo(udpSendSocket, &buffer, 1, &bytesSent, 0,
+                  reinterpret_cast<sockaddr*>(&udpSendAddr), sizeof(udpSendAddr), NULL, NULL);
+    }
+}
+
+pwar_session_params_t pwarASIO::sessionLocalParams() const {
+    pwar_session_params_t local;
+    memset(&local, 0, sizeof(local));
+    local.sample_rate = static_cast<uint32_t>(sampleRate);
+    local.remote_block_size = static_cast<uint32_t>(blockFrames);
+    local.send_channels = kNumInputs;
+    local.return_channels = kNumOutputs;
+    local.sample_formats = PWAR_SAMPLE_FORMAT_F32;
+    local.features = PWAR_FEATURE_RETRANSMIT;
+    return local;
+}
+
 void pwarASIO::bufferSwitchX() {
     getSamplePosition(&asioTime.timeInfo.samplePosition, &asioTime.timeInfo.systemTime);
     if (tcRead) {
@@ -489,6 +569,26 @@ ASIOError pwarASIO::outputReady() {
     return ASE_NotPresent;
 }
 
+void pwarASIO::udp_listener_thread() {
+    udp_packet_listener();
+    // Whoever waits for a park must not wait for a thread that is gone
+    InterlockedExchange(&listenerExited, 1);
+}
+
+// Only the host's thread parks and unparks, the network thread only acknowledges
+void pwarASIO::parkListener() {
+    InterlockedCompareExchange(&listenerState, kListenerParkRequested, kListenerRunning);
+    // The listener wakes at least every receive timeout, 100 ms
+    while (InterlockedCompareExchange(&listenerState, 0, 0) != kListenerParked &&
+           !InterlockedCompareExchange(&listenerExited, 0, 0) && udpListenerThread.joinable()) {
+        Sleep(1);
+    }
+}
+
+void pwarASIO::unparkListener() {
+    InterlockedExchange(&listenerState, kListenerRunning);
+}
+
 void pwarASIO::udp_packet_listener() {
     WSADATA wsaData;
     SOCKET sockfd;
@@ -541,9 +641,25 @@ void pwarASIO::udp_packet_listener() {
         WSACleanup();
         return;
     }
+    // Wake up regularly so session retries and stop requests are handled without traffic
+    DWORD recvTimeoutMs = 100;
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, (const char*)&recvTimeoutMs, sizeof(recvTimeoutMs));
+
+    pwar_session_params_t local = sessionLocalParams();
+    pwar_session_init(&session, PWAR_SESSION_ROLE_RESPONDER, &local);
+    long sessionParamsSeen = sessionParamsChanged;
+    pwar_paths_init(&paths, redundantSocket != INVALID_SOCKET ? 2 : 1);
+    uint32_t streamSessionId = 0;
+    uint32_t streamGeneration = 0;
+
+    // Let a running Linux side know we (re)started so it resumes right away
+    pwar_session_msg_t announce;
+    if (pwar_session_announce(&session, &announce)) {
+        sendSessionMessage(announce);
+    }
+
     udpListenerRunning = true;
-    pwar_packet_t output_packets[32];
-    uint32_t packets_to_send = 0;
+    pwarClientBlock* block = nullptr;
     while (udpListenerRunning) {
         len = sizeof(cliaddr);
         WSABUF wsaBuf;
@@ -552,74 +668,95 @@ void pwarASIO::udp_packet_listener() {
         DWORD bytesReceived = 0;
         DWORD flags = 0;
         int res = WSARecvFrom(sockfd, &wsaBuf, 1, &bytesReceived, &flags, reinterpret_cast<sockaddr*>(&cliaddr), &len, NULL, NULL);
-        if (res == 0 && bytesReceived >= sizeof(pwar_packet_t)) {
+
+        pwar_session_msg_t sessionOut;
+        uint64_t now = latency_manager_timestamp_now();
+        // The buffers are changing, let go of the block and stay away from them until unparked
+        if (InterlockedCompareExchange(&listenerState, kListenerParked, kListenerParkRequested) == kListenerParkRequested) {
+            block = nullptr;
+        }
+        bool parked = InterlockedCompareExchange(&listenerState, 0, 0) != kListenerRunning;
+        if (sessionParamsSeen != sessionParamsChanged) {
+            // The host picked a new buffer size, Linux has to agree before audio continues
+            sessionParamsSeen = sessionParamsChanged;
+            local = sessionLocalParams();
+            if (pwar_session_request_renegotiation(&session, &local, now, &sessionOut)) {
+                sendSessionMessage(sessionOut);
+            }
+        }
+        if (pwar_session_poll(&session, now, &sessionOut)) {
+            sendSessionMessage(sessionOut);
+        }
+
+        if (res == 0 && pwar_session_is_message(buffer, bytesReceived)) {
+            pwar_session_msg_t msg;
+            memcpy(&msg, buffer, sizeof(msg));
+            if (pwar_session_handle_message(&session, &msg, now, &sessionOut)) {
+                sendSessionMessage(sessionOut);
+            }
+        }
+        if (session.state == PWAR_SESSION_STATE_ESTABLISHED &&
+            (session.session_id != streamSessionId || session.generation != streamGeneration)) {
+            // New stream, forget any half assembled block from before
+            streamSessionId = session.session_id;
+            streamGeneration = session.generation;
+            pwar_router_init(&router, PWAR_MAX_CHANNELS);
+            pwar_paths_reset(&paths);
+            pwarASIOLog::Send("Session established, stream state reset.");
+        }
+
+        if (res == 0 && pwar_retransmit_is_nack(buffer, bytesReceived)) {
+            pwar_nack_msg_t nack;
+            memcpy(&nack, buffer, sizeof(nack));
+            pwar_session_note_traffic(&session, now);
+            // A NACK from before a renegotiation names segments of another stream
+            if (session.state != PWAR_SESSION_STATE_ESTABLISHED || nack.generation == session.generation) {
+                pwar_retransmit_answer(&retransmitRing, &nack, &pwarASIO::resendReturn, this);
+            }
+            continue;
+        }
+
+        if (res == 0 && !pwar_session_is_message(buffer, bytesReceived) && bytesReceived >= sizeof(pwar_packet_t)) {
             pwar_packet_t pkt;
             memcpy(&pkt, buffer, sizeof(pwar_packet_t));
+            pwar_session_note_traffic(&session, now);
+            if (paths.num_paths > 1) {
+                // The copy from the other path already went to the router
+                uint32_t path = cliaddr.sin_addr.s_addr == redundantAddr.sin_addr.s_addr ? 1 : 0;
+                if (!pwar_paths_accept(&paths, path, pwar_paths_key(&pkt), now, 0)) continue;
+            }
 
             uint32_t chunk_size = pkt.n_samples;
+            // Without a session (older Linux side) the block layout is inferred from the packet
+            if (pwar_session_audio_allowed(&session)) {
+                chunk_size = session.negotiated.linux_block_size;
+            }
+            if (parked) continue;
             pkt.num_packets =  blockFrames / chunk_size;
-            latency_manager_process_packet_client(&pkt);
-
-            int samples_ready = pwar_router_process_streaming_packet(&router, &pkt, input_buffers, blockFrames, PWAR_MAX_CHANNELS);
-
-            if (started && (samples_ready > 0)) {
-                uint32_t seq = pkt.seq;
-
-                latency_manager_start_audio_cbk_begin();
-
-                // Do the ASIO things.. input in input_buffers
-                size_t to_copy = blockFrames;
-
-                for (long i = 0; i < activeInputs; ++i) {
-                    float* dest = inputBuffers[i] + (toggle ? blockFrames : 0);
-
-                    // Copy the first input channel..
-                    memcpy(dest, input_buffers, to_copy * sizeof(float));
-
-                    // Zero out the rest
-                    for (size_t j = to_copy; j < blockFrames; ++j)
-                        dest[j] = 0.0f;
-                }
-                samplePosition += blockFrames;
-
-                if (timeInfoMode) {
-                    bufferSwitchX();
-                } else {
-                    callbacks->bufferSwitch(toggle, ASIOFalse);
-                }
-
-                latency_manager_start_audio_cbk_end();
-
-                float* outputSamplesCh1 = outputBuffers[0] + (toggle ? blockFrames : 0);
-                float* outputSamplesCh2 = outputBuffers[1] + (toggle ? blockFrames : 0);
-
-                memcpy(output_buffers, outputSamplesCh1, blockFrames * sizeof(float));
-                memcpy(output_buffers + blockFrames, outputSamplesCh2, blockFrames * sizeof(float));
-
-                // Send the result
-                pwar_router_send_buffer(&router, chunk_size, output_buffers, samples_ready, PWAR_MAX_CHANNELS, output_packets, 32, &packets_to_send);
-
-                uint64_t timestamp = latency_manager_timestamp_now();
-                for (uint32_t i = 0; i < packets_to_send; ++i) {
-                    output_packets[i].seq = seq;
-                    output_packets[i].timestamp = timestamp;
-                    output(output_packets[i]);
-                }
-                toggle = toggle ? 0 : 1;
-
-                pwar_latency_info_t latency_info;
-                if (latency_manager_time_for_sending_latency_info(&latency_info)) {
-                    // Send the latency info over the socket
-                    if (udpSendSocket != INVALID_SOCKET) {
-                        WSABUF buffer;
-                        buffer.buf = reinterpret_cast<CHAR*>(&latency_info);
-                        buffer.len = sizeof(latency_info);
-                        DWORD bytesSent = 0;
-                        int flags = 0;
-                        WSASendTo(udpSendSocket, &buffer, 1, &bytesSent, flags,
-                                  reinterpret_cast<sockaddr*>(&udpSendAddr), sizeof(udpSendAddr), NULL, NULL);
-                    }
-                }
+
+            // Only keep a block while the host is running, otherwise reassemble into scratch
+            if (!block && started) {
+                block = static_cast<pwarClientBlock*>(pwar_spsc_queue_pop(&freeBlocks));
+                if (block) block->num_arrivals = 0;
+            }
+            // The audio thread owns the latency stats, the arrival goes along with the block
+            if (block && block->num_arrivals < kMaxBlockArrivals) {
+                block->arrival_ns[block->num_arrivals] = now;
+                block->packet_timestamp[block->num_arrivals] = pkt.timestamp;
+                block->num_arrivals++;
+            }
+            float* dest = block ? block->samples : input_buffers;
+            int samples_ready = pwar_router_process_streaming_packet(&router, &pkt, dest, blockFrames, PWAR_MAX_CHANNELS);
+
+            if (block && samples_ready > 0) {
+                block->seq = pkt.seq;
+                block->seq_timestamp = router.seq_timestamp;
+                block->chunk_size = chunk_size;
+                block->n_samples = samples_ready;
+                block->return_channels = pwar_session_audio_allowed(&session) ? session.negotiated.return_channels : PWAR_MAX_CHANNELS;
+                pwar_spsc_queue_push(&readyBlocks, block);
+                SetEvent(blockReadyEvent);
+                block = nullptr;
             }
         }
     }
@@ -627,10 +764,97 @@ void pwarASIO::udp_packet_listener() {
     WSACleanup();
 }
 
+void pwarASIO::audio_processing_thread() {
+    // The host callback runs here so the network thread can keep draining the socket
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+    DWORD mmcssTaskIndex = 0;
+    HANDLE mmcssHandle = AvSetMmThreadCharacteristicsA("Pro Audio", &mmcssTaskIndex);
+    if (!mmcssHandle) {
+        pwarASIOLog::Send("Warning: MMCSS registration failed for audio thread!");
+    }
+
+    while (audioThreadRunning) {
+        WaitForSingleObject(blockReadyEvent, 100);
+        pwarClientBlock* block;
+        while ((block = static_cast<pwarClientBlock*>(pwar_spsc_queue_pop(&readyBlocks))) != nullptr) {
+            if (started && callbacks) {
+                processBlock(block);
+            }
+            pwar_spsc_queue_push(&freeBlocks, block);
+        }
+    }
+
+    if (mmcssHandle) AvRevertMmThreadCharacteristics(mmcssHandle);
+}
+
+void pwarASIO::processBlock(pwarClientBlock* block) {
+    pwar_packet_t output_packets[32];
+    uint32_t packets_to_send = 0;
+
+    for (uint32_t i = 0; i < block->num_arrivals; ++i) {
+        latency_manager_process_arrival_client(block->packet_timestamp[i], block->arrival_ns[i]);
+    }
+    latency_manager_start_audio_cbk_begin();
+
+    // Do the ASIO things.. each received channel goes to its own host input
+    float* dest[kNumInputs];
+    for (long i = 0; i < activeInputs; ++i) {
+        dest[i] = inputBuffers[i] + (toggle ? blockFrames : 0);
+    }
+    pwar_channel_map_inputs(block->samples, PWAR_MAX_CHANNELS, block->n_samples,
+                            dest, inMap, activeInputs, blockFrames);
+    samplePosition += blockFrames;
+
+    if (timeInfoMode) {
+        bufferSwitchX();
+    } else {
+        callbacks->bufferSwitch(toggle, ASIOFalse);
+    }
+
+    latency_manager_start_audio_cbk_end();
+
+    float* outputSamplesCh1 = outputBuffers[0] + (toggle ? blockFrames : 0);
+    float* outputSamplesCh2 = outputBuffers[1] + (toggle ? blockFrames : 0);
+
+    memcpy(output_buffers, outputSamplesCh1, blockFrames * sizeof(float));
+    memcpy(output_buffers + blockFrames, outputSamplesCh2, blockFrames * sizeof(float));
+
+    // Send the result, unless Linux asked for a send-only session
+    if (block->return_channels > 0)
+        pwar_router_send_buffer(&router, block->chunk_size, output_buffers, block->n_samples, PWAR_MAX_CHANNELS, output_packets, 32, &packets_to_send);
+
+    uint64_t timestamp = latency_manager_timestamp_now();
+    // Large blocks leave in paced groups instead of one burst that overflows small switch buffers
+    uint64_t period_ns = static_cast<uint64_t>(block->n_samples * 1e9 / sampleRate);
+    pwar_pacer_begin_block(&pacer, packets_to_send, period_ns, timestamp);
+    for (uint32_t i = 0; i < packets_to_send; ++i) {
+        output_packets[i].seq = block->seq;
+        output_packets[i].seq_timestamp = block->seq_timestamp;
+        output_packets[i].timestamp = timestamp;
+        pwar_pacer_wait(&pacer, i);
+        output(output_packets[i]);
+    }
+    toggle = toggle ? 0 : 1;
+
+    pwar_latency_info_t latency_info;
+    if (latency_manager_time_for_sending_latency_info(&latency_info)) {
+        // Send the latency info over the socket
+        if (udpSendSocket != INVALID_SOCKET) {
+            WSABUF buffer;
+            buffer.buf = reinterpret_cast<CHAR*>(&latency_info);
+            buffer.len = sizeof(latency_info);
+            DWORD bytesSent = 0;
+            int flags = 0;
+            WSASendTo(udpSendSocket, &buffer, 1, &bytesSent, flags,
+                      reinterpret_cast<sockaddr*>(&udpSendAddr), sizeof(udpSendAddr), NULL, NULL);
+        }
+    }
+}
+
 void pwarASIO::startUdpListener() {
     if (!udpListenerRunning) {
         udpListenerRunning = true;
-        udpListenerThread = std::thread(&pwarASIO::udp_packet_listener, this);
+        udpListenerThread = std::thread(&pwarASIO::udp_listener_thread, this);
     }
 }
 
@@ -661,6 +885,18 @@ void pwarASIO::parseConfigFile() {
             if (key == "udp_send_ip") {
                 udpSendIp = value;
                 pwarASIOLog::Send("Read ip from config");
+            } else if (key == "pace_burst") {
+                paceBurst = static_cast<uint32_t>(atoi(value.c_str()));
+                pwarASIOLog::Send("Read pace_burst from config");
+            } else if (key == "pace_spread") {
+                paceSpread = atof(value.c_str());
+                pwarASIOLog::Send("Read pace_spread from config");
+            } else if (key == "redundant_ip") {
+                redundantIp = value;
+                pwarASIOLog::Send("Read redundant_ip from config");
+            } else if (key == "redundant_bind") {
+                redundantBind = value;
+                pwarASIOLog::Send("Read redundant_bind from config");
             }
         }
     }
@@ -696,6 +932,33 @@ void pwarASIO::initUdpSender() {
             pwarASIOLog::Send("Failed to create UDP send socket");
         }
     }
+    if (redundantSocket == INVALID_SOCKET && udpWSAInitialized && !redundantIp.empty()) {
+        redundantSocket = socket(AF_INET, SOCK_DGRAM, 0);
+        if (redundantSocket == INVALID_SOCKET) {
+            pwarASIOLog::Send("Failed to create the redundant path socket");
+            return;
+        }
+        memset(&redundantAddr, 0, sizeof(redundantAddr));
+        redundantAddr.sin_family = AF_INET;
+        redundantAddr.sin_port = htons(udp_port);
+        inet_pton(AF_INET, redundantIp.c_str(), &redundantAddr.sin_addr);
+        if (!redundantBind.empty()) {
+            // Leave through the second NIC, Linux tells the paths apart by the source address
+            sockaddr_in local{};
+            local.sin_family = AF_INET;
+            inet_pton(AF_INET, redundantBind.c_str(), &local.sin_addr);
+            if (bind(redundantSocket, reinterpret_cast<sockaddr*>(&local), sizeof(local)) == SOCKET_ERROR) {
+                pwarASIOLog::Send("Failed to bind the redundant path socket");
+            }
+        }
+        int sndbuf = 1024;
+        setsockopt(redundantSocket, SOL_SOCKET, SO_SNDBUF, (const char*)&sndbuf, sizeof(sndbuf));
+        DWORD bytesReturned = 0;
+        BOOL bNewBehavior = FALSE;
+        WSAIoctl(redundantSocket, SIO_UDP_CONNRESET, &bNewBehavior, sizeof(bNewBehavior),
+                 NULL, 0, &bytesReturned, NULL, NULL);
+        pwarASIOLog::Send("Redundant path enabled.");
+    }
 }
 
 void pwarASIO::closeUdpSender() {
@@ -703,6 +966,10 @@ void pwarASIO::closeUdpSender() {
         closesocket(udpSendSocket);
         udpSendSocket = INVALID_SOCKET;
     }
+    if (redundantSocket != INVALID_SOCKET) {
+        closesocket(redundantSocket);
+        redundantSocket = INVALID_SOCKET;
+    }
     if (udpWSAInitialized) {
         WSACleanup();
         udpWSAInitialized = false;
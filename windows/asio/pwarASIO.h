@@ -13,6 +13,11 @@
 #include <string>
 #include "../../protocol/pwar_packet.h"
 #include "../../protocol/pwar_router.h"
+#include "../../protocol/pwar_spsc_queue.h"
+#include "../../protocol/pwar_session.h"
+#include "../../protocol/pwar_pacer.h"
+#include "../../protocol/pwar_paths.h"
+#include "../../protocol/pwar_retransmit.h"
 
 #include "rpc.h"
 #include "rpcndr.h"
@@ -27,8 +32,30 @@ constexpr int kMinBlockFrames = 64;
 constexpr int kMaxBlockFrames = 2048;
 constexpr int kDefaultBlockFrames = 128;
 constexpr int kBlockFramesGranularity = 64;
-constexpr int kNumInputs = 1;
+constexpr int kNumInputs = PWAR_CHANNELS; // One host input per protocol channel
 constexpr int kNumOutputs = 2;
+constexpr int kNumClientBlocks = 8; // Blocks in flight between the network and the audio thread
+constexpr int kMaxBlockArrivals = 32; // Packet arrivals a block carries to the audio thread's jitter stats
+
+// Network thread access to the client blocks, the queues and the router
+enum pwarListenerState : long {
+    kListenerRunning = 0,
+    kListenerParkRequested = 1, // Finishes the packet at hand, then parks
+    kListenerParked = 2,        // Keeps off them until unparked
+};
+
+// A reassembled block handed from the network thread to the audio thread
+struct pwarClientBlock {
+    uint64_t seq;
+    uint64_t seq_timestamp;
+    uint32_t chunk_size;
+    uint32_t n_samples;
+    uint32_t return_channels; // 0 = send-only session, the host records and nothing goes back
+    float* samples; // PWAR_MAX_CHANNELS * blockFrames, channel-major
+    uint32_t num_arrivals;
+    uint64_t arrival_ns[kMaxBlockArrivals];       // When each packet of the block arrived
+    uint64_t packet_timestamp[kMaxBlockArrivals]; // And when Linux sent it
+};
 
 class pwarASIO : public IASIO, public CUnknown {
 public:
@@ -70,13 +97,22 @@ public:
 private:
     pwar_router_t router;
     void output(const pwar_packet_t& packet);
+    void sendReturn(const pwar_packet_t& packet);
+    static void resendReturn(const pwar_packet_t* packet, void* userdata);
     void bufferSwitchX();
+    void udp_listener_thread();
     void udp_packet_listener();
+    void parkListener();
+    void unparkListener();
+    void audio_processing_thread();
+    void processBlock(pwarClientBlock* block);
     void startUdpListener();
     void stopUdpListener();
     void initUdpSender();
     void closeUdpSender();
     void parseConfigFile();
+    void sendSessionMessage(const pwar_session_msg_t& msg);
+    pwar_session_params_t sessionLocalParams() const;
 
     float *output_buffers;
     float *input_buffers;
@@ -105,10 +141,29 @@ private:
     uint64_t _timestamp = 0;
     std::thread udpListenerThread;
     bool udpListenerRunning = false;
+    std::thread audioThread;
+    bool audioThreadRunning = false;
+    HANDLE blockReadyEvent = nullptr;
+    pwarClientBlock clientBlocks[kNumClientBlocks];
+    volatile long listenerState = kListenerParkRequested; // pwarListenerState, no buffers until createBuffers
+    volatile long listenerExited = 0;
+    pwar_spsc_queue_t freeBlocks;  // audio thread -> network thread
+    pwar_spsc_queue_t readyBlocks; // network thread -> audio thread
+    pwar_session_t session;        // Owned by the network thread
+    volatile long sessionParamsChanged = 0; // Buffer size changed, renegotiate with Linux
     SOCKET udpSendSocket = INVALID_SOCKET;
     bool udpWSAInitialized = false;
     struct sockaddr_in udpSendAddr;
     std::string udpSendIp = "192.168.66.2";
+    SOCKET redundantSocket = INVALID_SOCKET; // Second path, every return is sent over both
+    struct sockaddr_in redundantAddr;
+    std::string redundantIp;    // Linux's address on the second path, empty = single path
+    std::string redundantBind;  // Local address of the second path, empty = any
+    pwar_paths_t paths;         // Incoming copies, owned by the network thread
+    pwar_retransmit_ring_t retransmitRing; // Returns sent by the audio thread, resent by the network thread on a NACK
+    uint32_t paceBurst = 0;  // Segments sent back to back, 0 sends a whole block at once
+    double paceSpread = PWAR_PACER_DEFAULT_SPREAD;
+    pwar_pacer_t pacer;      // Used by the audio thread only
 };
 
 #endif // __PWAR_ASIO_H__